@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Collects small writes (the scene JSON writer emits one per comma) into a
+// fixed buffer and hands them to 'Sink' in Capacity-sized chunks, so an SD
+// file only ever sees whole, aligned multiples of Capacity plus one short
+// tail from flush(). Sink needs size_t write(const uint8_t*, size_t), which
+// Arduino's File already has. Lives on the caller's stack: no allocation.
+//
+// Nothing is written after the first short sink write; check ok() after
+// flush().
+template <typename Sink, size_t Capacity>
+class BufferedWriter {
+public:
+  static_assert(Capacity > 0, "BufferedWriter needs a buffer");
+
+  explicit BufferedWriter(Sink& sink) : sink_(sink) {}
+  ~BufferedWriter() { flush(); }
+
+  BufferedWriter(const BufferedWriter&) = delete;
+  BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+  size_t write(const uint8_t* data, size_t len) {
+    if (!ok_) return 0;
+    size_t remaining = len;
+    while (remaining > 0) {
+      if (fill_ == 0 && remaining >= Capacity) {
+        // whole chunks go straight through; file offsets stay aligned
+        size_t direct = remaining - remaining % Capacity;
+        if (!emit(data, direct)) return len - remaining;
+        data += direct;
+        remaining -= direct;
+        continue;
+      }
+      size_t count = Capacity - fill_;
+      if (count > remaining) count = remaining;
+      memcpy(buffer_ + fill_, data, count);
+      fill_ += count;
+      data += count;
+      remaining -= count;
+      if (fill_ == Capacity) {
+        fill_ = 0;
+        if (!emit(buffer_, Capacity)) return len - remaining;
+      }
+    }
+    return len;
+  }
+
+  size_t write(uint8_t value) { return write(&value, 1); }
+
+  // Writes whatever is buffered. Returns false once any sink write fell short.
+  bool flush() {
+    if (ok_ && fill_ > 0) {
+      size_t count = fill_;
+      fill_ = 0;
+      emit(buffer_, count);
+    }
+    return ok_;
+  }
+
+  bool ok() const { return ok_; }
+  size_t bytesWritten() const { return bytesWritten_; }
+  // sink write calls so far, for comparing against unbuffered output
+  size_t sinkWrites() const { return sinkWrites_; }
+
+private:
+  bool emit(const uint8_t* data, size_t len) {
+    size_t written = sink_.write(data, len);
+    ++sinkWrites_;
+    bytesWritten_ += written;
+    if (written != len) ok_ = false;
+    return ok_;
+  }
+
+  Sink& sink_;
+  uint8_t buffer_[Capacity];
+  size_t fill_ = 0;
+  size_t bytesWritten_ = 0;
+  size_t sinkWrites_ = 0;
+  bool ok_ = true;
+};
@@ -0,0 +1,114 @@
+// Sweeps tempo and delay length and checks every read index the delay
+// lines can produce.
+//
+//   make -C experiments delay_taps && ./experiments/delay_taps
+//
+// Three passes:
+//  - delayTap() at every write index for the delay lengths TempoDelay
+//    computes from BPM x beats x sample rate, and for lengths just under
+//    each whole sample, where a wrapped float position used to round up to
+//    the line length;
+//  - delayTap() for the modulated FDN reverb heads, which read one sample
+//    short of a full line minus up to a few samples of wobble;
+//  - TempoDelay and FdnReverb themselves, built with AddressSanitizer so a
+//    read past a buffer aborts.
+// Exit status is non-zero on the first bad index.
+#include <cmath>
+#include <cstdio>
+
+#include "src/dsp/miniacid_engine.h"
+#include "src/dsp/mini_dsp_utils.h"
+#include "src/dsp/mini_reverb.h"
+
+namespace {
+
+constexpr float kSampleRates[] = {22050.0f, 44100.0f, 48000.0f};
+constexpr float kBeats[] = {0.125f, 0.25f, 1.0f / 3.0f, 0.5f, 0.75f, 1.0f, 1.5f, 2.0f, 3.0f, 4.0f};
+
+bool checkTaps(float delay, int length) {
+  for (int write = 0; write < length; ++write) {
+    DelayTap tap = delayTap(write, delay, length);
+    if (tap.newer < 0 || tap.newer >= length || tap.older < 0 || tap.older >= length || tap.frac < 0.0f ||
+        tap.frac >= 1.0f) {
+      std::printf("delay %.6f on %d: write %d reads %d/%d frac %f\n", delay, length, write, tap.newer, tap.older,
+                  tap.frac);
+      return false;
+    }
+  }
+  return true;
+}
+
+// same length TempoDelay::updateTargetDelay() picks
+float tempoDelay(float sampleRate, float bpm, float beats, int length) {
+  float target = 60.0f / bpm * beats * sampleRate;
+  if (target > static_cast<float>(length - 2)) target = static_cast<float>(length - 2);
+  if (target < 1.0f) target = 1.0f;
+  return target;
+}
+
+} // namespace
+
+int main() {
+  long checked = 0;
+  for (float sampleRate : kSampleRates) {
+    int length = static_cast<int>(sampleRate);
+    for (float bpm = 40.0f; bpm <= 300.0f; bpm += 0.25f) {
+      for (float beats : kBeats) {
+        if (!checkTaps(tempoDelay(sampleRate, bpm, beats, length), length)) return 1;
+        ++checked;
+      }
+    }
+    for (int whole = 1; whole < length - 1; whole += 97) {
+      if (!checkTaps(std::nextafter(static_cast<float>(whole), 0.0f), length)) return 1;
+      if (!checkTaps(static_cast<float>(whole) + 0.000488f, length)) return 1;
+      checked += 2;
+    }
+  }
+  for (int length = 401; length < 3000; length += 37) {
+    for (int wobble = 0; wobble <= 8 * 64; ++wobble) {
+      if (!checkTaps(static_cast<float>(length) - 1.0f - wobble / 64.0f, length)) return 1;
+      ++checked;
+    }
+  }
+  std::printf("delayTap: %ld delay lengths, every write index in range\n", checked);
+
+  TempoDelay delay(22050.0f);
+  delay.setEnabled(true);
+  delay.setMix(1.0f);
+  delay.setFeedback(0.5f);
+  int runs = 0;
+  for (int bpm = 40; bpm <= 240; bpm += 3) {
+    for (float beats : kBeats) {
+      delay.setBpm(static_cast<float>(bpm));
+      delay.setBeats(beats);
+      // a full pass of the line plus the glide
+      for (int i = 0; i < 22050 + 2048; ++i) delay.process(i & 64 ? 0.5f : -0.5f);
+      ++runs;
+    }
+  }
+  std::printf("TempoDelay: %d settings, one pass each\n", runs);
+
+  float input[256];
+  float out[256];
+  float outRight[256];
+  for (int i = 0; i < 256; ++i) input[i] = i & 32 ? 0.5f : -0.5f;
+  runs = 0;
+  for (float sampleRate : kSampleRates) {
+    for (int lines : {4, 8}) {
+      for (bool compact : {false, true}) {
+        FdnReverb reverb(sampleRate);
+        reverb.setLineCount(lines);
+        reverb.setCompactLines(compact);
+        reverb.setModulation(true);
+        reverb.setDecay(3.0f);
+        // a few seconds, so the modulated heads sweep their whole range
+        for (int block = 0; block < static_cast<int>(sampleRate) * 4 / 256; ++block) {
+          reverb.process(input, out, outRight, 256);
+        }
+        ++runs;
+      }
+    }
+  }
+  std::printf("FdnReverb: %d configurations, 4 s each\n", runs);
+  return 0;
+}
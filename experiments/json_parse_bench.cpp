@@ -0,0 +1,373 @@
+// Evented JSON parser throughput, in MB/s of scene JSON.
+//
+//   make -C experiments json_bench && ./experiments/json_bench
+//
+// Runs the same filled scene through:
+//   legacy   the std::function-per-character parser this replaced, kept
+//            below verbatim apart from the observer's string types
+//   memory   JsonParser over JsonMemorySource (keys are views into the input)
+//   stream   JsonParser over JsonStreamSource, reading one char at a time
+//            from the stream the way a plain read() source does
+//   scene    SceneManager::loadScene, the memory row plus applying the scene
+//   arduino  SceneManager::loadSceneJson, the ArduinoJson fallback
+// The first three feed SceneJsonObserver; 'arduino' also applies the
+// scene, so it is an upper bound for that path. The 'raw' rows repeat
+// legacy and memory with an observer that does nothing, which separates
+// tokenizing cost from SceneJsonObserver's key matching. Heap allocations
+// per run are counted through the global operator new.
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <utility>
+
+#include "scenes.h"
+
+namespace {
+std::atomic<size_t> g_allocations{0};
+} // namespace
+
+void* operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+constexpr int kIterations = 500;
+
+namespace legacy {
+using NextChar = std::function<int()>;
+
+class CharStream {
+public:
+  explicit CharStream(NextChar nextChar) : nextChar_(std::move(nextChar)) {}
+
+  bool get(char& c) {
+    if (hasBuffered_) {
+      hasBuffered_ = false;
+      c = buffered_;
+      return true;
+    }
+    int value = nextChar_();
+    if (value < 0) return false;
+    c = static_cast<char>(value);
+    return true;
+  }
+
+  bool peek(char& c) {
+    if (hasBuffered_) {
+      c = buffered_;
+      return true;
+    }
+    int value = nextChar_();
+    if (value < 0) return false;
+    buffered_ = static_cast<char>(value);
+    hasBuffered_ = true;
+    c = buffered_;
+    return true;
+  }
+
+  void skipWhitespace() {
+    char c;
+    while (peek(c)) {
+      if (!std::isspace(static_cast<unsigned char>(c))) break;
+      hasBuffered_ = false;
+    }
+  }
+
+private:
+  NextChar nextChar_;
+  char buffered_ = 0;
+  bool hasBuffered_ = false;
+};
+
+bool parseValue(CharStream& stream, JsonObserver& observer);
+
+bool parseLiteral(CharStream& stream, const char* literal) {
+  for (const char* ptr = literal; *ptr; ++ptr) {
+    char c;
+    if (!stream.get(c) || c != *ptr) return false;
+  }
+  return true;
+}
+
+bool parseString(CharStream& stream, std::string& out) {
+  out.clear();
+  char c;
+  while (stream.get(c)) {
+    if (c == '"') return true;
+    if (c == '\\') {
+      char esc;
+      if (!stream.get(esc)) return false;
+      switch (esc) {
+      case '"': out.push_back('"'); break;
+      case '\\': out.push_back('\\'); break;
+      case '/': out.push_back('/'); break;
+      case 'b': out.push_back('\b'); break;
+      case 'f': out.push_back('\f'); break;
+      case 'n': out.push_back('\n'); break;
+      case 'r': out.push_back('\r'); break;
+      case 't': out.push_back('\t'); break;
+      case 'u': {
+        // Minimal \uXXXX handling: consume four hex digits and skip unicode conversion.
+        for (int i = 0; i < 4; ++i) {
+          if (!stream.get(esc) || !std::isxdigit(static_cast<unsigned char>(esc))) return false;
+        }
+        out.push_back('?');
+        break;
+      }
+      default:
+        return false;
+      }
+    } else {
+      out.push_back(c);
+    }
+  }
+  return false;
+}
+
+bool parseNumber(CharStream& stream, JsonObserver& observer, char firstChar) {
+  std::string numStr;
+  numStr.push_back(firstChar);
+  char c;
+  while (stream.peek(c)) {
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+      stream.get(c);
+      numStr.push_back(c);
+    } else {
+      break;
+    }
+  }
+
+  bool isFloat = (numStr.find('.') != std::string::npos) || (numStr.find('e') != std::string::npos) ||
+                 (numStr.find('E') != std::string::npos);
+  const char* start = numStr.c_str();
+  char* endPtr = nullptr;
+  if (isFloat) {
+    double value = std::strtod(start, &endPtr);
+    if (endPtr != start + static_cast<int>(numStr.size())) return false;
+    observer.onNumber(value);
+  } else {
+    long long value = std::strtoll(start, &endPtr, 10);
+    if (endPtr != start + static_cast<int>(numStr.size())) return false;
+    observer.onNumber(static_cast<int>(value));
+  }
+  return true;
+}
+
+bool parseArray(CharStream& stream, JsonObserver& observer) {
+  observer.onArrayStart();
+  stream.skipWhitespace();
+  char c;
+  if (stream.peek(c) && c == ']') {
+    stream.get(c);
+    observer.onArrayEnd();
+    return true;
+  }
+
+  while (true) {
+    observer.onObjectValueStart();
+    if (!parseValue(stream, observer)) return false;
+    observer.onObjectValueEnd();
+    stream.skipWhitespace();
+    if (!stream.get(c)) return false;
+    if (c == ']') {
+      observer.onArrayEnd();
+      return true;
+    }
+    if (c != ',') return false;
+    stream.skipWhitespace();
+  }
+}
+
+bool parseObject(CharStream& stream, JsonObserver& observer) {
+  observer.onObjectStart();
+  stream.skipWhitespace();
+  char c;
+  if (stream.peek(c) && c == '}') {
+    stream.get(c);
+    observer.onObjectEnd();
+    return true;
+  }
+
+  while (true) {
+    if (!stream.get(c) || c != '"') return false;
+    std::string key;
+    if (!parseString(stream, key)) return false;
+    observer.onObjectKey(JsonStringView(key.data(), key.size()));
+    stream.skipWhitespace();
+    if (!stream.get(c) || c != ':') return false;
+    stream.skipWhitespace();
+    observer.onObjectValueStart();
+    if (!parseValue(stream, observer)) return false;
+    observer.onObjectValueEnd();
+    stream.skipWhitespace();
+    if (!stream.get(c)) return false;
+    if (c == '}') {
+      observer.onObjectEnd();
+      return true;
+    }
+    if (c != ',') return false;
+    stream.skipWhitespace();
+  }
+}
+
+bool parseValue(CharStream& stream, JsonObserver& observer) {
+  stream.skipWhitespace();
+  char c;
+  if (!stream.get(c)) return false;
+  switch (c) {
+  case '{':
+    return parseObject(stream, observer);
+  case '[':
+    return parseArray(stream, observer);
+  case '"': {
+    std::string value;
+    if (!parseString(stream, value)) return false;
+    observer.onString(JsonStringView(value.data(), value.size()));
+    return true;
+  }
+  case 't':
+    if (!parseLiteral(stream, "rue")) return false;
+    observer.onBool(true);
+    return true;
+  case 'f':
+    if (!parseLiteral(stream, "alse")) return false;
+    observer.onBool(false);
+    return true;
+  case 'n':
+    if (!parseLiteral(stream, "ull")) return false;
+    observer.onNull();
+    return true;
+  default:
+    if (c == '-' || std::isdigit(static_cast<unsigned char>(c))) {
+      return parseNumber(stream, observer, c);
+    }
+    return false;
+  }
+}
+
+bool parse(const std::string& input, JsonObserver& observer) {
+  size_t idx = 0;
+  NextChar nextChar = [&input, &idx]() -> int {
+    if (idx >= input.size()) return -1;
+    return static_cast<unsigned char>(input[idx++]);
+  };
+  CharStream stream(std::move(nextChar));
+  if (!parseValue(stream, observer)) return false;
+  stream.skipWhitespace();
+  char extra;
+  return !stream.peek(extra);
+}
+} // namespace legacy
+
+class NullObserver final : public JsonObserver {
+public:
+  void onObjectStart() override {}
+  void onObjectEnd() override {}
+  void onArrayStart() override {}
+  void onArrayEnd() override {}
+  void onNumber(int) override {}
+  void onNumber(double) override {}
+  void onBool(bool) override {}
+  void onNull() override {}
+  void onString(JsonStringView) override {}
+  void onObjectKey(JsonStringView) override {}
+  void onObjectValueStart() override {}
+  void onObjectValueEnd() override {}
+};
+
+struct StringReader {
+  const std::string& text;
+  size_t pos = 0;
+  int read() { return pos < text.size() ? static_cast<unsigned char>(text[pos++]) : -1; }
+};
+
+void fillScene(SceneManager& manager) {
+  manager.loadDefaultScene();
+  unsigned seed = 777;
+  auto next = [&seed]() {
+    seed = seed * 1103515245u + 12345u;
+    return static_cast<int>((seed >> 16) & 0x7FFF);
+  };
+  for (int p = 0; p < Bank<DrumPatternSet>::kPatterns; ++p) {
+    DrumPatternSet& set = manager.editDrumPatternSet(p);
+    for (int v = 0; v < DrumPatternSet::kVoices; ++v) {
+      for (int s = 0; s < DrumPattern::kSteps; ++s) {
+        set.voices[v].steps[s].hit = next() % 3 == 0;
+        set.voices[v].steps[s].timing = static_cast<int8_t>(next() % 11 - 5);
+      }
+    }
+    for (int synth = 0; synth < 2; ++synth) {
+      SynthPattern& pattern = manager.editSynthPattern(synth, p);
+      for (int s = 0; s < SynthPattern::kSteps; ++s) {
+        pattern.steps[s].note = next() % 4 == 0 ? -1 : 36 + next() % 24;
+        pattern.steps[s].slide = next() % 4 == 0;
+      }
+    }
+  }
+}
+
+template <typename Fn>
+void report(const char* name, size_t bytes, Fn&& fn) {
+  bool ok = true;
+  size_t allocationsBefore = g_allocations.load();
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < kIterations; ++i) ok = fn() && ok;
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+  double allocations = static_cast<double>(g_allocations.load() - allocationsBefore) / kIterations;
+  double perCall = elapsed.count() / kIterations;
+  std::printf("%-10s %9.1f us %9.1f MB/s %9.1f allocs%s\n", name, perCall * 1e6, bytes / perCall / 1e6, allocations,
+              ok ? "" : "  (parse failed)");
+}
+
+} // namespace
+
+int main() {
+  SceneManager source;
+  fillScene(source);
+  std::string json = source.dumpCurrentScene();
+  std::printf("scene JSON: %zu bytes\n", json.size());
+
+  Scene scene{};
+  report("legacy", json.size(), [&]() {
+    SceneJsonObserver observer(scene);
+    return legacy::parse(json, observer) && !observer.hadError();
+  });
+  report("memory", json.size(), [&]() {
+    SceneJsonObserver observer(scene);
+    JsonMemorySource input(json.data(), json.size());
+    return parseJson(input, observer) && !observer.hadError();
+  });
+  report("stream", json.size(), [&]() {
+    SceneJsonObserver observer(scene);
+    StringReader reader{json};
+    JsonStreamSource<StringReader> input(reader);
+    return parseJson(input, observer) && !observer.hadError();
+  });
+  NullObserver null;
+  report("legacy/raw", json.size(), [&]() { return legacy::parse(json, null); });
+  report("memory/raw", json.size(), [&]() {
+    JsonMemorySource input(json.data(), json.size());
+    return parseJson(input, null);
+  });
+  SceneManager target;
+  report("scene", json.size(), [&]() { return target.loadScene(json); });
+  report("arduino", json.size(), [&]() { return target.loadSceneJson(json); });
+  return 0;
+}
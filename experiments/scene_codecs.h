@@ -0,0 +1,251 @@
+// Shared by scene_roundtrip and scene_fuzz: the scene save/load paths as a
+// table, a seeded random scene generator and a field-by-field comparison.
+// A new format goes into kCodecs and both tools pick it up.
+#pragma once
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "scenes.h"
+
+namespace scene_codecs {
+
+// Hands a buffer to loadSceneEvented() in chunks, the way a file does.
+struct MemoryReader {
+  const char* data;
+  size_t size;
+  size_t pos = 0;
+  size_t read(uint8_t* out, size_t len) {
+    size_t count = size - pos < len ? size - pos : len;
+    std::memcpy(out, data + pos, count);
+    pos += count;
+    return count;
+  }
+};
+
+struct Codec {
+  const char* name;
+  // relative error allowed on float fields; JSON prints six digits
+  float floatTolerance;
+  bool (*save)(const SceneManager& scene, std::string& out);
+  bool (*load)(SceneManager& scene, const std::string& in);
+};
+
+inline bool saveJson(const SceneManager& scene, std::string& out) {
+  out.clear();
+  return scene.writeSceneJson(out);
+}
+
+inline bool loadEvented(SceneManager& scene, const std::string& in) {
+  MemoryReader reader{in.data(), in.size()};
+  return scene.loadSceneEvented(reader);
+}
+
+inline bool loadArduinoJson(SceneManager& scene, const std::string& in) { return scene.loadSceneJson(in); }
+
+inline bool saveBinary(const SceneManager& scene, std::string& out) {
+  uint8_t buffer[SceneManager::kSceneBinaryMaxSize];
+  size_t size = scene.writeSceneBinary(buffer, sizeof(buffer));
+  out.assign(reinterpret_cast<const char*>(buffer), size);
+  return size > 0;
+}
+
+inline bool loadBinary(SceneManager& scene, const std::string& in) {
+  return scene.loadSceneBinary(reinterpret_cast<const uint8_t*>(in.data()), in.size());
+}
+
+constexpr Codec kCodecs[] = {
+    {"evented", 1e-5f, saveJson, loadEvented},
+    {"arduino", 1e-5f, saveJson, loadArduinoJson},
+    {"binary", 0.0f, saveBinary, loadBinary},
+};
+constexpr int kCodecCount = sizeof(kCodecs) / sizeof(kCodecs[0]);
+
+// Every field gets a random value in the range the loaders accept, with the
+// ends of each range weighted up since that is where formats disagree.
+inline void randomScene(SceneManager& manager, uint32_t seed) {
+  manager.loadDefaultScene();
+  uint32_t state = seed * 2654435761u + 1;
+  auto next = [&state]() {
+    state = state * 1103515245u + 12345u;
+    return static_cast<int>((state >> 16) & 0x7FFF);
+  };
+  auto range = [&next](int lo, int hi) {
+    int pick = next() % 8;
+    if (pick == 0) return lo;
+    if (pick == 1) return hi;
+    return lo + next() % (hi - lo + 1);
+  };
+  auto real = [&next](float lo, float hi) {
+    int pick = next() % 8;
+    if (pick == 0) return lo;
+    if (pick == 1) return hi;
+    return lo + (hi - lo) * static_cast<float>(next()) / 32767.0f;
+  };
+
+  Scene& scene = manager.currentScene();
+  for (int p = 0; p < Bank<DrumPatternSet>::kPatterns; ++p) {
+    for (int v = 0; v < DrumPatternSet::kVoices; ++v) {
+      DrumPattern& pattern = scene.drumBank.patterns[p].voices[v];
+      for (int s = 0; s < DrumPattern::kSteps; ++s) {
+        pattern.steps[s].hit = next() % 3 == 0;
+        pattern.steps[s].accent = next() % 4 == 0;
+        pattern.steps[s].timing = static_cast<int8_t>(next() % 2 ? 0 : range(-kMaxStepTiming, kMaxStepTiming));
+      }
+      pattern.swing = static_cast<int8_t>(range(0, kMaxStepSwing));
+    }
+    for (int synth = 0; synth < 2; ++synth) {
+      SynthPattern& pattern = synth == 0 ? scene.synthABank.patterns[p] : scene.synthBBank.patterns[p];
+      for (int s = 0; s < SynthPattern::kSteps; ++s) {
+        pattern.steps[s].note = next() % 4 == 0 ? -1 : range(0, 127);
+        pattern.steps[s].slide = next() % 4 == 0;
+        pattern.steps[s].accent = next() % 3 == 0;
+        pattern.steps[s].timing = static_cast<int8_t>(next() % 2 ? 0 : range(-kMaxStepTiming, kMaxStepTiming));
+      }
+      pattern.swing = static_cast<int8_t>(range(0, kMaxStepSwing));
+    }
+  }
+
+  Song& song = manager.editSong();
+  song.length = range(1, Song::kMaxPositions);
+  for (int pos = 0; pos < song.length; ++pos) {
+    for (int t = 0; t < SongPosition::kTrackCount; ++t) {
+      song.positions[pos].patterns[t] = static_cast<int8_t>(range(-1, SceneManager::kSongPatternCount - 1));
+    }
+  }
+  // a trailing empty row would be trimmed on load
+  song.positions[song.length - 1].patterns[next() % SongPosition::kTrackCount] =
+      static_cast<int8_t>(range(0, SceneManager::kSongPatternCount - 1));
+
+  manager.setCurrentDrumBank(range(0, SceneManager::kBankCount - 1), scene.drumBank);
+  manager.setCurrentSynthBank(0, range(0, SceneManager::kBankCount - 1), scene.synthABank);
+  manager.setCurrentSynthBank(1, range(0, SceneManager::kBankCount - 1), scene.synthBBank);
+  manager.setCurrentDrumPatternIndex(range(0, Bank<DrumPatternSet>::kPatterns - 1));
+  manager.setCurrentSynthPatternIndex(0, range(0, Bank<SynthPattern>::kPatterns - 1));
+  manager.setCurrentSynthPatternIndex(1, range(0, Bank<SynthPattern>::kPatterns - 1));
+  for (int v = 0; v < DrumPatternSet::kVoices; ++v) manager.setDrumMute(v, next() % 4 == 0);
+  manager.setSynthMute(0, next() % 4 == 0);
+  manager.setSynthMute(1, next() % 4 == 0);
+  for (int synth = 0; synth < 2; ++synth) {
+    SynthParameters params;
+    params.cutoff = real(60.0f, 8000.0f);
+    params.resonance = real(0.0f, 1.2f);
+    params.envAmount = real(0.0f, 2000.0f);
+    params.envDecay = real(20.0f, 2000.0f);
+    params.oscType = range(0, 2);
+    manager.setSynthParameters(synth, params);
+  }
+  manager.setBpm(real(40.0f, 200.0f));
+  manager.setSongPosition(range(0, song.length - 1));
+  manager.setSongMode(next() % 2 == 0);
+}
+
+// Compares everything a scene file carries. On a mismatch 'why' names the
+// first differing field.
+class SceneDiff {
+public:
+  explicit SceneDiff(float floatTolerance) : tolerance_(floatTolerance) {}
+
+  bool compare(const SceneManager& a, const SceneManager& b) {
+    why_[0] = '\0';
+    const Scene& x = a.currentScene();
+    const Scene& y = b.currentScene();
+    for (int p = 0; p < Bank<DrumPatternSet>::kPatterns; ++p) {
+      for (int v = 0; v < DrumPatternSet::kVoices; ++v) {
+        const DrumPattern& dx = x.drumBank.patterns[p].voices[v];
+        const DrumPattern& dy = y.drumBank.patterns[p].voices[v];
+        for (int s = 0; s < DrumPattern::kSteps; ++s) {
+          if (!same(dx.steps[s].hit, dy.steps[s].hit, "drum[%d].voice[%d].step[%d].hit", p, v, s)) return false;
+          if (!same(dx.steps[s].accent, dy.steps[s].accent, "drum[%d].voice[%d].step[%d].accent", p, v, s))
+            return false;
+          if (!same(dx.steps[s].timing, dy.steps[s].timing, "drum[%d].voice[%d].step[%d].timing", p, v, s))
+            return false;
+        }
+        if (!same(dx.swing, dy.swing, "drum[%d].voice[%d].swing", p, v)) return false;
+      }
+      for (int synth = 0; synth < 2; ++synth) {
+        const SynthPattern& sx = synth == 0 ? x.synthABank.patterns[p] : x.synthBBank.patterns[p];
+        const SynthPattern& sy = synth == 0 ? y.synthABank.patterns[p] : y.synthBBank.patterns[p];
+        for (int s = 0; s < SynthPattern::kSteps; ++s) {
+          if (!same(sx.steps[s].note, sy.steps[s].note, "synth%d[%d].step[%d].note", synth, p, s)) return false;
+          if (!same(sx.steps[s].slide, sy.steps[s].slide, "synth%d[%d].step[%d].slide", synth, p, s)) return false;
+          if (!same(sx.steps[s].accent, sy.steps[s].accent, "synth%d[%d].step[%d].accent", synth, p, s))
+            return false;
+          if (!same(sx.steps[s].timing, sy.steps[s].timing, "synth%d[%d].step[%d].timing", synth, p, s))
+            return false;
+        }
+        if (!same(sx.swing, sy.swing, "synth%d[%d].swing", synth, p)) return false;
+      }
+    }
+
+    if (!same(x.song.length, y.song.length, "song.length")) return false;
+    for (int pos = 0; pos < x.song.length; ++pos) {
+      for (int t = 0; t < SongPosition::kTrackCount; ++t) {
+        if (!same(x.song.positions[pos].patterns[t], y.song.positions[pos].patterns[t], "song[%d].track[%d]", pos, t))
+          return false;
+      }
+    }
+
+    if (!same(a.getCurrentDrumPatternIndex(), b.getCurrentDrumPatternIndex(), "drumPatternIndex")) return false;
+    if (!same(a.getCurrentBankIndex(0), b.getCurrentBankIndex(0), "drumBankIndex")) return false;
+    for (int v = 0; v < DrumPatternSet::kVoices; ++v) {
+      if (!same(a.getDrumMute(v), b.getDrumMute(v), "drumMute[%d]", v)) return false;
+    }
+    for (int synth = 0; synth < 2; ++synth) {
+      if (!same(a.getCurrentSynthPatternIndex(synth), b.getCurrentSynthPatternIndex(synth), "synth%d.patternIndex",
+                synth))
+        return false;
+      if (!same(a.getCurrentBankIndex(synth + 1), b.getCurrentBankIndex(synth + 1), "synth%d.bankIndex", synth))
+        return false;
+      if (!same(a.getSynthMute(synth), b.getSynthMute(synth), "synth%d.mute", synth)) return false;
+      const SynthParameters& px = a.getSynthParameters(synth);
+      const SynthParameters& py = b.getSynthParameters(synth);
+      if (!close(px.cutoff, py.cutoff, "synth%d.cutoff", synth)) return false;
+      if (!close(px.resonance, py.resonance, "synth%d.resonance", synth)) return false;
+      if (!close(px.envAmount, py.envAmount, "synth%d.envAmount", synth)) return false;
+      if (!close(px.envDecay, py.envDecay, "synth%d.envDecay", synth)) return false;
+      if (!same(px.oscType, py.oscType, "synth%d.oscType", synth)) return false;
+    }
+    if (!close(a.getBpm(), b.getBpm(), "bpm")) return false;
+    if (!same(a.getSongPosition(), b.getSongPosition(), "songPosition")) return false;
+    if (!same(a.songMode(), b.songMode(), "songMode")) return false;
+    return true;
+  }
+
+  const char* why() const { return why_; }
+
+private:
+  void describe(const char* format, va_list args, double x, double y) {
+    int used = std::vsnprintf(why_, sizeof(why_), format, args);
+    if (used < 0 || used >= static_cast<int>(sizeof(why_))) return;
+    std::snprintf(why_ + used, sizeof(why_) - used, ": %g vs %g", x, y);
+  }
+
+  bool same(int x, int y, const char* format, ...) {
+    if (x == y) return true;
+    va_list args;
+    va_start(args, format);
+    describe(format, args, x, y);
+    va_end(args);
+    return false;
+  }
+
+  bool close(float x, float y, const char* format, ...) {
+    float scale = std::fabs(x) > 1.0f ? std::fabs(x) : 1.0f;
+    if (x == y || std::fabs(x - y) <= tolerance_ * scale) return true;
+    va_list args;
+    va_start(args, format);
+    describe(format, args, x, y);
+    va_end(args);
+    return false;
+  }
+
+  float tolerance_;
+  char why_[96];
+};
+
+} // namespace scene_codecs
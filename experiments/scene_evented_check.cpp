@@ -0,0 +1,151 @@
+// Checks the evented scene loader against the ArduinoJson one and counts
+// its heap allocations.
+//
+//   make -C experiments scene_evented_check && ./experiments/scene_evented_check [scenes] [seed]
+//
+// Each random scene (default 1000) is saved as JSON and fed to both
+// loaders as is, re-indented with extra whitespace, with one byte changed
+// and cut short. Clean and re-indented text has to load through both and
+// give the same scenes, floats within a few ulp; for the damaged copies
+// the scenes only have to match when both loaders accept them. Evented
+// loads of the clean and re-indented text, from memory (loadScene) and
+// from a chunked reader (loadSceneEvented), have to make no heap
+// allocations, counted through the global operator new. A damaged file can
+// turn into a string longer than the parser's inline scratch space, which
+// is allowed to spill. Exit status is non-zero on the first failure.
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "scene_codecs.h"
+
+namespace {
+std::atomic<size_t> g_allocations{0};
+} // namespace
+
+void* operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+
+enum class Damage { None, Whitespace, Byte, Cut };
+constexpr Damage kDamages[] = {Damage::None, Damage::Whitespace, Damage::Byte, Damage::Cut};
+constexpr const char* kDamageNames[] = {"clean", "spaced", "byte", "cut"};
+
+struct Random {
+  uint32_t state;
+  uint32_t next() {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+  }
+  size_t below(size_t n) { return n ? next() % n : 0; }
+};
+
+void damage(const std::string& json, Damage kind, Random& random, std::string& out) {
+  out = json;
+  switch (kind) {
+  case Damage::None: break;
+  case Damage::Whitespace: {
+    static const char kSpace[] = " \t\r\n";
+    out.clear();
+    for (char c : json) {
+      out.push_back(c);
+      if (c == ',' || c == ':' || c == '{' || c == '[') {
+        for (size_t n = random.below(3); n > 0; --n) out.push_back(kSpace[random.below(4)]);
+      }
+    }
+    break;
+  }
+  case Damage::Byte: out[random.below(out.size())] = static_cast<char>(random.below(256)); break;
+  case Damage::Cut: out.resize(random.below(out.size())); break;
+  }
+}
+
+struct Tally {
+  int loads = 0;
+  int agreed = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+  int scenes = argc > 1 ? std::atoi(argv[1]) : 1000;
+  uint32_t seed = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1;
+
+  SceneManager original;
+  SceneManager evented;
+  SceneManager streamed;
+  SceneManager dom;
+  // both parse the same digits, but ArduinoJson's float conversion can
+  // land an ulp or two away from strtof's
+  scene_codecs::SceneDiff diff(1e-6f);
+  Random random{seed};
+  std::string json;
+  std::string input;
+  json.reserve(SceneManager::kSceneBinaryMaxSize * 4);
+  input.reserve(SceneManager::kSceneBinaryMaxSize * 8);
+  Tally tally[sizeof(kDamages) / sizeof(kDamages[0])];
+
+  for (int i = 0; i < scenes; ++i) {
+    scene_codecs::randomScene(original, seed + i);
+    scene_codecs::saveJson(original, json);
+    for (int d = 0; d < static_cast<int>(sizeof(kDamages) / sizeof(kDamages[0])); ++d) {
+      damage(json, kDamages[d], random, input);
+      evented.loadDefaultScene();
+      streamed.loadDefaultScene();
+      dom.loadDefaultScene();
+
+      scene_codecs::MemoryReader reader{input.data(), input.size()};
+      size_t before = g_allocations.load();
+      bool streamedOk = streamed.loadSceneEvented(reader);
+      size_t streamAllocations = g_allocations.load() - before;
+      before = g_allocations.load();
+      bool eventedOk = evented.loadScene(input);
+      size_t memoryAllocations = g_allocations.load() - before;
+      bool domOk = dom.loadSceneJson(input);
+
+      ++tally[d].loads;
+      if (kDamages[d] == Damage::None || kDamages[d] == Damage::Whitespace) {
+        if (streamAllocations != 0 || memoryAllocations != 0) {
+          std::printf("seed %u %s: evented load allocated %zu (stream) / %zu (memory) times\n",
+                      static_cast<unsigned>(seed + i), kDamageNames[d], streamAllocations, memoryAllocations);
+          return 1;
+        }
+        if (!streamedOk || !eventedOk || !domOk) {
+          std::printf("seed %u %s: rejected by %s\n", static_cast<unsigned>(seed + i), kDamageNames[d],
+                      streamedOk && eventedOk ? "arduino" : "evented");
+          return 1;
+        }
+      }
+      if (!streamedOk || !domOk) continue;
+      // loadScene() falls back to ArduinoJson, so only the stream result
+      // says the evented parser took the input on its own
+      if (!diff.compare(streamed, dom) || !diff.compare(evented, dom)) {
+        std::printf("seed %u %s: evented and arduino scenes differ at %s\n", static_cast<unsigned>(seed + i),
+                    kDamageNames[d], diff.why());
+        return 1;
+      }
+      ++tally[d].agreed;
+    }
+  }
+
+  for (int d = 0; d < static_cast<int>(sizeof(kDamages) / sizeof(kDamages[0])); ++d) {
+    std::printf("%-7s %6d loads, %6d accepted by both and matching\n", kDamageNames[d], tally[d].loads,
+                tally[d].agreed);
+  }
+  std::printf("evented loads of clean and spaced files: no heap allocations\n");
+  return 0;
+}
@@ -0,0 +1,170 @@
+// Scene save/load cost, JSON vs the binary container.
+//
+//   make -C experiments scene_bench && ./experiments/scene_bench [dir]
+//
+// Fills every pattern, then times serialization alone and a full round
+// trip through a file in 'dir' (default: current directory). Point 'dir'
+// at a mounted SD card to get card numbers on desktop; on the Cardputer the
+// storage layer prints the same timings over serial.
+//
+// The JSON export is timed twice with stdio buffering off, so every write
+// call reaches the file the way it reaches the SD driver: once chunk by
+// chunk as writeSceneJson emits it, once through BufferedWriter.
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "buffered_writer.h"
+#include "scenes.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+constexpr int kIterations = 200;
+
+void fillScene(SceneManager& manager) {
+  manager.loadDefaultScene();
+  unsigned seed = 12345;
+  auto next = [&seed]() {
+    seed = seed * 1103515245u + 12345u;
+    return static_cast<int>((seed >> 16) & 0x7FFF);
+  };
+  for (int p = 0; p < Bank<DrumPatternSet>::kPatterns; ++p) {
+    DrumPatternSet& set = manager.editDrumPatternSet(p);
+    for (int v = 0; v < DrumPatternSet::kVoices; ++v) {
+      for (int s = 0; s < DrumPattern::kSteps; ++s) {
+        set.voices[v].steps[s].hit = next() % 3 == 0;
+        set.voices[v].steps[s].accent = next() % 5 == 0;
+        set.voices[v].steps[s].timing = static_cast<int8_t>(next() % 11 - 5);
+      }
+    }
+    for (int synth = 0; synth < 2; ++synth) {
+      SynthPattern& pattern = manager.editSynthPattern(synth, p);
+      for (int s = 0; s < SynthPattern::kSteps; ++s) {
+        pattern.steps[s].note = next() % 4 == 0 ? -1 : 36 + next() % 24;
+        pattern.steps[s].slide = next() % 4 == 0;
+        pattern.steps[s].accent = next() % 3 == 0;
+      }
+    }
+  }
+  for (int pos = 0; pos < 32; ++pos) {
+    manager.setSongPattern(pos, SongTrack::SynthA, pos % 8);
+    manager.setSongPattern(pos, SongTrack::SynthB, (pos + 3) % 8);
+    manager.setSongPattern(pos, SongTrack::Drums, (pos / 2) % 8);
+  }
+}
+
+template <typename Fn>
+double microsPerCall(Fn&& fn) {
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < kIterations; ++i) fn();
+  std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+  return elapsed.count() / kIterations;
+}
+
+struct CountingSink {
+  std::FILE* file;
+  size_t writes = 0;
+  size_t write(const uint8_t* data, size_t len) {
+    ++writes;
+    return std::fwrite(data, 1, len, file);
+  }
+};
+
+struct FileReader {
+  std::FILE* file;
+  int read() { return std::fgetc(file); }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::string dir = argc > 1 ? argv[1] : ".";
+  std::string jsonPath = dir + "/scene_bench.json";
+  std::string binaryPath = dir + "/scene_bench.mas";
+
+  SceneManager source;
+  fillScene(source);
+  SceneManager target;
+
+  std::string json;
+  uint8_t binary[SceneManager::kSceneBinaryMaxSize];
+  size_t binarySize = 0;
+
+  double jsonSave = microsPerCall([&]() {
+    json.clear();
+    source.writeSceneJson(json);
+  });
+  double jsonLoad = microsPerCall([&]() { target.loadScene(json); });
+  double binarySave = microsPerCall([&]() { binarySize = source.writeSceneBinary(binary, sizeof(binary)); });
+  double binaryLoad = microsPerCall([&]() { target.loadSceneBinary(binary, binarySize); });
+
+  // file round trips, the way the storage classes do them
+  double jsonFileSave = microsPerCall([&]() {
+    std::FILE* file = std::fopen(jsonPath.c_str(), "wb");
+    if (!file) return;
+    std::string out;
+    source.writeSceneJson(out);
+    std::fwrite(out.data(), 1, out.size(), file);
+    std::fclose(file);
+  });
+  size_t rawWrites = 0;
+  double jsonRawSave = microsPerCall([&]() {
+    std::FILE* file = std::fopen(jsonPath.c_str(), "wb");
+    if (!file) return;
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    CountingSink sink{file};
+    source.writeSceneJson(sink);
+    std::fclose(file);
+    rawWrites = sink.writes;
+  });
+  size_t bufferedWrites = 0;
+  double jsonBufferedSave = microsPerCall([&]() {
+    std::FILE* file = std::fopen(jsonPath.c_str(), "wb");
+    if (!file) return;
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    CountingSink sink{file};
+    {
+      BufferedWriter<CountingSink, 4096> writer(sink);
+      source.writeSceneJson(writer);
+    }
+    std::fclose(file);
+    bufferedWrites = sink.writes;
+  });
+  double jsonFileLoad = microsPerCall([&]() {
+    std::FILE* file = std::fopen(jsonPath.c_str(), "rb");
+    if (!file) return;
+    FileReader reader{file};
+    target.loadSceneEvented(reader);
+    std::fclose(file);
+  });
+  double binaryFileSave = microsPerCall([&]() {
+    std::FILE* file = std::fopen(binaryPath.c_str(), "wb");
+    if (!file) return;
+    size_t size = source.writeSceneBinary(binary, sizeof(binary));
+    std::fwrite(binary, 1, size, file);
+    std::fclose(file);
+  });
+  double binaryFileLoad = microsPerCall([&]() {
+    std::FILE* file = std::fopen(binaryPath.c_str(), "rb");
+    if (!file) return;
+    uint8_t buffer[SceneManager::kSceneBinaryMaxSize];
+    size_t size = std::fread(buffer, 1, sizeof(buffer), file);
+    std::fclose(file);
+    target.loadSceneBinary(buffer, size);
+  });
+
+  std::string roundTrip;
+  target.writeSceneJson(roundTrip);
+  std::printf("round trip %s\n", roundTrip == json ? "matches" : "DIFFERS");
+  std::printf("%-8s %8s %12s %12s %12s %12s\n", "format", "bytes", "save us", "load us", "file save", "file load");
+  std::printf("%-8s %8zu %12.1f %12.1f %12.1f %12.1f\n", "json", json.size(), jsonSave, jsonLoad, jsonFileSave,
+              jsonFileLoad);
+  std::printf("%-8s %8zu %12.1f %12.1f %12.1f %12.1f\n", "binary", binarySize, binarySave, binaryLoad,
+              binaryFileSave, binaryFileLoad);
+  std::printf("json export, unbuffered file: %zu writes, %.1f us\n", rawWrites, jsonRawSave);
+  std::printf("json export, BufferedWriter: %zu writes, %.1f us\n", bufferedWrites, jsonBufferedSave);
+  std::remove(jsonPath.c_str());
+  std::remove(binaryPath.c_str());
+  return 0;
+}
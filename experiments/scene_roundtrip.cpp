@@ -0,0 +1,114 @@
+// Round trips random scenes through every save/load path and checks they
+// agree, then reports each path's throughput.
+//
+//   make -C experiments scene_roundtrip && ./experiments/scene_roundtrip [scenes] [seed]
+//
+// Each scene (default 500) is saved and loaded back through every entry in
+// scene_codecs.h: the JSON writer read by the evented parser, the same JSON
+// read by ArduinoJson, and the binary container. The reloaded scene has to
+// match the original field by field, and saving it again has to give the
+// same bytes. The first mismatch per path is printed and the exit status is
+// non-zero if there was any.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "scene_codecs.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using scene_codecs::Codec;
+using scene_codecs::kCodecCount;
+using scene_codecs::kCodecs;
+
+constexpr int kTimedScenes = 16;
+constexpr int kTimedRounds = 50;
+
+struct Timing {
+  size_t bytes = 0;
+  double saveMicros = 0;
+  double loadMicros = 0;
+};
+
+template <typename Fn>
+double micros(Fn&& fn) {
+  Clock::time_point start = Clock::now();
+  fn();
+  std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+  return elapsed.count();
+}
+
+// number of scenes that did not survive the trip
+int check(const Codec& codec, int scenes, uint32_t seed) {
+  SceneManager original;
+  SceneManager loaded;
+  scene_codecs::SceneDiff diff(codec.floatTolerance);
+  std::string first;
+  std::string second;
+  int failures = 0;
+  for (int i = 0; i < scenes; ++i) {
+    scene_codecs::randomScene(original, seed + i);
+    const char* problem = nullptr;
+    if (!codec.save(original, first)) {
+      problem = "save failed";
+    } else if (!codec.load(loaded, first)) {
+      problem = "load failed";
+    } else if (!diff.compare(original, loaded)) {
+      problem = diff.why();
+    } else if (!codec.save(loaded, second) || second != first) {
+      problem = "saving the loaded scene gives different bytes";
+    }
+    if (!problem) continue;
+    if (failures++ == 0) std::printf("%-8s seed %u: %s\n", codec.name, static_cast<unsigned>(seed + i), problem);
+  }
+  return failures;
+}
+
+Timing time(const Codec& codec, uint32_t seed) {
+  SceneManager scenes[kTimedScenes];
+  std::string saved[kTimedScenes];
+  for (int i = 0; i < kTimedScenes; ++i) scene_codecs::randomScene(scenes[i], seed + i);
+  SceneManager target;
+  Timing timing;
+  double save = micros([&]() {
+    for (int round = 0; round < kTimedRounds; ++round) {
+      for (int i = 0; i < kTimedScenes; ++i) codec.save(scenes[i], saved[i]);
+    }
+  });
+  double load = micros([&]() {
+    for (int round = 0; round < kTimedRounds; ++round) {
+      for (int i = 0; i < kTimedScenes; ++i) codec.load(target, saved[i]);
+    }
+  });
+  for (int i = 0; i < kTimedScenes; ++i) timing.bytes += saved[i].size();
+  timing.bytes /= kTimedScenes;
+  timing.saveMicros = save / (kTimedRounds * kTimedScenes);
+  timing.loadMicros = load / (kTimedRounds * kTimedScenes);
+  return timing;
+}
+
+double megabytesPerSecond(size_t bytes, double micros) { return micros > 0 ? bytes / micros : 0; }
+
+} // namespace
+
+int main(int argc, char** argv) {
+  int scenes = argc > 1 ? std::atoi(argv[1]) : 500;
+  uint32_t seed = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1;
+
+  int failed = 0;
+  for (int c = 0; c < kCodecCount; ++c) {
+    int failures = check(kCodecs[c], scenes, seed);
+    std::printf("%-8s %d/%d scenes round trip\n", kCodecs[c].name, scenes - failures, scenes);
+    if (failures) ++failed;
+  }
+
+  std::printf("%-8s %8s %10s %10s %10s %10s\n", "path", "bytes", "save us", "save MB/s", "load us", "load MB/s");
+  for (int c = 0; c < kCodecCount; ++c) {
+    Timing t = time(kCodecs[c], seed);
+    std::printf("%-8s %8zu %10.1f %10.1f %10.1f %10.1f\n", kCodecs[c].name, t.bytes, t.saveMicros,
+                megabytesPerSecond(t.bytes, t.saveMicros), t.loadMicros, megabytesPerSecond(t.bytes, t.loadMicros));
+  }
+  return failed ? 1 : 0;
+}
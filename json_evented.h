@@ -1,7 +1,37 @@
 #pragma once
 
-#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
 #include <string>
+#include <type_traits>
+#include <utility>
+
+// Non-owning key or string value handed to observers. It points into the
+// input when parsing memory and into the parser's scratch space otherwise,
+// so it stays valid until the next string of the same kind (key or value)
+// or, for memory sources, for as long as the input does.
+class JsonStringView {
+public:
+  JsonStringView() = default;
+  JsonStringView(const char* data, size_t size) : data_(data), size_(size) {}
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  std::string str() const { return std::string(data_, size_); }
+
+  bool operator==(const char* other) const {
+    size_t len = std::strlen(other);
+    return len == size_ && std::memcmp(data_, other, len) == 0;
+  }
+  bool operator!=(const char* other) const { return !(*this == other); }
+
+private:
+  const char* data_ = "";
+  size_t size_ = 0;
+};
 
 class JsonObserver {
 public:
@@ -14,26 +44,355 @@ public:
   virtual void onNumber(double value) = 0;
   virtual void onBool(bool value) = 0;
   virtual void onNull() = 0;
-  virtual void onString(const std::string& value) = 0;
-  virtual void onObjectKey(const std::string& key) = 0;
+  virtual void onString(JsonStringView value) = 0;
+  virtual void onObjectKey(JsonStringView key) = 0;
   virtual void onObjectValueStart() = 0;
   virtual void onObjectValueEnd() = 0;
 };
 
-class JsonVisitor {
+// Input over memory that outlives the parse. Strings without escapes come
+// back as views straight into it.
+class JsonMemorySource {
+public:
+  static constexpr bool kStableSpans = true;
+
+  JsonMemorySource(const char* data, size_t size) : pos_(data), end_(data + size) {}
+
+  int get() { return pos_ < end_ ? static_cast<unsigned char>(*pos_++) : -1; }
+  int peek() const { return pos_ < end_ ? static_cast<unsigned char>(*pos_) : -1; }
+  // Unread input that can be scanned in place.
+  const char* span(size_t& available) {
+    available = static_cast<size_t>(end_ - pos_);
+    return pos_;
+  }
+  void advance(size_t count) { pos_ += count; }
+
+private:
+  const char* pos_;
+  const char* end_;
+};
+
+namespace json_detail {
+template <typename Stream>
+auto readChunkImpl(Stream& stream, uint8_t* buffer, size_t size, int)
+    -> decltype(stream.read(buffer, size), size_t()) {
+  auto count = stream.read(buffer, size);
+  return count > 0 ? static_cast<size_t>(count) : 0;
+}
+
+template <typename Stream>
+size_t readChunkImpl(Stream& stream, uint8_t* buffer, size_t size, ...) {
+  size_t count = 0;
+  while (count < size) {
+    int c = stream.read();
+    if (c < 0) break;
+    buffer[count++] = static_cast<uint8_t>(c);
+  }
+  return count;
+}
+} // namespace json_detail
+
+// Input pulled from a stream Capacity bytes at a time: block reads when the
+// stream has read(uint8_t*, size_t) (Arduino File does), int read()
+// otherwise. Strings are copied into scratch space, since the chunk they
+// sit in is reused.
+template <typename Stream, size_t Capacity = 256>
+class JsonStreamSource {
+public:
+  static constexpr bool kStableSpans = false;
+
+  explicit JsonStreamSource(Stream& stream) : stream_(stream) {}
+
+  int get() {
+    if (pos_ == fill_ && !refill()) return -1;
+    return buffer_[pos_++];
+  }
+  int peek() {
+    if (pos_ == fill_ && !refill()) return -1;
+    return buffer_[pos_];
+  }
+  const char* span(size_t& available) {
+    if (pos_ == fill_) refill();
+    available = fill_ - pos_;
+    return reinterpret_cast<const char*>(buffer_ + pos_);
+  }
+  void advance(size_t count) { pos_ += count; }
+
+private:
+  bool refill() {
+    pos_ = 0;
+    fill_ = json_detail::readChunkImpl(stream_, buffer_, Capacity, 0);
+    return fill_ > 0;
+  }
+
+  Stream& stream_;
+  uint8_t buffer_[Capacity];
+  size_t pos_ = 0;
+  size_t fill_ = 0;
+};
+
+// Decoded string storage for the parser. Anything up to kInline bytes (all
+// keys and values in a scene file) stays in the fixed buffer, so parsing
+// does not touch the heap; longer strings spill into a std::string.
+class JsonScratch {
+public:
+  static constexpr size_t kInline = 48;
+
+  void clear() {
+    size_ = 0;
+    spilled_ = false;
+  }
+  void append(const char* data, size_t len) {
+    if (!spilled_ && size_ + len <= kInline) {
+      std::memcpy(inline_ + size_, data, len);
+      size_ += len;
+      return;
+    }
+    if (!spilled_) {
+      overflow_.assign(inline_, size_);
+      spilled_ = true;
+    }
+    overflow_.append(data, len);
+  }
+  void push_back(char c) { append(&c, 1); }
+  JsonStringView view() const {
+    return spilled_ ? JsonStringView(overflow_.data(), overflow_.size()) : JsonStringView(inline_, size_);
+  }
+
+private:
+  char inline_[kInline];
+  size_t size_ = 0;
+  bool spilled_ = false;
+  std::string overflow_;
+};
+
+// Recursive-descent parser templated on its input and observer, so the
+// per-character path is inlined and, with a final observer class, the
+// callbacks are direct calls.
+template <typename Source, typename Observer>
+class JsonParser {
 public:
-  using NextChar = std::function<int()>;
+  JsonParser(Source& source, Observer& observer) : source_(source), observer_(observer) {}
+
+  bool parse() {
+    if (!parseValue()) return false;
+    skipWhitespace();
+    return source_.peek() < 0;
+  }
+
+private:
+  static bool isWhitespace(int c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f'; }
+  static bool isDigit(int c) { return c >= '0' && c <= '9'; }
+
+  void skipWhitespace() {
+    while (isWhitespace(source_.peek())) source_.advance(1);
+  }
+
+  bool parseLiteral(const char* rest) {
+    for (const char* ptr = rest; *ptr; ++ptr) {
+      if (source_.get() != static_cast<unsigned char>(*ptr)) return false;
+    }
+    return true;
+  }
+
+  static bool isHexDigit(int c) {
+    return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+  }
+
+  // The opening quote is already consumed.
+  bool parseString(JsonScratch& scratch, JsonStringView& out) {
+    scratch.clear();
+    bool copied = false;
+    while (true) {
+      size_t available = 0;
+      const char* start = source_.span(available);
+      if (available == 0) return false;
+      const char* end = start + available;
+      const char* stop = start;
+      while (stop < end && *stop != '"' && *stop != '\\') ++stop;
+      size_t plain = static_cast<size_t>(stop - start);
+      if (stop < end && *stop == '"' && Source::kStableSpans && !copied) {
+        out = JsonStringView(start, plain);
+        source_.advance(plain + 1);
+        return true;
+      }
+      scratch.append(start, plain);
+      copied = true;
+      source_.advance(plain);
+      if (stop == end) continue;
+
+      if (source_.get() == '"') {
+        out = scratch.view();
+        return true;
+      }
+      int esc = source_.get();
+      switch (esc) {
+      case '"': scratch.push_back('"'); break;
+      case '\\': scratch.push_back('\\'); break;
+      case '/': scratch.push_back('/'); break;
+      case 'b': scratch.push_back('\b'); break;
+      case 'f': scratch.push_back('\f'); break;
+      case 'n': scratch.push_back('\n'); break;
+      case 'r': scratch.push_back('\r'); break;
+      case 't': scratch.push_back('\t'); break;
+      case 'u':
+        // Minimal \uXXXX handling: consume four hex digits and skip unicode conversion.
+        for (int i = 0; i < 4; ++i) {
+          if (!isHexDigit(source_.get())) return false;
+        }
+        scratch.push_back('?');
+        break;
+      default:
+        return false;
+      }
+    }
+  }
 
+  bool parseNumber(int firstChar) {
+    char text[64];
+    size_t len = 0;
+    text[len++] = static_cast<char>(firstChar);
+    bool isFloat = false;
+    bool digitsOnly = true;
+    while (true) {
+      int c = source_.peek();
+      if (c == '.' || c == 'e' || c == 'E') {
+        isFloat = true;
+      } else if (c == '+' || c == '-') {
+        digitsOnly = false;
+      } else if (!isDigit(c)) {
+        break;
+      }
+      if (len + 1 >= sizeof(text)) return false;
+      text[len++] = static_cast<char>(c);
+      source_.advance(1);
+    }
+    text[len] = '\0';
+
+    if (!isFloat) {
+      // the scene files are almost all small integers: skip strtoll
+      size_t i = text[0] == '-' ? 1 : 0;
+      if (!digitsOnly || i == len || len - i > 18) return false;
+      long long value = 0;
+      for (; i < len; ++i) value = value * 10 + (text[i] - '0');
+      if (text[0] == '-') value = -value;
+      observer_.onNumber(static_cast<int>(value));
+      return true;
+    }
+    char* endPtr = nullptr;
+    double value = std::strtod(text, &endPtr);
+    if (endPtr != text + len) return false;
+    observer_.onNumber(value);
+    return true;
+  }
+
+  bool parseArray() {
+    observer_.onArrayStart();
+    skipWhitespace();
+    if (source_.peek() == ']') {
+      source_.advance(1);
+      observer_.onArrayEnd();
+      return true;
+    }
+
+    while (true) {
+      observer_.onObjectValueStart();
+      if (!parseValue()) return false;
+      observer_.onObjectValueEnd();
+      skipWhitespace();
+      int c = source_.get();
+      if (c == ']') {
+        observer_.onArrayEnd();
+        return true;
+      }
+      if (c != ',') return false;
+      skipWhitespace();
+    }
+  }
+
+  bool parseObject() {
+    observer_.onObjectStart();
+    skipWhitespace();
+    if (source_.peek() == '}') {
+      source_.advance(1);
+      observer_.onObjectEnd();
+      return true;
+    }
+
+    while (true) {
+      if (source_.get() != '"') return false;
+      JsonStringView key;
+      if (!parseString(keyScratch_, key)) return false;
+      observer_.onObjectKey(key);
+      skipWhitespace();
+      if (source_.get() != ':') return false;
+      skipWhitespace();
+      observer_.onObjectValueStart();
+      if (!parseValue()) return false;
+      observer_.onObjectValueEnd();
+      skipWhitespace();
+      int c = source_.get();
+      if (c == '}') {
+        observer_.onObjectEnd();
+        return true;
+      }
+      if (c != ',') return false;
+      skipWhitespace();
+    }
+  }
+
+  bool parseValue() {
+    skipWhitespace();
+    int c = source_.get();
+    switch (c) {
+    case '{':
+      return parseObject();
+    case '[':
+      return parseArray();
+    case '"': {
+      JsonStringView value;
+      if (!parseString(valueScratch_, value)) return false;
+      observer_.onString(value);
+      return true;
+    }
+    case 't':
+      if (!parseLiteral("rue")) return false;
+      observer_.onBool(true);
+      return true;
+    case 'f':
+      if (!parseLiteral("alse")) return false;
+      observer_.onBool(false);
+      return true;
+    case 'n':
+      if (!parseLiteral("ull")) return false;
+      observer_.onNull();
+      return true;
+    default:
+      if (c == '-' || isDigit(c)) return parseNumber(c);
+      return false;
+    }
+  }
+
+  Source& source_;
+  Observer& observer_;
+  JsonScratch keyScratch_;
+  JsonScratch valueScratch_;
+};
+
+template <typename Source, typename Observer>
+bool parseJson(Source& source, Observer& observer) {
+  JsonParser<Source, Observer> parser(source, observer);
+  return parser.parse();
+}
+
+class JsonVisitor {
+public:
   bool parse(const std::string& input, JsonObserver& observer);
+  bool parse(const char* data, size_t size, JsonObserver& observer);
 
   template <typename Stream>
   bool parse(Stream& stream, JsonObserver& observer) {
-    auto nextChar = [&stream]() -> int {
-      return stream.read();
-    };
-    return parseImpl(nextChar, observer);
+    JsonStreamSource<Stream> source(stream);
+    return parseJson(source, observer);
   }
-
-private:
-  bool parseImpl(NextChar nextChar, JsonObserver& observer);
 };
@@ -10,16 +10,27 @@
 #include "src/ui/miniacid_display.h"
 #include "miniacid_encoder8.h"
 #include "scene_storage_cardputer.h"
+#include "recording_storage_cardputer.h"
+#include "sd_recorder.h"
+#include "scene_autosave.h"
+#include "scene_cache.h"
+#include "scene_bank_pager.h"
 
 static constexpr IGfxColor CP_BLACK = IGfxColor::Black();
 
 CardputerDisplay g_display;
 MiniAcidDisplay* g_miniDisplay = nullptr;
 SceneStorageCardputer g_sceneStorage;
+RecordingStorageCardputer g_recordingStorage;
+SdRecorder g_sdRecorder(&g_recordingStorage);
+SceneAutosave g_sceneAutosave(&g_sceneStorage);
+SceneCache g_sceneCache(&g_sceneStorage);
+SceneBankPager g_bankPager(&g_sceneStorage);
 
-int16_t g_audioBuffer[AUDIO_BUFFER_SAMPLES];
+int16_t g_audioBuffer[AUDIO_BUFFER_SAMPLES * AUDIO_CHANNELS];
 
 TaskHandle_t g_audioTaskHandle = nullptr;
+TaskHandle_t g_sdWriterTaskHandle = nullptr;
 
 MiniAcid g_miniAcid(SAMPLE_RATE, &g_sceneStorage);
 Encoder8Miniacid g_encoder8(g_miniAcid);
@@ -36,12 +47,41 @@ void audioTask(void *param) {
     }
 
     g_miniAcid.generateAudioBuffer(g_audioBuffer, AUDIO_BUFFER_SAMPLES);
+    g_sdRecorder.push(g_audioBuffer, AUDIO_BUFFER_SAMPLES);
 
-    M5Cardputer.Speaker.playRaw(g_audioBuffer, AUDIO_BUFFER_SAMPLES,
-                                SAMPLE_RATE, false);
+    M5Cardputer.Speaker.playRaw(g_audioBuffer, AUDIO_BUFFER_SAMPLES * AUDIO_CHANNELS,
+                                SAMPLE_RATE, AUDIO_CHANNELS == 2);
   }
 }
 
+// Drains recorded blocks and scene saves to the card and prefetches scenes
+// from it. Runs below the UI so SD latency never holds up audio or input.
+void sdWriterTask(void *param) {
+  while (true) {
+    bool wasRecording = g_sdRecorder.isRecording();
+    size_t written = g_sdRecorder.pump();
+    if (g_sceneAutosave.pump(millis())) ++written;
+    if (g_sceneCache.pump()) ++written;
+    if (g_bankPager.pump()) ++written;
+    if (wasRecording && !g_sdRecorder.isRecording()) {
+      SdRecorderStats st = g_sdRecorder.stats();
+      Serial.printf("Recording saved: %s (%u blocks, peak queue %u/%u%s, dropped %u buffers / %u frames, %u write errors)\n",
+                    g_sdRecorder.filename().c_str(), st.blocksWritten, st.queueHighWater, st.blockCount,
+                    st.inPsram ? " PSRAM" : "", st.droppedBlocks, st.droppedFrames, st.writeErrors);
+    }
+    if (written == 0) vTaskDelay(20 / portTICK_PERIOD_MS);
+  }
+}
+
+void toggleSdRecording() {
+  if (g_sdRecorder.isRecording()) {
+    g_sdRecorder.stop();
+  } else if (g_sdRecorder.start(SAMPLE_RATE, AUDIO_CHANNELS)) {
+    Serial.printf("Recording to %s\n", g_sdRecorder.filename().c_str());
+  } else {
+    Serial.println("Failed to start SD recording");
+  }
+}
 
 void drawUI() {
   if (g_miniDisplay) g_miniDisplay->update();
@@ -61,6 +101,9 @@ void setup() {
   M5Cardputer.Speaker.setVolume(200); // 0-255
 
   g_miniAcid.init();
+  g_miniAcid.setSceneAutosave(&g_sceneAutosave);
+  g_miniAcid.setSceneCache(&g_sceneCache);
+  g_miniAcid.setBankPager(&g_bankPager);
   g_miniDisplay = new MiniAcidDisplay(g_display, g_miniAcid);
 
   xTaskCreatePinnedToCore(audioTask, "AudioTask",
@@ -71,6 +114,14 @@ void setup() {
                           1 // core
   );
 
+  xTaskCreatePinnedToCore(sdWriterTask, "SdWriter",
+                          8192, // stack: scene saves build the binary image on it
+                          nullptr,
+                          1, // priority
+                          &g_sdWriterTaskHandle,
+                          0 // core
+  );
+
   g_encoder8.initialize();
 
   drawUI();
@@ -199,6 +250,10 @@ void loop() {
     }
 
     for (auto inputChar : ks.word) {
+      if (ks.ctrl && (inputChar == 'r' || inputChar == 'R')) {
+        toggleSdRecording();
+        continue;
+      }
       UIEvent evt{};
       evt.alt = ks.alt;
       evt.key = inputChar;
@@ -0,0 +1,60 @@
+#include "recording_storage_sdl.h"
+
+#ifndef __EMSCRIPTEN__
+#include <filesystem>
+#endif
+
+RecordingStorageSdl::~RecordingStorageSdl() {
+  close();
+}
+
+std::string RecordingStorageSdl::pathFor(const std::string& name) const {
+  std::string path = kRootDir;
+  if (name.empty() || name.front() != '/') path += "/";
+  path += name;
+  return path;
+}
+
+bool RecordingStorageSdl::initializeStorage() {
+#ifndef __EMSCRIPTEN__
+  std::error_code ec;
+  std::filesystem::create_directories(kRootDir, ec);
+  return !ec;
+#else
+  return false;
+#endif
+}
+
+bool RecordingStorageSdl::exists(const std::string& name) const {
+  std::FILE* file = std::fopen(pathFor(name).c_str(), "rb");
+  if (!file) return false;
+  std::fclose(file);
+  return true;
+}
+
+bool RecordingStorageSdl::open(const std::string& name) {
+  close();
+  if (!initializeStorage()) return false;
+  file_ = std::fopen(pathFor(name).c_str(), "wb");
+  return file_ != nullptr;
+}
+
+size_t RecordingStorageSdl::write(const uint8_t* data, size_t bytes) {
+  if (!file_) return 0;
+  return std::fwrite(data, 1, bytes, file_);
+}
+
+bool RecordingStorageSdl::writeAt(uint32_t offset, const uint8_t* data, size_t bytes) {
+  if (!file_) return false;
+  long end = std::ftell(file_);
+  bool ok = std::fseek(file_, static_cast<long>(offset), SEEK_SET) == 0 &&
+            std::fwrite(data, 1, bytes, file_) == bytes;
+  std::fseek(file_, end, SEEK_SET);
+  return ok;
+}
+
+void RecordingStorageSdl::close() {
+  if (!file_) return;
+  std::fclose(file_);
+  file_ = nullptr;
+}
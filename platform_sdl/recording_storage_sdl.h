@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include "../recording_storage.h"
+
+// File-backed stand-in for the Cardputer's SD card: recordings land in
+// ./sdcard/, so SdRecorder can be exercised on desktop.
+class RecordingStorageSdl : public RecordingStorage {
+public:
+  ~RecordingStorageSdl() override;
+  bool initializeStorage() override;
+  bool exists(const std::string& name) const override;
+  bool open(const std::string& name) override;
+  size_t write(const uint8_t* data, size_t bytes) override;
+  bool writeAt(uint32_t offset, const uint8_t* data, size_t bytes) override;
+  void close() override;
+
+private:
+  static constexpr const char* kRootDir = "sdcard";
+
+  std::string pathFor(const std::string& name) const;
+
+  std::FILE* file_ = nullptr;
+};
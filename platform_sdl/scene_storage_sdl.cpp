@@ -1,5 +1,6 @@
 #include "scene_storage_sdl.h"
 
+#include <cstdio>
 #include <fstream>
 #include <iterator>
 #include <sstream>
@@ -8,8 +9,24 @@
 #include <filesystem>
 #endif
 
+#include "buffered_writer.h"
 #include "scenes.h"
 
+#ifndef __EMSCRIPTEN__
+namespace {
+
+// stdio sink for BufferedWriter; the stream's own buffer is switched off so
+// every chunk reaches the file as one write, as it would on the card
+struct StdioSink {
+  std::FILE* file;
+  size_t write(const uint8_t* data, size_t len) { return std::fwrite(data, 1, len, file); }
+};
+
+constexpr size_t kJsonWriteChunk = 4096;
+
+} // namespace
+#endif
+
 #ifdef __EMSCRIPTEN__
 #include <emscripten/emscripten.h>
 
@@ -105,12 +122,24 @@ std::string SceneStorageSdl::normalizeSceneName(const std::string& name) const {
   return cleaned;
 }
 
-std::string SceneStorageSdl::sceneFilePath() const {
-  std::string path = normalizeSceneName(currentSceneName_);
+std::string SceneStorageSdl::sceneFilePath(const std::string& name) const {
+  std::string path = normalizeSceneName(name);
   path += kSceneExtension;
   return path;
 }
 
+std::string SceneStorageSdl::binarySceneFilePath(const std::string& name) const {
+  std::string path = normalizeSceneName(name);
+  path += kBinarySceneExtension;
+  return path;
+}
+
+std::string SceneStorageSdl::bankFilePath(const std::string& name) const {
+  std::string path = normalizeSceneName(name);
+  path += kBankExtension;
+  return path;
+}
+
 void SceneStorageSdl::loadStoredSceneName() {
 #ifdef __EMSCRIPTEN__
   int length = wasm_read_current_scene_name(nullptr, 0);
@@ -150,8 +179,12 @@ std::string SceneStorageSdl::sceneKeyForStorage(const std::string& name) const {
 }
 
 bool SceneStorageSdl::readScene(std::string& out) {
+  return readSceneText(currentSceneName_, out);
+}
+
+bool SceneStorageSdl::readSceneText(const std::string& name, std::string& out) const {
 #ifdef __EMSCRIPTEN__
-  std::string key = sceneKeyForStorage(currentSceneName_);
+  std::string key = sceneKeyForStorage(normalizeSceneName(name));
   int length = wasm_read_scene(key.c_str(), nullptr, 0);
   if (length <= 0) return false;
   std::string buffer;
@@ -162,7 +195,7 @@ bool SceneStorageSdl::readScene(std::string& out) {
   out = buffer;
   return true;
 #else
-  std::ifstream file(sceneFilePath(), std::ios::in);
+  std::ifstream file(sceneFilePath(name), std::ios::in);
   if (!file.is_open()) return false;
 
   out.assign((std::istreambuf_iterator<char>(file)),
@@ -172,25 +205,180 @@ bool SceneStorageSdl::readScene(std::string& out) {
 }
 
 bool SceneStorageSdl::writeScene(const SceneManager& manager) {
+  persistCurrentSceneName();
+  return writeSceneNamed(currentSceneName_, manager);
+}
+
+bool SceneStorageSdl::writeSceneNamed(const std::string& name, const SceneManager& manager) {
+#ifdef __EMSCRIPTEN__
+  // localStorage holds text, so the web build keeps JSON
   std::string out;
   bool ok = manager.writeSceneJson(out);
   if (!ok) return false;
-  return writeScene(out);
+  return writeSceneText(name, out);
+#else
+  uint8_t buffer[SceneManager::kSceneBinaryMaxSize];
+  size_t size = manager.writeSceneBinary(buffer, sizeof(buffer));
+  if (size == 0) return false;
+  if (patchBinaryScene(name, manager, buffer, size)) return true;
+  // written whole to a temporary file and renamed over the scene, so a
+  // write cut short never replaces it
+  std::string path = binarySceneFilePath(name);
+  std::string temp = path + ".tmp";
+  std::FILE* file = std::fopen(temp.c_str(), "wb");
+  if (!file) return false;
+  bool ok = std::fwrite(buffer, 1, size, file) == size;
+  ok = std::fclose(file) == 0 && ok;
+  std::error_code ec;
+  if (ok) std::filesystem::rename(temp, path, ec);
+  if (!ok || ec) std::filesystem::remove(temp, ec);
+  return ok && !ec;
+#endif
+}
+
+bool SceneStorageSdl::patchBinaryScene(const std::string& name, const SceneManager& manager, const uint8_t* image,
+                                       size_t size) {
+#ifdef __EMSCRIPTEN__
+  (void)name;
+  (void)manager;
+  (void)image;
+  (void)size;
+  return false;
+#else
+  // the saved file only needs the sections that changed since it was written
+  SceneManager::BinaryRange ranges[SceneManager::kMaxBinaryRanges];
+  size_t rangeCount = manager.dirtyBinaryRanges(ranges, SceneManager::kMaxBinaryRanges);
+  if (rangeCount == 0) return false;
+  std::FILE* file = std::fopen(binarySceneFilePath(name).c_str(), "r+b");
+  if (!file) return false;
+  bool ok = std::fseek(file, 0, SEEK_END) == 0 && std::ftell(file) == static_cast<long>(size);
+  for (size_t i = 0; i < rangeCount && ok; ++i) {
+    ok = std::fseek(file, ranges[i].offset, SEEK_SET) == 0 &&
+         std::fwrite(image + ranges[i].offset, 1, ranges[i].size, file) == ranges[i].size;
+  }
+  return std::fclose(file) == 0 && ok;
+#endif
+}
+
+bool SceneStorageSdl::exportSceneJson(const SceneManager& manager) {
+  return exportSceneJsonNamed(currentSceneName_, manager);
+}
+
+bool SceneStorageSdl::exportSceneJsonNamed(const std::string& name, const SceneManager& manager) {
+#ifdef __EMSCRIPTEN__
+  return writeSceneNamed(name, manager);
+#else
+  std::FILE* file = std::fopen(sceneFilePath(name).c_str(), "wb");
+  if (!file) return false;
+  std::setvbuf(file, nullptr, _IONBF, 0);
+  StdioSink sink{file};
+  BufferedWriter<StdioSink, kJsonWriteChunk> writer(sink);
+  bool ok = manager.writeSceneJson(writer);
+  ok = writer.flush() && ok;
+  return std::fclose(file) == 0 && ok;
+#endif
+}
+
+// localStorage holds text, so the web build has no bank files: scenes there
+// keep to the banks they hold.
+bool SceneStorageSdl::readSceneBanks(const std::string& name, size_t offset, uint8_t* out, size_t size) {
+#ifdef __EMSCRIPTEN__
+  (void)name;
+  (void)offset;
+  (void)out;
+  (void)size;
+  return false;
+#else
+  std::memset(out, 0, size);
+  std::FILE* file = std::fopen(bankFilePath(name).c_str(), "rb");
+  if (!file) return true;
+  bool ok = std::fseek(file, static_cast<long>(offset), SEEK_SET) == 0;
+  if (ok) {
+    std::fread(out, 1, size, file);
+    ok = !std::ferror(file);
+  }
+  std::fclose(file);
+  return ok;
+#endif
+}
+
+bool SceneStorageSdl::writeSceneBanks(const std::string& name, size_t offset, const uint8_t* data, size_t size) {
+#ifdef __EMSCRIPTEN__
+  (void)name;
+  (void)offset;
+  (void)data;
+  (void)size;
+  return false;
+#else
+  std::string path = bankFilePath(name);
+  std::FILE* file = std::fopen(path.c_str(), "r+b");
+  if (!file) file = std::fopen(path.c_str(), "w+b");
+  if (!file) return false;
+  // seeking past the end leaves zeros in between once written
+  bool ok = std::fseek(file, static_cast<long>(offset), SEEK_SET) == 0 &&
+            std::fwrite(data, 1, size, file) == size;
+  return std::fclose(file) == 0 && ok;
+#endif
+}
+
+bool SceneStorageSdl::copySceneBanks(const std::string& from, const std::string& to) {
+#ifdef __EMSCRIPTEN__
+  (void)from;
+  (void)to;
+  return false;
+#else
+  namespace fs = std::filesystem;
+  fs::path source = bankFilePath(from);
+  fs::path target = bankFilePath(to);
+  if (source == target) return true;
+  std::error_code ec;
+  if (!fs::exists(source, ec)) return removeSceneBanks(to);
+  return fs::copy_file(source, target, fs::copy_options::overwrite_existing, ec) && !ec;
+#endif
+}
+
+bool SceneStorageSdl::removeSceneBanks(const std::string& name) {
+#ifdef __EMSCRIPTEN__
+  (void)name;
+  return false;
+#else
+  std::error_code ec;
+  std::filesystem::remove(bankFilePath(name), ec);
+  return !ec;
+#endif
 }
 
 bool SceneStorageSdl::readScene(SceneManager& manager) {
+  return readSceneNamed(currentSceneName_, manager);
+}
+
+bool SceneStorageSdl::readSceneNamed(const std::string& name, SceneManager& manager) {
+#ifndef __EMSCRIPTEN__
+  std::FILE* file = std::fopen(binarySceneFilePath(name).c_str(), "rb");
+  if (file) {
+    uint8_t buffer[SceneManager::kSceneBinaryMaxSize];
+    size_t size = std::fread(buffer, 1, sizeof(buffer), file);
+    std::fclose(file);
+    if (manager.loadSceneBinary(buffer, size)) return true;
+  }
+#endif
+  // scenes saved before the binary format, or imported as JSON
   std::string serialized;
-  if (!readScene(serialized)) return false;
+  if (!readSceneText(name, serialized)) return false;
   return manager.loadScene(serialized);
 }
 
 bool SceneStorageSdl::writeScene(const std::string& data) {
   persistCurrentSceneName();
+  return writeSceneText(currentSceneName_, data);
+}
+
+bool SceneStorageSdl::writeSceneText(const std::string& name, const std::string& data) {
 #ifdef __EMSCRIPTEN__
-  std::string key = sceneKeyForStorage(currentSceneName_);
+  std::string key = sceneKeyForStorage(normalizeSceneName(name));
   return wasm_write_scene(key.c_str(), data.c_str()) > 0;
 #else
-  std::ofstream file(sceneFilePath(), std::ios::out | std::ios::trunc);
+  std::ofstream file(sceneFilePath(name), std::ios::out | std::ios::trunc);
   if (!file.is_open()) return false;
   file << data;
   return file.good();
@@ -208,7 +396,7 @@ std::vector<std::string> SceneStorageSdl::findSceneNamesOnDisk() const {
     if (ec) break;
     if (!entry.is_regular_file()) continue;
     const fs::path& path = entry.path();
-    if (path.extension() == kSceneExtension) {
+    if (path.extension() == kSceneExtension || path.extension() == kBinarySceneExtension) {
       names.push_back(path.stem().string());
     }
   }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
 #include <vector>
 #include "../scene_storage.h"
@@ -10,7 +12,15 @@ public:
   bool readScene(std::string& out) override;
   bool writeScene(const std::string& data) override;
   bool writeScene(const SceneManager& manager) override;
+  bool writeSceneNamed(const std::string& name, const SceneManager& manager) override;
   bool readScene(SceneManager& manager) override;
+  bool readSceneNamed(const std::string& name, SceneManager& manager) override;
+  bool exportSceneJson(const SceneManager& manager) override;
+  bool exportSceneJsonNamed(const std::string& name, const SceneManager& manager) override;
+  bool readSceneBanks(const std::string& name, size_t offset, uint8_t* out, size_t size) override;
+  bool writeSceneBanks(const std::string& name, size_t offset, const uint8_t* data, size_t size) override;
+  bool copySceneBanks(const std::string& from, const std::string& to) override;
+  bool removeSceneBanks(const std::string& name) override;
   void initializeStorage() override;
   std::vector<std::string> getAvailableSceneNames() const override;
   std::string getCurrentSceneName() const override;
@@ -20,9 +30,16 @@ private:
   static constexpr const char* kDefaultSceneName = "miniacid_scene";
   static constexpr const char* kSceneNameFile = "miniacid_scene_name.txt";
   static constexpr const char* kSceneExtension = ".json";
+  static constexpr const char* kBinarySceneExtension = ".mas";
+  static constexpr const char* kBankExtension = ".mab";
 
   std::string normalizeSceneName(const std::string& name) const;
-  std::string sceneFilePath() const;
+  std::string bankFilePath(const std::string& name) const;
+  std::string sceneFilePath(const std::string& name) const;
+  std::string binarySceneFilePath(const std::string& name) const;
+  bool readSceneText(const std::string& name, std::string& out) const;
+  bool writeSceneText(const std::string& name, const std::string& data);
+  bool patchBinaryScene(const std::string& name, const SceneManager& manager, const uint8_t* image, size_t size);
   void loadStoredSceneName();
   bool persistCurrentSceneName() const;
   std::vector<std::string> findSceneNamesOnDisk() const;
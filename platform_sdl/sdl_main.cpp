@@ -1,7 +1,10 @@
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <functional>
 #include <stdio.h>
 #include <string>
+#include <thread>
 
 #include <SDL.h>
 #ifdef __EMSCRIPTEN__
@@ -15,6 +18,8 @@
 #include "scene_storage_sdl.h"
 #ifndef __EMSCRIPTEN__
 #include "wav_recorder.h"
+#include "recording_storage_sdl.h"
+#include "../sd_recorder.h"
 #endif
 
 struct AudioContext {
@@ -22,8 +27,14 @@ struct AudioContext {
   SceneStorageSdl storage;
   MiniAcid synth;
   SDL_AudioDeviceID device;
+  SceneAutosave autosave{&storage};
+  SceneCache sceneCache{&storage};
+  SceneBankPager bankPager{&storage};
 #ifndef __EMSCRIPTEN__
   WavRecorder recorder;
+  // the Cardputer's SD recorder against ./sdcard/
+  RecordingStorageSdl sdStorage;
+  SdRecorder sdRecorder{&sdStorage};
 #endif
 };
 
@@ -37,20 +48,122 @@ struct AppState {
   bool running = true;
   bool cleaned_up = false;
   unsigned long lastUIUpdate = 0;
+#ifndef __EMSCRIPTEN__
+  std::thread sdWriter;
+  // plays the part of the device's writer task for scene saves and prefetch
+  std::thread sceneSaver;
+  std::atomic<bool> sceneSaverRunning{false};
+#endif
 };
 
 static void audioCallback(void *userdata, Uint8 *stream, int len) {
   AudioContext *ctx = static_cast<AudioContext *>(userdata);
   int16_t *out = reinterpret_cast<int16_t *>(stream);
-  size_t frames = static_cast<size_t>(len) / sizeof(int16_t);
+  size_t frames = static_cast<size_t>(len) / (sizeof(int16_t) * AUDIO_CHANNELS);
 
   // Fill the output buffer using the synth
   ctx->synth.generateAudioBuffer(out, frames);
 #ifndef __EMSCRIPTEN__
-  ctx->recorder.writeSamples(out, frames);
+  ctx->recorder.writeSamples(out, frames * AUDIO_CHANNELS);
+  ctx->sdRecorder.push(out, frames);
 #endif
 }
 
+#ifndef __EMSCRIPTEN__
+static void stopRecording(AppState& s) {
+  // only the stem sink lives in the synth; the recorder stops without the lock
+  SDL_LockAudioDevice(s.audio.device);
+  s.audio.synth.setStemSink(nullptr);
+  s.audio.synth.setMixSink(nullptr);
+  SDL_UnlockAudioDevice(s.audio.device);
+  s.audio.recorder.stop();
+  printf("WAV Recording stopped: %s\n", s.audio.recorder.filename().c_str());
+  if (s.audio.recorder.droppedSamples() > 0) {
+    printf("  dropped %llu samples in %llu blocks (ring peak %zu of %zu)\n",
+           static_cast<unsigned long long>(s.audio.recorder.droppedSamples()),
+           static_cast<unsigned long long>(s.audio.recorder.droppedBlocks()),
+           s.audio.recorder.ringHighWater(), s.audio.recorder.ringCapacity());
+  }
+}
+
+static void stemNames(const char* names[MiniAcid::kStemCount]) {
+  for (int i = 0; i < MiniAcid::kStemCount; ++i) {
+    names[i] = MiniAcid::stemName(static_cast<MiniAcidStem>(i));
+  }
+}
+
+// Offline bounce of the song, or of the loop when one is set, as fast as the
+// engine renders. Live audio is held off meanwhile and stops afterwards.
+static void bounceSong(AppState& s, bool stems) {
+  WavRecorder& recorder = s.audio.recorder;
+  if (recorder.isRecording()) {
+    fprintf(stderr, "Stop recording before bouncing\n");
+    return;
+  }
+  MiniAcid& synth = s.audio.synth;
+  int start = 0;
+  int end = synth.songLength() - 1;
+  if (synth.songLoopEnabled()) {
+    start = synth.songLoopStart();
+    end = synth.songLoopEnd();
+  }
+  bool started;
+  if (stems) {
+    const char* names[MiniAcid::kStemCount];
+    stemNames(names);
+    started = recorder.startStems(SAMPLE_RATE, MiniAcid::kStemCount, StemLayout::FilePerStem, names);
+  } else {
+    started = recorder.start(SAMPLE_RATE, AUDIO_CHANNELS);
+  }
+  if (!started) {
+    fprintf(stderr, "Failed to start the bounce\n");
+    return;
+  }
+  recorder.setOffline(true);
+  WavRecorder* out = &recorder;
+  size_t frames;
+  SDL_LockAudioDevice(s.audio.device);
+  if (stems) {
+    frames = synth.renderSongStems(start, end, [out](const float* const* buffers, size_t count) {
+      out->writeStems(buffers, count);
+    });
+  } else {
+    frames = synth.renderSongRange(start, end, [out](const int16_t* samples, size_t count) {
+      out->writeSamples(samples, count * AUDIO_CHANNELS);
+    });
+  }
+  SDL_UnlockAudioDevice(s.audio.device);
+  recorder.stop();
+  printf("Bounced bars %d-%d (%.1f s): %s\n", start + 1, end + 1, static_cast<double>(frames) / SAMPLE_RATE,
+         recorder.filename().c_str());
+}
+
+static void toggleSdRecording(AppState& s) {
+  SdRecorder& recorder = s.audio.sdRecorder;
+  if (recorder.isRecording()) {
+    recorder.stop();
+    if (s.sdWriter.joinable()) s.sdWriter.join();
+    SdRecorderStats st = recorder.stats();
+    printf("SD recording saved: sdcard%s (%u blocks, peak queue %u/%u, dropped %u buffers / %u frames, %u write errors)\n",
+           recorder.filename().c_str(), st.blocksWritten, st.queueHighWater, st.blockCount, st.droppedBlocks,
+           st.droppedFrames, st.writeErrors);
+    return;
+  }
+  if (!recorder.start(SAMPLE_RATE, AUDIO_CHANNELS)) {
+    fprintf(stderr, "Failed to start SD recording\n");
+    return;
+  }
+  // plays the part of the device's low-priority writer task
+  SdRecorder* writer = &recorder;
+  s.sdWriter = std::thread([writer]() {
+    while (writer->isRecording()) {
+      if (writer->pump() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+  });
+  printf("SD recording started: sdcard%s\n", recorder.filename().c_str());
+}
+#endif
+
 static void handleEvents(AppState& s) {
   SDL_Event e;
   while (SDL_PollEvent(&e)) {
@@ -60,17 +173,51 @@ static void handleEvents(AppState& s) {
       if (s.ui) s.ui->dismissSplash();
       SDL_Scancode sc = e.key.keysym.scancode;
 #ifndef __EMSCRIPTEN__
+      if (sc == SDL_SCANCODE_D && (e.key.keysym.mod & KMOD_CTRL) != 0 && s.sdl && e.key.repeat == 0) {
+        toggleSdRecording(s);
+        continue;
+      }
+      if (sc == SDL_SCANCODE_B && (e.key.keysym.mod & KMOD_CTRL) != 0 && s.sdl && e.key.repeat == 0) {
+        // Shift bounces per-voice stems
+        bounceSong(s, (e.key.keysym.mod & KMOD_SHIFT) != 0);
+        continue;
+      }
       if (sc == SDL_SCANCODE_R && (e.key.keysym.mod & KMOD_CTRL) != 0 && s.sdl && e.key.repeat == 0) {
-        SDL_LockAudioDevice(s.audio.device);
+        // Shift records per-voice stems, Alt records unclipped float32
+        bool stems = (e.key.keysym.mod & KMOD_SHIFT) != 0;
+        WavFormat format = (e.key.keysym.mod & KMOD_ALT) != 0 ? WavFormat::Float32 : WavFormat::Pcm16;
         if (s.audio.recorder.isRecording()) {
-          s.audio.recorder.stop();
-          printf("WAV Recording stopped: %s\n", s.audio.recorder.filename().c_str());
-        } else if (s.audio.recorder.start(SAMPLE_RATE, 1)) {
+          stopRecording(s);
+        } else if (stems) {
+          // one mono file per voice, taken before the mix bus
+          const char* names[MiniAcid::kStemCount];
+          stemNames(names);
+          if (s.audio.recorder.startStems(SAMPLE_RATE, MiniAcid::kStemCount, StemLayout::FilePerStem,
+                                          names, format)) {
+            WavRecorder* recorder = &s.audio.recorder;
+            SDL_LockAudioDevice(s.audio.device);
+            s.audio.synth.setStemSink([recorder](const float* const* buffers, size_t frames) {
+              recorder->writeStems(buffers, frames);
+            });
+            SDL_UnlockAudioDevice(s.audio.device);
+            printf("Stem recording started: %s\n", s.audio.recorder.filename().c_str());
+          } else {
+            fprintf(stderr, "Failed to start stem recording\n");
+          }
+        } else if (s.audio.recorder.start(SAMPLE_RATE, AUDIO_CHANNELS, format)) {
+          if (format == WavFormat::Float32) {
+            // the pre-clip mix, not the 16-bit device output
+            WavRecorder* recorder = &s.audio.recorder;
+            SDL_LockAudioDevice(s.audio.device);
+            s.audio.synth.setMixSink([recorder](const float* const* channels, size_t frames) {
+              recorder->writeMix(channels, frames);
+            });
+            SDL_UnlockAudioDevice(s.audio.device);
+          }
           printf("WAV Recording started: %s\n", s.audio.recorder.filename().c_str());
         } else {
           fprintf(stderr, "Failed to start WAV recording\n");
         }
-        SDL_UnlockAudioDevice(s.audio.device);
         continue;
       }
 #endif
@@ -212,16 +359,41 @@ static void updateUI(AppState& s) {
   }
 }
 
+#ifndef __EMSCRIPTEN__
+static void startSceneSaver(AppState& s) {
+  SceneAutosave* autosave = &s.audio.autosave;
+  SceneCache* cache = &s.audio.sceneCache;
+  SceneBankPager* pager = &s.audio.bankPager;
+  std::atomic<bool>* running = &s.sceneSaverRunning;
+  running->store(true);
+  s.sceneSaver = std::thread([autosave, cache, pager, running]() {
+    while (running->load()) {
+      bool busy = autosave->pump(SDL_GetTicks());
+      busy = cache->pump() || busy;
+      busy = pager->pump() || busy;
+      if (!busy) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+  });
+}
+
+static void stopSceneSaver(AppState& s) {
+  s.sceneSaverRunning.store(false);
+  if (s.sceneSaver.joinable()) s.sceneSaver.join();
+}
+#endif
+
 static void cleanup(AppState& s) {
   if (s.cleaned_up) return;
 #ifndef __EMSCRIPTEN__
+  stopSceneSaver(s);
   if (s.audio.recorder.isRecording()) {
-    SDL_LockAudioDevice(s.audio.device);
-    s.audio.recorder.stop();
-    SDL_UnlockAudioDevice(s.audio.device);
-    printf("WAV Recording stopped: %s\n", s.audio.recorder.filename().c_str());
+    stopRecording(s);
+  }
+  if (s.audio.sdRecorder.isRecording()) {
+    toggleSdRecording(s);
   }
 #endif
+  if (!s.audio.synth.flushSceneAutosave()) fprintf(stderr, "Failed to save the scene\n");
   SDL_CloseAudioDevice(s.audio.device);
   SDL_Quit();
   s.cleaned_up = true;
@@ -230,6 +402,12 @@ static void cleanup(AppState& s) {
 static void mainLoopTick(void* userdata) {
   AppState* s = static_cast<AppState*>(userdata);
   handleEvents(*s);
+#ifdef __EMSCRIPTEN__
+  // no threads: scene saves and prefetches run between frames
+  s->audio.autosave.pump(SDL_GetTicks());
+  s->audio.sceneCache.pump();
+  s->audio.bankPager.pump();
+#endif
   updateUI(*s);
   if (!s->running) {
 #ifdef __EMSCRIPTEN__
@@ -269,11 +447,14 @@ int main(int argc, char **argv) {
 
   state.gfx->begin();
   state.audio.synth.init();
+  state.audio.synth.setSceneAutosave(&state.audio.autosave);
+  state.audio.synth.setSceneCache(&state.audio.sceneCache);
+  state.audio.synth.setBankPager(&state.audio.bankPager);
 
   SDL_AudioSpec desired{};
   desired.freq = SAMPLE_RATE;
   desired.format = AUDIO_S16SYS;
-  desired.channels = 1;
+  desired.channels = AUDIO_CHANNELS;
   desired.samples = AUDIO_BUFFER_SAMPLES;
   desired.callback = audioCallback;
   desired.userdata = &state.audio;
@@ -298,6 +479,7 @@ int main(int argc, char **argv) {
 #ifdef __EMSCRIPTEN__
   emscripten_set_main_loop_arg(mainLoopTick, &state, 0, 1);
 #else
+  startSceneSaver(state);
   while (state.running) {
     mainLoopTick(&state);
     if (!state.running) break;
@@ -1,5 +1,6 @@
 #include "wav_recorder.h"
 
+#include <chrono>
 #include <cstring>
 #include <ctime>
 
@@ -17,6 +18,51 @@ void writeLE32(std::uint8_t* dst, std::uint32_t value) {
   dst[3] = static_cast<std::uint8_t>((value >> 24) & 0xFF);
 }
 
+void writeLE64(std::uint8_t* dst, std::uint64_t value) {
+  writeLE32(dst, static_cast<std::uint32_t>(value & 0xFFFFFFFFu));
+  writeLE32(dst + 4, static_cast<std::uint32_t>(value >> 32));
+}
+
+void appendTag(std::vector<std::uint8_t>& out, const char* tag, std::uint32_t size) {
+  size_t at = out.size();
+  out.resize(at + 8);
+  std::memcpy(out.data() + at, tag, 4);
+  writeLE32(out.data() + at + 4, size);
+}
+
+void patchLE32(std::FILE* file, size_t offset, std::uint32_t value) {
+  std::uint8_t field[4];
+  writeLE32(field, value);
+  std::fseek(file, static_cast<long>(offset), SEEK_SET);
+  std::fwrite(field, sizeof(field), 1, file);
+}
+
+constexpr std::uint16_t kFormatPcm = 1;
+constexpr std::uint16_t kFormatFloat = 3;
+// RIFF header + JUNK chunk that becomes ds64 if the file outgrows 4 GB
+constexpr size_t kDs64Offset = 12;
+constexpr std::uint32_t kDs64Size = 28;
+constexpr std::uint64_t kMaxRiffSize = 0xFFFFFFFFull;
+
+// float input is scaled like the master output before it reaches the
+// volume, so full scale lines up with the 16-bit recordings
+constexpr float kRecordHeadroom = 0.65f;
+
+std::int16_t pcmSample(float value) {
+  float s = value * kRecordHeadroom;
+  if (s > 1.0f) s = 1.0f;
+  if (s < -1.0f) s = -1.0f;
+  return static_cast<std::int16_t>(s * 32767.0f);
+}
+
+// ring depth in seconds of audio; the writer has this long to catch up
+constexpr int kRingSeconds = 4;
+// the writer sleeps between drains and writes at most this much per batch
+constexpr int kWriterPollMs = 20;
+constexpr size_t kBatchBytes = 256 * 1024;
+// float input is converted this many frames at a time into the ring
+constexpr size_t kConvertFrames = 256;
+
 }  // namespace
 
 WavRecorder::WavRecorder() = default;
@@ -25,53 +71,238 @@ WavRecorder::~WavRecorder() {
   stop();
 }
 
-bool WavRecorder::start(int sampleRate, int channels) {
-  if (file_) {
+bool WavRecorder::start(int sampleRate, int channels, WavFormat format) {
+  if (isRecording() || channels <= 0) {
+    return false;
+  }
+
+  sampleRate_ = sampleRate;
+  format_ = format;
+  if (!openFiles({generateTimestampFilename()}, channels)) {
     return false;
   }
+  launch(format == WavFormat::Float32 ? Source::Mix : Source::Output, channels);
+  return true;
+}
 
-  filename_ = generateTimestampFilename();
-  file_ = std::fopen(filename_.c_str(), "wb");
-  if (!file_) {
-    filename_.clear();
+bool WavRecorder::startStems(int sampleRate, int stemCount, StemLayout layout, const char* const* stemNames,
+                             WavFormat format) {
+  if (isRecording() || stemCount <= 0 || !stemNames) {
     return false;
   }
 
+  std::string base = generateTimestampFilename();
+  base.resize(base.size() - 4);  // drop ".wav"
+  std::vector<std::string> names;
+  if (layout == StemLayout::Multichannel) {
+    names.push_back(base + "_stems.wav");
+  } else {
+    for (int i = 0; i < stemCount; ++i) {
+      names.push_back(base + "_" + stemNames[i] + ".wav");
+    }
+  }
   sampleRate_ = sampleRate;
-  channels_ = channels;
-  dataBytes_ = 0;
-  writeHeaderPlaceholder();
+  format_ = format;
+  if (!openFiles(names, layout == StemLayout::Multichannel ? stemCount : 1)) {
+    return false;
+  }
+  launch(Source::Stems, stemCount);
+  return true;
+}
+
+bool WavRecorder::openFiles(const std::vector<std::string>& names, int channelsPerFile) {
+  sampleBytes_ = format_ == WavFormat::Float32 ? sizeof(float) : sizeof(int16_t);
+  fileChannels_ = channelsPerFile;
+  std::vector<std::uint8_t> header;
+  buildHeader(channelsPerFile, header);
+  for (const std::string& name : names) {
+    std::FILE* file = std::fopen(name.c_str(), "wb");
+    if (!file) {
+      for (std::FILE* open : files_) std::fclose(open);
+      files_.clear();
+      filename_.clear();
+      return false;
+    }
+    std::fwrite(header.data(), 1, header.size(), file);
+    files_.push_back(file);
+  }
+  filename_ = names.front();
+  fileBytes_.assign(files_.size(), 0);
   return true;
 }
 
+void WavRecorder::launch(Source source, int channels) {
+  source_ = source;
+  channels_ = channels;
+  size_t frameBytes = static_cast<size_t>(channels) * sampleBytes_;
+  ring_.allocate(static_cast<size_t>(sampleRate_) * kRingSeconds * frameBytes);
+  batch_.assign(kBatchBytes / frameBytes * frameBytes, 0);
+  planar_.assign(files_.size() > 1 ? batch_.size() / channels : 0, 0);
+  convert_.assign(source == Source::Output ? 0 : kConvertFrames * frameBytes, 0);
+  droppedSamples_.store(0, std::memory_order_relaxed);
+  droppedBlocks_.store(0, std::memory_order_relaxed);
+  stopWriter_.store(false, std::memory_order_relaxed);
+  writer_ = std::thread(&WavRecorder::writerLoop, this);
+  recording_.store(true, std::memory_order_release);
+}
+
 void WavRecorder::stop() {
-  if (!file_) {
+  if (!writer_.joinable()) {
     return;
   }
 
-  finalizeHeader();
-  std::fclose(file_);
-  file_ = nullptr;
-  dataBytes_ = 0;
+  // Once the producer is out of the write calls nothing else reaches the
+  // ring; the writer drains what is left and closes the files.
+  recording_.store(false, std::memory_order_seq_cst);
+  while (producerBusy_.load(std::memory_order_seq_cst)) {
+    std::this_thread::yield();
+  }
+  stopWriter_.store(true, std::memory_order_release);
+  writer_.join();
+  offline_ = false;
 }
 
+void WavRecorder::setOffline(bool offline) { offline_ = offline; }
+
 bool WavRecorder::isRecording() const {
-  return file_ != nullptr;
+  return writer_.joinable();
 }
 
 void WavRecorder::writeSamples(const int16_t* samples, size_t sampleCount) {
-  if (!file_ || !samples || sampleCount == 0) {
+  if (!samples || sampleCount == 0) {
     return;
   }
+  producerBusy_.store(true, std::memory_order_seq_cst);
+  if (recording_.load(std::memory_order_seq_cst) && source_ == Source::Output) {
+    size_t bytes = sampleCount * sizeof(int16_t);
+    if (!reserve(bytes) || !ring_.push(reinterpret_cast<const std::uint8_t*>(samples), bytes)) {
+      dropped(sampleCount);
+    }
+  }
+  producerBusy_.store(false, std::memory_order_release);
+}
 
-  size_t written = std::fwrite(samples, sizeof(int16_t), sampleCount, file_);
-  dataBytes_ += static_cast<std::uint32_t>(written * sizeof(int16_t));
+void WavRecorder::writeMix(const float* const* channels, size_t frames) {
+  pushPlanar(Source::Mix, channels, frames);
+}
+
+void WavRecorder::writeStems(const float* const* stems, size_t frames) {
+  pushPlanar(Source::Stems, stems, frames);
+}
+
+void WavRecorder::pushPlanar(Source source, const float* const* channels, size_t frames) {
+  if (!channels || frames == 0) {
+    return;
+  }
+  producerBusy_.store(true, std::memory_order_seq_cst);
+  if (recording_.load(std::memory_order_seq_cst) && source_ == source) {
+    size_t channelCount = static_cast<size_t>(channels_);
+    // all frames or none, so the ring never holds a partial block
+    if (!reserve(frames * channelCount * sampleBytes_)) {
+      dropped(frames * channelCount);
+    } else {
+      for (size_t done = 0; done < frames; done += kConvertFrames) {
+        size_t count = frames - done < kConvertFrames ? frames - done : kConvertFrames;
+        if (format_ == WavFormat::Float32) {
+          float* out = reinterpret_cast<float*>(convert_.data());
+          for (size_t i = 0; i < count; ++i) {
+            for (size_t c = 0; c < channelCount; ++c) {
+              out[i * channelCount + c] = channels[c][done + i] * kRecordHeadroom;
+            }
+          }
+        } else {
+          int16_t* out = reinterpret_cast<int16_t*>(convert_.data());
+          for (size_t i = 0; i < count; ++i) {
+            for (size_t c = 0; c < channelCount; ++c) {
+              out[i * channelCount + c] = pcmSample(channels[c][done + i]);
+            }
+          }
+        }
+        ring_.push(convert_.data(), count * channelCount * sampleBytes_);
+      }
+    }
+  }
+  producerBusy_.store(false, std::memory_order_release);
+}
+
+bool WavRecorder::reserve(size_t bytes) {
+  if (!offline_ || bytes > ring_.capacity()) return ring_.writeAvailable() >= bytes;
+  while (ring_.writeAvailable() < bytes) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+void WavRecorder::dropped(size_t samples) {
+  droppedSamples_.fetch_add(samples, std::memory_order_relaxed);
+  droppedBlocks_.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint64_t WavRecorder::droppedSamples() const {
+  return droppedSamples_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t WavRecorder::droppedBlocks() const {
+  return droppedBlocks_.load(std::memory_order_relaxed);
+}
+
+size_t WavRecorder::ringHighWater() const {
+  return ring_.highWater();
+}
+
+size_t WavRecorder::ringCapacity() const {
+  return ring_.capacity();
+}
+
+void WavRecorder::writerLoop() {
+  while (!stopWriter_.load(std::memory_order_acquire)) {
+    if (drain() == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(kWriterPollMs));
+    }
+  }
+  while (drain() > 0) {
+  }
+
+  for (size_t i = 0; i < files_.size(); ++i) {
+    finalizeHeader(files_[i], fileBytes_[i]);
+    std::fclose(files_[i]);
+  }
+  files_.clear();
+  fileBytes_.clear();
+}
+
+// Writes one batch of whole frames; returns how many bytes it took.
+size_t WavRecorder::drain() {
+  size_t frameBytes = static_cast<size_t>(channels_) * sampleBytes_;
+  size_t available = ring_.readAvailable() / frameBytes * frameBytes;
+  if (available == 0) {
+    return 0;
+  }
+  size_t count = ring_.pop(batch_.data(), available < batch_.size() ? available : batch_.size());
+  if (files_.size() == 1) {
+    fileBytes_[0] += std::fwrite(batch_.data(), 1, count, files_[0]);
+    return count;
+  }
+
+  size_t frames = count / frameBytes;
+  for (size_t f = 0; f < files_.size(); ++f) {
+    const std::uint8_t* src = batch_.data() + f * sampleBytes_;
+    for (size_t i = 0; i < frames; ++i) {
+      std::memcpy(planar_.data() + i * sampleBytes_, src + i * frameBytes, sampleBytes_);
+    }
+    fileBytes_[f] += std::fwrite(planar_.data(), 1, frames * sampleBytes_, files_[f]);
+  }
+  return count;
 }
 
 const std::string& WavRecorder::filename() const {
   return filename_;
 }
 
+WavFormat WavRecorder::format() const {
+  return format_;
+}
+
 std::string WavRecorder::generateTimestampFilename() const {
   char timestamp[32] = "unknown";
   std::time_t now = std::time(nullptr);
@@ -92,36 +323,63 @@ std::string WavRecorder::generateTimestampFilename() const {
   return filename;
 }
 
-void WavRecorder::writeHeaderPlaceholder() {
-  std::uint8_t header[44];
-  std::memcpy(header, "RIFF", 4);
-  writeLE32(header + 4, 36 + dataBytes_);
-  std::memcpy(header + 8, "WAVE", 4);
-  std::memcpy(header + 12, "fmt ", 4);
-  writeLE32(header + 16, 16);
-  writeLE16(header + 20, 1);
-  writeLE16(header + 22, static_cast<std::uint16_t>(channels_));
-  writeLE32(header + 24, static_cast<std::uint32_t>(sampleRate_));
-  std::uint32_t byteRate = static_cast<std::uint32_t>(sampleRate_ * channels_ * sizeof(int16_t));
-  writeLE32(header + 28, byteRate);
-  std::uint16_t blockAlign = static_cast<std::uint16_t>(channels_ * sizeof(int16_t));
-  writeLE16(header + 32, blockAlign);
-  writeLE16(header + 34, 16);
-  std::memcpy(header + 36, "data", 4);
-  writeLE32(header + 40, dataBytes_);
-
-  std::fwrite(header, sizeof(header), 1, file_);
-}
-
-void WavRecorder::finalizeHeader() {
-  std::uint8_t sizeField[4];
-  writeLE32(sizeField, 36 + dataBytes_);
-  std::fseek(file_, 4, SEEK_SET);
-  std::fwrite(sizeField, sizeof(sizeField), 1, file_);
-
-  writeLE32(sizeField, dataBytes_);
-  std::fseek(file_, 40, SEEK_SET);
-  std::fwrite(sizeField, sizeof(sizeField), 1, file_);
-
-  std::fflush(file_);
+void WavRecorder::buildHeader(int channels, std::vector<std::uint8_t>& header) {
+  const bool isFloat = format_ == WavFormat::Float32;
+  header.clear();
+  appendTag(header, "RIFF", 0);
+  header.insert(header.end(), {'W', 'A', 'V', 'E'});
+
+  appendTag(header, "JUNK", kDs64Size);
+  header.resize(header.size() + kDs64Size, 0);
+
+  // float formats carry cbSize and a fact chunk
+  appendTag(header, "fmt ", isFloat ? 18 : 16);
+  size_t fmt = header.size();
+  header.resize(fmt + (isFloat ? 18 : 16), 0);
+  writeLE16(header.data() + fmt, isFloat ? kFormatFloat : kFormatPcm);
+  writeLE16(header.data() + fmt + 2, static_cast<std::uint16_t>(channels));
+  writeLE32(header.data() + fmt + 4, static_cast<std::uint32_t>(sampleRate_));
+  std::uint32_t byteRate = static_cast<std::uint32_t>(sampleRate_ * channels * sampleBytes_);
+  writeLE32(header.data() + fmt + 8, byteRate);
+  writeLE16(header.data() + fmt + 12, static_cast<std::uint16_t>(channels * sampleBytes_));
+  writeLE16(header.data() + fmt + 14, static_cast<std::uint16_t>(sampleBytes_ * 8));
+
+  factOffset_ = 0;
+  if (isFloat) {
+    appendTag(header, "fact", 4);
+    factOffset_ = header.size();
+    header.resize(header.size() + 4, 0);
+  }
+
+  appendTag(header, "data", 0);
+  dataSizeOffset_ = header.size() - 4;
+}
+
+void WavRecorder::finalizeHeader(std::FILE* file, std::uint64_t dataBytes) {
+  std::uint64_t riffSize = dataSizeOffset_ + 4 - 8 + dataBytes;
+  std::uint64_t frames = dataBytes / (static_cast<std::uint64_t>(fileChannels_) * sampleBytes_);
+
+  if (riffSize <= kMaxRiffSize) {
+    patchLE32(file, 4, static_cast<std::uint32_t>(riffSize));
+    patchLE32(file, dataSizeOffset_, static_cast<std::uint32_t>(dataBytes));
+    if (factOffset_ != 0) patchLE32(file, factOffset_, static_cast<std::uint32_t>(frames));
+  } else {
+    // RF64: the 32-bit fields are saturated and the real sizes go in ds64
+    std::fseek(file, 0, SEEK_SET);
+    std::fwrite("RF64", 1, 4, file);
+    patchLE32(file, 4, 0xFFFFFFFFu);
+    std::uint8_t ds64[8 + kDs64Size] = {};
+    std::memcpy(ds64, "ds64", 4);
+    writeLE32(ds64 + 4, kDs64Size);
+    writeLE64(ds64 + 8, riffSize);
+    writeLE64(ds64 + 16, dataBytes);
+    writeLE64(ds64 + 24, frames);
+    writeLE32(ds64 + 32, 0);  // no extra chunk sizes
+    std::fseek(file, static_cast<long>(kDs64Offset), SEEK_SET);
+    std::fwrite(ds64, sizeof(ds64), 1, file);
+    patchLE32(file, dataSizeOffset_, 0xFFFFFFFFu);
+    if (factOffset_ != 0) patchLE32(file, factOffset_, 0xFFFFFFFFu);
+  }
+
+  std::fflush(file);
 }
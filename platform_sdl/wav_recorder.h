@@ -1,29 +1,103 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "../src/dsp/mini_sample_ring.h"
+
+enum class StemLayout {
+  Multichannel, // one WAV, one channel per stem
+  FilePerStem,  // one mono WAV per stem, named after the stem
+};
+
+enum class WavFormat {
+  Pcm16,   // 16-bit PCM
+  Float32, // IEEE float (format 3), unclipped
+};
+
+// WAV capture for the desktop build. writeSamples()/writeMix()/writeStems()
+// are called from the audio thread and only copy into a preallocated ring; a
+// writer thread drains it in large batches and finalizes the headers, so a
+// slow disk costs dropped samples (counted) rather than audio glitches.
+// start() and stop() do not need the audio device lock.
+//
+// Sizes are tracked in 64 bits; a file whose RIFF size no longer fits in 32
+// bits is finalized as RF64, using the ds64 chunk reserved up front.
 class WavRecorder {
  public:
   WavRecorder();
   ~WavRecorder();
 
-  bool start(int sampleRate, int channels);
+  // Pcm16 records the device output passed to writeSamples(); Float32
+  // records the pre-clip mix passed to writeMix().
+  bool start(int sampleRate, int channels, WavFormat format = WavFormat::Pcm16);
+  // Float stems are scaled by the master's headroom; Pcm16 also clips them.
+  bool startStems(int sampleRate, int stemCount, StemLayout layout, const char* const* stemNames,
+                  WavFormat format = WavFormat::Pcm16);
+  // Blocks until the writer has flushed and closed every file.
   void stop();
+  // For offline bounces, which outrun the disk: the write calls wait for
+  // the writer to make room instead of dropping samples. Never set it while
+  // the audio thread is the producer. Cleared by stop().
+  void setOffline(bool offline);
   bool isRecording() const;
   void writeSamples(const int16_t* samples, size_t sampleCount);
+  void writeMix(const float* const* channels, size_t frames);
+  void writeStems(const float* const* stems, size_t frames);
   const std::string& filename() const;
+  WavFormat format() const;
+
+  // Samples the audio thread could not queue because the ring was full, and
+  // how many blocks that affected. Reset by start().
+  std::uint64_t droppedSamples() const;
+  std::uint64_t droppedBlocks() const;
+  // Deepest ring fill of the current or last recording, in bytes.
+  size_t ringHighWater() const;
+  size_t ringCapacity() const;
 
  private:
+  enum class Source { Output, Mix, Stems };
+
   std::string generateTimestampFilename() const;
-  void writeHeaderPlaceholder();
-  void finalizeHeader();
+  bool openFiles(const std::vector<std::string>& names, int channelsPerFile);
+  void launch(Source source, int channels);
+  void buildHeader(int channels, std::vector<std::uint8_t>& header);
+  void finalizeHeader(std::FILE* file, std::uint64_t dataBytes);
+  void pushPlanar(Source source, const float* const* channels, size_t frames);
+  void writerLoop();
+  size_t drain();
+  void dropped(size_t samples);
+  bool reserve(size_t bytes);
 
-  std::FILE* file_ = nullptr;
   std::string filename_;
-  std::uint32_t dataBytes_ = 0;
   int sampleRate_ = 0;
-  int channels_ = 0;
+  int channels_ = 0; // samples per frame in the ring
+  int fileChannels_ = 0;
+  WavFormat format_ = WavFormat::Pcm16;
+  size_t sampleBytes_ = sizeof(int16_t);
+  Source source_ = Source::Output;
+  // header layout, the same for every file of a recording
+  size_t dataSizeOffset_ = 0;
+  size_t factOffset_ = 0; // 0 when there is no fact chunk
+
+  // owned by the writer thread while recording
+  std::vector<std::FILE*> files_; // one, or one per channel
+  std::vector<std::uint64_t> fileBytes_;
+  std::vector<std::uint8_t> batch_;
+  std::vector<std::uint8_t> planar_;
+
+  SampleRing<std::uint8_t> ring_;
+  std::vector<std::uint8_t> convert_; // audio thread scratch for float input
+  std::thread writer_;
+  bool offline_ = false; // producer side
+  std::atomic<bool> recording_{false};
+  std::atomic<bool> producerBusy_{false};
+  std::atomic<bool> stopWriter_{false};
+  std::atomic<std::uint64_t> droppedSamples_{0};
+  std::atomic<std::uint64_t> droppedBlocks_{0};
 };
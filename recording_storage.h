@@ -0,0 +1,28 @@
+#pragma once
+#ifndef RECORDING_STORAGE_H
+#define RECORDING_STORAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Abstract file sink for SdRecorder: the SD card on the Cardputer, a plain
+// directory on desktop. One file is open at a time and every call comes
+// from the recorder's writer task, apart from open() at start.
+class RecordingStorage {
+public:
+  virtual ~RecordingStorage() = default;
+  // Returns false when there is nowhere to record to.
+  virtual bool initializeStorage() = 0;
+
+  virtual bool exists(const std::string& name) const = 0;
+  // Creates or truncates 'name' and keeps it open for the calls below.
+  virtual bool open(const std::string& name) = 0;
+  // Appends to the open file; returns the number of bytes written.
+  virtual size_t write(const uint8_t* data, size_t bytes) = 0;
+  // Overwrites bytes at 'offset', used to patch the header on close.
+  virtual bool writeAt(uint32_t offset, const uint8_t* data, size_t bytes) = 0;
+  virtual void close() = 0;
+};
+
+#endif // RECORDING_STORAGE_H
@@ -0,0 +1,37 @@
+#include "recording_storage_cardputer.h"
+
+#include <M5Cardputer.h>
+
+bool RecordingStorageCardputer::initializeStorage() {
+  return SD.cardType() != CARD_NONE;
+}
+
+bool RecordingStorageCardputer::exists(const std::string& name) const {
+  return SD.exists(name.c_str());
+}
+
+bool RecordingStorageCardputer::open(const std::string& name) {
+  if (!initializeStorage()) {
+    Serial.println("Recording: no SD card");
+    return false;
+  }
+  file_ = SD.open(name.c_str(), FILE_WRITE);
+  return static_cast<bool>(file_);
+}
+
+size_t RecordingStorageCardputer::write(const uint8_t* data, size_t bytes) {
+  if (!file_) return 0;
+  return file_.write(data, bytes);
+}
+
+bool RecordingStorageCardputer::writeAt(uint32_t offset, const uint8_t* data, size_t bytes) {
+  if (!file_) return false;
+  size_t end = file_.position();
+  bool ok = file_.seek(offset) && file_.write(data, bytes) == bytes;
+  file_.seek(end);
+  return ok;
+}
+
+void RecordingStorageCardputer::close() {
+  if (file_) file_.close();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <SD.h>
+#include "recording_storage.h"
+
+// Recordings on the SD card, which SceneStorageCardputer has already
+// mounted.
+class RecordingStorageCardputer : public RecordingStorage {
+public:
+  bool initializeStorage() override;
+  bool exists(const std::string& name) const override;
+  bool open(const std::string& name) override;
+  size_t write(const uint8_t* data, size_t bytes) override;
+  bool writeAt(uint32_t offset, const uint8_t* data, size_t bytes) override;
+  void close() override;
+
+private:
+  File file_;
+};
@@ -0,0 +1,171 @@
+#include "scene_autosave.h"
+
+#include <chrono>
+#include <thread>
+
+SceneAutosave::SceneAutosave(SceneStorage* storage) : storage_(storage) {
+  for (int i = 0; i < kSlots; ++i) state_[i].store(Free);
+}
+
+int SceneAutosave::claim(SlotState from, SlotState to) {
+  for (int i = 0; i < kSlots; ++i) {
+    uint8_t expected = from;
+    if (state_[i].compare_exchange_strong(expected, to)) return i;
+  }
+  return -1;
+}
+
+int SceneAutosave::claimQueued(const std::string& name, JobKind kind) {
+  for (int i = 0; i < kSlots; ++i) {
+    uint8_t expected = Queued;
+    if (!state_[i].compare_exchange_strong(expected, Filling)) continue;
+    if (jobs_[i].kind == kind && jobs_[i].name == name) return i;
+    state_[i].store(Queued);
+  }
+  return -1;
+}
+
+void SceneAutosave::reclaimFailed(const std::string& name, SceneManager& scene) {
+  int slot;
+  while ((slot = claim(Failed, Filling)) >= 0) {
+    // the file is rewritten in full next time anyway
+    if (jobs_[slot].kind == Save && jobs_[slot].name == name) scene.markAllDirty();
+    state_[slot].store(Free);
+  }
+}
+
+void SceneAutosave::request(const std::string& name, SceneManager& scene) {
+  reclaimFailed(name, scene);
+  if (!scene.isDirty()) return;
+  requests_.fetch_add(1);
+
+  int slot = claimQueued(name, Save);
+  if (slot >= 0) {
+    // the replaced snapshot was never written, so its changes still count
+    scene.markDirty(jobs_[slot].scene.dirtyState());
+    coalesced_.fetch_add(1);
+  } else {
+    slot = claim(Free, Filling);
+  }
+  // every slot busy would take a second writer
+  if (slot < 0) return;
+
+  jobs_[slot].scene = scene;
+  jobs_[slot].name = name;
+  jobs_[slot].kind = Save;
+  scene.markClean();
+  state_[slot].store(Queued);
+  serial_.fetch_add(1);
+}
+
+bool SceneAutosave::requestExport(const std::string& name, const SceneManager& scene) {
+  int slot = claimQueued(name, Export);
+  if (slot < 0) slot = claim(Free, Filling);
+  if (slot < 0) return false;
+  jobs_[slot].scene = scene;
+  jobs_[slot].name = name;
+  jobs_[slot].kind = Export;
+  state_[slot].store(Queued);
+  serial_.fetch_add(1);
+  return true;
+}
+
+bool SceneAutosave::readPending(const std::string& name, SceneManager& out) {
+  while (true) {
+    int slot = claimQueued(name, Save);
+    if (slot >= 0) {
+      out = jobs_[slot].scene;
+      state_[slot].store(Queued);
+      // its changes go out with the queued write; a later request of 'name'
+      // that replaces the snapshot carries them over
+      out.markClean();
+      return true;
+    }
+    // the writer leaves the name alone while it holds the slot
+    bool writing = false;
+    for (int i = 0; i < kSlots; ++i) {
+      writing = writing || (state_[i].load() == Writing && jobs_[i].kind == Save && jobs_[i].name == name);
+    }
+    if (!writing) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+bool SceneAutosave::isSaving() const {
+  for (int i = 0; i < kSlots; ++i) {
+    uint8_t state = state_[i].load();
+    if (state == Filling || state == Queued || state == Writing) return true;
+  }
+  return false;
+}
+
+bool SceneAutosave::flush(const std::string& name, SceneManager& scene) {
+  bool ok = true;
+  while (true) {
+    bool writing = false;
+    bool queued = false;
+    for (int i = 0; i < kSlots; ++i) {
+      uint8_t state = state_[i].load();
+      writing = writing || state == Writing;
+      queued = queued || state == Queued;
+    }
+    if (!writing && !queued) break;
+    // only one writer at a time: snapshots of a name go to the same file
+    if (!writing) {
+      int slot = claim(Queued, Writing);
+      if (slot >= 0) {
+        ok = write(slot) && ok;
+        continue;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  for (int i = 0; i < kSlots; ++i) {
+    if (state_[i].load() == Failed) ok = false;
+  }
+  reclaimFailed(name, scene);
+  return ok;
+}
+
+SceneAutosaveStats SceneAutosave::stats() const {
+  SceneAutosaveStats st;
+  st.requests = requests_.load();
+  st.coalesced = coalesced_.load();
+  st.writes = writes_.load();
+  st.failures = failures_.load();
+  return st;
+}
+
+bool SceneAutosave::pump(uint32_t nowMs) {
+  uint32_t serial = serial_.load();
+  if (serial != seenSerial_) {
+    seenSerial_ = serial;
+    seenAtMs_ = nowMs;
+    return false;
+  }
+  if (nowMs - seenAtMs_ < kSettleMs) return false;
+  int slot = claim(Queued, Writing);
+  if (slot < 0) return false;
+  return write(slot);
+}
+
+bool SceneAutosave::write(int slot) {
+  Job& job = jobs_[slot];
+  bool ok = false;
+  if (job.kind == Export) {
+    ok = storage_ && storage_->exportSceneJsonNamed(job.name, job.scene);
+  } else {
+    // after a failed write only a full rewrite leaves the file consistent
+    if (forceFull_.load()) job.scene.markAllDirty();
+    ok = storage_ && storage_->writeSceneNamed(job.name, job.scene);
+    forceFull_.store(!ok);
+  }
+  if (ok) {
+    writes_.fetch_add(1);
+    state_[slot].store(Free);
+  } else {
+    failures_.fetch_add(1);
+    state_[slot].store(Failed);
+  }
+  return ok;
+}
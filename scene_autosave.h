@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+#include "scene_storage.h"
+#include "scenes.h"
+
+struct SceneAutosaveStats {
+  uint32_t requests = 0;  // requests that found unsaved changes
+  uint32_t coalesced = 0; // snapshots replaced before the writer got to them
+  uint32_t writes = 0;
+  uint32_t failures = 0;
+};
+
+// Saves scenes from a background task so nothing on the UI side waits for
+// the card. request() copies the SceneManager (a few KB, no serialization)
+// into a slot along with the name to save it as, and returns; the writer
+// task calls pump() to serialize and write the snapshot once requests have
+// settled for kSettleMs. A save of a name the writer has not picked up yet
+// is overwritten in place, so a burst of stops costs one write. JSON exports
+// queue the same way. The writer only ever holds one slot, so the scene
+// being switched away from and the one switched to both have somewhere to
+// go.
+class SceneAutosave {
+public:
+  static constexpr uint32_t kSettleMs = 250;
+
+  explicit SceneAutosave(SceneStorage* storage);
+
+  // UI side. request() snapshots 'scene' if it has unsaved changes and marks
+  // it clean; a failed write of 'name' marks it all dirty again on the next
+  // call. Failed saves of other names are dropped, as the UI no longer holds
+  // those scenes.
+  void request(const std::string& name, SceneManager& scene);
+  // Snapshots 'scene' to be written as JSON (SceneStorage::exportSceneJson()).
+  // False if every slot is busy.
+  bool requestExport(const std::string& name, const SceneManager& scene);
+  // Copies the unwritten snapshot of 'name' into 'out', clean, and waits
+  // out one being written. False when the file already holds the newest
+  // save, so a read of it cannot meet a write half done.
+  bool readPending(const std::string& name, SceneManager& out);
+  // true from request() until the snapshot is written
+  bool isSaving() const;
+  // Writes whatever is queued right away on the calling thread and waits for
+  // the one being written. Returns false if a write failed; 'scene' is
+  // marked dirty again if it was a save of 'name'.
+  bool flush(const std::string& name, SceneManager& scene);
+  SceneAutosaveStats stats() const;
+
+  // Writer task. 'nowMs' is any millisecond clock. Returns true if it wrote.
+  bool pump(uint32_t nowMs);
+
+private:
+  enum SlotState : uint8_t { Free, Filling, Queued, Writing, Failed };
+  enum JobKind : uint8_t { Save, Export };
+  static constexpr int kSlots = 3;
+
+  // set by whoever holds the slot in Filling
+  struct Job {
+    SceneManager scene;
+    std::string name;
+    JobKind kind = Save;
+  };
+
+  int claim(SlotState from, SlotState to);
+  int claimQueued(const std::string& name, JobKind kind);
+  void reclaimFailed(const std::string& name, SceneManager& scene);
+  bool write(int slot);
+
+  SceneStorage* storage_;
+  Job jobs_[kSlots];
+  std::atomic<uint8_t> state_[kSlots];
+  std::atomic<uint32_t> serial_{0}; // bumped by every snapshot
+
+  // writer side
+  uint32_t seenSerial_ = 0;
+  uint32_t seenAtMs_ = 0;
+
+  std::atomic<bool> forceFull_{false}; // a file may not match the last snapshot
+
+  std::atomic<uint32_t> requests_{0};
+  std::atomic<uint32_t> coalesced_{0};
+  std::atomic<uint32_t> writes_{0};
+  std::atomic<uint32_t> failures_{0};
+};
@@ -0,0 +1,512 @@
+#include "scene_bank_pager.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#if defined(ARDUINO)
+#include <esp_heap_caps.h>
+#endif
+
+namespace {
+constexpr int kDrumTrack = static_cast<int>(SongTrack::Drums);
+} // namespace
+
+SceneBankPager::SceneBankPager(SceneStorage* storage) : storage_(storage) {}
+
+SceneBankPager::~SceneBankPager() { free(pool_); }
+
+bool SceneBankPager::allocate() {
+  if (pageCount_.load()) return true;
+  // synth banks first: they hold ints, the drum banks only bytes
+  size_t pageBytes = 2 * sizeof(Bank<SynthPattern>) + sizeof(Bank<DrumPatternSet>);
+#if defined(ARDUINO)
+  uint16_t count = kPsramPages;
+  void* pool = heap_caps_malloc(count * pageBytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (pool) {
+    inPsram_ = true;
+  } else {
+    count = kDramPages;
+    pool = heap_caps_malloc(count * pageBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+#else
+  // desktop memory is not the constraint; keep the PSRAM sizing
+  uint16_t count = kPsramPages;
+  void* pool = malloc(count * pageBytes);
+#endif
+  if (!pool) return false;
+  synthBanks_ = static_cast<Bank<SynthPattern>*>(pool);
+  drumBanks_ = reinterpret_cast<Bank<DrumPatternSet>*>(synthBanks_ + 2 * count);
+  for (uint16_t i = 0; i < 2 * count; ++i) new (&synthBanks_[i]) Bank<SynthPattern>();
+  for (uint16_t i = 0; i < count; ++i) new (&drumBanks_[i]) Bank<DrumPatternSet>();
+  pool_ = pool;
+  pageCount_.store(count);
+  return true;
+}
+
+void* SceneBankPager::content(int track, int page) const {
+  if (track == kDrumTrack) return &drumBanks_[page];
+  return &synthBanks_[track * pageCount_ + page];
+}
+
+size_t SceneBankPager::bankBytes(int track) const {
+  return track == kDrumTrack ? sizeof(Bank<DrumPatternSet>) : sizeof(Bank<SynthPattern>);
+}
+
+uint32_t SceneBankPager::touch() { return useClock_.fetch_add(1) + 1; }
+
+int SceneBankPager::find(int track, int bank, uint8_t scene) const {
+  for (uint16_t i = 0; i < pageCount_; ++i) {
+    const Page& page = pages_[track][i];
+    if (page.bank == bank && page.scene == scene && page.state.load() != Free) return i;
+  }
+  return -1;
+}
+
+int SceneBankPager::findReadable(int track, int bank) const {
+  uint8_t current = current_.load();
+  for (uint16_t i = 0; i < pageCount_; ++i) {
+    const Page& page = pages_[track][i];
+    if (page.bank != bank || page.scene != current) continue;
+    uint8_t state = page.state.load();
+    if (state == Ready || state == Queued || state == Writing) return i;
+  }
+  return -1;
+}
+
+int SceneBankPager::claimPage(int track, int keep) {
+  // no pages until setScene() or prepareScene() allocated them
+  int oldest = -1;
+  for (uint16_t i = 0; i < pageCount_; ++i) {
+    Page& page = pages_[track][i];
+    uint8_t state = page.state.load();
+    if (state == Free) {
+      if (page.state.compare_exchange_strong(state, Filling)) return i;
+      continue;
+    }
+    // writes still to do and reads under way stay put
+    if (page.bank == keep || (state != Ready && state != Requested)) continue;
+    if (oldest < 0 || page.lastUse.load() < pages_[track][oldest].lastUse.load()) oldest = i;
+  }
+  if (oldest < 0) return -1;
+  uint8_t state = pages_[track][oldest].state.load();
+  if (state != Ready && state != Requested) return -1;
+  if (!pages_[track][oldest].state.compare_exchange_strong(state, Filling)) return -1;
+  return oldest;
+}
+
+int SceneBankPager::settle(int track, int page) {
+  while (true) {
+    uint8_t state = pages_[track][page].state.load();
+    if (state != Loading && state != Writing) return state;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void SceneBankPager::dropPages(uint8_t scene) {
+  for (int t = 0; t < kTracks; ++t) {
+    for (uint16_t i = 0; i < pageCount_; ++i) {
+      Page& page = pages_[t][i];
+      // a read the writer starts in between settles first; a page someone
+      // holds in Filling gets their scene, not this one
+      uint8_t state = settle(t, i);
+      while ((state == Requested || state == Ready) && page.scene == scene &&
+             !page.state.compare_exchange_strong(state, Free)) {
+        state = settle(t, i);
+      }
+    }
+  }
+}
+
+bool SceneBankPager::readBank(int track, uint8_t scene, int bank, void* out) {
+  const std::string& name = names_[scene];
+  if (!storage_ || name.empty()) return false;
+  SongTrack songTrack = static_cast<SongTrack>(track);
+  size_t size = SceneManager::bankRecordSize(songTrack);
+  uint8_t record[SceneManager::kBankRecordMaxSize];
+  bool ok = storage_->readSceneBanks(name, SceneManager::bankRecordOffset(songTrack, bank), record, size);
+  if (ok && track == kDrumTrack) {
+    ok = SceneManager::loadBankRecord(record, size, *static_cast<Bank<DrumPatternSet>*>(out));
+  } else if (ok) {
+    ok = SceneManager::loadBankRecord(record, size, *static_cast<Bank<SynthPattern>*>(out));
+  }
+  if (ok) {
+    reads_.fetch_add(1);
+  } else {
+    failures_.fetch_add(1);
+  }
+  return ok;
+}
+
+bool SceneBankPager::writeBank(int track, uint8_t scene, int bank, const void* in) {
+  const std::string& name = names_[scene];
+  if (!storage_ || name.empty()) return false;
+  SongTrack songTrack = static_cast<SongTrack>(track);
+  uint8_t record[SceneManager::kBankRecordMaxSize];
+  size_t size = track == kDrumTrack
+                    ? SceneManager::writeBankRecord(*static_cast<const Bank<DrumPatternSet>*>(in), record, sizeof(record))
+                    : SceneManager::writeBankRecord(*static_cast<const Bank<SynthPattern>*>(in), record, sizeof(record));
+  bool ok = size > 0 &&
+            storage_->writeSceneBanks(name, SceneManager::bankRecordOffset(songTrack, bank), record, size);
+  if (ok) {
+    writes_.fetch_add(1);
+  } else {
+    failures_.fetch_add(1);
+  }
+  return ok;
+}
+
+void SceneBankPager::setScene(const std::string& name) {
+  allocate();
+  if (name == scene()) return;
+  prepareScene(name);
+  commitScene();
+}
+
+void SceneBankPager::prepareScene(const std::string& name, BankFile file) {
+  // here rather than on the first prefetch, which may come from the audio
+  // thread; a failed allocation is retried on the next switch
+  allocate();
+  uint8_t next = 1 - current_.load();
+  prepared_.store(false);
+  // a bank file the last switch asked for is done first, or not at all if
+  // that switch never went through
+  if (!runFileOp(true)) fileOp_.store(NoFileOp);
+  // the pages left from the scene before last still owe it their writes
+  flush();
+  dropPages(next);
+  names_[next] = name;
+  if (file != BankFile::Keep) {
+    fileScene_.store(next);
+    fileOp_.store(file == BankFile::Copy ? CopyFile : RemoveFile);
+  }
+  prepared_.store(true);
+}
+
+void SceneBankPager::prefetchPrepared(SongTrack track, int bank) {
+  if (bank < 0 || bank >= SceneManager::kBankCount || !prepared_.load()) return;
+  uint8_t next = 1 - current_.load();
+  int t = static_cast<int>(track);
+  if (find(t, bank, next) >= 0) return;
+  int page = claimPage(t, -1);
+  if (page < 0) return;
+  pages_[t][page].bank = static_cast<int8_t>(bank);
+  pages_[t][page].scene = next;
+  pages_[t][page].lastUse.store(touch());
+  pages_[t][page].state.store(Requested);
+}
+
+bool SceneBankPager::commitScene() {
+  if (!prepared_.exchange(false)) return false;
+  uint8_t outgoing = current_.load();
+  uint8_t next = 1 - outgoing;
+  if (fileOp_.load() == CopyFile && fileScene_.load() == next) adoptPages(outgoing, next);
+  // the outgoing scene's pages stop being found; queued ones still go out
+  // under its name
+  current_.store(next);
+  return true;
+}
+
+void SceneBankPager::adoptPages(uint8_t from, uint8_t to) {
+  // a save as plays on from the same pages: once the copy is made they hold
+  // what the file does. Queued ones are written under the old name and read
+  // back under the new one.
+  for (int t = 0; t < kTracks; ++t) {
+    for (uint16_t i = 0; i < pageCount_; ++i) {
+      Page& page = pages_[t][i];
+      uint8_t state = Ready;
+      if (page.scene != from || !page.state.compare_exchange_strong(state, Filling)) continue;
+      int requested = find(t, page.bank, to);
+      uint8_t expected = Requested;
+      if (requested >= 0) pages_[t][requested].state.compare_exchange_strong(expected, Free);
+      page.scene = to;
+      page.state.store(Ready);
+    }
+  }
+}
+
+const DrumPatternSet* SceneBankPager::drumPattern(int bank, int pattern) const {
+  if (pattern < 0 || pattern >= Bank<DrumPatternSet>::kPatterns) return nullptr;
+  int page = findReadable(kDrumTrack, bank);
+  return page < 0 ? nullptr : &drumBanks_[page].patterns[pattern];
+}
+
+const SynthPattern* SceneBankPager::synthPattern(int synthIndex, int bank, int pattern) const {
+  if (pattern < 0 || pattern >= Bank<SynthPattern>::kPatterns) return nullptr;
+  int track = synthIndex == 0 ? 0 : 1;
+  int page = findReadable(track, bank);
+  return page < 0 ? nullptr : &synthBanks_[track * pageCount_ + page].patterns[pattern];
+}
+
+void SceneBankPager::prefetch(SongTrack track, int bank, int keep) {
+  uint8_t current = current_.load();
+  if (bank < 0 || bank >= SceneManager::kBankCount || names_[current].empty()) return;
+  int t = static_cast<int>(track);
+  int page = find(t, bank, current);
+  if (page < 0) {
+    page = claimPage(t, keep);
+    if (page < 0) return;
+    pages_[t][page].bank = static_cast<int8_t>(bank);
+    pages_[t][page].scene = current;
+    pages_[t][page].lastUse.store(touch());
+    pages_[t][page].state.store(Requested);
+    return;
+  }
+  pages_[t][page].lastUse.store(touch());
+}
+
+bool SceneBankPager::arrive(SongTrack track, int bank) {
+  int t = static_cast<int>(track);
+  int page = findReadable(t, bank);
+  if (page < 0) {
+    misses_.fetch_add(1);
+    return false;
+  }
+  pages_[t][page].lastUse.store(touch());
+  hits_.fetch_add(1);
+  return true;
+}
+
+bool SceneBankPager::load(SongTrack track, int bank, int keep) {
+  uint8_t current = current_.load();
+  if (bank < 0 || bank >= SceneManager::kBankCount || names_[current].empty()) return false;
+  int t = static_cast<int>(track);
+  int page = find(t, bank, current);
+  if (page >= 0) {
+    uint8_t state = settle(t, page);
+    if (state == Ready || state == Queued) {
+      pages_[t][page].lastUse.store(touch());
+      return true;
+    }
+    // still requested: read it here rather than wait for the writer
+    if (state != Requested || !pages_[t][page].state.compare_exchange_strong(state, Filling)) page = -1;
+  }
+  if (page < 0) page = claimPage(t, keep);
+  if (page < 0) return false;
+  Page& claimed = pages_[t][page];
+  claimed.bank = static_cast<int8_t>(bank);
+  claimed.scene = current;
+  claimed.lastUse.store(touch());
+  runFileOp(true);
+  bool ok = readBank(t, current, bank, content(t, page));
+  claimed.state.store(ok ? Ready : Free);
+  return ok;
+}
+
+bool SceneBankPager::copyOut(int track, int bank, void* out) {
+  if (bank < 0 || bank >= SceneManager::kBankCount) return false;
+  uint8_t current = current_.load();
+  int page = find(track, bank, current);
+  if (page >= 0) {
+    // held in Writing while copied: the audio thread still plays from it,
+    // but nobody takes or writes it meanwhile
+    Page& held = pages_[track][page];
+    uint8_t state = settle(track, page);
+    while ((state == Ready || state == Queued) && !held.state.compare_exchange_strong(state, Writing)) {
+      state = settle(track, page);
+    }
+    if (state == Ready || state == Queued) {
+      // the audio thread may have taken it for another bank after find()
+      bool same = held.bank == bank && held.scene == current;
+      if (same) memcpy(out, content(track, page), bankBytes(track));
+      held.state.store(state);
+      if (same) return true;
+    }
+  }
+  runFileOp(true);
+  return readBank(track, current, bank, out);
+}
+
+bool SceneBankPager::reserveInPage(int track, int bank, const void* in, int keep) {
+  releaseBank(static_cast<SongTrack>(track));
+  uint8_t current = current_.load();
+  if (bank < 0 || bank >= SceneManager::kBankCount || names_[current].empty()) return false;
+  int page = find(track, bank, current);
+  uint8_t state = Free;
+  if (page >= 0) {
+    state = settle(track, page);
+    bool reusable = state == Free || state == Requested || state == Ready || state == Queued;
+    if (!reusable || !pages_[track][page].state.compare_exchange_strong(state, Filling)) {
+      page = -1;
+    } else if (pages_[track][page].bank != bank || pages_[track][page].scene != current) {
+      pages_[track][page].state.store(state);
+      page = -1;
+    }
+  }
+  if (page < 0) {
+    page = claimPage(track, keep);
+    state = Free;
+  }
+  // every page is waiting to be written: this one goes straight out
+  if (page < 0) {
+    runFileOp(true);
+    return writeBank(track, current, bank, in);
+  }
+  // the page keeps its bank until storeInPage(), so a release restores it
+  Reservation& reserved = reserved_[track];
+  reserved.page = static_cast<int8_t>(page);
+  reserved.bank = static_cast<int8_t>(bank);
+  reserved.scene = current;
+  reserved.state = state;
+  return true;
+}
+
+void SceneBankPager::storeInPage(int track, const void* in) {
+  Reservation& reserved = reserved_[track];
+  if (reserved.page < 0) return;
+  Page& claimed = pages_[track][reserved.page];
+  claimed.bank = reserved.bank;
+  claimed.scene = reserved.scene;
+  claimed.lastUse.store(touch());
+  memcpy(content(track, reserved.page), in, bankBytes(track));
+  claimed.state.store(Queued);
+  reserved.page = -1;
+}
+
+bool SceneBankPager::takeBank(int bank, Bank<DrumPatternSet>& out) { return copyOut(kDrumTrack, bank, &out); }
+
+bool SceneBankPager::takeBank(int synthIndex, int bank, Bank<SynthPattern>& out) {
+  return copyOut(synthIndex == 0 ? 0 : 1, bank, &out);
+}
+
+bool SceneBankPager::reserveBank(int bank, const Bank<DrumPatternSet>& in, int keep) {
+  return reserveInPage(kDrumTrack, bank, &in, keep);
+}
+
+bool SceneBankPager::reserveBank(int synthIndex, int bank, const Bank<SynthPattern>& in, int keep) {
+  return reserveInPage(synthIndex == 0 ? 0 : 1, bank, &in, keep);
+}
+
+void SceneBankPager::storeBank(const Bank<DrumPatternSet>& in) { storeInPage(kDrumTrack, &in); }
+
+void SceneBankPager::storeBank(int synthIndex, const Bank<SynthPattern>& in) {
+  storeInPage(synthIndex == 0 ? 0 : 1, &in);
+}
+
+void SceneBankPager::releaseBank(SongTrack track) {
+  Reservation& reserved = reserved_[static_cast<int>(track)];
+  if (reserved.page < 0) return;
+  pages_[static_cast<int>(track)][reserved.page].state.store(reserved.state);
+  reserved.page = -1;
+}
+
+bool SceneBankPager::writeQueued(uint8_t scene) {
+  bool ok = true;
+  for (int t = 0; t < kTracks; ++t) {
+    for (uint16_t i = 0; i < pageCount_; ++i) {
+      Page& page = pages_[t][i];
+      uint8_t state = settle(t, i);
+      // the writer may take it first; then wait for that write instead
+      while (state == Queued && !page.state.compare_exchange_strong(state, Writing)) state = settle(t, i);
+      if (state != Queued) continue;
+      if (page.scene != scene) {
+        page.state.store(Queued);
+        continue;
+      }
+      bool written = writeBank(t, page.scene, page.bank, content(t, i));
+      page.state.store(written ? Ready : Queued);
+      ok = ok && written;
+    }
+  }
+  return ok;
+}
+
+bool SceneBankPager::hasUnwritten(uint8_t scene) const {
+  for (int t = 0; t < kTracks; ++t) {
+    for (uint16_t i = 0; i < pageCount_; ++i) {
+      uint8_t state = pages_[t][i].state.load();
+      if ((state == Queued || state == Writing) && pages_[t][i].scene == scene) return true;
+    }
+  }
+  return false;
+}
+
+bool SceneBankPager::fileOpPending(uint8_t scene) const {
+  return fileOp_.load() != NoFileOp && fileScene_.load() == scene;
+}
+
+bool SceneBankPager::runFileOp(bool wait) {
+  while (true) {
+    uint8_t op = fileOp_.load();
+    if (op == NoFileOp) return true;
+    uint8_t scene = fileScene_.load();
+    // nothing happens to the file before the switch to its scene
+    if (current_.load() != scene) return false;
+    if (op == FileOpRunning) {
+      if (!wait) return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    // a copy takes the banks the outgoing scene still had queued
+    uint8_t outgoing = 1 - scene;
+    if (wait) {
+      writeQueued(outgoing);
+    } else if (hasUnwritten(outgoing)) {
+      return false;
+    }
+    if (!fileOp_.compare_exchange_strong(op, FileOpRunning)) continue;
+    bool ok = storage_ && (op == CopyFile ? storage_->copySceneBanks(names_[outgoing], names_[scene])
+                                          : storage_->removeSceneBanks(names_[scene]));
+    if (!ok) failures_.fetch_add(1);
+    fileOp_.store(NoFileOp);
+    return true;
+  }
+}
+
+bool SceneBankPager::flush() {
+  // the outgoing scene's writes go before a bank file copy, the current
+  // scene's after it
+  uint8_t current = current_.load();
+  bool ok = writeQueued(1 - current);
+  runFileOp(true);
+  return writeQueued(current) && ok;
+}
+
+SceneBankPagerStats SceneBankPager::stats() const {
+  SceneBankPagerStats st;
+  st.pages = pageCount_;
+  st.inPsram = inPsram_;
+  st.hits = hits_.load();
+  st.misses = misses_.load();
+  st.reads = reads_.load();
+  st.writes = writes_.load();
+  st.failures = failures_.load();
+  return st;
+}
+
+bool SceneBankPager::pump() {
+  // writes first, so a bank the editor just left is on the card before
+  // anything reads it back; a scene whose bank file is still to be copied
+  // or removed waits for that
+  for (int t = 0; t < kTracks; ++t) {
+    for (uint16_t i = 0; i < pageCount_; ++i) {
+      uint8_t expected = Queued;
+      if (!pages_[t][i].state.compare_exchange_strong(expected, Writing)) continue;
+      if (fileOpPending(pages_[t][i].scene)) {
+        pages_[t][i].state.store(Queued);
+        continue;
+      }
+      bool ok = writeBank(t, pages_[t][i].scene, pages_[t][i].bank, content(t, i));
+      // a failed write stays queued for the next pump or flush()
+      pages_[t][i].state.store(ok ? Ready : Queued);
+      return ok;
+    }
+  }
+  if (fileOp_.load() != NoFileOp && runFileOp(false)) return true;
+  for (int t = 0; t < kTracks; ++t) {
+    for (uint16_t i = 0; i < pageCount_; ++i) {
+      uint8_t expected = Requested;
+      if (!pages_[t][i].state.compare_exchange_strong(expected, Loading)) continue;
+      if (fileOpPending(pages_[t][i].scene)) {
+        pages_[t][i].state.store(Requested);
+        continue;
+      }
+      bool ok = readBank(t, pages_[t][i].scene, pages_[t][i].bank, content(t, i));
+      pages_[t][i].state.store(ok ? Ready : Free);
+      return true;
+    }
+  }
+  return false;
+}
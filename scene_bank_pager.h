@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "scene_storage.h"
+#include "scenes.h"
+
+struct SceneBankPagerStats {
+  uint32_t pages = 0; // per track
+  bool inPsram = false;
+  uint32_t hits = 0;     // song bars whose bank was paged in when they started
+  uint32_t misses = 0;   // bars that started before it was, and played silent
+  uint32_t reads = 0;
+  uint32_t writes = 0;
+  uint32_t failures = 0; // damaged records and failed reads or writes
+};
+
+// The banks of the current scene that it does not hold, paged in from its
+// bank file (SceneStorage::readSceneBanks()) a few per track: the bank a
+// song bar is playing and the ones prefetched for the bars after it. Pages
+// live in PSRAM when there is any and are allocated by setScene() and
+// prepareScene() on the UI side, so the audio thread never allocates.
+//
+// Everything but pump() belongs to the front side: the audio thread, or the
+// UI holding the audio guard. prefetch() names a bank and the writer task's
+// pump() reads it into a page; a bank the editor leaves comes back through
+// storeBank() and pump() writes it out. Only load(), takeBank(),
+// reserveBank(), flush(), setScene() and prepareScene() ever wait for
+// storage, so the audio thread keeps to the rest. takeBank(), reserveBank()
+// and releaseBank() are the UI's to call without the guard as well.
+//
+// A scene switch waits for the bar line, so the pager knows two scenes: the
+// current one and the one prepared to replace it. Each page belongs to one
+// of them and is read and written under that scene's name; commitScene()
+// swaps the two without touching a page.
+class SceneBankPager {
+public:
+  // pages per track; a drum bank is about 3 KB, a synth bank 1 KB
+  static constexpr uint16_t kPsramPages = 6;
+  static constexpr uint16_t kDramPages = 2;
+
+  explicit SceneBankPager(SceneStorage* storage);
+  ~SceneBankPager();
+
+  SceneBankPager(const SceneBankPager&) = delete;
+  SceneBankPager& operator=(const SceneBankPager&) = delete;
+
+  // Makes 'name' the current scene right away; the pages of the one before
+  // are written if queued and then left to be reused.
+  void setScene(const std::string& name);
+  const std::string& scene() const { return names_[current_.load()]; }
+
+  // Scene switches. prepareScene() names the scene that comes next, writing
+  // and dropping whatever the pages of the scene before last still held; it
+  // may wait for storage, so the UI calls it outside the audio guard.
+  // prefetchPrepared() asks for a bank of that scene ahead of the switch.
+  // commitScene() makes it the current scene and is cheap enough for the
+  // audio thread at the bar line; false if nothing was prepared.
+  //
+  // 'file' says what happens to the bank file of the scene prepared: Copy
+  // gives it the banks of the scene it replaces (save as), Remove starts it
+  // with none (a new scene). The writer task does that once the switch is
+  // committed and the outgoing scene's queued banks are written; until then
+  // the new scene's pages neither read from nor write to the card.
+  enum class BankFile : uint8_t { Keep, Copy, Remove };
+  void prepareScene(const std::string& name, BankFile file = BankFile::Keep);
+  void prefetchPrepared(SongTrack track, int bank);
+  bool commitScene();
+
+  // Playback. nullptr until the bank is paged in.
+  const DrumPatternSet* drumPattern(int bank, int pattern) const;
+  const SynthPattern* synthPattern(int synthIndex, int bank, int pattern) const;
+  // Queues 'bank' for the writer task unless it is paged in or on its way.
+  // It may take the page of any bank but 'keep'.
+  void prefetch(SongTrack track, int bank, int keep);
+  // A song bar starts on 'bank': counts a hit or a miss.
+  bool arrive(SongTrack track, int bank);
+  // Pages 'bank' in on the calling thread, for offline renders.
+  bool load(SongTrack track, int bank, int keep);
+
+  // Bank switches in the editor. take copies a bank out, from its page or
+  // straight from storage. reserve finds a page for the bank being left,
+  // taking any but that of 'keep', the bank the audio thread plays; with
+  // every page still to be written it writes the bank out itself. store,
+  // under the guard, fills the reserved page and queues its write; release
+  // gives the page back unused.
+  bool takeBank(int bank, Bank<DrumPatternSet>& out);
+  bool takeBank(int synthIndex, int bank, Bank<SynthPattern>& out);
+  bool reserveBank(int bank, const Bank<DrumPatternSet>& in, int keep);
+  bool reserveBank(int synthIndex, int bank, const Bank<SynthPattern>& in, int keep);
+  void storeBank(const Bank<DrumPatternSet>& in);
+  void storeBank(int synthIndex, const Bank<SynthPattern>& in);
+  void releaseBank(SongTrack track);
+
+  // Writes every queued bank on the calling thread and waits for the one
+  // being written. False if a write failed.
+  bool flush();
+  SceneBankPagerStats stats() const;
+
+  // Writer task. Returns true if it read or wrote a bank.
+  bool pump();
+
+private:
+  enum PageState : uint8_t { Free, Requested, Loading, Ready, Filling, Queued, Writing };
+  enum FileOp : uint8_t { NoFileOp, CopyFile, RemoveFile, FileOpRunning };
+  static constexpr int kTracks = SongPosition::kTrackCount;
+
+  struct Page {
+    std::atomic<uint8_t> state{Free};
+    // set by whoever holds the page in Filling, as is the names_ entry it
+    // belongs to; find() reads them while another thread may
+    std::atomic<int8_t> bank{-1};
+    std::atomic<uint8_t> scene{0};
+    // bumped by the audio thread and the UI alike; only orders evictions
+    std::atomic<uint32_t> lastUse{0};
+  };
+
+  // a page the UI holds in Filling between reserveBank() and storeBank()
+  struct Reservation {
+    int8_t page = -1;
+    int8_t bank = -1;
+    uint8_t scene = 0;
+    uint8_t state = Free; // given back on release
+  };
+
+  bool allocate();
+  void* content(int track, int page) const;
+  size_t bankBytes(int track) const;
+  uint32_t touch();
+  int find(int track, int bank, uint8_t scene) const;
+  int findReadable(int track, int bank) const;
+  int claimPage(int track, int keep);
+  int settle(int track, int page);
+  void dropPages(uint8_t scene);
+  void adoptPages(uint8_t from, uint8_t to);
+  bool readBank(int track, uint8_t scene, int bank, void* out);
+  bool writeBank(int track, uint8_t scene, int bank, const void* in);
+  bool copyOut(int track, int bank, void* out);
+  bool reserveInPage(int track, int bank, const void* in, int keep);
+  void storeInPage(int track, const void* in);
+  bool writeQueued(uint8_t scene);
+  bool hasUnwritten(uint8_t scene) const;
+  bool fileOpPending(uint8_t scene) const;
+  bool runFileOp(bool wait);
+
+  SceneStorage* storage_;
+  // the current scene and the prepared or previous one; an entry is renamed
+  // only while none of its pages is in use
+  std::string names_[2];
+  std::atomic<uint8_t> current_{0};
+  std::atomic<bool> prepared_{false};
+  std::atomic<uint8_t> fileOp_{NoFileOp};
+  std::atomic<uint8_t> fileScene_{0}; // the names_ entry fileOp_ is for, set before it
+
+  void* pool_ = nullptr;
+  Bank<DrumPatternSet>* drumBanks_ = nullptr;  // pageCount_
+  Bank<SynthPattern>* synthBanks_ = nullptr;   // pageCount_ for synth A, then B
+  // set once the pool is; only the UI allocates, the other sides read it
+  std::atomic<uint16_t> pageCount_{0};
+  bool inPsram_ = false;
+  Page pages_[kTracks][kPsramPages];
+  Reservation reserved_[kTracks];
+  std::atomic<uint32_t> useClock_{0};
+
+  std::atomic<uint32_t> hits_{0};
+  std::atomic<uint32_t> misses_{0};
+  std::atomic<uint32_t> reads_{0};
+  std::atomic<uint32_t> writes_{0};
+  std::atomic<uint32_t> failures_{0};
+};
@@ -0,0 +1,458 @@
+#include "scenes.h"
+
+// Layout, little-endian throughout:
+//   header   "MASC", u16 version, u16 header size, u32 payload size,
+//            u32 CRC-32 of the payload
+//   drums    per pattern, per voice: u16 hit mask, u16 accent mask,
+//            i8 swing, i8 timing[16]
+//   synth    A then B, per pattern: u8 note+1 [16] (0 = rest), u16 slide
+//            mask, u16 accent mask, i8 swing, i8 timing[16]
+//   song     u8 length, then Song::kMaxPositions x i8[3] song cells
+//            (bank * 8 + pattern, -1 = empty); version 1 stored only
+//            'length' entries
+//   state    u8 drum pattern, u8 synth pattern[2], u8 drum bank,
+//            u8 synth bank[2], f32 bpm, u8 song mode, u8 song position,
+//            u8 drum mute mask, u8 synth mute mask, then per synth f32
+//            cutoff, resonance, env amount, env decay and u8 osc type
+// Since version 2 every section has a fixed size and offset, so a saved file
+// can be patched in place section by section (see dirtyBinaryRanges()).
+// Anything that changes this layout bumps kVersion.
+//
+// Bank records, for the banks a scene does not hold:
+//   header   "MABK", u16 version, u16 payload size, u32 CRC-32 of the payload
+//   payload  one bank, drum or synth, laid out as in the scene image
+// A bank file is kBankCount drum records, then kBankCount per synth, each
+// padded to its track's record size.
+
+namespace {
+constexpr uint8_t kMagic[4] = {'M', 'A', 'S', 'C'};
+constexpr uint16_t kVersion = 2;
+constexpr size_t kHeaderSize = 16;
+
+constexpr size_t kDrumVoiceSize = 2 + 2 + 1 + DrumPattern::kSteps;
+constexpr size_t kDrumPatternSize = DrumPatternSet::kVoices * kDrumVoiceSize;
+constexpr size_t kSynthPatternSize = SynthPattern::kSteps + 2 + 2 + 1 + SynthPattern::kSteps;
+constexpr size_t kSongSize = 1 + Song::kMaxPositions * SongPosition::kTrackCount;
+constexpr size_t kSynthParamsSize = 4 * 4 + 1;
+constexpr size_t kStateSize = 6 + 4 + 2 + 2 + 2 * kSynthParamsSize;
+
+// section offsets in the image, header included
+constexpr size_t kDrumOffset = kHeaderSize;
+constexpr size_t kSynthOffset = kDrumOffset + Bank<DrumPatternSet>::kPatterns * kDrumPatternSize;
+constexpr size_t kSongOffset = kSynthOffset + 2 * Bank<SynthPattern>::kPatterns * kSynthPatternSize;
+constexpr size_t kStateOffset = kSongOffset + kSongSize;
+constexpr size_t kImageSize = kStateOffset + kStateSize;
+static_assert(kImageSize <= SceneManager::kSceneBinaryMaxSize, "kSceneBinaryMaxSize too small for the layout");
+
+constexpr uint8_t kBankMagic[4] = {'M', 'A', 'B', 'K'};
+constexpr uint16_t kBankVersion = 1;
+constexpr size_t kBankHeaderSize = 12;
+constexpr size_t kDrumRecordSize = kBankHeaderSize + Bank<DrumPatternSet>::kPatterns * kDrumPatternSize;
+constexpr size_t kSynthRecordSize = kBankHeaderSize + Bank<SynthPattern>::kPatterns * kSynthPatternSize;
+static_assert(kDrumRecordSize <= SceneManager::kBankRecordMaxSize && kSynthRecordSize <= SceneManager::kBankRecordMaxSize,
+              "kBankRecordMaxSize too small for the layout");
+
+// CRC-32 (IEEE), nibble table to stay small in flash
+uint32_t crc32(const uint8_t* data, size_t size) {
+  static constexpr uint32_t kTable[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+      0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+  };
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ kTable[crc & 0x0F];
+    crc = (crc >> 4) ^ kTable[crc & 0x0F];
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+struct BinaryWriter {
+  uint8_t* out;
+  size_t capacity;
+  size_t pos = 0;
+  bool ok = true;
+
+  void u8(uint8_t v) {
+    if (pos >= capacity) {
+      ok = false;
+      return;
+    }
+    out[pos++] = v;
+  }
+  void i8(int8_t v) { u8(static_cast<uint8_t>(v)); }
+  void u16(uint16_t v) {
+    u8(static_cast<uint8_t>(v & 0xFF));
+    u8(static_cast<uint8_t>(v >> 8));
+  }
+  void u32(uint32_t v) {
+    u16(static_cast<uint16_t>(v & 0xFFFF));
+    u16(static_cast<uint16_t>(v >> 16));
+  }
+  void f32(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    u32(bits);
+  }
+};
+
+struct BinaryReader {
+  const uint8_t* data;
+  size_t size;
+  size_t pos = 0;
+  bool ok = true;
+
+  uint8_t u8() {
+    if (pos >= size) {
+      ok = false;
+      return 0;
+    }
+    return data[pos++];
+  }
+  int8_t i8() { return static_cast<int8_t>(u8()); }
+  uint16_t u16() {
+    uint16_t lo = u8();
+    return static_cast<uint16_t>(lo | (u8() << 8));
+  }
+  uint32_t u32() {
+    uint32_t lo = u16();
+    return lo | (static_cast<uint32_t>(u16()) << 16);
+  }
+  float f32() {
+    uint32_t bits = u32();
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+};
+
+int clampBankIndex(int value) {
+  return value < SceneManager::kBankCount ? value : SceneManager::kBankCount - 1;
+}
+
+int8_t clampTiming(int8_t value) {
+  if (value < -kMaxStepTiming) return -kMaxStepTiming;
+  if (value > kMaxStepTiming) return kMaxStepTiming;
+  return value;
+}
+
+int8_t clampSwing(int8_t value) {
+  if (value < 0) return 0;
+  if (value > kMaxStepSwing) return kMaxStepSwing;
+  return value;
+}
+
+void writeDrumPatternSet(BinaryWriter& w, const DrumPatternSet& set) {
+  for (int v = 0; v < DrumPatternSet::kVoices; ++v) {
+    const DrumPattern& pattern = set.voices[v];
+    uint16_t hit = 0;
+    uint16_t accent = 0;
+    for (int i = 0; i < DrumPattern::kSteps; ++i) {
+      if (pattern.steps[i].hit) hit |= static_cast<uint16_t>(1u << i);
+      if (pattern.steps[i].accent) accent |= static_cast<uint16_t>(1u << i);
+    }
+    w.u16(hit);
+    w.u16(accent);
+    w.i8(pattern.swing);
+    for (int i = 0; i < DrumPattern::kSteps; ++i) w.i8(pattern.steps[i].timing);
+  }
+}
+
+void readDrumPatternSet(BinaryReader& r, DrumPatternSet& set) {
+  for (int v = 0; v < DrumPatternSet::kVoices; ++v) {
+    DrumPattern& pattern = set.voices[v];
+    uint16_t hit = r.u16();
+    uint16_t accent = r.u16();
+    pattern.swing = clampSwing(r.i8());
+    for (int i = 0; i < DrumPattern::kSteps; ++i) {
+      pattern.steps[i].hit = (hit >> i) & 1u;
+      pattern.steps[i].accent = (accent >> i) & 1u;
+      pattern.steps[i].timing = clampTiming(r.i8());
+    }
+  }
+}
+
+void writeSynthPattern(BinaryWriter& w, const SynthPattern& pattern) {
+  uint16_t slide = 0;
+  uint16_t accent = 0;
+  for (int i = 0; i < SynthPattern::kSteps; ++i) {
+    int note = pattern.steps[i].note;
+    w.u8(note < 0 || note > 127 ? 0 : static_cast<uint8_t>(note + 1));
+    if (pattern.steps[i].slide) slide |= static_cast<uint16_t>(1u << i);
+    if (pattern.steps[i].accent) accent |= static_cast<uint16_t>(1u << i);
+  }
+  w.u16(slide);
+  w.u16(accent);
+  w.i8(pattern.swing);
+  for (int i = 0; i < SynthPattern::kSteps; ++i) w.i8(pattern.steps[i].timing);
+}
+
+void readSynthPattern(BinaryReader& r, SynthPattern& pattern) {
+  for (int i = 0; i < SynthPattern::kSteps; ++i) {
+    uint8_t stored = r.u8();
+    pattern.steps[i].note = stored == 0 || stored > 128 ? -1 : stored - 1;
+  }
+  uint16_t slide = r.u16();
+  uint16_t accent = r.u16();
+  pattern.swing = clampSwing(r.i8());
+  for (int i = 0; i < SynthPattern::kSteps; ++i) {
+    pattern.steps[i].slide = (slide >> i) & 1u;
+    pattern.steps[i].accent = (accent >> i) & 1u;
+    pattern.steps[i].timing = clampTiming(r.i8());
+  }
+}
+} // namespace
+
+size_t SceneManager::writeSceneBinary(uint8_t* out, size_t capacity) const {
+  if (!out || capacity < kHeaderSize) return 0;
+  BinaryWriter w{out, capacity};
+  w.pos = kHeaderSize;
+
+  for (int p = 0; p < Bank<DrumPatternSet>::kPatterns; ++p) writeDrumPatternSet(w, scene_.drumBank.patterns[p]);
+  for (int p = 0; p < Bank<SynthPattern>::kPatterns; ++p) writeSynthPattern(w, scene_.synthABank.patterns[p]);
+  for (int p = 0; p < Bank<SynthPattern>::kPatterns; ++p) writeSynthPattern(w, scene_.synthBBank.patterns[p]);
+
+  int songLen = songLength();
+  w.u8(static_cast<uint8_t>(songLen));
+  for (int i = 0; i < Song::kMaxPositions; ++i) {
+    for (int t = 0; t < SongPosition::kTrackCount; ++t) {
+      w.i8(i < songLen ? scene_.song.positions[i].patterns[t] : -1);
+    }
+  }
+
+  w.u8(static_cast<uint8_t>(drumPatternIndex_));
+  w.u8(static_cast<uint8_t>(synthPatternIndex_[0]));
+  w.u8(static_cast<uint8_t>(synthPatternIndex_[1]));
+  w.u8(static_cast<uint8_t>(drumBankIndex_));
+  w.u8(static_cast<uint8_t>(synthBankIndex_[0]));
+  w.u8(static_cast<uint8_t>(synthBankIndex_[1]));
+  w.f32(bpm_);
+  w.u8(songMode_ ? 1 : 0);
+  w.u8(static_cast<uint8_t>(clampSongPosition(songPosition_)));
+  uint8_t drumMute = 0;
+  for (int i = 0; i < DrumPatternSet::kVoices; ++i) {
+    if (drumMute_[i]) drumMute |= static_cast<uint8_t>(1u << i);
+  }
+  w.u8(drumMute);
+  w.u8(static_cast<uint8_t>((synthMute_[0] ? 1 : 0) | (synthMute_[1] ? 2 : 0)));
+  for (int i = 0; i < 2; ++i) {
+    w.f32(synthParameters_[i].cutoff);
+    w.f32(synthParameters_[i].resonance);
+    w.f32(synthParameters_[i].envAmount);
+    w.f32(synthParameters_[i].envDecay);
+    w.u8(static_cast<uint8_t>(synthParameters_[i].oscType));
+  }
+  if (!w.ok) return 0;
+
+  size_t size = w.pos;
+  uint32_t payloadSize = static_cast<uint32_t>(size - kHeaderSize);
+  w.pos = 0;
+  for (uint8_t b : kMagic) w.u8(b);
+  w.u16(kVersion);
+  w.u16(static_cast<uint16_t>(kHeaderSize));
+  w.u32(payloadSize);
+  w.u32(crc32(out + kHeaderSize, payloadSize));
+  return size;
+}
+
+bool SceneManager::loadSceneBinary(const uint8_t* data, size_t size) {
+  if (!data || size < kHeaderSize || memcmp(data, kMagic, sizeof(kMagic)) != 0) return false;
+  BinaryReader header{data, kHeaderSize};
+  header.pos = sizeof(kMagic);
+  uint16_t version = header.u16();
+  uint16_t headerSize = header.u16();
+  uint32_t payloadSize = header.u32();
+  uint32_t crc = header.u32();
+  // newer files may grow the header, never shrink it
+  if (version < 1 || version > kVersion || headerSize < kHeaderSize || headerSize > size) return false;
+  if (payloadSize > size - headerSize) return false;
+  if (crc32(data + headerSize, payloadSize) != crc) return false;
+
+  BinaryReader r{data + headerSize, payloadSize};
+  Scene loaded{};
+  for (int p = 0; p < Bank<DrumPatternSet>::kPatterns; ++p) readDrumPatternSet(r, loaded.drumBank.patterns[p]);
+  for (int p = 0; p < Bank<SynthPattern>::kPatterns; ++p) readSynthPattern(r, loaded.synthABank.patterns[p]);
+  for (int p = 0; p < Bank<SynthPattern>::kPatterns; ++p) readSynthPattern(r, loaded.synthBBank.patterns[p]);
+
+  clearSongData(loaded.song);
+  loaded.song.length = clampSongLength(r.u8());
+  int storedPositions = version == 1 ? loaded.song.length : Song::kMaxPositions;
+  for (int i = 0; i < storedPositions; ++i) {
+    for (int t = 0; t < SongPosition::kTrackCount; ++t) {
+      int8_t pattern = r.i8();
+      if (i >= loaded.song.length) continue;
+      loaded.song.positions[i].patterns[t] = pattern >= 0 && pattern < kSongPatternCount ? pattern : -1;
+    }
+  }
+
+  int drumPatternIndex = r.u8();
+  int synthPatternIndexA = r.u8();
+  int synthPatternIndexB = r.u8();
+  int drumBankIndex = r.u8();
+  int synthBankIndexA = r.u8();
+  int synthBankIndexB = r.u8();
+  float bpm = r.f32();
+  bool songMode = r.u8() != 0;
+  int songPosition = r.u8();
+  uint8_t drumMute = r.u8();
+  uint8_t synthMute = r.u8();
+  SynthParameters params[2];
+  for (int i = 0; i < 2; ++i) {
+    params[i].cutoff = r.f32();
+    params[i].resonance = r.f32();
+    params[i].envAmount = r.f32();
+    params[i].envDecay = r.f32();
+    params[i].oscType = r.u8();
+  }
+  if (!r.ok) return false;
+
+  scene_ = loaded;
+  drumPatternIndex_ = clampPatternIndex(drumPatternIndex);
+  synthPatternIndex_[0] = clampPatternIndex(synthPatternIndexA);
+  synthPatternIndex_[1] = clampPatternIndex(synthPatternIndexB);
+  drumBankIndex_ = clampBankIndex(drumBankIndex);
+  synthBankIndex_[0] = clampBankIndex(synthBankIndexA);
+  synthBankIndex_[1] = clampBankIndex(synthBankIndexB);
+  for (int i = 0; i < DrumPatternSet::kVoices; ++i) drumMute_[i] = (drumMute >> i) & 1u;
+  synthMute_[0] = (synthMute & 1u) != 0;
+  synthMute_[1] = (synthMute & 2u) != 0;
+  synthParameters_[0] = params[0];
+  synthParameters_[1] = params[1];
+  sanitizeSynthParameters(synthParameters_[0]);
+  sanitizeSynthParameters(synthParameters_[1]);
+  setSongLength(scene_.song.length);
+  songPosition_ = clampSongPosition(songPosition);
+  songMode_ = songMode;
+  setBpm(bpm);
+  clearEditHistory();
+  markClean();
+  return true;
+}
+
+size_t SceneManager::dirtyBinaryRanges(BinaryRange* out, size_t maxRanges) const {
+  if (!out || maxRanges == 0) return 0;
+  size_t count = 0;
+  bool overflow = false;
+  auto add = [&](size_t offset, size_t size) {
+    if (count > 0 && out[count - 1].offset + out[count - 1].size == offset) {
+      out[count - 1].size = static_cast<uint16_t>(out[count - 1].size + size);
+    } else if (count < maxRanges) {
+      out[count].offset = static_cast<uint16_t>(offset);
+      out[count].size = static_cast<uint16_t>(size);
+      ++count;
+    } else {
+      overflow = true;
+    }
+  };
+
+  // the header's CRC changes with any edit
+  add(0, kHeaderSize);
+  for (int p = 0; p < Bank<DrumPatternSet>::kPatterns; ++p) {
+    if (dirty_.drumPatterns & (1u << p)) add(kDrumOffset + p * kDrumPatternSize, kDrumPatternSize);
+  }
+  for (int synth = 0; synth < 2; ++synth) {
+    for (int p = 0; p < Bank<SynthPattern>::kPatterns; ++p) {
+      if (!(dirty_.synthPatterns[synth] & (1u << p))) continue;
+      add(kSynthOffset + (synth * Bank<SynthPattern>::kPatterns + p) * kSynthPatternSize, kSynthPatternSize);
+    }
+  }
+  if (dirty_.song) add(kSongOffset, kSongSize);
+  if (dirty_.state) add(kStateOffset, kStateSize);
+
+  if (overflow || (count == 1 && out[0].size == kImageSize)) return 0;
+  return count;
+}
+
+namespace {
+
+size_t finishBankRecord(uint8_t* out, BinaryWriter& w) {
+  if (!w.ok) return 0;
+  size_t size = w.pos;
+  uint16_t payloadSize = static_cast<uint16_t>(size - kBankHeaderSize);
+  w.pos = 0;
+  for (uint8_t b : kBankMagic) w.u8(b);
+  w.u16(kBankVersion);
+  w.u16(payloadSize);
+  w.u32(crc32(out + kBankHeaderSize, payloadSize));
+  return size;
+}
+
+// 1 for a record, 0 for one never written, -1 if damaged
+int openBankRecord(const uint8_t* data, size_t size, BinaryReader& payload) {
+  if (!data || size < kBankHeaderSize) return -1;
+  if (memcmp(data, kBankMagic, sizeof(kBankMagic)) != 0) {
+    for (size_t i = 0; i < kBankHeaderSize; ++i) {
+      if (data[i] != 0) return -1;
+    }
+    return 0;
+  }
+  BinaryReader header{data, kBankHeaderSize};
+  header.pos = sizeof(kBankMagic);
+  uint16_t version = header.u16();
+  uint16_t payloadSize = header.u16();
+  uint32_t crc = header.u32();
+  if (version != kBankVersion || payloadSize > size - kBankHeaderSize) return -1;
+  if (crc32(data + kBankHeaderSize, payloadSize) != crc) return -1;
+  payload = BinaryReader{data + kBankHeaderSize, payloadSize};
+  return 1;
+}
+
+} // namespace
+
+size_t SceneManager::bankRecordSize(SongTrack track) {
+  return track == SongTrack::Drums ? kDrumRecordSize : kSynthRecordSize;
+}
+
+size_t SceneManager::bankRecordOffset(SongTrack track, int bank) {
+  bank = clampBankIndex(bank < 0 ? 0 : bank);
+  if (track == SongTrack::Drums) return bank * kDrumRecordSize;
+  size_t synthStart = kBankCount * kDrumRecordSize;
+  int synth = track == SongTrack::SynthA ? 0 : 1;
+  return synthStart + (synth * kBankCount + bank) * kSynthRecordSize;
+}
+
+size_t SceneManager::writeBankRecord(const Bank<DrumPatternSet>& bank, uint8_t* out, size_t capacity) {
+  if (!out || capacity < kBankHeaderSize) return 0;
+  BinaryWriter w{out, capacity};
+  w.pos = kBankHeaderSize;
+  for (int p = 0; p < Bank<DrumPatternSet>::kPatterns; ++p) writeDrumPatternSet(w, bank.patterns[p]);
+  return finishBankRecord(out, w);
+}
+
+size_t SceneManager::writeBankRecord(const Bank<SynthPattern>& bank, uint8_t* out, size_t capacity) {
+  if (!out || capacity < kBankHeaderSize) return 0;
+  BinaryWriter w{out, capacity};
+  w.pos = kBankHeaderSize;
+  for (int p = 0; p < Bank<SynthPattern>::kPatterns; ++p) writeSynthPattern(w, bank.patterns[p]);
+  return finishBankRecord(out, w);
+}
+
+bool SceneManager::loadBankRecord(const uint8_t* data, size_t size, Bank<DrumPatternSet>& bank) {
+  BinaryReader r{nullptr, 0};
+  int opened = openBankRecord(data, size, r);
+  if (opened < 0) return false;
+  Bank<DrumPatternSet> loaded{};
+  if (opened > 0) {
+    for (int p = 0; p < Bank<DrumPatternSet>::kPatterns; ++p) readDrumPatternSet(r, loaded.patterns[p]);
+    if (!r.ok) return false;
+  }
+  bank = loaded;
+  return true;
+}
+
+bool SceneManager::loadBankRecord(const uint8_t* data, size_t size, Bank<SynthPattern>& bank) {
+  BinaryReader r{nullptr, 0};
+  int opened = openBankRecord(data, size, r);
+  if (opened < 0) return false;
+  Bank<SynthPattern> loaded{};
+  if (opened > 0) {
+    for (int p = 0; p < Bank<SynthPattern>::kPatterns; ++p) readSynthPattern(r, loaded.patterns[p]);
+    if (!r.ok) return false;
+  } else {
+    for (int p = 0; p < Bank<SynthPattern>::kPatterns; ++p) {
+      for (int i = 0; i < SynthPattern::kSteps; ++i) loaded.patterns[p].steps[i].note = -1;
+    }
+  }
+  bank = loaded;
+  return true;
+}
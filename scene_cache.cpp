@@ -0,0 +1,144 @@
+#include "scene_cache.h"
+
+#include <cstdlib>
+#include <new>
+
+#if defined(ARDUINO)
+#include <esp_heap_caps.h>
+#endif
+
+SceneCache::SceneCache(SceneStorage* storage) : storage_(storage) {}
+
+SceneCache::~SceneCache() {
+  if (entries_) {
+    for (uint16_t i = 0; i <= entryCount_; ++i) entries_[i].~SceneManager();
+    free(entries_);
+  }
+  delete[] names_;
+  delete[] lastUse_;
+}
+
+bool SceneCache::allocate() {
+  if (entries_) return true;
+  // one extra entry for the prefetch to load into
+#if defined(ARDUINO)
+  void* pool = heap_caps_malloc((kPsramEntries + 1) * sizeof(SceneManager), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  uint16_t count = kPsramEntries;
+  if (pool) {
+    inPsram_ = true;
+  } else {
+    pool = heap_caps_malloc((kDramEntries + 1) * sizeof(SceneManager), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    count = kDramEntries;
+  }
+#else
+  // desktop memory is not the constraint; keep the PSRAM sizing
+  void* pool = malloc((kPsramEntries + 1) * sizeof(SceneManager));
+  uint16_t count = kPsramEntries;
+#endif
+  if (!pool) return false;
+  entries_ = static_cast<SceneManager*>(pool);
+  for (uint16_t i = 0; i <= count; ++i) new (&entries_[i]) SceneManager();
+  names_ = new std::string[count];
+  lastUse_ = new uint32_t[count]();
+  entryCount_ = count;
+  return true;
+}
+
+int SceneCache::find(const std::string& name) const {
+  if (name.empty()) return -1;
+  for (uint16_t i = 0; i < entryCount_; ++i) {
+    if (names_[i] == name) return i;
+  }
+  return -1;
+}
+
+int SceneCache::slotFor(const std::string& name) {
+  int slot = find(name);
+  if (slot >= 0) return slot;
+  int oldest = 0;
+  for (uint16_t i = 0; i < entryCount_; ++i) {
+    if (names_[i].empty()) return i;
+    if (lastUse_[i] < lastUse_[oldest]) oldest = i;
+  }
+  ++evictions_;
+  return oldest;
+}
+
+void SceneCache::adoptPrefetch() {
+  if (prefetchState_.load() != Ready) return;
+  if (prefetchOk_.load() && !discardPrefetch_ && find(prefetchName_) < 0) {
+    int slot = slotFor(prefetchName_);
+    entries_[slot] = entries_[entryCount_];
+    names_[slot] = prefetchName_;
+    lastUse_[slot] = ++useClock_;
+    ++prefetched_;
+  }
+  prefetchState_.store(Idle);
+}
+
+bool SceneCache::lookup(const std::string& name, SceneManager& out) {
+  if (!allocate()) return false;
+  adoptPrefetch();
+  int slot = find(name);
+  if (slot < 0) {
+    ++misses_;
+    return false;
+  }
+  out = entries_[slot];
+  lastUse_[slot] = ++useClock_;
+  ++hits_;
+  return true;
+}
+
+void SceneCache::store(const std::string& name, const SceneManager& scene) {
+  if (name.empty() || !allocate()) return;
+  adoptPrefetch();
+  int slot = slotFor(name);
+  entries_[slot] = scene;
+  names_[slot] = name;
+  lastUse_[slot] = ++useClock_;
+  // whatever the prefetch reads from storage is older than this
+  if (name == prefetchName_) discardPrefetch_ = true;
+}
+
+void SceneCache::invalidate(const std::string& name) {
+  if (!entries_) return;
+  adoptPrefetch();
+  int slot = find(name);
+  if (slot >= 0) names_[slot].clear();
+  if (name == prefetchName_) discardPrefetch_ = true;
+}
+
+void SceneCache::prefetch(const std::string& name) {
+  if (name.empty() || !storage_ || !allocate()) return;
+  adoptPrefetch();
+  if (find(name) >= 0) return;
+  uint8_t state = prefetchState_.load();
+  if ((state == Requested || state == Loading) && name == prefetchName_) return;
+  // a request the writer has not started on yet gives way to the newer one
+  uint8_t expected = Requested;
+  if (state != Idle && !prefetchState_.compare_exchange_strong(expected, Idle)) return;
+  prefetchName_ = name;
+  discardPrefetch_ = false;
+  prefetchState_.store(Requested);
+}
+
+SceneCacheStats SceneCache::stats() const {
+  SceneCacheStats st;
+  st.entries = entryCount_;
+  st.inPsram = inPsram_;
+  st.hits = hits_;
+  st.misses = misses_;
+  st.prefetched = prefetched_;
+  st.evictions = evictions_;
+  return st;
+}
+
+bool SceneCache::pump() {
+  uint8_t expected = Requested;
+  if (!prefetchState_.compare_exchange_strong(expected, Loading)) return false;
+  bool ok = storage_->readSceneNamed(prefetchName_, entries_[entryCount_]);
+  prefetchOk_.store(ok);
+  prefetchState_.store(Ready);
+  return ok;
+}
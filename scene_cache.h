@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "scene_storage.h"
+#include "scenes.h"
+
+struct SceneCacheStats {
+  uint32_t entries = 0; // capacity
+  bool inPsram = false;
+  uint32_t hits = 0;
+  uint32_t misses = 0;
+  uint32_t prefetched = 0; // background loads that made it into the cache
+  uint32_t evictions = 0;
+};
+
+// Parsed scenes kept in memory so switching between them during a set does
+// not wait for the card. Entries live in PSRAM when there is any, otherwise
+// a couple fit in internal RAM; the least recently used one goes first.
+//
+// Everything but pump() belongs to the UI side. prefetch() names a scene,
+// the writer task's pump() loads it into a spare entry through
+// SceneStorage::readSceneNamed(), and the next UI call adopts it.
+class SceneCache {
+public:
+  // entries: about 6 KB each
+  static constexpr uint16_t kPsramEntries = 8;
+  static constexpr uint16_t kDramEntries = 2;
+
+  explicit SceneCache(SceneStorage* storage);
+  ~SceneCache();
+
+  SceneCache(const SceneCache&) = delete;
+  SceneCache& operator=(const SceneCache&) = delete;
+
+  // UI side. lookup() copies a cached scene into 'out'.
+  bool lookup(const std::string& name, SceneManager& out);
+  void store(const std::string& name, const SceneManager& scene);
+  void invalidate(const std::string& name);
+  // Loads 'name' in the background unless it is cached or already on its way.
+  void prefetch(const std::string& name);
+  SceneCacheStats stats() const;
+
+  // Writer task. Returns true if it loaded a scene.
+  bool pump();
+
+private:
+  enum PrefetchState : uint8_t { Idle, Requested, Loading, Ready };
+
+  bool allocate();
+  int find(const std::string& name) const;
+  int slotFor(const std::string& name);
+  void adoptPrefetch();
+
+  SceneStorage* storage_;
+  SceneManager* entries_ = nullptr; // entryCount_ cached scenes, then the prefetch target
+  std::string* names_ = nullptr;
+  uint32_t* lastUse_ = nullptr;
+  uint16_t entryCount_ = 0;
+  bool inPsram_ = false;
+  uint32_t useClock_ = 0;
+
+  std::string prefetchName_; // written by the UI side only while Idle
+  std::atomic<uint8_t> prefetchState_{Idle};
+  std::atomic<bool> prefetchOk_{false};
+  bool discardPrefetch_ = false; // stored or invalidated since it was requested
+
+  uint32_t hits_ = 0;
+  uint32_t misses_ = 0;
+  uint32_t prefetched_ = 0;
+  uint32_t evictions_ = 0;
+};
@@ -0,0 +1,86 @@
+#include "scene_journal.h"
+
+void SceneJournal::clear() {
+  // depth_ is left alone: a group may be open around whatever cleared it
+  start_ = 0;
+  undoCount_ = 0;
+  redoCount_ = 0;
+  groupStarted_ = false;
+  groupEntries_ = 0;
+}
+
+void SceneJournal::beginGroup() {
+  if (depth_ < 255) ++depth_;
+}
+
+void SceneJournal::endGroup() {
+  if (depth_ == 0) return;
+  if (--depth_ > 0) return;
+  groupStarted_ = false;
+  groupEntries_ = 0;
+  discardGroup_ = false;
+}
+
+void SceneJournal::record(Target target, uint8_t a, uint8_t b, uint8_t c, uint32_t before, uint32_t after) {
+  if (discardGroup_) return;
+  bool afterUndo = redoCount_ > 0;
+  redoCount_ = 0;
+
+  if (undoCount_ > 0) {
+    Entry& last = at(undoCount_ - 1);
+    bool sameCell = targetOf(last) == target && last.a == a && last.b == b && last.c == c;
+    bool inOpenGroup = depth_ > 0 && groupStarted_;
+    bool knobTurn = depth_ == 0 && !afterUndo && target == SynthParam && startsGroup(last);
+    if (sameCell && (inOpenGroup || knobTurn)) {
+      last.after = after;
+      return;
+    }
+  }
+
+  if (undoCount_ == kCapacity) {
+    if (groupStarted_ && groupEntries_ >= undoCount_) {
+      // one edit bigger than the whole ring cannot be undone at all
+      clear();
+      discardGroup_ = true;
+      ++droppedEdits_;
+      return;
+    }
+    dropOldestEdit();
+  }
+
+  Entry& entry = at(undoCount_);
+  bool start = depth_ == 0 || !groupStarted_;
+  entry.target = static_cast<uint8_t>(target | (start ? kGroupStart : 0));
+  entry.a = a;
+  entry.b = b;
+  entry.c = c;
+  entry.before = before;
+  entry.after = after;
+  ++undoCount_;
+  if (depth_ > 0) {
+    groupStarted_ = true;
+    ++groupEntries_;
+  }
+}
+
+void SceneJournal::dropOldestEdit() {
+  do {
+    start_ = static_cast<uint16_t>((start_ + 1) % kCapacity);
+    --undoCount_;
+  } while (undoCount_ > 0 && !startsGroup(at(0)));
+  ++droppedEdits_;
+}
+
+bool SceneJournal::canUndo() const { return undoCount_ > 0; }
+
+bool SceneJournal::canRedo() const { return redoCount_ > 0; }
+
+SceneJournalStats SceneJournal::stats() const {
+  SceneJournalStats st;
+  st.capacity = kCapacity;
+  st.bytes = sizeof(entries_);
+  st.undoEntries = undoCount_;
+  st.redoEntries = redoCount_;
+  st.droppedEdits = droppedEdits_;
+  return st;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct SceneJournalStats {
+  uint32_t capacity = 0; // entries
+  uint32_t bytes = 0;
+  uint32_t undoEntries = 0;
+  uint32_t redoEntries = 0;
+  uint32_t droppedEdits = 0; // oldest edits pushed out to make room
+};
+
+// Undo history for scene edits, kept as a fixed ring of cell diffs so it
+// never allocates and recording is O(1). Each entry holds one changed cell
+// (a step, a swing value, a song slot, a synth parameter) with its value
+// before and after; SceneManager decides what the fields mean and applies
+// them. Entries recorded between beginGroup() and endGroup() undo as one
+// edit. When the ring is full the oldest whole edit goes.
+class SceneJournal {
+public:
+  static constexpr uint16_t kCapacity = 512;
+
+  enum Target : uint8_t { DrumStep, SynthStep, DrumSwing, SynthSwing, SongCell, SongLength, SynthParam };
+
+  struct Entry {
+    uint8_t target; // Target, plus kGroupStart on the first entry of an edit
+    uint8_t a;
+    uint8_t b;
+    uint8_t c;
+    uint32_t before;
+    uint32_t after;
+  };
+  static constexpr uint8_t kGroupStart = 0x80;
+
+  void clear();
+  // Groups nest; only the outermost pair closes the edit.
+  void beginGroup();
+  void endGroup();
+  // Drops anything that could be redone. A cell recorded again within the
+  // same edit only updates its 'after', and consecutive changes to one synth
+  // parameter (a knob being turned) merge into one edit.
+  void record(Target target, uint8_t a, uint8_t b, uint8_t c, uint32_t before, uint32_t after);
+
+  bool canUndo() const;
+  bool canRedo() const;
+  // Call apply(entry, value) for every entry of the last edit, newest first,
+  // with the value to restore. False if there was nothing to undo.
+  template <typename Apply>
+  bool undo(Apply&& apply);
+  // Same for the next undone edit, oldest first.
+  template <typename Apply>
+  bool redo(Apply&& apply);
+
+  SceneJournalStats stats() const;
+
+private:
+  static Target targetOf(const Entry& entry) { return static_cast<Target>(entry.target & ~kGroupStart); }
+  static bool startsGroup(const Entry& entry) { return (entry.target & kGroupStart) != 0; }
+  Entry& at(uint16_t index) { return entries_[(start_ + index) % kCapacity]; }
+  void dropOldestEdit();
+
+  Entry entries_[kCapacity];
+  uint16_t start_ = 0;     // oldest entry
+  uint16_t undoCount_ = 0; // entries from start_ that can be undone
+  uint16_t redoCount_ = 0; // entries after those that can be redone
+  uint8_t depth_ = 0;
+  bool groupStarted_ = false;  // the open group has an entry
+  uint16_t groupEntries_ = 0;
+  bool discardGroup_ = false;  // the open group outgrew the ring
+  uint32_t droppedEdits_ = 0;
+};
+
+template <typename Apply>
+bool SceneJournal::undo(Apply&& apply) {
+  if (depth_ > 0 || undoCount_ == 0) return false;
+  while (undoCount_ > 0) {
+    --undoCount_;
+    ++redoCount_;
+    const Entry& entry = at(undoCount_);
+    apply(entry, entry.before);
+    if (startsGroup(entry)) break;
+  }
+  return true;
+}
+
+template <typename Apply>
+bool SceneJournal::redo(Apply&& apply) {
+  if (depth_ > 0 || redoCount_ == 0) return false;
+  do {
+    const Entry& entry = at(undoCount_);
+    apply(entry, entry.after);
+    ++undoCount_;
+    --redoCount_;
+  } while (redoCount_ > 0 && !startsGroup(at(undoCount_)));
+  return true;
+}
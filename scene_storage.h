@@ -2,6 +2,8 @@
 #ifndef SCENE_STORAGE_H
 #define SCENE_STORAGE_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -20,7 +22,29 @@ public:
   // it should also always write to a general, to persist the name of the current scene being opened.
   virtual bool writeScene(const std::string& data) = 0;
   virtual bool readScene(SceneManager& manager) = 0;
+  // Loads the scene saved as 'name' without making it the current one, so
+  // scenes can be prefetched. Safe to call from a background task while the
+  // current scene name stays put.
+  virtual bool readSceneNamed(const std::string& name, SceneManager& manager) = 0;
   virtual bool writeScene(const SceneManager& manager) = 0;
+  // Saves 'manager' as 'name' without touching the current scene name, so
+  // the writer task can finish one scene's save after the UI moved on.
+  virtual bool writeSceneNamed(const std::string& name, const SceneManager& manager) = 0;
+  // Writes the current scene as JSON next to its saved copy, for sharing or
+  // editing off the device. Saves themselves use the binary format.
+  virtual bool exportSceneJson(const SceneManager& manager) = 0;
+  virtual bool exportSceneJsonNamed(const std::string& name, const SceneManager& manager) = 0;
+
+  // The scene's bank file: pattern banks it does not hold, as fixed-size
+  // records (see SceneManager::bankRecordOffset()). Reads past the end, or
+  // of a scene with no bank file, give zeros; writes past the end grow the
+  // file with zeros. Both are called from the writer task.
+  virtual bool readSceneBanks(const std::string& name, size_t offset, uint8_t* out, size_t size) = 0;
+  virtual bool writeSceneBanks(const std::string& name, size_t offset, const uint8_t* data, size_t size) = 0;
+  // For "save as": 'to' gets a copy of 'from's bank file, or none if 'from'
+  // has none.
+  virtual bool copySceneBanks(const std::string& from, const std::string& to) = 0;
+  virtual bool removeSceneBanks(const std::string& name) = 0;
 
   // return the scenes currently found on the storage
   virtual std::vector<std::string> getAvailableSceneNames() const = 0;
@@ -6,6 +6,7 @@
 #include <SPI.h>
 #include <SD.h>
 
+#include "buffered_writer.h"
 #include "scenes.h"
 
 #define SD_SPI_SCK_PIN  40
@@ -15,6 +16,10 @@
 
 namespace {
 
+// four sectors: big enough that the SD driver sees few, aligned writes,
+// small enough for the loop task's stack
+constexpr size_t kJsonWriteChunk = 2048;
+
 bool endsWith(const std::string& value, const char* suffix) {
   size_t suffixLen = std::strlen(suffix);
   return value.size() >= suffixLen &&
@@ -33,6 +38,24 @@ std::string trimWhitespace(const std::string& value) {
   return value.substr(start, end - start);
 }
 
+// a full binary write lands here first and is renamed over the scene once
+// complete
+constexpr const char* kTempExtension = ".tmp";
+
+bool readBinaryScene(const std::string& path, SceneManager& manager) {
+  if (!SD.exists(path.c_str())) return false;
+  unsigned long startUs = micros();
+  File binary = SD.open(path.c_str(), FILE_READ);
+  if (!binary) return false;
+  uint8_t buffer[SceneManager::kSceneBinaryMaxSize];
+  size_t size = binary.read(buffer, sizeof(buffer));
+  binary.close();
+  bool ok = manager.loadSceneBinary(buffer, size);
+  Serial.printf("Binary read %s: %zu bytes from %s in %lu us\n", ok ? "succeeded" : "failed", size, path.c_str(),
+                micros() - startUs);
+  return ok;
+}
+
 }
 
 std::string SceneStorageCardputer::normalizeSceneName(const std::string& name) const {
@@ -57,6 +80,20 @@ std::string SceneStorageCardputer::currentScenePath() const {
   return scenePathFor(currentSceneName_);
 }
 
+std::string SceneStorageCardputer::binaryScenePathFor(const std::string& name) const {
+  std::string path = "/";
+  path += normalizeSceneName(name);
+  path += kBinarySceneExtension;
+  return path;
+}
+
+std::string SceneStorageCardputer::bankPathFor(const std::string& name) const {
+  std::string path = "/";
+  path += normalizeSceneName(name);
+  path += kBankExtension;
+  return path;
+}
+
 void SceneStorageCardputer::loadStoredSceneName() {
   if (!isInitialized_) return;
   File file = SD.open(kSceneNamePath, FILE_READ);
@@ -155,12 +192,24 @@ bool SceneStorageCardputer::writeScene(const std::string& data) {
 }
 
 bool SceneStorageCardputer::readScene(SceneManager& manager) {
+  return readSceneNamed(currentSceneName_, manager);
+}
+
+bool SceneStorageCardputer::readSceneNamed(const std::string& name, SceneManager& manager) {
   if (!isInitialized_) {
     Serial.println("Storage not initialized. Please call initializeStorage() first.");
     return false;
   }
-  std::string path = currentScenePath();
+  std::string binaryPath = binaryScenePathFor(name);
+  if (readBinaryScene(binaryPath, manager)) return true;
+  // power lost between removing the old file and renaming the new one
+  // leaves only the new one, complete
+  if (!SD.exists(binaryPath.c_str()) && readBinaryScene(binaryPath + kTempExtension, manager)) return true;
+
+  // scenes saved before the binary format, or imported as JSON
+  std::string path = scenePathFor(name);
   Serial.printf("Reading scene (streaming) from SD card (%s)...\n", path.c_str());
+  unsigned long startUs = micros();
   File file = SD.open(path.c_str(), FILE_READ);
   if (!file) return false;
 
@@ -175,7 +224,7 @@ bool SceneStorageCardputer::readScene(SceneManager& manager) {
       retry.close();
     }
   }
-  Serial.printf("Streaming read %s\n", ok ? "succeeded" : "failed");
+  Serial.printf("Streaming read %s in %lu us\n", ok ? "succeeded" : "failed", micros() - startUs);
   return ok;
 }
 
@@ -184,20 +233,157 @@ bool SceneStorageCardputer::writeScene(const SceneManager& manager) {
     Serial.println("Storage not initialized. Please call initializeStorage() first.");
     return false;
   }
-  Serial.println("Writing scene (streaming) to SD card...");
   persistCurrentSceneName();
-  std::string path = currentScenePath();
-  bool removed = SD.remove(path.c_str());
-  Serial.printf("Removed old scene file: %s\n", removed ? "yes" : "no");
+  return writeSceneNamed(currentSceneName_, manager);
+}
+
+bool SceneStorageCardputer::writeSceneNamed(const std::string& name, const SceneManager& manager) {
+  if (!isInitialized_) {
+    Serial.println("Storage not initialized. Please call initializeStorage() first.");
+    return false;
+  }
+  unsigned long startUs = micros();
+  uint8_t buffer[SceneManager::kSceneBinaryMaxSize];
+  size_t size = manager.writeSceneBinary(buffer, sizeof(buffer));
+  if (size == 0) return false;
+  std::string path = binaryScenePathFor(name);
+
+  // the saved file only needs the sections that changed since it was written
+  SceneManager::BinaryRange ranges[SceneManager::kMaxBinaryRanges];
+  size_t rangeCount = manager.dirtyBinaryRanges(ranges, SceneManager::kMaxBinaryRanges);
+  if (rangeCount > 0 && SD.exists(path.c_str())) {
+    File existing = SD.open(path.c_str(), "r+");
+    if (existing && existing.size() == size) {
+      bool ok = true;
+      size_t patched = 0;
+      for (size_t i = 0; i < rangeCount && ok; ++i) {
+        ok = existing.seek(ranges[i].offset) &&
+             existing.write(buffer + ranges[i].offset, ranges[i].size) == ranges[i].size;
+        patched += ranges[i].size;
+      }
+      existing.close();
+      Serial.printf("Binary patch %s: %zu of %zu bytes in %zu ranges to %s in %lu us\n",
+                    ok ? "succeeded" : "failed", patched, size, rangeCount, path.c_str(), micros() - startUs);
+      if (ok) return true;
+    } else if (existing) {
+      existing.close();
+    }
+  }
+
+  // written whole to a temporary file first: a write cut short never
+  // replaces the scene on the card
+  std::string temp = path + kTempExtension;
+  SD.remove(temp.c_str());
+  File file = SD.open(temp.c_str(), FILE_WRITE);
+  if (!file) return false;
+
+  bool ok = file.write(buffer, size) == size;
+  file.close();
+  // FAT renames only onto a free name
+  if (ok) {
+    SD.remove(path.c_str());
+    ok = SD.rename(temp.c_str(), path.c_str());
+  } else {
+    SD.remove(temp.c_str());
+  }
+  Serial.printf("Binary write %s: %zu bytes to %s in %lu us\n", ok ? "succeeded" : "failed", size, path.c_str(),
+                micros() - startUs);
+  return ok;
+}
+
+bool SceneStorageCardputer::exportSceneJson(const SceneManager& manager) {
+  return exportSceneJsonNamed(currentSceneName_, manager);
+}
+
+bool SceneStorageCardputer::exportSceneJsonNamed(const std::string& name, const SceneManager& manager) {
+  if (!isInitialized_) {
+    Serial.println("Storage not initialized. Please call initializeStorage() first.");
+    return false;
+  }
+  unsigned long startUs = micros();
+  std::string path = scenePathFor(name);
+  SD.remove(path.c_str());
   File file = SD.open(path.c_str(), FILE_WRITE);
   if (!file) return false;
 
-  bool ok = manager.writeSceneJson(file);
+  BufferedWriter<File, kJsonWriteChunk> writer(file);
+  bool ok = manager.writeSceneJson(writer);
+  ok = writer.flush() && ok;
+  file.close();
+  Serial.printf("JSON export %s: %zu bytes in %zu writes to %s in %lu us\n", ok ? "succeeded" : "failed",
+                writer.bytesWritten(), writer.sinkWrites(), path.c_str(), micros() - startUs);
+  return ok;
+}
+
+bool SceneStorageCardputer::readSceneBanks(const std::string& name, size_t offset, uint8_t* out, size_t size) {
+  if (!isInitialized_) return false;
+  memset(out, 0, size);
+  std::string path = bankPathFor(name);
+  if (!SD.exists(path.c_str())) return true;
+  File file = SD.open(path.c_str(), FILE_READ);
+  if (!file) return false;
+  bool ok = true;
+  if (offset < file.size()) {
+    size_t available = file.size() - offset;
+    size_t count = size < available ? size : available;
+    ok = file.seek(offset) && file.read(out, count) == count;
+  }
+  file.close();
+  return ok;
+}
+
+bool SceneStorageCardputer::writeSceneBanks(const std::string& name, size_t offset, const uint8_t* data,
+                                            size_t size) {
+  if (!isInitialized_) return false;
+  std::string path = bankPathFor(name);
+  File file = SD.exists(path.c_str()) ? SD.open(path.c_str(), "r+") : SD.open(path.c_str(), FILE_WRITE);
+  if (!file) return false;
+  bool ok = true;
+  size_t end = file.size();
+  if (end < offset) {
+    // records in between read as banks never written
+    uint8_t zeros[64] = {};
+    ok = file.seek(end);
+    while (ok && end < offset) {
+      size_t count = offset - end < sizeof(zeros) ? offset - end : sizeof(zeros);
+      ok = file.write(zeros, count) == count;
+      end += count;
+    }
+  }
+  ok = ok && file.seek(offset) && file.write(data, size) == size;
   file.close();
-  Serial.printf("Streaming write %s\n to %s\n", ok ? "succeeded" : "failed", path.c_str());
   return ok;
 }
 
+bool SceneStorageCardputer::copySceneBanks(const std::string& from, const std::string& to) {
+  if (!isInitialized_) return false;
+  std::string source = bankPathFor(from);
+  std::string target = bankPathFor(to);
+  if (source == target) return true;
+  SD.remove(target.c_str());
+  if (!SD.exists(source.c_str())) return true;
+  File in = SD.open(source.c_str(), FILE_READ);
+  if (!in) return false;
+  File out = SD.open(target.c_str(), FILE_WRITE);
+  if (!out) {
+    in.close();
+    return false;
+  }
+  uint8_t buffer[512];
+  bool ok = true;
+  size_t count;
+  while (ok && (count = in.read(buffer, sizeof(buffer))) > 0) ok = out.write(buffer, count) == count;
+  in.close();
+  out.close();
+  return ok;
+}
+
+bool SceneStorageCardputer::removeSceneBanks(const std::string& name) {
+  if (!isInitialized_) return false;
+  std::string path = bankPathFor(name);
+  return !SD.exists(path.c_str()) || SD.remove(path.c_str());
+}
+
 std::vector<std::string> SceneStorageCardputer::getAvailableSceneNames() const {
   std::vector<std::string> names;
   if (!isInitialized_) return names;
@@ -214,6 +400,9 @@ std::vector<std::string> SceneStorageCardputer::getAvailableSceneNames() const {
       if (endsWith(fileName, kSceneExtension)) {
         fileName.resize(fileName.size() - std::strlen(kSceneExtension));
         names.push_back(fileName);
+      } else if (endsWith(fileName, kBinarySceneExtension)) {
+        fileName.resize(fileName.size() - std::strlen(kBinarySceneExtension));
+        names.push_back(fileName);
       }
     }
     entry.close();
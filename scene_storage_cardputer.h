@@ -10,7 +10,15 @@ public:
   bool readScene(std::string& out) override;
   bool writeScene(const std::string& data) override;
   bool readScene(SceneManager& manager) override;
+  bool readSceneNamed(const std::string& name, SceneManager& manager) override;
   bool writeScene(const SceneManager& manager) override;
+  bool writeSceneNamed(const std::string& name, const SceneManager& manager) override;
+  bool exportSceneJson(const SceneManager& manager) override;
+  bool exportSceneJsonNamed(const std::string& name, const SceneManager& manager) override;
+  bool readSceneBanks(const std::string& name, size_t offset, uint8_t* out, size_t size) override;
+  bool writeSceneBanks(const std::string& name, size_t offset, const uint8_t* data, size_t size) override;
+  bool copySceneBanks(const std::string& from, const std::string& to) override;
+  bool removeSceneBanks(const std::string& name) override;
   void initializeStorage() override;
   std::vector<std::string> getAvailableSceneNames() const override;
   std::string getCurrentSceneName() const override;
@@ -20,10 +28,14 @@ private:
   static constexpr const char* kDefaultSceneName = "miniacid_scene";
   static constexpr const char* kSceneNamePath = "/miniacid_scene_name.txt";
   static constexpr const char* kSceneExtension = ".json";
+  static constexpr const char* kBinarySceneExtension = ".mas";
+  static constexpr const char* kBankExtension = ".mab";
 
   std::string scenePathFor(const std::string& name) const;
+  std::string binaryScenePathFor(const std::string& name) const;
   std::string currentScenePath() const;
   std::string normalizeSceneName(const std::string& name) const;
+  std::string bankPathFor(const std::string& name) const;
   void loadStoredSceneName();
   bool persistCurrentSceneName() const;
 
@@ -1,18 +1,127 @@
 #include "ArduinoJson-v7.4.2.h"
 #include "scenes.h"
 
+#include <cmath>
+
 namespace {
+// FNV-1a over a key, usable in case labels (written recursively to stay a
+// C++11 constexpr).
+constexpr uint32_t sceneKeyHash(const char* key, size_t len, uint32_t hash = 2166136261u) {
+  return len == 0 ? hash
+                  : sceneKeyHash(key + 1, len - 1, (hash ^ static_cast<uint8_t>(*key)) * 16777619u);
+}
+
+template <size_t N>
+constexpr uint32_t sceneKeyHash(const char (&key)[N]) {
+  return sceneKeyHash(key, N - 1);
+}
+
 int clampIndex(int value, int maxExclusive) {
   if (value < 0) return 0;
   if (value >= maxExclusive) return maxExclusive - 1;
   return value;
 }
 
+int8_t clampStepTiming(int value) {
+  if (value < -kMaxStepTiming) value = -kMaxStepTiming;
+  if (value > kMaxStepTiming) value = kMaxStepTiming;
+  return static_cast<int8_t>(value);
+}
+
+int8_t clampStepSwing(int value) {
+  if (value < 0) value = 0;
+  if (value > kMaxStepSwing) value = kMaxStepSwing;
+  return static_cast<int8_t>(value);
+}
+
+// Anything outside MIDI range is a rest, as in the binary container.
+int clampNote(int note) {
+  return note < 0 || note > 127 ? -1 : note;
+}
+
+int8_t clampSongPattern(int patternIndex) {
+  return static_cast<int8_t>(patternIndex < 0 || patternIndex >= SceneManager::kSongPatternCount ? -1 : patternIndex);
+}
+
+// A JSON number as an int without the undefined cast for NaN or values out
+// of range.
+int wholeNumber(double value) {
+  if (!(value > -2147483648.0)) return value != value ? 0 : INT32_MIN;
+  if (value >= 2147483647.0) return INT32_MAX;
+  return static_cast<int>(value);
+}
+
+float finiteOr(float value, float fallback) {
+  return std::isfinite(value) ? value : fallback;
+}
+
+// Journal values: a step packs into one word, timing and notes as bytes.
+uint32_t packDrumStep(const DrumStep& step) {
+  return (step.hit ? 1u : 0u) | (step.accent ? 2u : 0u) | (static_cast<uint32_t>(static_cast<uint8_t>(step.timing)) << 8);
+}
+
+DrumStep unpackDrumStep(uint32_t value) {
+  DrumStep step;
+  step.hit = (value & 1u) != 0;
+  step.accent = (value & 2u) != 0;
+  step.timing = static_cast<int8_t>((value >> 8) & 0xFF);
+  return step;
+}
+
+uint32_t packSynthStep(const SynthStep& step) {
+  return static_cast<uint32_t>(static_cast<uint8_t>(step.note)) | (step.slide ? 0x100u : 0u) |
+         (step.accent ? 0x200u : 0u) | (static_cast<uint32_t>(static_cast<uint8_t>(step.timing)) << 16);
+}
+
+SynthStep unpackSynthStep(uint32_t value) {
+  SynthStep step;
+  step.note = static_cast<int8_t>(value & 0xFF);
+  step.slide = (value & 0x100u) != 0;
+  step.accent = (value & 0x200u) != 0;
+  step.timing = static_cast<int8_t>((value >> 16) & 0xFF);
+  return step;
+}
+
+uint32_t floatBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float bitsFloat(uint32_t bits) {
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+float synthParamValue(const SynthParameters& params, SynthParamId id) {
+  switch (id) {
+  case SynthParamId::Cutoff: return params.cutoff;
+  case SynthParamId::Resonance: return params.resonance;
+  case SynthParamId::EnvAmount: return params.envAmount;
+  case SynthParamId::EnvDecay: return params.envDecay;
+  case SynthParamId::OscType: return static_cast<float>(params.oscType);
+  }
+  return 0.0f;
+}
+
+void setSynthParamValue(SynthParameters& params, SynthParamId id, float value) {
+  switch (id) {
+  case SynthParamId::Cutoff: params.cutoff = value; break;
+  case SynthParamId::Resonance: params.resonance = value; break;
+  case SynthParamId::EnvAmount: params.envAmount = value; break;
+  case SynthParamId::EnvDecay: params.envDecay = value; break;
+  case SynthParamId::OscType: params.oscType = static_cast<int>(value); break;
+  }
+}
+
 void clearDrumPattern(DrumPattern& pattern) {
   for (int i = 0; i < DrumPattern::kSteps; ++i) {
     pattern.steps[i].hit = false;
     pattern.steps[i].accent = false;
+    pattern.steps[i].timing = 0;
   }
+  pattern.swing = 0;
 }
 
 void clearSynthPattern(SynthPattern& pattern) {
@@ -20,7 +129,9 @@ void clearSynthPattern(SynthPattern& pattern) {
     pattern.steps[i].note = -1;
     pattern.steps[i].slide = false;
     pattern.steps[i].accent = false;
+    pattern.steps[i].timing = 0;
   }
+  pattern.swing = 0;
 }
 
 void clearSong(Song& song) {
@@ -48,10 +159,17 @@ void clearSceneData(Scene& scene) {
 void serializeDrumPattern(const DrumPattern& pattern, ArduinoJson::JsonObject obj) {
   ArduinoJson::JsonArray hit = obj["hit"].to<ArduinoJson::JsonArray>();
   ArduinoJson::JsonArray accent = obj["accent"].to<ArduinoJson::JsonArray>();
+  bool hasTiming = false;
   for (int i = 0; i < DrumPattern::kSteps; ++i) {
     hit.add(pattern.steps[i].hit);
     accent.add(pattern.steps[i].accent);
+    if (pattern.steps[i].timing != 0) hasTiming = true;
   }
+  if (hasTiming) {
+    ArduinoJson::JsonArray timing = obj["timing"].to<ArduinoJson::JsonArray>();
+    for (int i = 0; i < DrumPattern::kSteps; ++i) timing.add(pattern.steps[i].timing);
+  }
+  if (pattern.swing != 0) obj["swing"] = pattern.swing;
 }
 
 void serializeDrumBank(const Bank<DrumPatternSet>& bank, ArduinoJson::JsonArray patterns) {
@@ -70,6 +188,7 @@ void serializeSynthPattern(const SynthPattern& pattern, ArduinoJson::JsonArray s
     step["note"] = pattern.steps[i].note;
     step["slide"] = pattern.steps[i].slide;
     step["accent"] = pattern.steps[i].accent;
+    if (pattern.steps[i].timing != 0) step["timing"] = pattern.steps[i].timing;
   }
 }
 
@@ -80,6 +199,16 @@ void serializeSynthBank(const Bank<SynthPattern>& bank, ArduinoJson::JsonArray p
   }
 }
 
+void serializeSynthSwing(const Bank<SynthPattern>& bank, ArduinoJson::JsonObject root, const char* key) {
+  bool hasSwing = false;
+  for (int p = 0; p < Bank<SynthPattern>::kPatterns; ++p) {
+    if (bank.patterns[p].swing != 0) hasSwing = true;
+  }
+  if (!hasSwing) return;
+  ArduinoJson::JsonArray swing = root[key].to<ArduinoJson::JsonArray>();
+  for (int p = 0; p < Bank<SynthPattern>::kPatterns; ++p) swing.add(bank.patterns[p].swing);
+}
+
 bool deserializeBoolArray(ArduinoJson::JsonArrayConst arr, bool* dst, int expectedSize) {
   if (static_cast<int>(arr.size()) != expectedSize) return false;
   int idx = 0;
@@ -104,6 +233,20 @@ bool deserializeDrumPattern(ArduinoJson::JsonVariantConst value, DrumPattern& pa
     pattern.steps[i].hit = hits[i];
     pattern.steps[i].accent = accents[i];
   }
+  ArduinoJson::JsonArrayConst timing = obj["timing"].as<ArduinoJson::JsonArrayConst>();
+  if (!timing.isNull()) {
+    if (static_cast<int>(timing.size()) != DrumPattern::kSteps) return false;
+    int idx = 0;
+    for (ArduinoJson::JsonVariantConst t : timing) {
+      if (!t.is<int>()) return false;
+      pattern.steps[idx++].timing = clampStepTiming(t.as<int>());
+    }
+  }
+  auto swing = obj["swing"];
+  if (!swing.isNull()) {
+    if (!swing.is<int>()) return false;
+    pattern.swing = clampStepSwing(swing.as<int>());
+  }
   return true;
 }
 
@@ -140,9 +283,14 @@ bool deserializeSynthPattern(ArduinoJson::JsonVariantConst value, SynthPattern&
     auto slide = obj["slide"];
     auto accent = obj["accent"];
     if (!note.is<int>() || !slide.is<bool>() || !accent.is<bool>()) return false;
-    pattern.steps[i].note = note.as<int>();
+    pattern.steps[i].note = clampNote(note.as<int>());
     pattern.steps[i].slide = slide.as<bool>();
     pattern.steps[i].accent = accent.as<bool>();
+    auto timing = obj["timing"];
+    if (!timing.isNull()) {
+      if (!timing.is<int>()) return false;
+      pattern.steps[i].timing = clampStepTiming(timing.as<int>());
+    }
     ++i;
   }
   return true;
@@ -159,6 +307,18 @@ bool deserializeSynthBank(ArduinoJson::JsonVariantConst value, Bank<SynthPattern
   return true;
 }
 
+bool deserializeSynthSwing(ArduinoJson::JsonVariantConst value, Bank<SynthPattern>& bank) {
+  if (value.isNull()) return true;
+  ArduinoJson::JsonArrayConst swing = value.as<ArduinoJson::JsonArrayConst>();
+  if (swing.isNull() || static_cast<int>(swing.size()) != Bank<SynthPattern>::kPatterns) return false;
+  int p = 0;
+  for (ArduinoJson::JsonVariantConst s : swing) {
+    if (!s.is<int>()) return false;
+    bank.patterns[p++].swing = clampStepSwing(s.as<int>());
+  }
+  return true;
+}
+
 int valueToInt(ArduinoJson::JsonVariantConst value, int defaultValue) {
   if (value.is<int>()) {
     return value.as<int>();
@@ -208,6 +368,47 @@ bool deserializeSynthParameters(ArduinoJson::JsonVariantConst value, SynthParame
 }
 }
 
+SceneJsonObserver::Key SceneJsonObserver::keyFor(JsonStringView key) {
+  // the case labels are distinct hashes, so adding a key that collides with
+  // another fails to compile and the hash stays perfect over this set
+  switch (sceneKeyHash(key.data(), key.size())) {
+  case sceneKeyHash("a"): return key == "a" ? Key::A : Key::Other;
+  case sceneKeyHash("accent"): return key == "accent" ? Key::Accent : Key::Other;
+  case sceneKeyHash("b"): return key == "b" ? Key::B : Key::Other;
+  case sceneKeyHash("bpm"): return key == "bpm" ? Key::Bpm : Key::Other;
+  case sceneKeyHash("cutoff"): return key == "cutoff" ? Key::Cutoff : Key::Other;
+  case sceneKeyHash("drumBank"): return key == "drumBank" ? Key::DrumBank : Key::Other;
+  case sceneKeyHash("drumBankIndex"): return key == "drumBankIndex" ? Key::DrumBankIndex : Key::Other;
+  case sceneKeyHash("drumPatternIndex"): return key == "drumPatternIndex" ? Key::DrumPatternIndex : Key::Other;
+  case sceneKeyHash("drums"): return key == "drums" ? Key::Drums : Key::Other;
+  case sceneKeyHash("envAmount"): return key == "envAmount" ? Key::EnvAmount : Key::Other;
+  case sceneKeyHash("envDecay"): return key == "envDecay" ? Key::EnvDecay : Key::Other;
+  case sceneKeyHash("hit"): return key == "hit" ? Key::Hit : Key::Other;
+  case sceneKeyHash("length"): return key == "length" ? Key::Length : Key::Other;
+  case sceneKeyHash("mute"): return key == "mute" ? Key::Mute : Key::Other;
+  case sceneKeyHash("note"): return key == "note" ? Key::Note : Key::Other;
+  case sceneKeyHash("oscType"): return key == "oscType" ? Key::OscType : Key::Other;
+  case sceneKeyHash("positions"): return key == "positions" ? Key::Positions : Key::Other;
+  case sceneKeyHash("resonance"): return key == "resonance" ? Key::Resonance : Key::Other;
+  case sceneKeyHash("slide"): return key == "slide" ? Key::Slide : Key::Other;
+  case sceneKeyHash("song"): return key == "song" ? Key::Song : Key::Other;
+  case sceneKeyHash("songMode"): return key == "songMode" ? Key::SongMode : Key::Other;
+  case sceneKeyHash("songPosition"): return key == "songPosition" ? Key::SongPosition : Key::Other;
+  case sceneKeyHash("state"): return key == "state" ? Key::State : Key::Other;
+  case sceneKeyHash("swing"): return key == "swing" ? Key::Swing : Key::Other;
+  case sceneKeyHash("synth"): return key == "synth" ? Key::Synth : Key::Other;
+  case sceneKeyHash("synthABank"): return key == "synthABank" ? Key::SynthABank : Key::Other;
+  case sceneKeyHash("synthASwing"): return key == "synthASwing" ? Key::SynthASwing : Key::Other;
+  case sceneKeyHash("synthBBank"): return key == "synthBBank" ? Key::SynthBBank : Key::Other;
+  case sceneKeyHash("synthBSwing"): return key == "synthBSwing" ? Key::SynthBSwing : Key::Other;
+  case sceneKeyHash("synthBankIndex"): return key == "synthBankIndex" ? Key::SynthBankIndex : Key::Other;
+  case sceneKeyHash("synthParams"): return key == "synthParams" ? Key::SynthParams : Key::Other;
+  case sceneKeyHash("synthPatternIndex"): return key == "synthPatternIndex" ? Key::SynthPatternIndex : Key::Other;
+  case sceneKeyHash("timing"): return key == "timing" ? Key::Timing : Key::Other;
+  default: return Key::Other;
+  }
+}
+
 SceneJsonObserver::SceneJsonObserver(Scene& scene, float defaultBpm)
     : target_(scene), bpm_(defaultBpm) {
   clearSong(song_);
@@ -295,11 +496,11 @@ void SceneJsonObserver::onObjectStart() {
     const Context& parent = stack_[stackSize_ - 1];
     if (parent.type == Context::Type::Array) {
       path = deduceObjectPath(parent);
-    } else if (parent.path == Path::Root && lastKey_ == "state") {
+    } else if (parent.path == Path::Root && lastKey_ == Key::State) {
       path = Path::State;
-    } else if (parent.path == Path::Root && lastKey_ == "song") {
+    } else if (parent.path == Path::Root && lastKey_ == Key::Song) {
       path = Path::Song;
-    } else if (parent.path == Path::State && lastKey_ == "mute") {
+    } else if (parent.path == Path::State && lastKey_ == Key::Mute) {
       path = Path::Mute;
     }
   }
@@ -319,21 +520,24 @@ void SceneJsonObserver::onArrayStart() {
     const Context& parent = stack_[stackSize_ - 1];
     if (parent.type == Context::Type::Object) {
       if (parent.path == Path::Root) {
-        if (lastKey_ == "drumBank") path = Path::DrumBank;
-        else if (lastKey_ == "synthABank") path = Path::SynthABank;
-        else if (lastKey_ == "synthBBank") path = Path::SynthBBank;
+        if (lastKey_ == Key::DrumBank) path = Path::DrumBank;
+        else if (lastKey_ == Key::SynthABank) path = Path::SynthABank;
+        else if (lastKey_ == Key::SynthBBank) path = Path::SynthBBank;
+        else if (lastKey_ == Key::SynthASwing) path = Path::SynthASwing;
+        else if (lastKey_ == Key::SynthBSwing) path = Path::SynthBSwing;
       } else if (parent.path == Path::Song) {
-        if (lastKey_ == "positions") path = Path::SongPositions;
+        if (lastKey_ == Key::Positions) path = Path::SongPositions;
       } else if (parent.path == Path::DrumVoice) {
-        if (lastKey_ == "hit") path = Path::DrumHitArray;
-        else if (lastKey_ == "accent") path = Path::DrumAccentArray;
+        if (lastKey_ == Key::Hit) path = Path::DrumHitArray;
+        else if (lastKey_ == Key::Accent) path = Path::DrumAccentArray;
+        else if (lastKey_ == Key::Timing) path = Path::DrumTimingArray;
       } else if (parent.path == Path::State) {
-        if (lastKey_ == "synthPatternIndex") path = Path::SynthPatternIndex;
-        else if (lastKey_ == "synthBankIndex") path = Path::SynthBankIndex;
-        else if (lastKey_ == "synthParams") path = Path::SynthParams;
+        if (lastKey_ == Key::SynthPatternIndex) path = Path::SynthPatternIndex;
+        else if (lastKey_ == Key::SynthBankIndex) path = Path::SynthBankIndex;
+        else if (lastKey_ == Key::SynthParams) path = Path::SynthParams;
       } else if (parent.path == Path::Mute) {
-        if (lastKey_ == "drums") path = Path::MuteDrums;
-        else if (lastKey_ == "synth") path = Path::MuteSynth;
+        if (lastKey_ == Key::Drums) path = Path::MuteDrums;
+        else if (lastKey_ == Key::Synth) path = Path::MuteSynth;
       }
     } else if (parent.type == Context::Type::Array) {
       path = deduceArrayPath(parent);
@@ -352,9 +556,10 @@ void SceneJsonObserver::handlePrimitiveNumber(double value, bool isInteger) {
   (void)isInteger;
   if (error_ || stackSize_ == 0) return;
   Path path = stack_[stackSize_ - 1].path;
+  int whole = wholeNumber(value);
   if (path == Path::Song) {
-    if (lastKey_ == "length") {
-      int len = static_cast<int>(value);
+    if (lastKey_ == Key::Length) {
+      int len = whole;
       if (len < 1) len = 1;
       if (len > Song::kMaxPositions) len = Song::kMaxPositions;
       song_.length = len;
@@ -369,11 +574,11 @@ void SceneJsonObserver::handlePrimitiveNumber(double value, bool isInteger) {
       return;
     }
     int trackIdx = -1;
-    if (lastKey_ == "a") trackIdx = 0;
-    else if (lastKey_ == "b") trackIdx = 1;
-    else if (lastKey_ == "drums") trackIdx = 2;
+    if (lastKey_ == Key::A) trackIdx = 0;
+    else if (lastKey_ == Key::B) trackIdx = 1;
+    else if (lastKey_ == Key::Drums) trackIdx = 2;
     if (trackIdx >= 0 && trackIdx < SongPosition::kTrackCount) {
-      song_.positions[posIdx].patterns[trackIdx] = static_cast<int>(value);
+      song_.positions[posIdx].patterns[trackIdx] = clampSongPattern(whole);
       if (posIdx + 1 > song_.length) song_.length = posIdx + 1;
       hasSong_ = true;
     }
@@ -384,14 +589,45 @@ void SceneJsonObserver::handlePrimitiveNumber(double value, bool isInteger) {
     handlePrimitiveBool(value != 0);
     return;
   }
+  if (path == Path::DrumTimingArray || (path == Path::DrumVoice && lastKey_ == Key::Swing)) {
+    int patternIdx = currentIndexFor(Path::DrumBank);
+    int voiceIdx = currentIndexFor(Path::DrumPatternSet);
+    if (patternIdx < 0 || patternIdx >= Bank<DrumPatternSet>::kPatterns ||
+        voiceIdx < 0 || voiceIdx >= DrumPatternSet::kVoices) {
+      error_ = true;
+      return;
+    }
+    DrumPattern& pattern = target_.drumBank.patterns[patternIdx].voices[voiceIdx];
+    if (path == Path::DrumVoice) {
+      pattern.swing = clampStepSwing(whole);
+      return;
+    }
+    int stepIdx = stack_[stackSize_ - 1].index;
+    if (stepIdx < 0 || stepIdx >= DrumPattern::kSteps) {
+      error_ = true;
+      return;
+    }
+    pattern.steps[stepIdx].timing = clampStepTiming(whole);
+    return;
+  }
+  if (path == Path::SynthASwing || path == Path::SynthBSwing) {
+    int patternIdx = stack_[stackSize_ - 1].index;
+    if (patternIdx < 0 || patternIdx >= Bank<SynthPattern>::kPatterns) {
+      error_ = true;
+      return;
+    }
+    Bank<SynthPattern>& bank = path == Path::SynthBSwing ? target_.synthBBank : target_.synthABank;
+    bank.patterns[patternIdx].swing = clampStepSwing(whole);
+    return;
+  }
   if (path == Path::SynthPatternIndex) {
     int idx = stack_[stackSize_ - 1].index;
-    if (idx >= 0 && idx < 2) synthPatternIndex_[idx] = static_cast<int>(value);
+    if (idx >= 0 && idx < 2) synthPatternIndex_[idx] = whole;
     return;
   }
   if (path == Path::SynthBankIndex) {
     int idx = stack_[stackSize_ - 1].index;
-    if (idx >= 0 && idx < 2) synthBankIndex_[idx] = static_cast<int>(value);
+    if (idx >= 0 && idx < 2) synthBankIndex_[idx] = whole;
     return;
   }
   if (path == Path::SynthStep) {
@@ -405,12 +641,12 @@ void SceneJsonObserver::handlePrimitiveNumber(double value, bool isInteger) {
     }
     SynthPattern& pattern = useBankB ? target_.synthBBank.patterns[patternIdx]
                                      : target_.synthABank.patterns[patternIdx];
-    if (lastKey_ == "note") {
-      pattern.steps[stepIdx].note = static_cast<int>(value);
-    } else if (lastKey_ == "slide") {
-      pattern.steps[stepIdx].slide = value != 0;
-    } else if (lastKey_ == "accent") {
-      pattern.steps[stepIdx].accent = value != 0;
+    switch (lastKey_) {
+    case Key::Note: pattern.steps[stepIdx].note = clampNote(whole); break;
+    case Key::Slide: pattern.steps[stepIdx].slide = value != 0; break;
+    case Key::Accent: pattern.steps[stepIdx].accent = value != 0; break;
+    case Key::Timing: pattern.steps[stepIdx].timing = clampStepTiming(whole); break;
+    default: break;
     }
     return;
   }
@@ -421,41 +657,26 @@ void SceneJsonObserver::handlePrimitiveNumber(double value, bool isInteger) {
       return;
     }
     float fval = static_cast<float>(value);
-    if (lastKey_ == "cutoff") {
-      synthParameters_[synthIdx].cutoff = fval;
-    } else if (lastKey_ == "resonance") {
-      synthParameters_[synthIdx].resonance = fval;
-    } else if (lastKey_ == "envAmount") {
-      synthParameters_[synthIdx].envAmount = fval;
-    } else if (lastKey_ == "envDecay") {
-      synthParameters_[synthIdx].envDecay = fval;
-    } else if (lastKey_ == "oscType") {
-      synthParameters_[synthIdx].oscType = static_cast<int>(value);
+    switch (lastKey_) {
+    case Key::Cutoff: synthParameters_[synthIdx].cutoff = fval; break;
+    case Key::Resonance: synthParameters_[synthIdx].resonance = fval; break;
+    case Key::EnvAmount: synthParameters_[synthIdx].envAmount = fval; break;
+    case Key::EnvDecay: synthParameters_[synthIdx].envDecay = fval; break;
+    case Key::OscType: synthParameters_[synthIdx].oscType = whole; break;
+    default: break;
     }
     return;
   }
   if (path == Path::State) {
-    if (lastKey_ == "bpm") {
-      bpm_ = static_cast<float>(value);
-      return;
-    }
-    if (lastKey_ == "songPosition") {
-      songPosition_ = static_cast<int>(value);
-      return;
-    }
-    if (lastKey_ == "songMode") {
-      songMode_ = value != 0;
-      return;
-    }
-    int intValue = static_cast<int>(value);
-    if (lastKey_ == "drumPatternIndex") {
-      drumPatternIndex_ = intValue;
-    } else if (lastKey_ == "drumBankIndex") {
-      drumBankIndex_ = intValue;
-    } else if (lastKey_ == "synthPatternIndex") {
-      synthPatternIndex_[0] = intValue;
-    } else if (lastKey_ == "synthBankIndex") {
-      synthBankIndex_[0] = intValue;
+    switch (lastKey_) {
+    case Key::Bpm: bpm_ = static_cast<float>(value); break;
+    case Key::SongPosition: songPosition_ = whole; break;
+    case Key::SongMode: songMode_ = value != 0; break;
+    case Key::DrumPatternIndex: drumPatternIndex_ = whole; break;
+    case Key::DrumBankIndex: drumBankIndex_ = whole; break;
+    case Key::SynthPatternIndex: synthPatternIndex_[0] = whole; break;
+    case Key::SynthBankIndex: synthBankIndex_[0] = whole; break;
+    default: break;
     }
   }
 }
@@ -513,15 +734,15 @@ void SceneJsonObserver::handlePrimitiveBool(bool value) {
     }
     SynthPattern& pattern = useBankB ? target_.synthBBank.patterns[patternIdx]
                                      : target_.synthABank.patterns[patternIdx];
-    if (lastKey_ == "slide") {
+    if (lastKey_ == Key::Slide) {
       pattern.steps[stepIdx].slide = value;
-    } else if (lastKey_ == "accent") {
+    } else if (lastKey_ == Key::Accent) {
       pattern.steps[stepIdx].accent = value;
     }
     return;
   }
 
-  if (path == Path::State && lastKey_ == "songMode") {
+  if (path == Path::State && lastKey_ == Key::SongMode) {
     songMode_ = value;
   }
 }
@@ -534,11 +755,11 @@ void SceneJsonObserver::onBool(bool value) { handlePrimitiveBool(value); }
 
 void SceneJsonObserver::onNull() {}
 
-void SceneJsonObserver::onString(const std::string& value) {
+void SceneJsonObserver::onString(JsonStringView value) {
   (void)value;
 }
 
-void SceneJsonObserver::onObjectKey(const std::string& key) { lastKey_ = key; }
+void SceneJsonObserver::onObjectKey(JsonStringView key) { lastKey_ = keyFor(key); }
 
 void SceneJsonObserver::onObjectValueStart() {}
 
@@ -705,9 +926,14 @@ void SceneManager::loadDefaultScene() {
     scene_.drumBank.patterns[0].voices[7].steps[i].hit = clap[i];
     scene_.drumBank.patterns[0].voices[7].steps[i].accent = clap[i];
   }
+  clearEditHistory();
+  markAllDirty();
 }
 
-Scene& SceneManager::currentScene() { return scene_; }
+Scene& SceneManager::currentScene() {
+  markAllDirty();
+  return scene_;
+}
 
 const Scene& SceneManager::currentScene() const { return scene_; }
 
@@ -716,7 +942,9 @@ const DrumPatternSet& SceneManager::getCurrentDrumPattern() const {
 }
 
 DrumPatternSet& SceneManager::editCurrentDrumPattern() {
-  return scene_.drumBank.patterns[clampPatternIndex(drumPatternIndex_)];
+  int pat = clampPatternIndex(drumPatternIndex_);
+  markDrumPatternDirty(pat);
+  return scene_.drumBank.patterns[pat];
 }
 
 const SynthPattern& SceneManager::getCurrentSynthPattern(int synthIndex) const {
@@ -731,6 +959,7 @@ const SynthPattern& SceneManager::getCurrentSynthPattern(int synthIndex) const {
 SynthPattern& SceneManager::editCurrentSynthPattern(int synthIndex) {
   int idx = clampSynthIndex(synthIndex);
   int patternIndex = clampPatternIndex(synthPatternIndex_[idx]);
+  markSynthPatternDirty(idx, patternIndex);
   if (idx == 0) {
     return scene_.synthABank.patterns[patternIndex];
   }
@@ -749,6 +978,7 @@ const SynthPattern& SceneManager::getSynthPattern(int synthIndex, int patternInd
 SynthPattern& SceneManager::editSynthPattern(int synthIndex, int patternIndex) {
   int idx = clampSynthIndex(synthIndex);
   int pat = clampPatternIndex(patternIndex);
+  markSynthPatternDirty(idx, pat);
   if (idx == 0) {
     return scene_.synthABank.patterns[pat];
   }
@@ -762,16 +992,21 @@ const DrumPatternSet& SceneManager::getDrumPatternSet(int patternIndex) const {
 
 DrumPatternSet& SceneManager::editDrumPatternSet(int patternIndex) {
   int pat = clampPatternIndex(patternIndex);
+  markDrumPatternDirty(pat);
   return scene_.drumBank.patterns[pat];
 }
 
 void SceneManager::setCurrentDrumPatternIndex(int idx) {
-  drumPatternIndex_ = clampPatternIndex(idx);
+  int clamped = clampPatternIndex(idx);
+  if (clamped != drumPatternIndex_) dirty_.state = true;
+  drumPatternIndex_ = clamped;
 }
 
 void SceneManager::setCurrentSynthPatternIndex(int synthIdx, int idx) {
   int clampedSynth = clampSynthIndex(synthIdx);
-  synthPatternIndex_[clampedSynth] = clampPatternIndex(idx);
+  int clamped = clampPatternIndex(idx);
+  if (clamped != synthPatternIndex_[clampedSynth]) dirty_.state = true;
+  synthPatternIndex_[clampedSynth] = clamped;
 }
 
 int SceneManager::getCurrentDrumPatternIndex() const { return drumPatternIndex_; }
@@ -783,6 +1018,7 @@ int SceneManager::getCurrentSynthPatternIndex(int synthIdx) const {
 
 void SceneManager::setDrumMute(int voiceIdx, bool mute) {
   int clampedVoice = clampIndex(voiceIdx, DrumPatternSet::kVoices);
+  if (drumMute_[clampedVoice] != mute) dirty_.state = true;
   drumMute_[clampedVoice] = mute;
 }
 
@@ -793,6 +1029,7 @@ bool SceneManager::getDrumMute(int voiceIdx) const {
 
 void SceneManager::setSynthMute(int synthIdx, bool mute) {
   int clampedSynth = clampSynthIndex(synthIdx);
+  if (synthMute_[clampedSynth] != mute) dirty_.state = true;
   synthMute_[clampedSynth] = mute;
 }
 
@@ -803,6 +1040,12 @@ bool SceneManager::getSynthMute(int synthIdx) const {
 
 void SceneManager::setSynthParameters(int synthIdx, const SynthParameters& params) {
   int clampedSynth = clampSynthIndex(synthIdx);
+  const SynthParameters& current = synthParameters_[clampedSynth];
+  if (current.cutoff != params.cutoff || current.resonance != params.resonance ||
+      current.envAmount != params.envAmount || current.envDecay != params.envDecay ||
+      current.oscType != params.oscType) {
+    dirty_.state = true;
+  }
   synthParameters_[clampedSynth] = params;
 }
 
@@ -811,9 +1054,22 @@ const SynthParameters& SceneManager::getSynthParameters(int synthIdx) const {
   return synthParameters_[clampedSynth];
 }
 
+void SceneManager::setSynthParameter(int synthIdx, SynthParamId id, float value) {
+  int clampedSynth = clampSynthIndex(synthIdx);
+  float current = synthParamValue(synthParameters_[clampedSynth], id);
+  if (current == value) return;
+  if (journal_.journal) {
+    journal_.journal->record(SceneJournal::SynthParam, static_cast<uint8_t>(clampedSynth),
+                             static_cast<uint8_t>(id), 0, floatBits(current), floatBits(value));
+  }
+  setSynthParamValue(synthParameters_[clampedSynth], id, value);
+  dirty_.state = true;
+}
+
 void SceneManager::setBpm(float bpm) {
-  if (bpm < 40.0f) bpm = 40.0f;
+  if (!(bpm >= 40.0f)) bpm = 40.0f; // NaN too
   if (bpm > 200.0f) bpm = 200.0f;
+  if (bpm != bpm_) dirty_.state = true;
   bpm_ = bpm;
 }
 
@@ -821,7 +1077,10 @@ float SceneManager::getBpm() const { return bpm_; }
 
 const Song& SceneManager::song() const { return scene_.song; }
 
-Song& SceneManager::editSong() { return scene_.song; }
+Song& SceneManager::editSong() {
+  dirty_.song = true;
+  return scene_.song;
+}
 
 void SceneManager::setSongPattern(int position, SongTrack track, int patternIndex) {
   int pos = position;
@@ -831,17 +1090,21 @@ void SceneManager::setSongPattern(int position, SongTrack track, int patternInde
   if (trackIdx < 0 || trackIdx >= SongPosition::kTrackCount) return;
   int pat = patternIndex;
   if (pat < -1) pat = -1;
-  if (pat >= Bank<SynthPattern>::kPatterns) pat = Bank<SynthPattern>::kPatterns - 1;
+  if (pat >= kSongPatternCount) pat = kSongPatternCount - 1;
+  beginEdit();
   if (pos >= scene_.song.length) setSongLength(pos + 1);
-  scene_.song.positions[pos].patterns[trackIdx] = static_cast<int8_t>(pat);
+  writeSongCell(pos, trackIdx, pat);
+  endEdit();
 }
 
 void SceneManager::clearSongPattern(int position, SongTrack track) {
   int pos = clampSongPosition(position);
   int trackIdx = songTrackToIndex(track);
   if (trackIdx < 0 || trackIdx >= SongPosition::kTrackCount) return;
-  scene_.song.positions[pos].patterns[trackIdx] = -1;
+  beginEdit();
+  writeSongCell(pos, trackIdx, -1);
   trimSongLength();
+  endEdit();
 }
 
 int SceneManager::songPattern(int position, SongTrack track) const {
@@ -853,10 +1116,11 @@ int SceneManager::songPattern(int position, SongTrack track) const {
 }
 
 void SceneManager::setSongLength(int length) {
-  int clamped = clampSongLength(length);
-  scene_.song.length = clamped;
+  writeSongLength(clampSongLength(length));
+  int position = songPosition_;
   if (songPosition_ >= scene_.song.length) songPosition_ = scene_.song.length - 1;
   if (songPosition_ < 0) songPosition_ = 0;
+  if (position != songPosition_) dirty_.state = true;
 }
 
 int SceneManager::songLength() const {
@@ -867,46 +1131,305 @@ int SceneManager::songLength() const {
 }
 
 void SceneManager::setSongPosition(int position) {
-  songPosition_ = clampSongPosition(position);
+  int clamped = clampSongPosition(position);
+  if (clamped != songPosition_) dirty_.state = true;
+  songPosition_ = clamped;
 }
 
 int SceneManager::getSongPosition() const {
   return clampSongPosition(songPosition_);
 }
 
-void SceneManager::setSongMode(bool enabled) { songMode_ = enabled; }
+void SceneManager::setSongMode(bool enabled) {
+  if (enabled != songMode_) dirty_.state = true;
+  songMode_ = enabled;
+}
 
 bool SceneManager::songMode() const { return songMode_; }
 
-void SceneManager::setCurrentBankIndex(int instrumentId, int bankIdx) {
-  int clampedBank = 0; // Only a single bank exists today; retain parameter for future use
-  if (instrumentId == 0) {
-    drumBankIndex_ = clampedBank;
-  } else {
-    int synthIdx = clampSynthIndex(instrumentId - 1);
-    synthBankIndex_[synthIdx] = clampedBank;
-  }
+void SceneManager::setCurrentDrumBank(int bankIdx, const Bank<DrumPatternSet>& bank) {
+  drumBankIndex_ = clampIndex(bankIdx, kBankCount);
+  scene_.drumBank = bank;
+  dirty_.drumPatterns = (1u << Bank<DrumPatternSet>::kPatterns) - 1;
+  dirty_.state = true;
+  clearEditHistory();
+}
+
+void SceneManager::setCurrentSynthBank(int synthIdx, int bankIdx, const Bank<SynthPattern>& bank) {
+  int idx = clampSynthIndex(synthIdx);
+  synthBankIndex_[idx] = clampIndex(bankIdx, kBankCount);
+  (idx == 0 ? scene_.synthABank : scene_.synthBBank) = bank;
+  dirty_.synthPatterns[idx] = (1u << Bank<SynthPattern>::kPatterns) - 1;
+  dirty_.state = true;
+  clearEditHistory();
 }
 
 int SceneManager::getCurrentBankIndex(int instrumentId) const {
-  (void)instrumentId;
-  return 0;
+  if (instrumentId == 0) return drumBankIndex_;
+  return synthBankIndex_[clampSynthIndex(instrumentId - 1)];
+}
+
+bool SceneManager::isDirty() const {
+  return dirty_.drumPatterns != 0 || dirty_.synthPatterns[0] != 0 || dirty_.synthPatterns[1] != 0 ||
+         dirty_.song || dirty_.state;
+}
+
+const SceneManager::DirtyState& SceneManager::dirtyState() const { return dirty_; }
+
+void SceneManager::markClean() { dirty_ = DirtyState(); }
+
+void SceneManager::markAllDirty() {
+  static_assert(Bank<DrumPatternSet>::kPatterns < 32 && Bank<SynthPattern>::kPatterns < 32,
+                "dirty masks hold one bit per pattern");
+  dirty_.drumPatterns = (1u << Bank<DrumPatternSet>::kPatterns) - 1;
+  dirty_.synthPatterns[0] = (1u << Bank<SynthPattern>::kPatterns) - 1;
+  dirty_.synthPatterns[1] = dirty_.synthPatterns[0];
+  dirty_.song = true;
+  dirty_.state = true;
+}
+
+void SceneManager::markDirty(const DirtyState& state) {
+  dirty_.drumPatterns |= state.drumPatterns;
+  dirty_.synthPatterns[0] |= state.synthPatterns[0];
+  dirty_.synthPatterns[1] |= state.synthPatterns[1];
+  dirty_.song = dirty_.song || state.song;
+  dirty_.state = dirty_.state || state.state;
+}
+
+void SceneManager::markDrumPatternDirty(int patternIndex) {
+  dirty_.drumPatterns |= 1u << patternIndex;
+}
+
+void SceneManager::markSynthPatternDirty(int synthIndex, int patternIndex) {
+  dirty_.synthPatterns[synthIndex] |= 1u << patternIndex;
 }
 
 void SceneManager::setDrumStep(int voiceIdx, int step, bool hit, bool accent) {
-  DrumPatternSet& patternSet = editCurrentDrumPattern();
+  int pat = clampPatternIndex(drumPatternIndex_);
   int clampedVoice = clampIndex(voiceIdx, DrumPatternSet::kVoices);
   int clampedStep = clampIndex(step, DrumPattern::kSteps);
-  patternSet.voices[clampedVoice].steps[clampedStep].hit = hit;
-  patternSet.voices[clampedVoice].steps[clampedStep].accent = accent;
+  DrumStep value = scene_.drumBank.patterns[pat].voices[clampedVoice].steps[clampedStep];
+  value.hit = hit;
+  value.accent = accent;
+  writeDrumStep(pat, clampedVoice, clampedStep, value);
 }
 
 void SceneManager::setSynthStep(int synthIdx, int step, int note, bool slide, bool accent) {
-  SynthPattern& pattern = editCurrentSynthPattern(synthIdx);
+  int idx = clampSynthIndex(synthIdx);
+  int pat = clampPatternIndex(synthPatternIndex_[idx]);
   int clampedStep = clampIndex(step, SynthPattern::kSteps);
-  pattern.steps[clampedStep].note = note;
-  pattern.steps[clampedStep].slide = slide;
-  pattern.steps[clampedStep].accent = accent;
+  SynthStep value = getSynthPattern(idx, pat).steps[clampedStep];
+  value.note = note;
+  value.slide = slide;
+  value.accent = accent;
+  writeSynthStep(idx, pat, clampedStep, value);
+}
+
+void SceneManager::setDrumStepTiming(int voiceIdx, int step, int timing) {
+  int pat = clampPatternIndex(drumPatternIndex_);
+  int clampedVoice = clampIndex(voiceIdx, DrumPatternSet::kVoices);
+  int clampedStep = clampIndex(step, DrumPattern::kSteps);
+  DrumStep value = scene_.drumBank.patterns[pat].voices[clampedVoice].steps[clampedStep];
+  value.timing = clampStepTiming(timing);
+  writeDrumStep(pat, clampedVoice, clampedStep, value);
+}
+
+void SceneManager::setSynthStepTiming(int synthIdx, int step, int timing) {
+  int idx = clampSynthIndex(synthIdx);
+  int pat = clampPatternIndex(synthPatternIndex_[idx]);
+  int clampedStep = clampIndex(step, SynthPattern::kSteps);
+  SynthStep value = getSynthPattern(idx, pat).steps[clampedStep];
+  value.timing = clampStepTiming(timing);
+  writeSynthStep(idx, pat, clampedStep, value);
+}
+
+void SceneManager::setDrumSwing(int voiceIdx, int swing) {
+  writeDrumSwing(clampPatternIndex(drumPatternIndex_), clampIndex(voiceIdx, DrumPatternSet::kVoices),
+                 clampStepSwing(swing));
+}
+
+void SceneManager::setSynthSwing(int synthIdx, int swing) {
+  int idx = clampSynthIndex(synthIdx);
+  writeSynthSwing(idx, clampPatternIndex(synthPatternIndex_[idx]), clampStepSwing(swing));
+}
+
+void SceneManager::setCurrentDrumPattern(const DrumPatternSet& patternSet) {
+  int pat = clampPatternIndex(drumPatternIndex_);
+  beginEdit();
+  for (int v = 0; v < DrumPatternSet::kVoices; ++v) {
+    const DrumPattern& voice = patternSet.voices[v];
+    for (int i = 0; i < DrumPattern::kSteps; ++i) writeDrumStep(pat, v, i, voice.steps[i]);
+    writeDrumSwing(pat, v, clampStepSwing(voice.swing));
+  }
+  endEdit();
+}
+
+void SceneManager::setCurrentSynthPattern(int synthIdx, const SynthPattern& pattern) {
+  int idx = clampSynthIndex(synthIdx);
+  int pat = clampPatternIndex(synthPatternIndex_[idx]);
+  beginEdit();
+  for (int i = 0; i < SynthPattern::kSteps; ++i) writeSynthStep(idx, pat, i, pattern.steps[i]);
+  writeSynthSwing(idx, pat, clampStepSwing(pattern.swing));
+  endEdit();
+}
+
+// The write*() helpers take clamped indices, change one cell, mark it dirty
+// and record it; a write that changes nothing leaves no trace.
+void SceneManager::writeDrumStep(int patternIndex, int voiceIdx, int step, const DrumStep& value) {
+  DrumStep& cell = scene_.drumBank.patterns[patternIndex].voices[voiceIdx].steps[step];
+  uint32_t before = packDrumStep(cell);
+  uint32_t after = packDrumStep(value);
+  if (before == after) return;
+  if (journal_.journal) {
+    journal_.journal->record(SceneJournal::DrumStep, static_cast<uint8_t>(patternIndex),
+                             static_cast<uint8_t>(voiceIdx), static_cast<uint8_t>(step), before, after);
+  }
+  cell = value;
+  markDrumPatternDirty(patternIndex);
+}
+
+void SceneManager::writeSynthStep(int synthIdx, int patternIndex, int step, const SynthStep& value) {
+  Bank<SynthPattern>& bank = synthIdx == 0 ? scene_.synthABank : scene_.synthBBank;
+  SynthStep& cell = bank.patterns[patternIndex].steps[step];
+  uint32_t before = packSynthStep(cell);
+  uint32_t after = packSynthStep(value);
+  if (before == after) return;
+  if (journal_.journal) {
+    journal_.journal->record(SceneJournal::SynthStep, static_cast<uint8_t>(synthIdx),
+                             static_cast<uint8_t>(patternIndex), static_cast<uint8_t>(step), before, after);
+  }
+  cell = value;
+  markSynthPatternDirty(synthIdx, patternIndex);
+}
+
+void SceneManager::writeDrumSwing(int patternIndex, int voiceIdx, int swing) {
+  int8_t& cell = scene_.drumBank.patterns[patternIndex].voices[voiceIdx].swing;
+  if (cell == swing) return;
+  if (journal_.journal) {
+    journal_.journal->record(SceneJournal::DrumSwing, static_cast<uint8_t>(patternIndex),
+                             static_cast<uint8_t>(voiceIdx), 0, static_cast<uint8_t>(cell),
+                             static_cast<uint8_t>(swing));
+  }
+  cell = static_cast<int8_t>(swing);
+  markDrumPatternDirty(patternIndex);
+}
+
+void SceneManager::writeSynthSwing(int synthIdx, int patternIndex, int swing) {
+  Bank<SynthPattern>& bank = synthIdx == 0 ? scene_.synthABank : scene_.synthBBank;
+  int8_t& cell = bank.patterns[patternIndex].swing;
+  if (cell == swing) return;
+  if (journal_.journal) {
+    journal_.journal->record(SceneJournal::SynthSwing, static_cast<uint8_t>(synthIdx),
+                             static_cast<uint8_t>(patternIndex), 0, static_cast<uint8_t>(cell),
+                             static_cast<uint8_t>(swing));
+  }
+  cell = static_cast<int8_t>(swing);
+  markSynthPatternDirty(synthIdx, patternIndex);
+}
+
+void SceneManager::writeSongCell(int position, int trackIdx, int patternIndex) {
+  int8_t& cell = scene_.song.positions[position].patterns[trackIdx];
+  if (cell == patternIndex) return;
+  if (journal_.journal) {
+    journal_.journal->record(SceneJournal::SongCell, static_cast<uint8_t>(position),
+                             static_cast<uint8_t>(trackIdx), 0, static_cast<uint8_t>(cell),
+                             static_cast<uint8_t>(patternIndex));
+  }
+  cell = static_cast<int8_t>(patternIndex);
+  dirty_.song = true;
+}
+
+void SceneManager::writeSongLength(int length) {
+  if (scene_.song.length == length) return;
+  if (journal_.journal) {
+    journal_.journal->record(SceneJournal::SongLength, 0, 0, 0, static_cast<uint32_t>(scene_.song.length),
+                             static_cast<uint32_t>(length));
+  }
+  scene_.song.length = length;
+  dirty_.song = true;
+}
+
+void SceneManager::applyJournalEntry(const SceneJournal::Entry& entry, uint32_t value) {
+  // indices were clamped when the entry was recorded
+  switch (entry.target & ~SceneJournal::kGroupStart) {
+  case SceneJournal::DrumStep:
+    scene_.drumBank.patterns[entry.a].voices[entry.b].steps[entry.c] = unpackDrumStep(value);
+    markDrumPatternDirty(entry.a);
+    break;
+  case SceneJournal::SynthStep: {
+    Bank<SynthPattern>& bank = entry.a == 0 ? scene_.synthABank : scene_.synthBBank;
+    bank.patterns[entry.b].steps[entry.c] = unpackSynthStep(value);
+    markSynthPatternDirty(entry.a, entry.b);
+    break;
+  }
+  case SceneJournal::DrumSwing:
+    scene_.drumBank.patterns[entry.a].voices[entry.b].swing = static_cast<int8_t>(value);
+    markDrumPatternDirty(entry.a);
+    break;
+  case SceneJournal::SynthSwing: {
+    Bank<SynthPattern>& bank = entry.a == 0 ? scene_.synthABank : scene_.synthBBank;
+    bank.patterns[entry.b].swing = static_cast<int8_t>(value);
+    markSynthPatternDirty(entry.a, entry.b);
+    break;
+  }
+  case SceneJournal::SongCell:
+    scene_.song.positions[entry.a].patterns[entry.b] = static_cast<int8_t>(value);
+    dirty_.song = true;
+    break;
+  case SceneJournal::SongLength:
+    scene_.song.length = static_cast<int>(value);
+    dirty_.song = true;
+    if (songPosition_ >= scene_.song.length) {
+      songPosition_ = scene_.song.length - 1;
+      dirty_.state = true;
+    }
+    break;
+  case SceneJournal::SynthParam:
+    setSynthParamValue(synthParameters_[entry.a], static_cast<SynthParamId>(entry.b), bitsFloat(value));
+    dirty_.state = true;
+    break;
+  default:
+    break;
+  }
+}
+
+void SceneManager::setJournal(SceneJournal* journal) {
+  journal_.journal = journal;
+  clearEditHistory();
+}
+
+void SceneManager::beginEdit() {
+  if (journal_.journal) journal_.journal->beginGroup();
+}
+
+void SceneManager::endEdit() {
+  if (journal_.journal) journal_.journal->endGroup();
+}
+
+bool SceneManager::undo() {
+  if (!journal_.journal) return false;
+  return journal_.journal->undo(
+      [this](const SceneJournal::Entry& entry, uint32_t value) { applyJournalEntry(entry, value); });
+}
+
+bool SceneManager::redo() {
+  if (!journal_.journal) return false;
+  return journal_.journal->redo(
+      [this](const SceneJournal::Entry& entry, uint32_t value) { applyJournalEntry(entry, value); });
+}
+
+void SceneManager::clearEditHistory() {
+  if (journal_.journal) journal_.journal->clear();
+}
+
+SceneJournalStats SceneManager::journalStats() const {
+  return journal_.journal ? journal_.journal->stats() : SceneJournalStats();
+}
+
+SceneManager::JournalLink& SceneManager::JournalLink::operator=(const JournalLink&) {
+  // the history now refers to a scene that is gone, but clearing it belongs
+  // to whoever owns the journal, off the thread that did the assigning
+  return *this;
 }
 
 void SceneManager::buildSceneDocument(ArduinoJson::JsonDocument& doc) const {
@@ -919,6 +1442,8 @@ void SceneManager::buildSceneDocument(ArduinoJson::JsonDocument& doc) const {
   serializeSynthBank(scene_.synthABank, synthABank);
   ArduinoJson::JsonArray synthBBank = root["synthBBank"].to<ArduinoJson::JsonArray>();
   serializeSynthBank(scene_.synthBBank, synthBBank);
+  serializeSynthSwing(scene_.synthABank, root, "synthASwing");
+  serializeSynthSwing(scene_.synthBBank, root, "synthBSwing");
   ArduinoJson::JsonObject songObj = root["song"].to<ArduinoJson::JsonObject>();
   int songLen = songLength();
   songObj["length"] = songLen;
@@ -980,6 +1505,8 @@ bool SceneManager::applySceneDocument(const ArduinoJson::JsonDocument& doc) {
   if (!deserializeDrumBank(drumBank, loaded.drumBank)) return false;
   if (!deserializeSynthBank(synthABank, loaded.synthABank)) return false;
   if (!deserializeSynthBank(synthBBank, loaded.synthBBank)) return false;
+  if (!deserializeSynthSwing(obj["synthASwing"], loaded.synthABank)) return false;
+  if (!deserializeSynthSwing(obj["synthBSwing"], loaded.synthBBank)) return false;
 
   int drumPatternIndex = 0;
   int synthPatternIndexA = 0;
@@ -1012,9 +1539,9 @@ bool SceneManager::applySceneDocument(const ArduinoJson::JsonDocument& doc) {
           auto a = posObj["a"];
           auto b = posObj["b"];
           auto d = posObj["drums"];
-          if (a.is<int>()) loadedSong.positions[posIdx].patterns[0] = a.as<int>();
-          if (b.is<int>()) loadedSong.positions[posIdx].patterns[1] = b.as<int>();
-          if (d.is<int>()) loadedSong.positions[posIdx].patterns[2] = d.as<int>();
+          if (a.is<int>()) loadedSong.positions[posIdx].patterns[0] = clampSongPattern(a.as<int>());
+          if (b.is<int>()) loadedSong.positions[posIdx].patterns[1] = clampSongPattern(b.as<int>());
+          if (d.is<int>()) loadedSong.positions[posIdx].patterns[2] = clampSongPattern(d.as<int>());
         }
         if (posIdx + 1 > loadedSong.length) loadedSong.length = posIdx + 1;
         ++posIdx;
@@ -1071,9 +1598,9 @@ bool SceneManager::applySceneDocument(const ArduinoJson::JsonDocument& doc) {
   drumPatternIndex_ = clampPatternIndex(drumPatternIndex);
   synthPatternIndex_[0] = clampPatternIndex(synthPatternIndexA);
   synthPatternIndex_[1] = clampPatternIndex(synthPatternIndexB);
-  drumBankIndex_ = clampIndex(drumBankIndex, 1);
-  synthBankIndex_[0] = clampIndex(synthBankIndexA, 1);
-  synthBankIndex_[1] = clampIndex(synthBankIndexB, 1);
+  drumBankIndex_ = clampIndex(drumBankIndex, kBankCount);
+  synthBankIndex_[0] = clampIndex(synthBankIndexA, kBankCount);
+  synthBankIndex_[1] = clampIndex(synthBankIndexB, kBankCount);
   for (int i = 0; i < DrumPatternSet::kVoices; ++i) {
     drumMute_[i] = drumMute[i];
   }
@@ -1081,10 +1608,16 @@ bool SceneManager::applySceneDocument(const ArduinoJson::JsonDocument& doc) {
   synthMute_[1] = synthMute[1];
   synthParameters_[0] = synthParams[0];
   synthParameters_[1] = synthParams[1];
+  sanitizeSynthParameters(synthParameters_[0]);
+  sanitizeSynthParameters(synthParameters_[1]);
   setSongLength(scene_.song.length);
   songPosition_ = clampSongPosition(songPosition);
   songMode_ = songMode;
   setBpm(bpm);
+  clearEditHistory();
+  // the binary file may not hold this scene, or may be why it came from
+  // JSON: the next save rewrites it whole rather than patching it
+  markAllDirty();
   return true;
 }
 
@@ -1095,38 +1628,34 @@ std::string SceneManager::dumpCurrentScene() const {
 }
 
 bool SceneManager::loadScene(const std::string& json) {
-  size_t idx = 0;
-  JsonVisitor::NextChar nextChar = [&json, &idx]() -> int {
-    if (idx >= json.size()) return -1;
-    return static_cast<unsigned char>(json[idx++]);
-  };
-  if (loadSceneEventedWithReader(nextChar)) return true;
+  JsonMemorySource source(json.data(), json.size());
+  if (loadSceneEventedFrom(source)) return true;
   return loadSceneJson(json);
 }
 
-bool SceneManager::loadSceneEventedWithReader(JsonVisitor::NextChar nextChar) {
-  Scene loaded{};
-  clearSceneData(loaded);
-
-  struct NextCharStream {
-    JsonVisitor::NextChar next;
-    int read() { return next(); }
-  };
+void SceneManager::resetScene(Scene& scene) {
+  clearSceneData(scene);
+}
 
-  NextCharStream stream{std::move(nextChar)};
-  JsonVisitor visitor;
-  SceneJsonObserver observer(loaded, bpm_);
-  bool parsed = visitor.parse(stream, observer);
-  if (!parsed || observer.hadError()) return false;
+void SceneManager::sanitizeSynthParameters(SynthParameters& params) {
+  const SynthParameters defaults;
+  params.cutoff = finiteOr(params.cutoff, defaults.cutoff);
+  params.resonance = finiteOr(params.resonance, defaults.resonance);
+  params.envAmount = finiteOr(params.envAmount, defaults.envAmount);
+  params.envDecay = finiteOr(params.envDecay, defaults.envDecay);
+  // the binary container keeps it in a byte
+  if (params.oscType < 0 || params.oscType > 255) params.oscType = defaults.oscType;
+}
 
+bool SceneManager::applyEventedScene(const Scene& loaded, const SceneJsonObserver& observer) {
   scene_ = loaded;
   scene_.song = observer.song();
   drumPatternIndex_ = clampPatternIndex(observer.drumPatternIndex());
   synthPatternIndex_[0] = clampPatternIndex(observer.synthPatternIndex(0));
   synthPatternIndex_[1] = clampPatternIndex(observer.synthPatternIndex(1));
-  drumBankIndex_ = clampIndex(observer.drumBankIndex(), 1);
-  synthBankIndex_[0] = clampIndex(observer.synthBankIndex(0), 1);
-  synthBankIndex_[1] = clampIndex(observer.synthBankIndex(1), 1);
+  drumBankIndex_ = clampIndex(observer.drumBankIndex(), kBankCount);
+  synthBankIndex_[0] = clampIndex(observer.synthBankIndex(0), kBankCount);
+  synthBankIndex_[1] = clampIndex(observer.synthBankIndex(1), kBankCount);
   if (!observer.hasSong()) {
     scene_.song.length = 1;
     scene_.song.positions[0].patterns[0] = synthPatternIndex_[0];
@@ -1140,10 +1669,16 @@ bool SceneManager::loadSceneEventedWithReader(JsonVisitor::NextChar nextChar) {
   synthMute_[1] = observer.synthMute(1);
   synthParameters_[0] = observer.synthParameters(0);
   synthParameters_[1] = observer.synthParameters(1);
+  sanitizeSynthParameters(synthParameters_[0]);
+  sanitizeSynthParameters(synthParameters_[1]);
   setSongLength(scene_.song.length);
   songPosition_ = clampSongPosition(observer.songPosition());
   songMode_ = observer.songMode();
   setBpm(observer.bpm());
+  clearEditHistory();
+  // the binary file may not hold this scene, or may be why it came from
+  // JSON: the next save rewrites it whole rather than patching it
+  markAllDirty();
   return true;
 }
 
@@ -1197,8 +1732,11 @@ void SceneManager::trimSongLength() {
     }
   }
   int newLength = lastUsed >= 0 ? lastUsed + 1 : 1;
-  scene_.song.length = clampSongLength(newLength);
-  if (songPosition_ >= scene_.song.length) songPosition_ = scene_.song.length - 1;
+  writeSongLength(clampSongLength(newLength));
+  if (songPosition_ >= scene_.song.length) {
+    songPosition_ = scene_.song.length - 1;
+    dirty_.state = true;
+  }
 }
 
 void SceneManager::clearSongData(Song& song) const {
@@ -8,6 +8,7 @@
 #include <utility>
 #include "ArduinoJson-v7.4.2.h"
 #include "json_evented.h"
+#include "scene_journal.h"
 
 namespace scene_json_detail {
 inline bool writeChunk(std::string& writer, const char* data, size_t len) {
@@ -44,14 +45,21 @@ bool writeChunk(Writer& writer, const char* data, size_t len) {
 }
 } // namespace scene_json_detail
 
+// Step timing is stored in percent of a step so it survives tempo changes.
+// Swing delays the odd steps, microtiming nudges a single step either way.
+static constexpr int kMaxStepSwing = 50;
+static constexpr int kMaxStepTiming = 50;
+
 struct DrumStep {
   bool hit;
   bool accent;
+  int8_t timing; // -kMaxStepTiming..kMaxStepTiming
 };
 
 struct DrumPattern {
   static constexpr int kSteps = 16;
   DrumStep steps[kSteps];
+  int8_t swing; // 0..kMaxStepSwing
 };
 
 struct DrumPatternSet {
@@ -63,11 +71,13 @@ struct SynthStep {
   int note; 
   bool slide;
   bool accent;
+  int8_t timing; // -kMaxStepTiming..kMaxStepTiming
 };
 
 struct SynthPattern {
   static constexpr int kSteps = 16;
   SynthStep steps[kSteps];
+  int8_t swing; // 0..kMaxStepSwing
 };
 
 struct SynthParameters {
@@ -78,6 +88,14 @@ struct SynthParameters {
   int oscType = 0;
 };
 
+enum class SynthParamId : uint8_t {
+  Cutoff = 0,
+  Resonance,
+  EnvAmount,
+  EnvDecay,
+  OscType,
+};
+
 enum class SongTrack : uint8_t {
   SynthA = 0,
   SynthB = 1,
@@ -86,6 +104,7 @@ enum class SongTrack : uint8_t {
 
 struct SongPosition {
   static constexpr int kTrackCount = 3;
+  // bank * Bank::kPatterns + pattern, -1 = empty
   int8_t patterns[kTrackCount] = {-1, -1, -1};
 };
 
@@ -108,7 +127,7 @@ struct Scene {
   Song song;
 };
 
-class SceneJsonObserver : public JsonObserver {
+class SceneJsonObserver final : public JsonObserver {
 public:
   explicit SceneJsonObserver(Scene& scene, float defaultBpm = 100.0f);
 
@@ -120,8 +139,8 @@ public:
   void onNumber(double value) override;
   void onBool(bool value) override;
   void onNull() override;
-  void onString(const std::string& value) override;
-  void onObjectKey(const std::string& key) override;
+  void onString(JsonStringView value) override;
+  void onObjectKey(JsonStringView key) override;
   void onObjectValueStart() override;
   void onObjectValueEnd() override;
 
@@ -147,10 +166,13 @@ private:
     DrumVoice,
     DrumHitArray,
     DrumAccentArray,
+    DrumTimingArray,
     SynthABank,
     SynthBBank,
     SynthPattern,
     SynthStep,
+    SynthASwing,
+    SynthBSwing,
     State,
     SynthPatternIndex,
     SynthBankIndex,
@@ -165,6 +187,15 @@ private:
     Unknown,
   };
 
+  // Every key the scene format uses, resolved once per key as it is parsed
+  // so the handlers below switch on ids rather than compare strings.
+  enum class Key : uint8_t {
+    Other, A, Accent, B, Bpm, Cutoff, DrumBank, DrumBankIndex, DrumPatternIndex, Drums, EnvAmount,
+    EnvDecay, Hit, Length, Mute, Note, OscType, Positions, Resonance, Slide, Song, SongMode,
+    SongPosition, State, Swing, Synth, SynthABank, SynthASwing, SynthBBank, SynthBSwing,
+    SynthBankIndex, SynthParams, SynthPatternIndex, Timing,
+  };
+
   struct Context {
     enum class Type { Object, Array };
     Type type;
@@ -172,6 +203,7 @@ private:
     int index;
   };
 
+  static Key keyFor(JsonStringView key);
   Path deduceArrayPath(const Context& parent) const;
   Path deduceObjectPath(const Context& parent) const;
   int currentIndexFor(Path path) const;
@@ -185,7 +217,7 @@ private:
   static constexpr int kMaxStack = 16;
   Context stack_[kMaxStack];
   int stackSize_ = 0;
-  std::string lastKey_;
+  Key lastKey_ = Key::Other;
   Scene& target_;
   bool error_ = false;
   int drumPatternIndex_ = 0;
@@ -223,11 +255,32 @@ public:
   int getCurrentDrumPatternIndex() const;
   int getCurrentSynthPatternIndex(int synthIdx) const;
 
-  void setCurrentBankIndex(int instrumentId, int bankIdx);
+  // Each track has kBankCount banks of patterns. The scene holds the one
+  // each track has selected; song cells name bank * kPatterns + pattern, and
+  // the banks not held here live in bank records (see SceneBankPager).
+  static constexpr int kBankCount = 16;
+  static constexpr int kSongPatternCount = kBankCount * Bank<SynthPattern>::kPatterns;
+  static_assert(kSongPatternCount <= 128, "song cells are int8_t");
+  static int songCellBank(int cell) { return cell / Bank<SynthPattern>::kPatterns; }
+  static int songCellPattern(int cell) { return cell % Bank<SynthPattern>::kPatterns; }
+  static int songCell(int bank, int pattern) { return bank * Bank<SynthPattern>::kPatterns + pattern; }
+
+  // Replaces the bank a track holds with 'bank', keeping the pattern index.
+  // Not an edit: the history is cleared, since it refers to the old bank.
+  void setCurrentDrumBank(int bankIdx, const Bank<DrumPatternSet>& bank);
+  void setCurrentSynthBank(int synthIdx, int bankIdx, const Bank<SynthPattern>& bank);
+  // instrumentId 0 is the drums, 1 and 2 synth A and B
   int getCurrentBankIndex(int instrumentId) const;
 
   void setDrumStep(int voiceIdx, int step, bool hit, bool accent);
   void setSynthStep(int synthIdx, int step, int note, bool slide, bool accent);
+  void setDrumStepTiming(int voiceIdx, int step, int timing);
+  void setSynthStepTiming(int synthIdx, int step, int timing);
+  void setDrumSwing(int voiceIdx, int swing);
+  void setSynthSwing(int synthIdx, int swing);
+  // Whole-pattern writes, diffed cell by cell into one journal edit.
+  void setCurrentDrumPattern(const DrumPatternSet& patternSet);
+  void setCurrentSynthPattern(int synthIdx, const SynthPattern& pattern);
 
   std::string dumpCurrentScene() const;
   bool loadScene(const std::string& json);
@@ -237,6 +290,8 @@ public:
   void setSynthMute(int synthIdx, bool mute);
   bool getSynthMute(int synthIdx) const;
   void setSynthParameters(int synthIdx, const SynthParameters& params);
+  // One knob, recorded in the edit journal (setSynthParameters() is not).
+  void setSynthParameter(int synthIdx, SynthParamId id, float value);
   const SynthParameters& getSynthParameters(int synthIdx) const;
   void setBpm(float bpm);
   float getBpm() const;
@@ -253,6 +308,70 @@ public:
   void setSongMode(bool enabled);
   bool songMode() const;
 
+  // Binary scene container (scene_binary.cpp): magic, version and CRC
+  // around bit-packed banks, the song table and the sequencer state. Saved
+  // and loaded as one buffer, so storage does a single write or read. JSON
+  // remains the import/export format.
+  static constexpr size_t kSceneBinaryMaxSize = 2560;
+  size_t writeSceneBinary(uint8_t* out, size_t capacity) const;
+  bool loadSceneBinary(const uint8_t* data, size_t size);
+
+  // Bank records (scene_binary.cpp): one bank in the same pattern layout,
+  // with its own magic and CRC. A bank file holds a record per track and
+  // bank at a fixed offset; a record of zeros is a bank never written and
+  // loads empty. Loading fails only on a damaged record.
+  static constexpr size_t kBankRecordMaxSize = 1360;
+  static size_t bankRecordSize(SongTrack track);
+  static size_t bankRecordOffset(SongTrack track, int bank);
+  static size_t writeBankRecord(const Bank<DrumPatternSet>& bank, uint8_t* out, size_t capacity);
+  static size_t writeBankRecord(const Bank<SynthPattern>& bank, uint8_t* out, size_t capacity);
+  static bool loadBankRecord(const uint8_t* data, size_t size, Bank<DrumPatternSet>& bank);
+  static bool loadBankRecord(const uint8_t* data, size_t size, Bank<SynthPattern>& bank);
+
+  // Dirty tracking against the copy in storage. Setters mark only real
+  // changes; edit*() hand out references, so they mark their pattern (or
+  // the song) up front. Loading leaves the scene clean, loadDefaultScene()
+  // leaves it all dirty.
+  struct DirtyState {
+    uint32_t drumPatterns = 0;          // bit per pattern in the drum bank
+    uint32_t synthPatterns[2] = {0, 0}; // bit per pattern, synth A and B
+    bool song = false;
+    bool state = false; // pattern/bank indices, mutes, synth params, tempo, song mode and position
+  };
+  bool isDirty() const;
+  const DirtyState& dirtyState() const;
+  void markClean();
+  // Also means "not in storage under this name yet": forces a full write.
+  void markAllDirty();
+  // Adds 'state' to what is already dirty.
+  void markDirty(const DirtyState& state);
+
+  // Parts of the writeSceneBinary() image covering what is dirty, header
+  // first and neighbours merged, so storage can patch a saved file in place.
+  // Returns 0 when the whole image has to be written.
+  struct BinaryRange {
+    uint16_t offset;
+    uint16_t size;
+  };
+  static constexpr size_t kMaxBinaryRanges = 32;
+  size_t dirtyBinaryRanges(BinaryRange* out, size_t maxRanges) const;
+
+  // Edit history. With a journal attached, the step, swing, song and
+  // setSynthParameter() setters record what they change; edits made through
+  // edit*() references are not recorded. Selection, mutes, tempo and the
+  // song position are playing state, not edits. Loading a scene clears the
+  // history; copies start without a journal. Assigning one over this
+  // SceneManager keeps the journal and leaves clearing it to the owner, since
+  // a scene switch assigns on the audio thread.
+  void setJournal(SceneJournal* journal);
+  // Everything set between these undoes as one edit.
+  void beginEdit();
+  void endEdit();
+  bool undo();
+  bool redo();
+  void clearEditHistory();
+  SceneJournalStats journalStats() const;
+
   template <typename TWriter>
   bool writeSceneJson(TWriter&& writer) const;
   template <typename TReader>
@@ -272,9 +391,33 @@ private:
   void clearSongData(Song& song) const;
   void buildSceneDocument(ArduinoJson::JsonDocument& doc) const;
   bool applySceneDocument(const ArduinoJson::JsonDocument& doc);
-  bool loadSceneEventedWithReader(JsonVisitor::NextChar nextChar);
+  template <typename Source>
+  bool loadSceneEventedFrom(Source& source);
+  static void resetScene(Scene& scene);
+  // keeps what a loader read within what every format can store
+  static void sanitizeSynthParameters(SynthParameters& params);
+  bool applyEventedScene(const Scene& loaded, const SceneJsonObserver& observer);
+  void markDrumPatternDirty(int patternIndex);
+  void markSynthPatternDirty(int synthIndex, int patternIndex);
+  void writeDrumStep(int patternIndex, int voiceIdx, int step, const DrumStep& value);
+  void writeSynthStep(int synthIdx, int patternIndex, int step, const SynthStep& value);
+  void writeDrumSwing(int patternIndex, int voiceIdx, int swing);
+  void writeSynthSwing(int synthIdx, int patternIndex, int swing);
+  void writeSongCell(int position, int trackIdx, int patternIndex);
+  void writeSongLength(int length);
+  void applyJournalEntry(const SceneJournal::Entry& entry, uint32_t value);
+
+  // Stays with this object: copies get none, assignment keeps it as is.
+  struct JournalLink {
+    SceneJournal* journal = nullptr;
+    JournalLink() = default;
+    JournalLink(const JournalLink&) {}
+    JournalLink& operator=(const JournalLink&);
+  };
 
   Scene scene_;
+  DirtyState dirty_;
+  JournalLink journal_;
   int drumPatternIndex_ = 0;
   int synthPatternIndex_[2] = {0, 0};
   int drumBankIndex_ = 0;
@@ -352,7 +495,25 @@ bool SceneManager::writeSceneJson(TWriter&& writer) const {
       if (i > 0 && !writeChar(',')) return false;
       if (!writeBool(pattern.steps[i].accent)) return false;
     }
-    return writeLiteral("]}");
+    if (!writeChar(']')) return false;
+    // timing keys are optional and only written when used
+    bool hasTiming = false;
+    for (int i = 0; i < DrumPattern::kSteps; ++i) {
+      if (pattern.steps[i].timing != 0) hasTiming = true;
+    }
+    if (hasTiming) {
+      if (!writeLiteral(",\"timing\":[")) return false;
+      for (int i = 0; i < DrumPattern::kSteps; ++i) {
+        if (i > 0 && !writeChar(',')) return false;
+        if (!writeInt(pattern.steps[i].timing)) return false;
+      }
+      if (!writeChar(']')) return false;
+    }
+    if (pattern.swing != 0) {
+      if (!writeLiteral(",\"swing\":")) return false;
+      if (!writeInt(pattern.swing)) return false;
+    }
+    return writeChar('}');
   };
   auto writeDrumBank = [&](const Bank<DrumPatternSet>& bank) -> bool {
     if (!writeChar('[')) return false;
@@ -377,6 +538,10 @@ bool SceneManager::writeSceneJson(TWriter&& writer) const {
       if (!writeBool(pattern.steps[i].slide)) return false;
       if (!writeLiteral(",\"accent\":")) return false;
       if (!writeBool(pattern.steps[i].accent)) return false;
+      if (pattern.steps[i].timing != 0) {
+        if (!writeLiteral(",\"timing\":")) return false;
+        if (!writeInt(pattern.steps[i].timing)) return false;
+      }
       if (!writeChar('}')) return false;
     }
     return writeChar(']');
@@ -389,6 +554,20 @@ bool SceneManager::writeSceneJson(TWriter&& writer) const {
     }
     return writeChar(']');
   };
+  auto writeSynthSwing = [&](const char* key, const Bank<SynthPattern>& bank) -> bool {
+    bool hasSwing = false;
+    for (int p = 0; p < Bank<SynthPattern>::kPatterns; ++p) {
+      if (bank.patterns[p].swing != 0) hasSwing = true;
+    }
+    if (!hasSwing) return true;
+    if (!writeLiteral(key)) return false;
+    if (!writeChar('[')) return false;
+    for (int p = 0; p < Bank<SynthPattern>::kPatterns; ++p) {
+      if (p > 0 && !writeChar(',')) return false;
+      if (!writeInt(bank.patterns[p].swing)) return false;
+    }
+    return writeChar(']');
+  };
 
   if (!writeChar('{')) return false;
 
@@ -401,6 +580,9 @@ bool SceneManager::writeSceneJson(TWriter&& writer) const {
   if (!writeLiteral(",\"synthBBank\":")) return false;
   if (!writeSynthBank(scene_.synthBBank)) return false;
 
+  if (!writeSynthSwing(",\"synthASwing\":", scene_.synthABank)) return false;
+  if (!writeSynthSwing(",\"synthBSwing\":", scene_.synthBBank)) return false;
+
   if (!writeLiteral(",\"song\":{")) return false;
   int songLen = songLength();
   if (!writeLiteral("\"length\":")) return false;
@@ -480,6 +662,16 @@ bool SceneManager::loadSceneJson(TReader&& reader) {
 
 template <typename TReader>
 bool SceneManager::loadSceneEvented(TReader&& reader) {
-  JsonVisitor::NextChar nextChar = [&reader]() -> int { return reader.read(); };
-  return loadSceneEventedWithReader(nextChar);
+  using Reader = typename std::remove_reference<TReader>::type;
+  JsonStreamSource<Reader> source(reader);
+  return loadSceneEventedFrom(source);
+}
+
+template <typename Source>
+bool SceneManager::loadSceneEventedFrom(Source& source) {
+  Scene loaded{};
+  resetScene(loaded);
+  SceneJsonObserver observer(loaded, bpm_);
+  if (!parseJson(source, observer) || observer.hadError()) return false;
+  return applyEventedScene(loaded, observer);
 }
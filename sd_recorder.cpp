@@ -0,0 +1,233 @@
+#include "sd_recorder.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#if defined(ARDUINO)
+#include <esp_heap_caps.h>
+#endif
+
+namespace {
+
+void writeLE16(uint8_t* dst, uint16_t value) {
+  dst[0] = static_cast<uint8_t>(value & 0xFF);
+  dst[1] = static_cast<uint8_t>((value >> 8) & 0xFF);
+}
+
+void writeLE32(uint8_t* dst, uint32_t value) {
+  dst[0] = static_cast<uint8_t>(value & 0xFF);
+  dst[1] = static_cast<uint8_t>((value >> 8) & 0xFF);
+  dst[2] = static_cast<uint8_t>((value >> 16) & 0xFF);
+  dst[3] = static_cast<uint8_t>((value >> 24) & 0xFF);
+}
+
+// RIFF + fmt + JUNK padding + data header fill exactly one sector
+constexpr size_t kHeaderBytes = SdRecorder::kSectorBytes;
+constexpr uint32_t kPadBytes = kHeaderBytes - 12 - 24 - 8 - 8;
+constexpr uint32_t kRiffSizeOffset = 4;
+constexpr uint32_t kDataSizeOffset = kHeaderBytes - 4;
+// FAT32 caps a file just under 4 GB
+constexpr uint32_t kMaxDataBytes = 0xFFFFFFFFu - kHeaderBytes - SdRecorder::kBlockBytes;
+constexpr int kMaxRecordingIndex = 999;
+
+void buildHeader(uint8_t* header, int sampleRate, int channels) {
+  memset(header, 0, kHeaderBytes);
+  memcpy(header, "RIFF", 4);
+  memcpy(header + 8, "WAVE", 4);
+  memcpy(header + 12, "fmt ", 4);
+  writeLE32(header + 16, 16);
+  writeLE16(header + 20, 1);
+  writeLE16(header + 22, static_cast<uint16_t>(channels));
+  writeLE32(header + 24, static_cast<uint32_t>(sampleRate));
+  writeLE32(header + 28, static_cast<uint32_t>(sampleRate * channels * sizeof(int16_t)));
+  writeLE16(header + 32, static_cast<uint16_t>(channels * sizeof(int16_t)));
+  writeLE16(header + 34, 16);
+  memcpy(header + 36, "JUNK", 4);
+  writeLE32(header + 40, kPadBytes);
+  memcpy(header + kDataSizeOffset - 4, "data", 4);
+  writeLE32(header + kRiffSizeOffset, kHeaderBytes - 8);
+}
+
+} // namespace
+
+SdRecorder::SdRecorder(RecordingStorage* storage) : storage_(storage) {}
+
+SdRecorder::~SdRecorder() {
+  free(pool_);
+}
+
+bool SdRecorder::allocatePool() {
+  if (pool_) return true;
+#if defined(ARDUINO)
+  pool_ = static_cast<uint8_t*>(heap_caps_malloc(kPsramBlocks * kBlockBytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  if (pool_) {
+    blockCount_ = kPsramBlocks;
+    inPsram_ = true;
+  } else {
+    pool_ = static_cast<uint8_t*>(heap_caps_malloc(kDramBlocks * kBlockBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    blockCount_ = kDramBlocks;
+  }
+#else
+  // the desktop stand-in gets the same budget as a board without PSRAM
+  pool_ = static_cast<uint8_t*>(malloc(kDramBlocks * kBlockBytes));
+  blockCount_ = kDramBlocks;
+#endif
+  if (!pool_) {
+    blockCount_ = 0;
+    return false;
+  }
+  freeBlocks_.allocate(blockCount_);
+  fullBlocks_.allocate(blockCount_);
+  return true;
+}
+
+uint8_t* SdRecorder::block(uint16_t index) const {
+  return pool_ + static_cast<size_t>(index) * kBlockBytes;
+}
+
+bool SdRecorder::start(int sampleRate, int channels) {
+  if (state_.load(std::memory_order_acquire) != Idle || !storage_ || channels <= 0) return false;
+  if (!allocatePool()) return false;
+
+  char name[32];
+  int index = 1;
+  for (; index <= kMaxRecordingIndex; ++index) {
+    snprintf(name, sizeof(name), "/miniacid_rec_%03d.wav", index);
+    if (!storage_->exists(name)) break;
+  }
+  if (index > kMaxRecordingIndex || !storage_->open(name)) return false;
+
+  // the header sector goes out through the first pool block, so the file
+  // is sector-aligned from the start
+  uint8_t* header = block(0);
+  buildHeader(header, sampleRate, channels);
+  if (storage_->write(header, kHeaderBytes) != kHeaderBytes) {
+    storage_->close();
+    return false;
+  }
+
+  filename_ = name;
+  channels_ = channels;
+  dataBytes_ = 0;
+  freeBlocks_.clear();
+  fullBlocks_.clear();
+  for (uint16_t i = 0; i < blockCount_; ++i) freeBlocks_.push(&i, 1);
+  current_ = kNoBlock;
+  currentFill_ = 0;
+  blocksWritten_.store(0, std::memory_order_relaxed);
+  droppedBlocks_.store(0, std::memory_order_relaxed);
+  droppedFrames_.store(0, std::memory_order_relaxed);
+  writeErrors_.store(0, std::memory_order_relaxed);
+  state_.store(Recording, std::memory_order_release);
+  accepting_.store(true, std::memory_order_seq_cst);
+  return true;
+}
+
+void SdRecorder::stop() {
+  if (state_.load(std::memory_order_acquire) != Recording) return;
+
+  // fence off the audio task, then hand its partial block to the writer
+  accepting_.store(false, std::memory_order_seq_cst);
+  while (producerBusy_.load(std::memory_order_seq_cst)) {
+    std::this_thread::yield();
+  }
+  if (current_ != kNoBlock) {
+    blockFill_[current_] = currentFill_;
+    fullBlocks_.push(&current_, 1);
+    current_ = kNoBlock;
+  }
+  state_.store(Stopping, std::memory_order_release);
+}
+
+bool SdRecorder::isRecording() const {
+  return state_.load(std::memory_order_acquire) != Idle;
+}
+
+const std::string& SdRecorder::filename() const {
+  return filename_;
+}
+
+SdRecorderStats SdRecorder::stats() const {
+  SdRecorderStats s;
+  s.blockCount = blockCount_;
+  s.blockBytes = kBlockBytes;
+  s.inPsram = inPsram_;
+  s.queueHighWater = static_cast<uint32_t>(fullBlocks_.highWater());
+  s.blocksWritten = blocksWritten_.load(std::memory_order_relaxed);
+  s.droppedBlocks = droppedBlocks_.load(std::memory_order_relaxed);
+  s.droppedFrames = droppedFrames_.load(std::memory_order_relaxed);
+  s.writeErrors = writeErrors_.load(std::memory_order_relaxed);
+  return s;
+}
+
+void SdRecorder::push(const int16_t* samples, size_t frames) {
+  if (!samples || frames == 0) return;
+  producerBusy_.store(true, std::memory_order_seq_cst);
+  if (accepting_.load(std::memory_order_seq_cst)) {
+    const size_t frameBytes = static_cast<size_t>(channels_) * sizeof(int16_t);
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(samples);
+    size_t remaining = frames * frameBytes;
+    while (remaining > 0) {
+      if (current_ == kNoBlock) {
+        if (freeBlocks_.pop(&current_, 1) == 0) {
+          // the writer is behind: lose the rest of this buffer
+          current_ = kNoBlock;
+          droppedBlocks_.fetch_add(1, std::memory_order_relaxed);
+          droppedFrames_.fetch_add(static_cast<uint32_t>(remaining / frameBytes), std::memory_order_relaxed);
+          break;
+        }
+        currentFill_ = 0;
+      }
+      size_t count = kBlockBytes - currentFill_;
+      if (count > remaining) count = remaining;
+      memcpy(block(current_) + currentFill_, src, count);
+      currentFill_ += static_cast<uint32_t>(count);
+      src += count;
+      remaining -= count;
+      if (currentFill_ == kBlockBytes) {
+        blockFill_[current_] = currentFill_;
+        fullBlocks_.push(&current_, 1);
+        current_ = kNoBlock;
+      }
+    }
+  }
+  producerBusy_.store(false, std::memory_order_release);
+}
+
+size_t SdRecorder::pump() {
+  uint8_t state = state_.load(std::memory_order_acquire);
+  if (state == Idle) return 0;
+
+  size_t written = 0;
+  uint16_t index = kNoBlock;
+  while (fullBlocks_.pop(&index, 1) == 1) {
+    uint32_t bytes = blockFill_[index];
+    if (dataBytes_ + bytes > kMaxDataBytes) {
+      writeErrors_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      size_t done = storage_->write(block(index), bytes);
+      dataBytes_ += static_cast<uint32_t>(done);
+      if (done != bytes) writeErrors_.fetch_add(1, std::memory_order_relaxed);
+    }
+    freeBlocks_.push(&index, 1);
+    blocksWritten_.fetch_add(1, std::memory_order_relaxed);
+    ++written;
+  }
+
+  // stop() queued the last block before switching state, so an empty
+  // queue here means everything is on the card
+  if (state == Stopping) finalize();
+  return written;
+}
+
+void SdRecorder::finalize() {
+  uint8_t field[4];
+  writeLE32(field, static_cast<uint32_t>(kHeaderBytes - 8) + dataBytes_);
+  storage_->writeAt(kRiffSizeOffset, field, sizeof(field));
+  writeLE32(field, dataBytes_);
+  storage_->writeAt(kDataSizeOffset, field, sizeof(field));
+  storage_->close();
+  state_.store(Idle, std::memory_order_release);
+}
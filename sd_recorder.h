@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "recording_storage.h"
+#include "src/dsp/mini_sample_ring.h"
+
+struct SdRecorderStats {
+  uint32_t blockCount = 0;     // blocks in the pool
+  uint32_t blockBytes = 0;
+  bool inPsram = false;
+  uint32_t queueHighWater = 0; // most blocks waiting for the writer at once
+  uint32_t blocksWritten = 0;
+  uint32_t droppedBlocks = 0;  // audio buffers that found no free block
+  uint32_t droppedFrames = 0;
+  uint32_t writeErrors = 0;
+};
+
+// 16-bit WAV recorder for the audio task. push() copies each rendered
+// buffer into a pool of fixed-size blocks (PSRAM when there is any) and
+// never touches the card; a low-priority task calls pump() to write full
+// blocks out. Blocks are whole sectors and the header takes exactly one
+// sector, so every data write lands sector-aligned.
+class SdRecorder {
+public:
+  static constexpr size_t kSectorBytes = 512;
+  static constexpr size_t kBlockBytes = 16 * kSectorBytes;
+
+  explicit SdRecorder(RecordingStorage* storage);
+  ~SdRecorder();
+
+  // UI side. start() allocates the pool on first use and opens the next free
+  // /miniacid_rec_NNN.wav. stop() returns at once; the file is finalized by
+  // the next pump() calls and isRecording() stays true until it is closed.
+  bool start(int sampleRate, int channels);
+  void stop();
+  bool isRecording() const;
+  const std::string& filename() const;
+  SdRecorderStats stats() const;
+
+  // Audio task: 'frames' interleaved frames of the current channel count.
+  void push(const int16_t* samples, size_t frames);
+
+  // Writer task: writes every queued block and finalizes a stopped
+  // recording. Returns the number of blocks written.
+  size_t pump();
+
+private:
+  enum State : uint8_t { Idle, Recording, Stopping };
+  static constexpr uint16_t kNoBlock = 0xFFFF;
+  // pool sizes: about 6 s of mono audio in PSRAM, 1 s in internal RAM
+  static constexpr uint16_t kPsramBlocks = 32;
+  static constexpr uint16_t kDramBlocks = 6;
+
+  bool allocatePool();
+  void finalize();
+  uint8_t* block(uint16_t index) const;
+
+  RecordingStorage* storage_;
+  std::string filename_;
+  int channels_ = 1;
+
+  uint8_t* pool_ = nullptr;
+  uint16_t blockCount_ = 0;
+  bool inPsram_ = false;
+  uint32_t blockFill_[kPsramBlocks] = {}; // bytes used, set before a block is queued
+  SampleRing<uint16_t> freeBlocks_;
+  SampleRing<uint16_t> fullBlocks_;
+
+  // producer state, owned by the audio task while recording
+  uint16_t current_ = kNoBlock;
+  uint32_t currentFill_ = 0;
+
+  uint32_t dataBytes_ = 0; // writer side
+  std::atomic<uint8_t> state_{Idle};
+  std::atomic<bool> accepting_{false};
+  std::atomic<bool> producerBusy_{false};
+  std::atomic<uint32_t> blocksWritten_{0};
+  std::atomic<uint32_t> droppedBlocks_{0};
+  std::atomic<uint32_t> droppedFrames_{0};
+  std::atomic<uint32_t> writeErrors_{0};
+};
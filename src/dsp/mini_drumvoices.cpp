@@ -1,4 +1,5 @@
 #include "mini_drumvoices.h"
+#include "mini_dsp_utils.h"
 #include <math.h>
 
 static inline float fast_tanhf(float x) {
@@ -6,6 +7,9 @@ static inline float fast_tanhf(float x) {
   return x * (27.0f + x2) / (27.0f + 9.0f * x2);
 }
 static inline float db_to_amp(float db) { return powf(10.0f, db * 0.05f); }
+// bus compressor sub-rate; for tighter response, use 2
+static const int kCompDecim = 4;
+
 static inline float amp_to_db(float a) {
   const float eps = 1e-12f;
   return 20.0f * log10f(fabsf(a) + eps);
@@ -21,6 +25,14 @@ DrumSynthVoice::DrumSynthVoice(float sampleRate)
 }
 
 void DrumSynthVoice::reset() {
+  resetState();
+
+  // Params
+  params[static_cast<int>(DrumParamId::MainVolume)]    = Parameter("vol", "Main volume", 0.0f, 1.0f, 0.8f, 1.0f / 128);
+  params[static_cast<int>(DrumParamId::BusCompAmount)] = Parameter("comp", "Bus comp amount", 0.0f, 1.0f, compAmount, 1.0f / 128);
+}
+
+void DrumSynthVoice::resetState() {
   // Kick
   kickPhase = 0.0f; kickFreq = 55.0f;
   kickEnvAmp = 0.0f; kickEnvPitch = 0.0f; kickClickEnv = 0.0f;
@@ -79,10 +91,10 @@ void DrumSynthVoice::reset() {
   compGainDb   =  0.0f;
   compDecimCounter = 0;
   compLastGainAmp  = 1.0f;
+  compAmountRamp.reset();
 
-  // Params
-  params[static_cast<int>(DrumParamId::MainVolume)]    = Parameter("vol", "Main volume", 0.0f, 1.0f, 0.8f, 1.0f / 128);
-  params[static_cast<int>(DrumParamId::BusCompAmount)] = Parameter("comp", "Bus comp amount", 0.0f, 1.0f, compAmount, 1.0f / 128);
+  // Noise
+  rngState = 0x12345678u;
 }
 
 void DrumSynthVoice::setSampleRate(float sampleRateHz) {
@@ -115,6 +127,7 @@ void DrumSynthVoice::setSampleRate(float sampleRateHz) {
   float releaseTime = 0.060f;  // ~60 ms
   compAttackCoeff  = 1.0f - expf(-1.0f / (attackTime  * sampleRate));
   compReleaseCoeff = 1.0f - expf(-1.0f / (releaseTime * sampleRate));
+  compAmountRamp.setRampLength(static_cast<int>(sampleRate * kParamRampSeconds) / kCompDecim);
 }
 
 float DrumSynthVoice::frand() {
@@ -461,11 +474,82 @@ float DrumSynthVoice::processClap() {
 }
 
 // Bus Compressor
+template <float (DrumSynthVoice::*Process)(), bool DrumSynthVoice::*Active>
+void DrumSynthVoice::accumulateLane(float* out, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    // a lane only restarts on a trigger, so once it stops the block is done
+    if (!(this->*Active)) break;
+    out[i] += (this->*Process)();
+  }
+}
+
+void DrumSynthVoice::processLaneBlock(int lane, float* out, size_t count) {
+  using Block = void (DrumSynthVoice::*)(float*, size_t);
+  static const Block kLaneBlocks[kLaneCount] = {
+    &DrumSynthVoice::accumulateLane<&DrumSynthVoice::processKick, &DrumSynthVoice::kickActive>,
+    &DrumSynthVoice::accumulateLane<&DrumSynthVoice::processSnare, &DrumSynthVoice::snareActive>,
+    &DrumSynthVoice::accumulateLane<&DrumSynthVoice::processHat, &DrumSynthVoice::hatActive>,
+    &DrumSynthVoice::accumulateLane<&DrumSynthVoice::processOpenHat, &DrumSynthVoice::openHatActive>,
+    &DrumSynthVoice::accumulateLane<&DrumSynthVoice::processMidTom, &DrumSynthVoice::midTomActive>,
+    &DrumSynthVoice::accumulateLane<&DrumSynthVoice::processHighTom, &DrumSynthVoice::highTomActive>,
+    &DrumSynthVoice::accumulateLane<&DrumSynthVoice::processRim, &DrumSynthVoice::rimActive>,
+    &DrumSynthVoice::accumulateLane<&DrumSynthVoice::processClap, &DrumSynthVoice::clapActive>,
+  };
+  if (lane < 0 || lane >= kLaneCount || !out) return;
+  (this->*kLaneBlocks[lane])(out, count);
+}
+
+bool DrumSynthVoice::isLaneActive(int lane) const {
+  switch (lane) {
+  case 0: return kickActive;
+  case 1: return snareActive;
+  case 2: return hatActive;
+  case 3: return openHatActive;
+  case 4: return midTomActive;
+  case 5: return highTomActive;
+  case 6: return rimActive;
+  case 7: return clapActive;
+  default: return false;
+  }
+}
+
+void DrumSynthVoice::processBusBlock(float* io, size_t count) {
+  compAmountRamp.beginBlock(params[static_cast<int>(DrumParamId::BusCompAmount)].value());
+  for (size_t i = 0; i < count; ++i) io[i] = processBusSample(io[i]);
+}
+
+bool DrumSynthVoice::isActive() const {
+  return kickActive || snareActive || hatActive || openHatActive ||
+         midTomActive || highTomActive || rimActive || clapActive;
+}
+
+bool DrumSynthVoice::isBusIdle() const {
+  // -100 dB detector level and <0.001 dB of gain reduction left
+  return compEnv < 1.0e-5f && fabsf(compGainDb) < 1.0e-3f;
+}
+
 float DrumSynthVoice::processBus(float mixSample) {
-  const int kCompDecim = 4; // for tighter response, use 2
+  compAmountRamp.beginBlock(params[static_cast<int>(DrumParamId::BusCompAmount)].value());
+  return processBusSample(mixSample);
+}
+
+void DrumSynthVoice::processBusStereo(float* mono, float* left, float* right, size_t count) {
+  compAmountRamp.beginBlock(params[static_cast<int>(DrumParamId::BusCompAmount)].value());
+  for (size_t i = 0; i < count; ++i) {
+    float gain = busGain(mono[i]);
+    mono[i] *= gain;
+    left[i] *= gain;
+    right[i] *= gain;
+  }
+}
+
+float DrumSynthVoice::processBusSample(float mixSample) {
+  return mixSample * busGain(mixSample);
+}
 
+float DrumSynthVoice::busGain(float mixSample) {
   if (compDecimCounter == 0) {
-    compAmount   = params[static_cast<int>(DrumParamId::BusCompAmount)].value();
+    compAmount   = compAmountRamp.next();
     compThreshDb = -18.0f + 12.0f * compAmount; // -18 .. -6 dB
     compRatio    =  2.0f +  4.0f * compAmount;  // 2:1  .. 6:1
     compMakeupDb =  6.0f * compAmount;          // up to ~+6 dB
@@ -475,7 +559,7 @@ float DrumSynthVoice::processBus(float mixSample) {
     float inAbs  = fabsf(mixSample);
     float target = inAbs;
     float coeff  = (target > compEnv) ? compAttackCoeff : compReleaseCoeff;
-    compEnv += coeff * (target - compEnv);
+    compEnv = flushDenormal(compEnv + coeff * (target - compEnv));
 
     // dB-domain soft knee
     float levelDb = amp_to_db(compEnv);
@@ -494,14 +578,14 @@ float DrumSynthVoice::processBus(float mixSample) {
 
     // smooth gain reduction
     const float grSmooth = 0.8f;
-    compGainDb = grSmooth * compGainDb + (1.0f - grSmooth) * grDb;
+    compGainDb = flushDenormal(grSmooth * compGainDb + (1.0f - grSmooth) * grDb);
 
     // convert to amplitude + makeup once per update
     compLastGainAmp = db_to_amp(compGainDb + compMakeupDb);
   }
 
   compDecimCounter = (compDecimCounter + 1) % kCompDecim;
-  return mixSample * compLastGainAmp;
+  return compLastGainAmp;
 }
 
 const Parameter& DrumSynthVoice::parameter(DrumParamId id) const {
@@ -1,5 +1,6 @@
 
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 #include "mini_dsp_params.h"
 
@@ -13,6 +14,9 @@ class DrumSynthVoice {
 public:
   explicit DrumSynthVoice(float sampleRate);
   void reset();
+  // Silences every lane and clears the filters, bus compressor and noise
+  // generator; the parameters keep their values.
+  void resetState();
   void setSampleRate(float sampleRate);
 
   // Triggers
@@ -35,9 +39,26 @@ public:
   float processRim();
   float processClap();     // updated
 
+  // Block processing. Lanes are numbered in trigger order, 0 = kick .. 7 = clap.
+  static constexpr int kLaneCount = 8;
+  // Adds 'count' samples of one lane into 'out'.
+  void processLaneBlock(int lane, float* out, size_t count);
+  bool isLaneActive(int lane) const;
+  void processBusBlock(float* io, size_t count);
+  // Stereo bus: the compressor keys off 'mono' and applies the same gain to
+  // all three buffers.
+  void processBusStereo(float* mono, float* left, float* right, size_t count);
+
   // Bus processing
   float processBus(float mixSample);
 
+  // True while any drum is still sounding. Only a trigger can make a silent
+  // kit active again.
+  bool isActive() const;
+  // True once the bus compressor has settled after silence; processBus(0)
+  // would only return zeros.
+  bool isBusIdle() const;
+
   // Snare
   float snareHpPrev; // extra high-pass memory
 
@@ -46,6 +67,12 @@ public:
   void setParameter(DrumParamId id, float value);
 
 private:
+  template <float (DrumSynthVoice::*Process)(), bool DrumSynthVoice::*Active>
+  void accumulateLane(float* out, size_t count);
+
+  float processBusSample(float mixSample);
+  float busGain(float mixSample);
+
   // Fast RNG [-1, 1]
   float frand();
   uint32_t rngState;
@@ -118,6 +145,7 @@ private:
   float compGainDb, compMakeupDb, compThreshDb, compRatio, compKneeDb, compAmount;
   int   compDecimCounter;   // sub-rate update counter
   float compLastGainAmp;    // last applied amplitude gain
+  ParamRamp compAmountRamp; // stepped once per sub-rate update
   
   // Global params - for later
   Parameter params[static_cast<int>(DrumParamId::Count)];
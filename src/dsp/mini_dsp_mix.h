@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#define MINIACID_MIX_SSE 1
+#endif
+
+// Block mixing helpers. The SSE paths do the same per-element operations as
+// the scalar loops, so results match bit for bit.
+
+// dst[i] += src[i]
+inline void mixAdd(float* dst, const float* src, size_t count) {
+  size_t i = 0;
+#if defined(MINIACID_MIX_SSE)
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+  }
+#endif
+  for (; i < count; ++i) dst[i] += src[i];
+}
+
+// left[i] += src[i] * gainLeft, right[i] += src[i] * gainRight
+inline void mixPanned(float* left, float* right, const float* src, size_t count,
+                      float gainLeft, float gainRight) {
+  size_t i = 0;
+#if defined(MINIACID_MIX_SSE)
+  const __m128 gl = _mm_set1_ps(gainLeft);
+  const __m128 gr = _mm_set1_ps(gainRight);
+  for (; i + 4 <= count; i += 4) {
+    __m128 s = _mm_loadu_ps(src + i);
+    _mm_storeu_ps(left + i, _mm_add_ps(_mm_loadu_ps(left + i), _mm_mul_ps(s, gl)));
+    _mm_storeu_ps(right + i, _mm_add_ps(_mm_loadu_ps(right + i), _mm_mul_ps(s, gr)));
+  }
+#endif
+  for (; i < count; ++i) {
+    left[i] += src[i] * gainLeft;
+    right[i] += src[i] * gainRight;
+  }
+}
+
+// dst[i] *= gain
+inline void mixScale(float* dst, size_t count, float gain) {
+  size_t i = 0;
+#if defined(MINIACID_MIX_SSE)
+  const __m128 g = _mm_set1_ps(gain);
+  for (; i + 4 <= count; i += 4) _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), g));
+#endif
+  for (; i < count; ++i) dst[i] *= gain;
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <math.h>
+#include <stdint.h>
+
 class Parameter {
 public:
   Parameter();
@@ -129,3 +132,101 @@ inline const char* Parameter::optionLabel() const {
   if (idx < 0 || idx >= optionCount_) return nullptr;
   return options_[idx];
 }
+
+// Default smoothing time for DSP-facing parameters.
+constexpr float kParamRampSeconds = 0.01f;
+
+enum class RampShape : uint8_t {
+  Linear = 0,
+  Exponential, // constant ratio per sample; for frequencies and gains
+};
+
+// Smoothed view of a Parameter for the audio thread. The owner latches the
+// target once per block with beginBlock() and reads next() per sample. The
+// slope is only recomputed when the target moved, so a burst of parameter
+// changes between two blocks costs the same as a single one.
+class ParamRamp {
+public:
+  ParamRamp();
+  ParamRamp(RampShape shape, int rampSamples);
+
+  void setRampLength(int samples);
+  // Drops any ramp in progress; the next beginBlock() jumps to its target.
+  void reset();
+  void jump(float value);
+  void beginBlock(float target);
+  float next();
+
+  float current() const;
+  float target() const;
+  bool isRamping() const;
+
+private:
+  RampShape shape_;
+  bool primed_;
+  bool multiply_;
+  int rampSamples_;
+  int samplesLeft_;
+  float current_;
+  float target_;
+  float step_; // per-sample increment, or ratio when multiply_
+};
+
+inline ParamRamp::ParamRamp() : ParamRamp(RampShape::Linear, 1) {}
+
+inline ParamRamp::ParamRamp(RampShape shape, int rampSamples)
+  : shape_(shape), primed_(false), multiply_(false), rampSamples_(1),
+    samplesLeft_(0), current_(0.0f), target_(0.0f), step_(0.0f) {
+  setRampLength(rampSamples);
+}
+
+inline void ParamRamp::setRampLength(int samples) {
+  rampSamples_ = samples < 1 ? 1 : samples;
+}
+
+inline void ParamRamp::reset() {
+  primed_ = false;
+  samplesLeft_ = 0;
+}
+
+inline void ParamRamp::jump(float value) {
+  primed_ = true;
+  samplesLeft_ = 0;
+  current_ = value;
+  target_ = value;
+}
+
+inline void ParamRamp::beginBlock(float target) {
+  if (!primed_) {
+    jump(target);
+    return;
+  }
+  if (target == target_) return;
+  target_ = target;
+  if (rampSamples_ <= 1) {
+    current_ = target;
+    samplesLeft_ = 0;
+    return;
+  }
+  // exponential ramps need both ends on the same side of zero
+  multiply_ = shape_ == RampShape::Exponential &&
+              ((current_ > 0.0f && target > 0.0f) || (current_ < 0.0f && target < 0.0f));
+  if (multiply_) {
+    step_ = powf(target / current_, 1.0f / static_cast<float>(rampSamples_));
+  } else {
+    step_ = (target - current_) / static_cast<float>(rampSamples_);
+  }
+  samplesLeft_ = rampSamples_;
+}
+
+inline float ParamRamp::next() {
+  if (samplesLeft_ > 0) {
+    current_ = multiply_ ? current_ * step_ : current_ + step_;
+    if (--samplesLeft_ == 0) current_ = target_;
+  }
+  return current_;
+}
+
+inline float ParamRamp::current() const { return current_; }
+inline float ParamRamp::target() const { return target_; }
+inline bool ParamRamp::isRamping() const { return samplesLeft_ > 0; }
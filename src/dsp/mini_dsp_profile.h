@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Free-running cycle counter for measuring DSP cost. Only differences between
+// two reads are meaningful; wraps at 32 bits.
+// On targets without a readable cycle counter this falls back to nanoseconds.
+inline uint32_t dspCycleCount() {
+#if defined(ARDUINO)
+  return ESP.getCycleCount();
+#elif defined(__x86_64__) || defined(__i386__)
+  return static_cast<uint32_t>(__rdtsc());
+#else
+  using clock = std::chrono::steady_clock;
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count());
+#endif
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// Flat byte writer/reader used for engine state snapshots. Nothing allocates;
+// a writer without a destination only counts bytes, which is how the
+// snapshot size is computed.
+class SnapshotWriter {
+public:
+  SnapshotWriter(uint8_t* dst, size_t capacity) : dst_(dst), capacity_(capacity), size_(0), ok_(true) {}
+
+  void bytes(const void* src, size_t len) {
+    if (dst_) {
+      if (!ok_ || size_ + len > capacity_) {
+        ok_ = false;
+        return;
+      }
+      memcpy(dst_ + size_, src, len);
+    }
+    size_ += len;
+  }
+
+  template <typename T>
+  void value(const T& v) {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be trivially copyable");
+    bytes(&v, sizeof(T));
+  }
+
+  size_t size() const { return size_; }
+  bool ok() const { return ok_; }
+
+private:
+  uint8_t* dst_;
+  size_t capacity_;
+  size_t size_;
+  bool ok_;
+};
+
+class SnapshotReader {
+public:
+  SnapshotReader(const uint8_t* src, size_t size) : src_(src), size_(size), pos_(0), ok_(src != nullptr) {}
+
+  void bytes(void* dst, size_t len) {
+    if (!ok_ || pos_ + len > size_) {
+      ok_ = false;
+      return;
+    }
+    memcpy(dst, src_ + pos_, len);
+    pos_ += len;
+  }
+
+  template <typename T>
+  void value(T& v) {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be trivially copyable");
+    bytes(&v, sizeof(T));
+  }
+
+  template <typename T>
+  T read() {
+    T v{};
+    value(v);
+    return v;
+  }
+
+  // Marks the snapshot as unusable, e.g. when it was taken with another configuration.
+  void fail() { ok_ = false; }
+  bool ok() const { return ok_; }
+
+private:
+  const uint8_t* src_;
+  size_t size_;
+  size_t pos_;
+  bool ok_;
+};
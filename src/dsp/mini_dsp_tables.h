@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+
+// Lookup tables for per-event math and the output stage. Everything here is
+// generated at compile time, so the tables live in flash on the ESP32 and a
+// step boundary costs a load instead of a powf.
+
+constexpr int kMidiNoteCount = 128;
+constexpr double kLn2 = 0.69314718055994530942;
+
+// exp(x) for constant evaluation: range reduction to |r| <= ln2/2 followed by
+// a Taylor series. Good to a few ulp of double over the ranges used here.
+constexpr double constexprExp(double x) {
+  int n = static_cast<int>(x / kLn2 + (x < 0.0 ? -0.5 : 0.5));
+  double r = x - n * kLn2;
+  double term = 1.0;
+  double sum = 1.0;
+  for (int k = 1; k < 24; ++k) {
+    term *= r / k;
+    sum += term;
+  }
+  for (; n > 0; --n) sum *= 2.0;
+  for (; n < 0; ++n) sum *= 0.5;
+  return sum;
+}
+
+// 2^(semitones / 12), split into whole octaves so notes an octave apart are
+// exactly a factor of two apart.
+constexpr double constexprSemitoneRatio(int semitones) {
+  int octaves = semitones >= 0 ? semitones / 12 : -((11 - semitones) / 12);
+  int rem = semitones - octaves * 12;
+  double ratio = constexprExp(rem * kLn2 / 12.0);
+  for (; octaves > 0; --octaves) ratio *= 2.0;
+  for (; octaves < 0; ++octaves) ratio *= 0.5;
+  return ratio;
+}
+
+struct NoteFreqTable {
+  float hz[kMidiNoteCount];
+};
+
+constexpr NoteFreqTable makeNoteFreqTable() {
+  NoteFreqTable table{};
+  for (int note = 0; note < kMidiNoteCount; ++note) {
+    table.hz[note] = static_cast<float>(440.0 * constexprSemitoneRatio(note - 69));
+  }
+  return table;
+}
+
+// MIDI note -> Hz, A4 (69) = 440 Hz.
+inline constexpr NoteFreqTable kNoteFreqTable = makeNoteFreqTable();
+
+inline float noteFrequency(int note) {
+  if (note < 0) note = 0;
+  if (note >= kMidiNoteCount) note = kMidiNoteCount - 1;
+  return kNoteFreqTable.hz[note];
+}
+
+// tanh soft clip over [0, kSoftClipRange], odd-symmetric; linear
+// interpolation between entries stays within 1e-4 of tanhf.
+constexpr int kSoftClipTableSize = 256;
+constexpr float kSoftClipRange = 4.0f;
+
+struct SoftClipTable {
+  float y[kSoftClipTableSize + 1];
+};
+
+constexpr SoftClipTable makeSoftClipTable() {
+  SoftClipTable table{};
+  for (int i = 0; i <= kSoftClipTableSize; ++i) {
+    double x = static_cast<double>(kSoftClipRange) * i / kSoftClipTableSize;
+    table.y[i] = static_cast<float>(1.0 - 2.0 / (constexprExp(2.0 * x) + 1.0));
+  }
+  return table;
+}
+
+inline constexpr SoftClipTable kSoftClipTable = makeSoftClipTable();
+
+// Accuracy against the closed-form 440 * 2^((n - 69) / 12), reference values
+// from double precision rounded to float.
+namespace dsp_tables_check {
+constexpr bool near(double a, double b, double tolerance) {
+  return a - b <= tolerance && b - a <= tolerance;
+}
+static_assert(near(constexprExp(1.0), 2.718281828459045, 1e-15), "constexprExp accuracy");
+static_assert(near(constexprExp(-7.5), 5.530843701478336e-4, 1e-18), "constexprExp accuracy");
+static_assert(kNoteFreqTable.hz[69] == 440.0f, "A4 must be exact");
+static_assert(kNoteFreqTable.hz[57] == 220.0f && kNoteFreqTable.hz[81] == 880.0f, "octaves must be exact");
+static_assert(kNoteFreqTable.hz[60] == 261.6255798339844f, "C4 off by more than float rounding");
+static_assert(kNoteFreqTable.hz[0] == 8.175799369812012f, "note 0 off by more than float rounding");
+static_assert(kNoteFreqTable.hz[127] == 12543.853515625f, "note 127 off by more than float rounding");
+static_assert(kSoftClipTable.y[0] == 0.0f, "soft clip must pass zero");
+static_assert(near(kSoftClipTable.y[64], 0.7615941559557649, 1e-7), "tanh(1) off by more than float rounding");
+static_assert(near(kSoftClipTable.y[kSoftClipTableSize], 0.999329299739067, 1e-7), "tanh(4) off by more than float rounding");
+} // namespace dsp_tables_check
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <math.h>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#endif
+
+// Decaying feedback paths end up in the denormal range, where some FPUs
+// slow down by orders of magnitude. Values this small are inaudible.
+inline float flushDenormal(float x) {
+  return fabsf(x) < 1.0e-15f ? 0.0f : x;
+}
+
+// Let the FPU flush denormals itself where it can (SSE FTZ/DAZ). Applies to
+// the calling thread only, so call it from the audio thread.
+inline void enableFlushToZero() {
+#if defined(__SSE__) || defined(__x86_64__)
+  _mm_setcsr(_mm_getcsr() | 0x8040);
+#endif
+}
+
+// Read position 'delay' samples (0 <= delay < length) behind 'writeIndex' on
+// a circular line. The whole and fractional parts are split before the
+// subtraction: wrapping a float position and truncating it can round up to
+// 'length' itself. The tap reads newer + (older - newer) * frac.
+struct DelayTap {
+  int newer;
+  int older;
+  float frac;
+};
+
+inline DelayTap delayTap(int writeIndex, float delay, int length) {
+  int whole = static_cast<int>(delay);
+  DelayTap tap;
+  tap.frac = delay - static_cast<float>(whole);
+  tap.newer = writeIndex - whole;
+  if (tap.newer < 0) tap.newer += length;
+  tap.older = tap.newer - 1;
+  if (tap.older < 0) tap.older += length;
+  return tap;
+}
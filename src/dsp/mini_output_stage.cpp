@@ -0,0 +1,170 @@
+#include "mini_output_stage.h"
+#include "mini_dsp_tables.h"
+
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+// mix bus headroom applied before limiting
+constexpr float kHeadroom = 0.65f;
+constexpr float kFullScale = 32767.0f;
+constexpr float kSoftClipIndexScale = kSoftClipTableSize / kSoftClipRange;
+constexpr uint32_t kDitherSeed = 0x2545F491u;
+
+// Hard clip at constant gain. The SSE2 path matches the scalar one bit for
+// bit: same operation order and truncating conversion.
+void convertHardClip(const float* mix, int16_t* out, size_t count, float volume) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128 headroom = _mm_set1_ps(kHeadroom);
+  const __m128 hi = _mm_set1_ps(1.0f);
+  const __m128 lo = _mm_set1_ps(-1.0f);
+  const __m128 fullScale = _mm_set1_ps(kFullScale);
+  const __m128 gain = _mm_set1_ps(volume);
+  for (; i + 8 <= count; i += 8) {
+    __m128 a = _mm_mul_ps(_mm_loadu_ps(mix + i), headroom);
+    __m128 b = _mm_mul_ps(_mm_loadu_ps(mix + i + 4), headroom);
+    a = _mm_max_ps(_mm_min_ps(a, hi), lo);
+    b = _mm_max_ps(_mm_min_ps(b, hi), lo);
+    a = _mm_mul_ps(_mm_mul_ps(a, fullScale), gain);
+    b = _mm_mul_ps(_mm_mul_ps(b, fullScale), gain);
+    __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+  }
+#endif
+  for (; i < count; ++i) {
+    float s = mix[i] * kHeadroom;
+    if (s > 1.0f)  s = 1.0f;
+    if (s < -1.0f) s = -1.0f;
+    out[i] = static_cast<int16_t>(s * kFullScale * volume);
+  }
+}
+
+void convertHardClipStereo(const float* left, const float* right, int16_t* out, size_t frames,
+                           float volume) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128 headroom = _mm_set1_ps(kHeadroom);
+  const __m128 hi = _mm_set1_ps(1.0f);
+  const __m128 lo = _mm_set1_ps(-1.0f);
+  const __m128 fullScale = _mm_set1_ps(kFullScale);
+  const __m128 gain = _mm_set1_ps(volume);
+  for (; i + 4 <= frames; i += 4) {
+    __m128 l = _mm_mul_ps(_mm_loadu_ps(left + i), headroom);
+    __m128 r = _mm_mul_ps(_mm_loadu_ps(right + i), headroom);
+    l = _mm_mul_ps(_mm_mul_ps(_mm_max_ps(_mm_min_ps(l, hi), lo), fullScale), gain);
+    r = _mm_mul_ps(_mm_mul_ps(_mm_max_ps(_mm_min_ps(r, hi), lo), fullScale), gain);
+    // l0 l1 l2 l3 r0 r1 r2 r3 -> l0 r0 l1 r1 ...
+    __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(l), _mm_cvttps_epi32(r));
+    __m128i interleaved = _mm_unpacklo_epi16(packed, _mm_srli_si128(packed, 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), interleaved);
+  }
+#endif
+  for (; i < frames; ++i) {
+    float l = left[i] * kHeadroom;
+    float r = right[i] * kHeadroom;
+    if (l > 1.0f)  l = 1.0f;
+    if (l < -1.0f) l = -1.0f;
+    if (r > 1.0f)  r = 1.0f;
+    if (r < -1.0f) r = -1.0f;
+    out[i * 2] = static_cast<int16_t>(l * kFullScale * volume);
+    out[i * 2 + 1] = static_cast<int16_t>(r * kFullScale * volume);
+  }
+}
+} // namespace
+
+OutputStage::OutputStage()
+  : softClip_(false),
+    dither_(false),
+    ditherState_(kDitherSeed),
+    volumeRamp_(RampShape::Linear, 1) {}
+
+void OutputStage::setSampleRate(float sr) {
+  if (sr <= 0.0f) sr = 44100.0f;
+  volumeRamp_.setRampLength(static_cast<int>(sr * kParamRampSeconds));
+}
+
+void OutputStage::reset() {
+  ditherState_ = kDitherSeed;
+  volumeRamp_.reset();
+}
+
+void OutputStage::setSoftClip(bool on) { softClip_ = on; }
+void OutputStage::setDither(bool on) { dither_ = on; }
+bool OutputStage::softClip() const { return softClip_; }
+bool OutputStage::dither() const { return dither_; }
+
+void OutputStage::skip(float volume) {
+  volumeRamp_.jump(volume);
+}
+
+float OutputStage::limit(float x) const {
+  if (!softClip_) {
+    if (x > 1.0f)  return 1.0f;
+    if (x < -1.0f) return -1.0f;
+    return x;
+  }
+  float ax = fabsf(x);
+  if (ax >= kSoftClipRange) return x > 0.0f ? 1.0f : -1.0f;
+  float pos = ax * kSoftClipIndexScale;
+  int idx = static_cast<int>(pos);
+  float frac = pos - static_cast<float>(idx);
+  float y = kSoftClipTable.y[idx] + (kSoftClipTable.y[idx + 1] - kSoftClipTable.y[idx]) * frac;
+  return x < 0.0f ? -y : y;
+}
+
+float OutputStage::ditherNoise() {
+  // sum of two uniform [-0.5, 0.5) values: triangular over +/-1 LSB
+  float sum = 0.0f;
+  for (int k = 0; k < 2; ++k) {
+    uint32_t x = ditherState_;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    ditherState_ = x;
+    sum += static_cast<float>(x) * (1.0f / 4294967296.0f) - 0.5f;
+  }
+  return sum;
+}
+
+void OutputStage::process(const float* mix, int16_t* out, size_t count, float volume) {
+  if (!mix || !out || count == 0) return;
+  volumeRamp_.beginBlock(volume);
+  if (!softClip_ && !dither_ && !volumeRamp_.isRamping()) {
+    convertHardClip(mix, out, count, volumeRamp_.current());
+    return;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = convert(limit(mix[i] * kHeadroom), volumeRamp_.next());
+  }
+}
+
+void OutputStage::processStereo(const float* left, const float* right, int16_t* out, size_t frames,
+                                float volume) {
+  if (!left || !right || !out || frames == 0) return;
+  volumeRamp_.beginBlock(volume);
+  if (!softClip_ && !dither_ && !volumeRamp_.isRamping()) {
+    convertHardClipStereo(left, right, out, frames, volumeRamp_.current());
+    return;
+  }
+
+  for (size_t i = 0; i < frames; ++i) {
+    float gain = volumeRamp_.next();
+    out[i * 2] = convert(limit(left[i] * kHeadroom), gain);
+    out[i * 2 + 1] = convert(limit(right[i] * kHeadroom), gain);
+  }
+}
+
+int16_t OutputStage::convert(float limited, float gain) {
+  float s = limited * kFullScale * gain;
+  if (dither_) {
+    s = floorf(s + ditherNoise() + 0.5f);
+    if (s > kFullScale) s = kFullScale;
+    if (s < -kFullScale - 1.0f) s = -kFullScale - 1.0f;
+  }
+  return static_cast<int16_t>(s);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mini_dsp_params.h"
+
+// Final float -> int16 conversion for the mix bus: fixed headroom, hard or
+// soft limiting, main volume and optional TPDF dither, one pass per block.
+// Used by every path that calls MiniAcid::generateAudioBuffer (SDL callback,
+// device audio task, offline renders).
+class OutputStage {
+public:
+  OutputStage();
+
+  void setSampleRate(float sr);
+  void reset();
+
+  void setSoftClip(bool on); // tanh-shaped limiting instead of hard clipping
+  void setDither(bool on);   // TPDF dither at +/-1 LSB
+  bool softClip() const;
+  bool dither() const;
+
+  // Converts 'count' samples of 'mix' into 'out'. 'volume' is latched once
+  // per call and ramped from the previous block's value.
+  void process(const float* mix, int16_t* out, size_t count, float volume);
+  // Stereo version; writes 'frames' interleaved L/R pairs.
+  void processStereo(const float* left, const float* right, int16_t* out, size_t frames, float volume);
+  // For blocks that are skipped as silent: there is nothing to smooth, so
+  // the volume lands on its target.
+  void skip(float volume);
+
+private:
+  float limit(float x) const;
+  float ditherNoise();
+  int16_t convert(float limited, float gain);
+
+  bool softClip_;
+  bool dither_;
+  uint32_t ditherState_;
+  ParamRamp volumeRamp_;
+};
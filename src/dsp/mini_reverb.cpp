@@ -0,0 +1,319 @@
+#include "mini_reverb.h"
+#include "mini_dsp_utils.h"
+
+#include <math.h>
+#include <algorithm>
+
+namespace {
+// Mutually prime-ish line lengths in milliseconds.
+const float kLineMs4[4] = {31.3f, 37.9f, 43.1f, 53.3f};
+const float kLineMs8[8] = {29.7f, 37.1f, 41.1f, 43.7f, 47.9f, 53.3f, 59.9f, 67.3f};
+
+// int16 lines store +/-4.0 full scale
+constexpr float kShortScale = 8192.0f;
+constexpr float kShortInvScale = 1.0f / kShortScale;
+
+// ~-80 dB: below this for a whole line length and the tail is considered gone
+constexpr float kSilenceThreshold = 0.0001f;
+constexpr float kModDepthMs = 0.6f;
+constexpr float kModRateHz = 0.7f;
+} // namespace
+
+FdnReverb::FdnReverb(float sampleRate)
+  : sampleRate(sampleRate),
+    lines(4),
+    int16Lines(false),
+    modulationOn(true),
+    decaySeconds(1.6f),
+    damping(0.35f),
+    longestLine(1),
+    lfoPhase(0.0f),
+    lfoInc(0.0f),
+    modDepth(0.0f),
+    idle(true),
+    windowPeak(0.0f),
+    windowCount(0) {
+  setSampleRate(sampleRate);
+}
+
+void FdnReverb::reset() {
+  clearLines();
+  for (int l = 0; l < kMaxLines; ++l) {
+    writePos[l] = 0;
+    dampState[l] = 0.0f;
+  }
+  lfoPhase = 0.0f;
+  idle = true;
+  windowPeak = 0.0f;
+  windowCount = 0;
+}
+
+void FdnReverb::setSampleRate(float sr) {
+  if (sr <= 0.0f) sr = 44100.0f;
+  sampleRate = sr;
+  lfoInc = kModRateHz / sampleRate;
+  modDepth = kModDepthMs * 0.001f * sampleRate;
+  allocateLines();
+}
+
+void FdnReverb::setLineCount(int count) {
+  int newLines = count > 4 ? kMaxLines : 4;
+  if (newLines == lines) return;
+  lines = newLines;
+  allocateLines();
+}
+
+void FdnReverb::setCompactLines(bool on) {
+  if (on == int16Lines) return;
+  int16Lines = on;
+  allocateLines();
+}
+
+void FdnReverb::setModulation(bool on) { modulationOn = on; }
+
+void FdnReverb::setDecay(float seconds) {
+  if (seconds < 0.1f) seconds = 0.1f;
+  if (seconds > 8.0f) seconds = 8.0f;
+  decaySeconds = seconds;
+  updateLineGains();
+}
+
+void FdnReverb::setDamping(float d) {
+  if (d < 0.0f) d = 0.0f;
+  if (d > 0.95f) d = 0.95f;
+  damping = d;
+}
+
+int FdnReverb::lineCount() const { return lines; }
+bool FdnReverb::compactLines() const { return int16Lines; }
+bool FdnReverb::modulation() const { return modulationOn; }
+bool FdnReverb::isIdle() const { return idle; }
+
+size_t FdnReverb::memoryBytes() const {
+  return sizeof(*this) + floatStorage.capacity() * sizeof(float) +
+         shortStorage.capacity() * sizeof(int16_t);
+}
+
+void FdnReverb::saveState(SnapshotWriter& out) const {
+  out.value(lines);
+  out.value(int16Lines);
+  out.value(modulationOn);
+  out.value(decaySeconds);
+  out.value(damping);
+  if (int16Lines) {
+    out.bytes(shortStorage.data(), shortStorage.size() * sizeof(int16_t));
+  } else {
+    out.bytes(floatStorage.data(), floatStorage.size() * sizeof(float));
+  }
+  out.value(writePos);
+  out.value(lineGain);
+  out.value(dampState);
+  out.value(lfoPhase);
+  out.value(idle);
+  out.value(windowPeak);
+  out.value(windowCount);
+}
+
+bool FdnReverb::loadState(SnapshotReader& in) {
+  int savedLines = in.read<int>();
+  bool savedInt16 = in.read<bool>();
+  if (!in.ok() || savedLines != lines || savedInt16 != int16Lines) {
+    in.fail();
+    return false;
+  }
+  in.value(modulationOn);
+  in.value(decaySeconds);
+  in.value(damping);
+  if (int16Lines) {
+    in.bytes(shortStorage.data(), shortStorage.size() * sizeof(int16_t));
+  } else {
+    in.bytes(floatStorage.data(), floatStorage.size() * sizeof(float));
+  }
+  in.value(writePos);
+  in.value(lineGain);
+  in.value(dampState);
+  in.value(lfoPhase);
+  in.value(idle);
+  in.value(windowPeak);
+  in.value(windowCount);
+  return in.ok();
+}
+
+void FdnReverb::allocateLines() {
+  const float* lineMs = lines == kMaxLines ? kLineMs8 : kLineMs4;
+  int total = 0;
+  longestLine = 1;
+  for (int l = 0; l < kMaxLines; ++l) {
+    if (l >= lines) {
+      lineLength[l] = 0;
+      lineOffset[l] = total;
+      continue;
+    }
+    int len = static_cast<int>(lineMs[l] * 0.001f * sampleRate);
+    // modulated heads read up to modDepth samples ahead of the line end
+    int minLen = static_cast<int>(modDepth) + 4;
+    if (len < minLen) len = minLen;
+    lineLength[l] = len;
+    lineOffset[l] = total;
+    total += len;
+    if (len > longestLine) longestLine = len;
+  }
+
+  // release the unused representation so the RAM figure stays honest
+  if (int16Lines) {
+    std::vector<float>().swap(floatStorage);
+    shortStorage.assign(static_cast<size_t>(total), 0);
+  } else {
+    std::vector<int16_t>().swap(shortStorage);
+    floatStorage.assign(static_cast<size_t>(total), 0.0f);
+  }
+  updateLineGains();
+  reset();
+}
+
+void FdnReverb::updateLineGains() {
+  for (int l = 0; l < kMaxLines; ++l) {
+    if (l >= lines || lineLength[l] <= 0) {
+      lineGain[l] = 0.0f;
+      continue;
+    }
+    // -60 dB after decaySeconds: g = 10^(-3 * len / (sr * rt60))
+    float exponent = -3.0f * static_cast<float>(lineLength[l]) / (sampleRate * decaySeconds);
+    lineGain[l] = powf(10.0f, exponent);
+  }
+}
+
+void FdnReverb::clearLines() {
+  std::fill(floatStorage.begin(), floatStorage.end(), 0.0f);
+  std::fill(shortStorage.begin(), shortStorage.end(), static_cast<int16_t>(0));
+}
+
+float FdnReverb::readLine(int line, float delay) const {
+  DelayTap tap = delayTap(writePos[line], delay, lineLength[line]);
+  int base = lineOffset[line];
+  float a, b;
+  if (int16Lines) {
+    a = shortStorage[base + tap.newer] * kShortInvScale;
+    b = shortStorage[base + tap.older] * kShortInvScale;
+  } else {
+    a = floatStorage[base + tap.newer];
+    b = floatStorage[base + tap.older];
+  }
+  return a + (b - a) * tap.frac;
+}
+
+void FdnReverb::writeLine(int line, float value) {
+  int idx = lineOffset[line] + writePos[line];
+  if (int16Lines) {
+    float scaled = value * kShortScale;
+    if (scaled > 32767.0f) scaled = 32767.0f;
+    if (scaled < -32768.0f) scaled = -32768.0f;
+    shortStorage[idx] = static_cast<int16_t>(scaled);
+  } else {
+    floatStorage[idx] = value;
+  }
+  if (++writePos[line] >= lineLength[line]) writePos[line] = 0;
+}
+
+bool FdnReverb::process(const float* input, float* out, size_t numSamples) {
+  if (!input || !out || numSamples == 0) return false;
+  if (!wake(input, numSamples)) return false;
+  run<false>(input, out, nullptr, numSamples);
+  return true;
+}
+
+bool FdnReverb::process(const float* input, float* outLeft, float* outRight, size_t numSamples) {
+  if (!input || !outLeft || !outRight || numSamples == 0) return false;
+  if (!wake(input, numSamples)) return false;
+  run<true>(input, outLeft, outRight, numSamples);
+  return true;
+}
+
+bool FdnReverb::wake(const float* input, size_t numSamples) {
+  if (!idle) return true;
+  bool hasInput = false;
+  for (size_t i = 0; i < numSamples; ++i) {
+    if (fabsf(input[i]) >= kSilenceThreshold) {
+      hasInput = true;
+      break;
+    }
+  }
+  if (!hasInput) return false;
+  idle = false;
+  windowPeak = 0.0f;
+  windowCount = 0;
+  return true;
+}
+
+template <bool Stereo>
+void FdnReverb::run(const float* input, float* outLeft, float* outRight, size_t numSamples) {
+  const float feedbackScale = 2.0f / static_cast<float>(lines);
+  const float dampCoeff = 1.0f - damping;
+  const float outGain = 1.2f / static_cast<float>(lines);
+  const bool modulate = modulationOn;
+
+  for (size_t i = 0; i < numSamples; ++i) {
+    float x = input[i];
+    if (idle) {
+      // tail ran out earlier in this block; stay bypassed until new input
+      if (fabsf(x) < kSilenceThreshold) continue;
+      idle = false;
+    }
+    float y[kMaxLines];
+    float sum = 0.0f;
+
+    float mod = 0.0f;
+    if (modulate) {
+      lfoPhase += lfoInc;
+      if (lfoPhase >= 1.0f) lfoPhase -= 1.0f;
+      // triangle LFO in 0..1, cheaper than sinf and smooth enough at this rate
+      float tri = lfoPhase < 0.5f ? lfoPhase * 2.0f : 2.0f - lfoPhase * 2.0f;
+      mod = tri * modDepth;
+    }
+
+    for (int l = 0; l < lines; ++l) {
+      if (modulate && l < 2) {
+        // two heads move in opposite directions to keep the pitch wobble subtle
+        float m = l == 0 ? mod : modDepth - mod;
+        y[l] = readLine(l, static_cast<float>(lineLength[l]) - 1.0f - m);
+      } else {
+        int idx = lineOffset[l] + writePos[l];
+        y[l] = int16Lines ? shortStorage[idx] * kShortInvScale : floatStorage[idx];
+      }
+      sum += y[l];
+    }
+
+    // Householder feedback matrix: y - 2/N * sum(y)
+    float reflect = sum * feedbackScale;
+    float wet = 0.0f;
+    float wetRight = 0.0f;
+    float peak = fabsf(x);
+    for (int l = 0; l < lines; ++l) {
+      float fb = (y[l] - reflect) * lineGain[l];
+      dampState[l] = flushDenormal(dampState[l] + (fb - dampState[l]) * dampCoeff);
+      float v = dampState[l] + x;
+      writeLine(l, v);
+      float av = fabsf(v);
+      if (av > peak) peak = av;
+      wet += (l & 1) ? -y[l] : y[l];
+      if (Stereo) wetRight += (l & 2) ? -y[l] : y[l];
+    }
+    outLeft[i] += wet * outGain;
+    if (Stereo) outRight[i] += wetRight * outGain;
+
+    if (peak > windowPeak) windowPeak = peak;
+    if (++windowCount >= longestLine) {
+      if (windowPeak < kSilenceThreshold) {
+        idle = true;
+        // whatever is left in the lines is below the threshold; drop it
+        clearLines();
+        for (int l = 0; l < lines; ++l) dampState[l] = 0.0f;
+        windowPeak = 0.0f;
+        windowCount = 0;
+        continue;
+      }
+      windowPeak = 0.0f;
+      windowCount = 0;
+    }
+  }
+}
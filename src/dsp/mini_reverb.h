@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "mini_dsp_snapshot.h"
+
+// Small feedback-delay-network reverb meant to be used as a send effect.
+// 4 or 8 delay lines mixed through a Householder matrix, one-pole damping
+// per line and optional slow modulation of two read heads.
+class FdnReverb {
+public:
+  static constexpr int kMaxLines = 8;
+
+  explicit FdnReverb(float sampleRate);
+
+  void reset();
+  void setSampleRate(float sr);
+  // Reallocates the lines; call with the audio thread held off.
+  void setLineCount(int lines); // 4 or 8
+  void setCompactLines(bool int16Lines);
+  void setModulation(bool on);
+  void setDecay(float seconds); // RT60
+  void setDamping(float damping); // 0..1, more = darker tail
+
+  int lineCount() const;
+  bool compactLines() const;
+  bool modulation() const;
+
+  // Adds the wet signal for 'input' into 'out'. Returns false without touching
+  // 'out' when the reverb is idle and the input is silent.
+  bool process(const float* input, float* out, size_t numSamples);
+  // Same, with a stereo return: the lines are summed with two orthogonal
+  // sign patterns so left and right tails are decorrelated.
+  bool process(const float* input, float* outLeft, float* outRight, size_t numSamples);
+  // True once the tail has decayed below the bypass threshold.
+  bool isIdle() const;
+  size_t memoryBytes() const;
+
+  // Runtime state including the line contents. Loading fails when the
+  // snapshot was taken with a different line count or storage type.
+  void saveState(SnapshotWriter& out) const;
+  bool loadState(SnapshotReader& in);
+
+private:
+  void allocateLines();
+  void updateLineGains();
+  float readLine(int line, float delay) const;
+  void writeLine(int line, float value);
+  void clearLines();
+  bool wake(const float* input, size_t numSamples);
+  template <bool Stereo>
+  void run(const float* input, float* outLeft, float* outRight, size_t numSamples);
+
+  float sampleRate;
+  int lines;
+  bool int16Lines;
+  bool modulationOn;
+  float decaySeconds;
+  float damping;
+
+  std::vector<float> floatStorage;
+  std::vector<int16_t> shortStorage;
+  int lineLength[kMaxLines];
+  int lineOffset[kMaxLines];
+  int writePos[kMaxLines];
+  float lineGain[kMaxLines];
+  float dampState[kMaxLines];
+  int longestLine;
+
+  float lfoPhase;
+  float lfoInc;
+  float modDepth; // samples
+
+  bool idle;
+  float windowPeak;
+  int windowCount;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+// Single-producer / single-consumer ring for handing audio from the render
+// thread to a writer. Storage is allocated up front; push and the read side
+// never allocate or lock, so the producer can run inside an audio callback.
+// Indices grow without wrapping and are masked on access, which needs a
+// power-of-two capacity.
+template <typename T>
+class SampleRing {
+public:
+  // Not safe while either side is running.
+  void allocate(size_t minCapacity) {
+    size_t capacity = 1;
+    while (capacity < minCapacity) capacity <<= 1;
+    buffer_.assign(capacity, T());
+    mask_ = capacity - 1;
+    clear();
+  }
+
+  void clear() {
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+    highWater_.store(0, std::memory_order_relaxed);
+  }
+
+  size_t capacity() const { return buffer_.size(); }
+
+  size_t readAvailable() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+  }
+
+  size_t writeAvailable() const {
+    return buffer_.size() - (head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire));
+  }
+
+  // Deepest fill level seen by the producer since the last clear().
+  size_t highWater() const { return highWater_.load(std::memory_order_relaxed); }
+
+  // Producer side. Writes all of 'count' or nothing.
+  bool push(const T* src, size_t count) {
+    T* first = nullptr;
+    T* second = nullptr;
+    size_t firstCount = 0;
+    if (!reserve(count, &first, &firstCount, &second)) return false;
+    memcpy(first, src, firstCount * sizeof(T));
+    if (count > firstCount) memcpy(second, src + firstCount, (count - firstCount) * sizeof(T));
+    commit(count);
+    return true;
+  }
+
+  // Producer side, for filling in place: 'count' slots split over at most
+  // two regions. Nothing is visible to the reader until commit().
+  bool reserve(size_t count, T** first, size_t* firstCount, T** second) {
+    if (count > writeAvailable()) return false;
+    size_t start = head_.load(std::memory_order_relaxed) & mask_;
+    size_t untilEnd = buffer_.size() - start;
+    *first = buffer_.data() + start;
+    *firstCount = count < untilEnd ? count : untilEnd;
+    *second = buffer_.data();
+    return true;
+  }
+
+  void commit(size_t count) {
+    size_t head = head_.load(std::memory_order_relaxed) + count;
+    head_.store(head, std::memory_order_release);
+    size_t used = head - tail_.load(std::memory_order_acquire);
+    if (used > highWater_.load(std::memory_order_relaxed)) {
+      highWater_.store(used, std::memory_order_relaxed);
+    }
+  }
+
+  // Consumer side: copies up to 'maxCount' samples out, returns how many.
+  size_t pop(T* dst, size_t maxCount) {
+    size_t count = readAvailable();
+    if (count > maxCount) count = maxCount;
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t start = tail & mask_;
+    size_t untilEnd = buffer_.size() - start;
+    size_t firstCount = count < untilEnd ? count : untilEnd;
+    memcpy(dst, buffer_.data() + start, firstCount * sizeof(T));
+    if (count > firstCount) memcpy(dst + firstCount, buffer_.data(), (count - firstCount) * sizeof(T));
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+private:
+  std::vector<T> buffer_;
+  size_t mask_ = 0;
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+  std::atomic<size_t> highWater_{0};
+};
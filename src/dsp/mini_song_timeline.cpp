@@ -0,0 +1,75 @@
+#include "mini_song_timeline.h"
+
+namespace {
+int8_t resolvePattern(int pattern, int maxPatterns) {
+  if (pattern < 0) return -1;
+  if (pattern >= maxPatterns) pattern = maxPatterns - 1;
+  return static_cast<int8_t>(pattern);
+}
+} // namespace
+
+SongTimeline::SongTimeline()
+  : length_(1),
+    loopStart_(0),
+    loopEnd_(-1) {
+  for (int i = 0; i < Song::kMaxPositions; ++i) {
+    for (int t = 0; t < SongPosition::kTrackCount; ++t) bars_[i].patterns[t] = -1;
+  }
+}
+
+void SongTimeline::compile(const Song& song, int length) {
+  if (length < 1) length = 1;
+  if (length > Song::kMaxPositions) length = Song::kMaxPositions;
+  length_ = length;
+  for (int i = 0; i < length_; ++i) {
+    const SongPosition& pos = song.positions[i];
+    for (int t = 0; t < SongPosition::kTrackCount; ++t) {
+      bars_[i].patterns[t] = resolvePattern(pos.patterns[t], SceneManager::kSongPatternCount);
+    }
+  }
+  if (loopEnd_ >= length_) loopEnd_ = length_ - 1;
+  if (loopStart_ > loopEnd_) clearLoop();
+}
+
+int SongTimeline::length() const { return length_; }
+
+int SongTimeline::pattern(int position, SongTrack track) const {
+  int trackIdx = static_cast<int>(track);
+  if (trackIdx < 0 || trackIdx >= SongPosition::kTrackCount) return -1;
+  if (position < 0 || position >= length_) return -1;
+  return bars_[position].patterns[trackIdx];
+}
+
+void SongTimeline::setLoop(int start, int end) {
+  start = clampPosition(start);
+  end = clampPosition(end);
+  if (end < start) {
+    int tmp = start;
+    start = end;
+    end = tmp;
+  }
+  loopStart_ = start;
+  loopEnd_ = end;
+}
+
+void SongTimeline::clearLoop() {
+  loopStart_ = 0;
+  loopEnd_ = -1;
+}
+
+bool SongTimeline::hasLoop() const { return loopEnd_ >= 0; }
+
+int SongTimeline::loopStart() const { return loopStart_; }
+
+int SongTimeline::loopEnd() const { return loopEnd_; }
+
+int SongTimeline::clampPosition(int position) const {
+  if (position < 0) return 0;
+  if (position >= length_) return length_ - 1;
+  return position;
+}
+
+int SongTimeline::nextPosition(int position) const {
+  if (hasLoop() && position == loopEnd_) return loopStart_;
+  return (position + 1) % length_;
+}
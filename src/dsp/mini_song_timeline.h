@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "scenes.h"
+
+// Song arrangement flattened into one resolved entry per bar, so the
+// sequencer can jump to any position or loop a range without walking the
+// song. Rebuild with compile() whenever the song changes.
+class SongTimeline {
+public:
+  struct Bar {
+    int8_t patterns[SongPosition::kTrackCount]; // clamped song cell, -1 = track silent
+  };
+
+  SongTimeline();
+
+  void compile(const Song& song, int length);
+  int length() const;
+  int pattern(int position, SongTrack track) const;
+
+  // Inclusive bar range the playhead wraps inside once it reaches 'end'.
+  void setLoop(int start, int end);
+  void clearLoop();
+  bool hasLoop() const;
+  int loopStart() const;
+  int loopEnd() const;
+
+  int clampPosition(int position) const;
+  int nextPosition(int position) const;
+
+private:
+  Bar bars_[Song::kMaxPositions];
+  int length_;
+  int loopStart_;
+  int loopEnd_; // -1 when no loop is set
+};
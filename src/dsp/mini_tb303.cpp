@@ -1,4 +1,5 @@
 #include "mini_tb303.h"
+#include "mini_dsp_utils.h"
 
 #include <math.h>
 #include <stdlib.h>
@@ -33,7 +34,8 @@ float ChamberlinFilter::process(float input, float cutoffHz, float resonance) {
   _bp += f * hp;
   _lp += f * _bp;
 
-  _bp = tanhf(_bp * 1.3f);
+  _bp = flushDenormal(tanhf(_bp * 1.3f));
+  _lp = flushDenormal(_lp);
 
   // Keep states bounded to avoid numeric blowups
   const float kStateLimit = 50.0f;
@@ -49,13 +51,20 @@ TB303Voice::TB303Voice(float sampleRate)
   : sampleRate(sampleRate),
     invSampleRate(0.0f),
     nyquist(0.0f),
-    filter(sampleRate) {
+    filter(sampleRate),
+    cutoffRamp(RampShape::Exponential, 1),
+    resonanceRamp(RampShape::Linear, 1),
+    envAmountRamp(RampShape::Linear, 1) {
   setSampleRate(sampleRate);
   reset();
 }
 
 void TB303Voice::reset() {
   initParameters();
+  resetState();
+}
+
+void TB303Voice::resetState() {
   phase = 0.0f;
   for (int i = 0; i < kSuperSawOscCount; ++i) {
     float seed = (static_cast<float>(i) + 1.0f) * 0.137f;
@@ -68,7 +77,12 @@ void TB303Voice::reset() {
   gate = false;
   slide = false;
   amp = 0.3f;
+  decayMsApplied = -1.0f;
+  decayCoeff = 0.0f;
   filter.reset();
+  cutoffRamp.reset();
+  resonanceRamp.reset();
+  envAmountRamp.reset();
 }
 
 void TB303Voice::setSampleRate(float sampleRateHz) {
@@ -76,7 +90,12 @@ void TB303Voice::setSampleRate(float sampleRateHz) {
   sampleRate = sampleRateHz;
   invSampleRate = 1.0f / sampleRate;
   nyquist = sampleRate * 0.5f;
+  decayMsApplied = -1.0f;
   filter.setSampleRate(sampleRate);
+  int rampSamples = static_cast<int>(sampleRate * kParamRampSeconds);
+  cutoffRamp.setRampLength(rampSamples);
+  resonanceRamp.setRampLength(rampSamples);
+  envAmountRamp.setRampLength(rampSamples);
 }
 
 void TB303Voice::startNote(float freqHz, bool accent, bool slideFlag) {
@@ -135,56 +154,85 @@ float TB303Voice::oscSuperSaw() {
   return sum * kGain;
 }
 
-float TB303Voice::oscillatorSample() {
-  int oscIdx = oscillatorIndex();
-  if (oscIdx == 1) {
-    float saw = oscSaw();
-    return oscSquare(saw);
-  }
-  if (oscIdx == 2) {
-    return oscSuperSaw();
-  }
-  return oscSaw();
-}
-
-float TB303Voice::svfProcess(float input) {
-  // Slide toward target frequency
-  freq += (targetFreq - freq) * slideSpeed;
-  if (!isfinite(freq))
-    freq = targetFreq;
-
-  // Envelope decay
-  if (gate || env > 0.0001f) {
-    float decayMs = parameterValue(TB303ParamId::EnvDecay);
+template <int OscType>
+void TB303Voice::renderBlock(float* out, size_t count) {
+  // targets are latched once per block, the loop only steps the ramps
+  cutoffRamp.beginBlock(parameterValue(TB303ParamId::Cutoff));
+  envAmountRamp.beginBlock(parameterValue(TB303ParamId::EnvAmount));
+  resonanceRamp.beginBlock(parameterValue(TB303ParamId::Resonance));
+  // the decay coefficient only changes with the knob, not per block
+  float decayMs = parameterValue(TB303ParamId::EnvDecay);
+  if (decayMs != decayMsApplied) {
     float decaySamples = decayMs * sampleRate * 0.001f;
     if (decaySamples < 1.0f)
       decaySamples = 1.0f;
     // 0.01 represents roughly -40 dB, a practical "off" point for the envelope.
     constexpr float kDecayTargetLog = -4.60517019f; // ln(0.01f)
-    float decayCoeff = expf(kDecayTargetLog / decaySamples);
-    env *= decayCoeff;
+    decayCoeff = expf(kDecayTargetLog / decaySamples);
+    decayMsApplied = decayMs;
   }
+  const float maxCutoff = nyquist * 0.9f;
+
+  size_t i = 0;
+  for (; i < count; ++i) {
+    // the gate only opens in startNote(), so once silent the rest is too
+    if (isSilent()) break;
+
+    float osc;
+    if (OscType == 1) {
+      osc = oscSquare(oscSaw());
+    } else if (OscType == 2) {
+      osc = oscSuperSaw();
+    } else {
+      osc = oscSaw();
+    }
 
-  float cutoffHz = parameterValue(TB303ParamId::Cutoff) + parameterValue(TB303ParamId::EnvAmount) * env;
-  if (cutoffHz < 50.0f)
-    cutoffHz = 50.0f;
-  float maxCutoff = nyquist * 0.9f;
-  if (cutoffHz > maxCutoff)
-    cutoffHz = maxCutoff;
-
+    // Slide toward target frequency
+    freq += (targetFreq - freq) * slideSpeed;
+    if (!isfinite(freq))
+      freq = targetFreq;
+
+    // Envelope decay
+    if (gate || env > 0.0001f)
+      env *= decayCoeff;
+
+    float cutoffHz = cutoffRamp.next() + envAmountRamp.next() * env;
+    if (cutoffHz < 50.0f)
+      cutoffHz = 50.0f;
+    if (cutoffHz > maxCutoff)
+      cutoffHz = maxCutoff;
+    out[i] = filter.process(osc, cutoffHz, resonanceRamp.next()) * amp;
+  }
+  if (i < count) {
+    // nothing audible left to smooth, so land on the targets
+    cutoffRamp.jump(cutoffRamp.target());
+    envAmountRamp.jump(envAmountRamp.target());
+    resonanceRamp.jump(resonanceRamp.target());
+  }
+  for (; i < count; ++i) out[i] = 0.0f;
+}
 
-  return filter.process(input, cutoffHz, parameterValue(TB303ParamId::Resonance));
+bool TB303Voice::isSilent() const {
+  return !gate && env < 0.0001f;
 }
 
 float TB303Voice::process() {
-  if (!gate && env < 0.0001f) {
-    return 0.0f;
-  }
-
-  float osc = oscillatorSample();
-  float out = svfProcess(osc);
+  float out;
+  processBlock(&out, 1);
+  return out;
+}
 
-  return out * amp;
+void TB303Voice::processBlock(float* out, size_t count) {
+  using Kernel = void (TB303Voice::*)(float*, size_t);
+  static const Kernel kKernels[] = {
+    &TB303Voice::renderBlock<0>, // saw
+    &TB303Voice::renderBlock<1>, // square
+    &TB303Voice::renderBlock<2>, // super saw
+  };
+  if (!out || count == 0) return;
+  int oscIdx = oscillatorIndex();
+  if (oscIdx < 0 || oscIdx > 2) oscIdx = 0;
+  (this->*kKernels[oscIdx])(out, count);
 }
 
 const Parameter& TB303Voice::parameter(TB303ParamId id) const {
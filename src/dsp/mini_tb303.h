@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "mini_dsp_params.h"
@@ -31,22 +32,31 @@ public:
   explicit TB303Voice(float sampleRate);
 
   void reset();
+  // Silences the voice and clears the oscillators, envelope and filter; the
+  // parameters keep their values.
+  void resetState();
   void setSampleRate(float sampleRate);
   void startNote(float freqHz, bool accent, bool slideFlag);
   void release();
   float process();
+  // Renders 'count' samples into 'out'. The oscillator kernel is picked once
+  // per block; filter parameters glide to their new values over a short ramp.
+  void processBlock(float* out, size_t count);
   const Parameter& parameter(TB303ParamId id) const;
   void setParameter(TB303ParamId id, float value);
   void adjustParameter(TB303ParamId id, int steps);
   float parameterValue(TB303ParamId id) const;
   int oscillatorIndex() const;
+  // True once the note is released and the envelope has run out; process()
+  // only returns zeros until the next startNote().
+  bool isSilent() const;
 
 private:
   float oscSaw();
   float oscSquare(float saw);
   float oscSuperSaw();
-  float oscillatorSample();
-  float svfProcess(float input);
+  template <int OscType>
+  void renderBlock(float* out, size_t count);
   void initParameters();
 
   static constexpr int kSuperSawOscCount = 6;
@@ -60,6 +70,8 @@ private:
   bool gate;        // note on/off
   bool slide;       // slide flag for next note
   float amp;        // amplitude
+  float decayMsApplied; // EnvDecay value decayCoeff was computed for
+  float decayCoeff;     // per-sample envelope multiplier
 
   float sampleRate;
   float invSampleRate;
@@ -67,4 +79,7 @@ private:
 
   Parameter params[static_cast<int>(TB303ParamId::Count)];
   ChamberlinFilter filter;
+  ParamRamp cutoffRamp;
+  ParamRamp resonanceRamp;
+  ParamRamp envAmountRamp;
 };
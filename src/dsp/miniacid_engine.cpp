@@ -1,9 +1,18 @@
 #include "miniacid_engine.h"
+#include "mini_dsp_profile.h"
+#include "mini_dsp_tables.h"
+#include "mini_dsp_mix.h"
+#include "mini_dsp_utils.h"
 
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <algorithm>
+#if !defined(ARDUINO)
+#include <memory>
+#endif
 #include <string>
+#include <thread>
 
 namespace {
 constexpr int kDrumKickVoice = 0;
@@ -15,6 +24,49 @@ constexpr int kDrumHighTomVoice = 5;
 constexpr int kDrumRimVoice = 6;
 constexpr int kDrumClapVoice = 7;
 
+// offline stem render: engine copies per group, chunked hand-off to the sink
+constexpr int kStemGroup303A = 0;
+constexpr int kStemGroup303B = 1;
+constexpr int kStemGroupDrums = 2;
+constexpr int kStemGroupCount = 3;
+
+#if !defined(ARDUINO)
+constexpr size_t kStemChunkFrames = AUDIO_BUFFER_SAMPLES * 64;
+
+int stemGroup(int stem) {
+  switch (static_cast<MiniAcidStem>(stem)) {
+  case MiniAcidStem::Synth303A:
+  case MiniAcidStem::Delay303A:
+    return kStemGroup303A;
+  case MiniAcidStem::Synth303B:
+  case MiniAcidStem::Delay303B:
+    return kStemGroup303B;
+  default:
+    return kStemGroupDrums;
+  }
+}
+#endif
+
+// Off-grid triggers stay inside [-half a step, 0.9 step] so a late step can
+// never be overtaken by the next grid line.
+constexpr float kMinStepOffset = -0.5f;
+constexpr float kMaxStepOffset = 0.9f;
+
+// ~-100 dBFS: a delay line whose whole contents stay below this is dropped
+constexpr float kDelaySilenceThreshold = 1.0e-5f;
+
+constexpr uint32_t kSnapshotMagic = 0x4E53414D; // "MASN"
+constexpr uint16_t kSnapshotVersion = 5;
+
+float stepTimingOffset(int swing, int timing, int stepIndex) {
+  int percent = timing;
+  if (stepIndex & 1) percent += swing;
+  float offset = static_cast<float>(percent) / 100.0f;
+  if (offset < kMinStepOffset) offset = kMinStepOffset;
+  if (offset > kMaxStepOffset) offset = kMaxStepOffset;
+  return offset;
+}
+
 SynthPattern makeEmptySynthPattern() {
   SynthPattern pattern{};
   for (int i = 0; i < SynthPattern::kSteps; ++i) {
@@ -43,9 +95,17 @@ const DrumPatternSet kEmptyDrumPatternSet = makeEmptyDrumPatternSet();
 TempoDelay::TempoDelay(float sampleRate)
   : buffer(),
     writeIndex(0),
-    delaySamples(1),
+    delaySamples(1.0f),
+    targetDelaySamples(1.0f),
+    glideIncrement(0.0f),
+    glideSamplesLeft(0),
+    glideSeconds(0.05f),
     sampleRate(0.0f),
     maxDelaySamples(0),
+    idle(true),
+    windowPeak(0.0f),
+    windowCount(0),
+    bpm(0.0f),
     beats(0.25f),
     mix(0.35f),
     feedback(0.45f),
@@ -55,46 +115,71 @@ TempoDelay::TempoDelay(float sampleRate)
 }
 
 void TempoDelay::reset() {
+  // a cleared line has nothing to glide through, so jump straight to the target
+  delaySamples = targetDelaySamples;
+  glideIncrement = 0.0f;
+  glideSamplesLeft = 0;
+  idle = true;
+  windowPeak = 0.0f;
+  windowCount = 0;
   if (buffer.empty())
     return;
   std::fill(buffer.begin(), buffer.end(), 0.0f);
   writeIndex = 0;
-  if (delaySamples < 1)
-    delaySamples = 1;
-  if (delaySamples >= maxDelaySamples)
-    delaySamples = maxDelaySamples - 1;
 }
 
 void TempoDelay::setSampleRate(float sr) {
   if (sr <= 0.0f) sr = 44100.0f;
   sampleRate = sr;
   maxDelaySamples = static_cast<int>(sampleRate * kMaxDelaySeconds);
-  if (maxDelaySamples < 1)
-    maxDelaySamples = 1;
+  if (maxDelaySamples < 2)
+    maxDelaySamples = 2;
   buffer.assign(static_cast<size_t>(maxDelaySamples), 0.0f);
-  if (delaySamples >= maxDelaySamples)
-    delaySamples = maxDelaySamples - 1;
-  if (delaySamples < 1)
-    delaySamples = 1;
+  writeIndex = 0;
+  if (bpm > 0.0f)
+    updateTargetDelay();
+  delaySamples = targetDelaySamples;
+  glideSamplesLeft = 0;
 }
 
-void TempoDelay::setBpm(float bpm) {
-  if (bpm < 40.0f)
-    bpm = 40.0f;
-  float secondsPerBeat = 60.0f / bpm;
-  float delaySeconds = secondsPerBeat * beats;
-  int samples = static_cast<int>(delaySeconds * sampleRate);
-  if (samples < 1)
-    samples = 1;
-  if (samples >= maxDelaySamples)
-    samples = maxDelaySamples - 1;
-  delaySamples = samples;
+void TempoDelay::setBpm(float newBpm) {
+  if (newBpm < 40.0f)
+    newBpm = 40.0f;
+  if (newBpm == bpm)
+    return;
+  bpm = newBpm;
+  updateTargetDelay();
 }
 
 void TempoDelay::setBeats(float b) {
   if (b < 0.125f)
     b = 0.125f;
+  if (b == beats)
+    return;
   beats = b;
+  if (bpm > 0.0f)
+    updateTargetDelay();
+}
+
+void TempoDelay::updateTargetDelay() {
+  float secondsPerBeat = 60.0f / bpm;
+  float target = secondsPerBeat * beats * sampleRate;
+  // keep one sample of headroom for the interpolation neighbour
+  float maxTarget = static_cast<float>(maxDelaySamples - 2);
+  if (target > maxTarget)
+    target = maxTarget;
+  if (target < 1.0f)
+    target = 1.0f;
+  targetDelaySamples = target;
+
+  int glideSamples = static_cast<int>(glideSeconds * sampleRate);
+  if (glideSamples < 1) {
+    delaySamples = targetDelaySamples;
+    glideSamplesLeft = 0;
+    return;
+  }
+  glideIncrement = (targetDelaySamples - delaySamples) / static_cast<float>(glideSamples);
+  glideSamplesLeft = glideSamples;
 }
 
 void TempoDelay::setMix(float m) {
@@ -113,29 +198,116 @@ void TempoDelay::setFeedback(float fb) {
   feedback = fb;
 }
 
+void TempoDelay::setGlideTime(float seconds) {
+  if (seconds < 0.0f)
+    seconds = 0.0f;
+  glideSeconds = seconds;
+}
+
 void TempoDelay::setEnabled(bool on) { enabled = on; }
 
 bool TempoDelay::isEnabled() const { return enabled; }
 
+bool TempoDelay::isIdle() const { return idle || !enabled; }
+
+void TempoDelay::processBlock(float* io, size_t count) {
+  if (!enabled || buffer.empty()) return;
+  for (size_t i = 0; i < count; ++i) io[i] = process(io[i]);
+}
+
 float TempoDelay::process(float input) {
   if (!enabled || buffer.empty()) {
     return input;
   }
 
-  int readIndex = writeIndex - delaySamples;
-  if (readIndex < 0)
-    readIndex += maxDelaySamples;
+  if (idle) {
+    // nothing left in the line: silence in, silence out
+    if (fabsf(input) < kDelaySilenceThreshold)
+      return input;
+    idle = false;
+    windowPeak = 0.0f;
+    windowCount = 0;
+  }
+
+  if (glideSamplesLeft > 0) {
+    delaySamples += glideIncrement;
+    if (--glideSamplesLeft == 0)
+      delaySamples = targetDelaySamples;
+  }
 
-  float delayed = buffer[readIndex];
-  buffer[writeIndex] = input + delayed * feedback;
+  // read head sits between two samples
+  DelayTap tap = delayTap(writeIndex, delaySamples, maxDelaySamples);
+  float newer = buffer[tap.newer];
+  float older = buffer[tap.older];
+  float delayed = newer + (older - newer) * tap.frac;
+  float written = flushDenormal(input + delayed * feedback);
+  buffer[writeIndex] = written;
 
   writeIndex++;
   if (writeIndex >= maxDelaySamples)
     writeIndex = 0;
 
+  // after a full pass of the line below the threshold the tail is gone
+  float level = fabsf(written);
+  if (level > windowPeak)
+    windowPeak = level;
+  if (++windowCount >= maxDelaySamples) {
+    if (windowPeak < kDelaySilenceThreshold) {
+      std::fill(buffer.begin(), buffer.end(), 0.0f);
+      idle = true;
+      delaySamples = targetDelaySamples;
+      glideSamplesLeft = 0;
+    }
+    windowPeak = 0.0f;
+    windowCount = 0;
+  }
+
   return input + delayed * mix;
 }
 
+void TempoDelay::saveState(SnapshotWriter& out) const {
+  out.value(maxDelaySamples);
+  out.bytes(buffer.data(), buffer.size() * sizeof(float));
+  out.value(writeIndex);
+  out.value(delaySamples);
+  out.value(targetDelaySamples);
+  out.value(glideIncrement);
+  out.value(glideSamplesLeft);
+  out.value(glideSeconds);
+  out.value(bpm);
+  out.value(beats);
+  out.value(mix);
+  out.value(feedback);
+  out.value(enabled);
+  out.value(idle);
+  out.value(windowPeak);
+  out.value(windowCount);
+}
+
+bool TempoDelay::loadState(SnapshotReader& in) {
+  int savedMax = in.read<int>();
+  if (!in.ok() || savedMax != maxDelaySamples) {
+    in.fail();
+    return false;
+  }
+  in.bytes(buffer.data(), buffer.size() * sizeof(float));
+  in.value(writeIndex);
+  in.value(delaySamples);
+  in.value(targetDelaySamples);
+  in.value(glideIncrement);
+  in.value(glideSamplesLeft);
+  in.value(glideSeconds);
+  in.value(bpm);
+  in.value(beats);
+  in.value(mix);
+  in.value(feedback);
+  in.value(enabled);
+  in.value(idle);
+  in.value(windowPeak);
+  in.value(windowCount);
+  return in.ok();
+}
+
 MiniAcid::MiniAcid(float sampleRate, SceneStorage* sceneStorage)
   : voice303(sampleRate),
     voice3032(sampleRate),
@@ -156,16 +328,24 @@ MiniAcid::MiniAcid(float sampleRate, SceneStorage* sceneStorage)
     delay303Enabled(false),
     delay3032Enabled(false),
     bpmValue(100.0f),
+    appliedBpm_(0.0f),
     currentStepIndex(-1),
-    samplesIntoStep(0),
+    samplesIntoStep(0.0f),
     samplesPerStep(0.0f),
     songMode_(false),
     songPlayheadPosition_(0),
     patternModeDrumPatternIndex_(0),
     patternModeSynthPatternIndex_{0, 0},
+    pendingTriggerCount_(0),
     delay303(sampleRate),
-    delay3032(sampleRate) {
+    delay3032(sampleRate),
+    reverb_(sampleRate),
+    reverbDecayApplied_(0.0f) {
   if (sampleRateValue <= 0.0f) sampleRateValue = 44100.0f;
+  int rampSamples = static_cast<int>(sampleRateValue * kParamRampSeconds);
+  reverbSendRamp_.setRampLength(rampSamples);
+  outputStage_.setSampleRate(sampleRateValue);
+  sceneManager_.setJournal(&editJournal_);
   reset();
 }
 
@@ -173,9 +353,13 @@ MiniAcid::MiniAcid(float sampleRate, SceneStorage* sceneStorage)
 void MiniAcid::init() {
 
   params[static_cast<int>(MiniAcidParamId::MainVolume)] = Parameter("vol", "", 0.0f, 1.0f, 0.8f, 1.0f / 128);
+  params[static_cast<int>(MiniAcidParamId::ReverbSend)] = Parameter("rvb", "", 0.0f, 1.0f, 0.0f, 1.0f / 128);
+  params[static_cast<int>(MiniAcidParamId::ReverbDecay)] = Parameter("rdec", "s", 0.2f, 6.0f, 1.6f, (6.0f - 0.2f) / 128);
 
   // maybe move everything from the constructor here later
   sceneStorage_->initializeStorage();
+  sceneSwitch_.names[sceneSwitch_.live.load()] = sceneStorage_->getCurrentSceneName();
+  persistedSceneName_ = liveSceneName();
   loadSceneFromStorage();
   reset();
   applySceneStateFromManager();
@@ -204,20 +388,24 @@ void MiniAcid::reset() {
   delay3032Enabled = false;
   bpmValue = 100.0f;
   currentStepIndex = -1;
-  samplesIntoStep = 0;
-  updateSamplesPerStep();
-  delay303.reset();
+  samplesIntoStep = 0.0f;
   delay303.setBeats(0.5f); // eighth note
   delay303.setMix(0.25f);
   delay303.setFeedback(0.35f);
   delay303.setEnabled(delay303Enabled);
-  delay303.setBpm(bpmValue);
-  delay3032.reset();
   delay3032.setBeats(0.5f);
   delay3032.setMix(0.22f);
   delay3032.setFeedback(0.32f);
   delay3032.setEnabled(delay3032Enabled);
-  delay3032.setBpm(bpmValue);
+  updateSamplesPerStep();
+  delay303.reset();
+  delay3032.reset();
+  reverb_.reset();
+  reverbSendRamp_.reset();
+  outputStage_.reset();
+  stats_.reverbRamBytes = reverb_.memoryBytes();
+  stats_.reverbLines = reverb_.lineCount();
+  stats_.reverbActive = false;
   lastBufferCount = 0;
   for (int i = 0; i < AUDIO_BUFFER_SAMPLES; ++i) lastBuffer[i] = 0;
   songMode_ = false;
@@ -225,12 +413,16 @@ void MiniAcid::reset() {
   patternModeDrumPatternIndex_ = 0;
   patternModeSynthPatternIndex_[0] = 0;
   patternModeSynthPatternIndex_[1] = 0;
+  clearPendingTriggers();
+  for (int t = 0; t < kMixTracks; ++t) setTrackPan(t, 0.0f);
 }
 
 void MiniAcid::start() {
+  if (bpmValue != appliedBpm_) updateSamplesPerStep();
+  clearPendingTriggers();
   playing = true;
   currentStepIndex = -1;
-  samplesIntoStep = static_cast<unsigned long>(samplesPerStep);
+  samplesIntoStep = samplesPerStep;
   if (songMode_) {
     songPlayheadPosition_ = clampSongPosition(sceneManager_.getSongPosition());
     sceneManager_.setSongPosition(songPlayheadPosition_);
@@ -239,17 +431,22 @@ void MiniAcid::start() {
 }
 
 void MiniAcid::stop() {
+  stopPlayback();
+  commitPendingScene();
+  saveSceneToStorage();
+}
+
+void MiniAcid::stopPlayback() {
   playing = false;
   currentStepIndex = -1;
-  samplesIntoStep = 0;
+  samplesIntoStep = 0.0f;
+  clearPendingTriggers();
   voice303.release();
   voice3032.release();
   drums.reset();
   if (songMode_) {
     sceneManager_.setSongPosition(clampSongPosition(songPlayheadPosition_));
   }
-
-  saveSceneToStorage();
 }
 
 void MiniAcid::setBpm(float bpm) {
@@ -258,9 +455,7 @@ void MiniAcid::setBpm(float bpm) {
     bpmValue = 40.0f;
   if (bpmValue > 200.0f)
     bpmValue = 200.0f;
-  updateSamplesPerStep();
-  delay303.setBpm(bpmValue);
-  delay3032.setBpm(bpmValue);
+  // picked up by the audio thread at the start of the next buffer
 }
 
 float MiniAcid::bpm() const { return bpmValue; }
@@ -384,6 +579,7 @@ void MiniAcid::setSongPosition(int position) {
 
 void MiniAcid::setSongPattern(int position, SongTrack track, int patternIndex) {
   sceneManager_.setSongPattern(position, track, patternIndex);
+  rebuildSongTimeline();
   if (songMode_ && position == currentSongPosition()) {
     applySongPositionSelection();
   }
@@ -391,6 +587,7 @@ void MiniAcid::setSongPattern(int position, SongTrack track, int patternIndex) {
 
 void MiniAcid::clearSongPattern(int position, SongTrack track) {
   sceneManager_.clearSongPattern(position, track);
+  rebuildSongTimeline();
   int pos = clampSongPosition(sceneManager_.getSongPosition());
   sceneManager_.setSongPosition(pos);
   if (songMode_ && position == pos) {
@@ -404,19 +601,236 @@ int MiniAcid::songPatternAt(int position, SongTrack track) const {
 
 const Song& MiniAcid::song() const { return sceneManager_.song(); }
 
+void MiniAcid::seekSong(int position) {
+  int pos = clampSongPosition(position);
+  sceneManager_.setSongPosition(pos);
+  songPlayheadPosition_ = pos;
+  if (songMode_) applySongPositionSelection();
+  if (playing) {
+    clearPendingTriggers();
+    currentStepIndex = -1;
+    samplesIntoStep = samplesPerStep;
+  }
+}
+
+void MiniAcid::setSongLoop(int startPosition, int endPosition) {
+  songTimeline_.setLoop(startPosition, endPosition);
+}
+
+void MiniAcid::clearSongLoop() { songTimeline_.clearLoop(); }
+
+bool MiniAcid::songLoopEnabled() const { return songTimeline_.hasLoop(); }
+
+int MiniAcid::songLoopStart() const { return songTimeline_.loopStart(); }
+
+int MiniAcid::songLoopEnd() const { return songTimeline_.loopEnd(); }
+
+bool MiniAcid::beginOfflineRender(int startPosition, int endPosition, OfflineRender& render) {
+  int startPos = clampSongPosition(startPosition);
+  int endPos = clampSongPosition(endPosition);
+  if (endPos < startPos) return false;
+
+  render.wasSongMode = songMode_;
+  render.previousPosition = sceneManager_.getSongPosition();
+  render.loopStart = songTimeline_.loopStart();
+  render.loopEnd = songTimeline_.loopEnd();
+  render.liveMixSink = std::move(mixSink_);
+  mixSink_ = nullptr;
+  songTimeline_.clearLoop();
+
+  stopPlayback();
+  // nothing from live play carries into the bounce: same range, same audio
+  resetDspState();
+  renderingOffline_ = true;
+  setSongMode(true);
+  sceneManager_.setSongPosition(startPos);
+  start();
+
+  int bars = endPos - startPos + 1;
+  render.total = static_cast<size_t>(lroundf(static_cast<float>(bars * SEQ_STEPS) * samplesPerStep));
+  return true;
+}
+
+void MiniAcid::resetDspState() {
+  voice303.resetState();
+  voice3032.resetState();
+  drums.resetState();
+  delay303.reset();
+  delay3032.reset();
+  reverb_.reset();
+  reverbSendRamp_.reset();
+  outputStage_.reset();
+}
+
+void MiniAcid::endOfflineRender(const OfflineRender& render) {
+  stopPlayback();
+  renderingOffline_ = false;
+  if (render.loopEnd >= 0) songTimeline_.setLoop(render.loopStart, render.loopEnd);
+  setSongMode(render.wasSongMode);
+  sceneManager_.setSongPosition(clampSongPosition(render.previousPosition));
+  if (!render.wasSongMode) songPlayheadPosition_ = sceneManager_.getSongPosition();
+  mixSink_ = render.liveMixSink;
+}
+
+size_t MiniAcid::renderSongRange(int startPosition, int endPosition, const RenderSink& sink) {
+  if (!sink) return 0;
+  OfflineRender render;
+  if (!beginOfflineRender(startPosition, endPosition, render)) return 0;
+
+  int16_t block[AUDIO_BUFFER_SAMPLES * AUDIO_CHANNELS];
+  size_t rendered = 0;
+  while (rendered < render.total) {
+    size_t count = render.total - rendered;
+    if (count > AUDIO_BUFFER_SAMPLES) count = AUDIO_BUFFER_SAMPLES;
+    generateAudioBuffer(block, count);
+    sink(block, count);
+    rendered += count;
+  }
+
+  endOfflineRender(render);
+  return rendered;
+}
+
+const char* MiniAcid::stemName(MiniAcidStem stem) {
+  static const char* const kNames[kStemCount] = {
+    "303a", "303b", "303a_delay", "303b_delay", "kick", "snare",
+    "hat", "openhat", "midtom", "hightom", "rim", "clap",
+  };
+  int idx = static_cast<int>(stem);
+  if (idx < 0 || idx >= kStemCount) return "";
+  return kNames[idx];
+}
+
+void MiniAcid::setStemSink(StemSink sink) {
+  stemSink_ = std::move(sink);
+  if (stemSink_) {
+    stemStorage_.assign(static_cast<size_t>(kStemCount) * AUDIO_BUFFER_SAMPLES, 0.0f);
+  } else {
+    std::vector<float>().swap(stemStorage_);
+  }
+}
+
+void MiniAcid::setMixSink(MixSink sink) {
+  mixSink_ = std::move(sink);
+}
+
+float* MiniAcid::stemBuffer(MiniAcidStem stem) {
+  return stemStorage_.data() + static_cast<size_t>(stem) * AUDIO_BUFFER_SAMPLES;
+}
+
+void MiniAcid::isolateStemGroup(int group) {
+  // everything outside the group is muted; the group keeps the user's mutes
+  if (group != kStemGroup303A) mute303 = true;
+  if (group != kStemGroup303B) mute303_2 = true;
+  if (group != kStemGroupDrums) {
+    muteKick = muteSnare = muteHat = muteOpenHat = true;
+    muteMidTom = muteHighTom = muteRim = muteClap = true;
+  }
+  // the stems are taken before the reverb, so keep it bypassed
+  params[static_cast<int>(MiniAcidParamId::ReverbSend)].setValue(0.0f);
+  reverb_.reset();
+}
+
+size_t MiniAcid::renderSongStems(int startPosition, int endPosition, const StemSink& sink) {
+  if (!sink) return 0;
+  OfflineRender render;
+  if (!beginOfflineRender(startPosition, endPosition, render)) return 0;
+  StemSink liveSink = stemSink_;
+  size_t rendered = 0;
+
+#if defined(ARDUINO)
+  // no room for worker engines on the device
+  const bool parallel = false;
+#else
+  // worker copies have no bank pager, so songs reaching past the banks the
+  // scene holds render in one pass
+  const bool parallel = std::thread::hardware_concurrency() > 1 && !songUsesOtherBanks();
+  if (parallel) rendered = renderStemsParallel(render.total, sink);
+#endif
+  if (!parallel) {
+    // one pass capturing every stem
+    setStemSink(sink);
+    int16_t block[AUDIO_BUFFER_SAMPLES * AUDIO_CHANNELS];
+    while (rendered < render.total) {
+      size_t count = render.total - rendered;
+      if (count > AUDIO_BUFFER_SAMPLES) count = AUDIO_BUFFER_SAMPLES;
+      generateAudioBuffer(block, count);
+      rendered += count;
+    }
+  }
+
+  setStemSink(liveSink);
+  endOfflineRender(render);
+  return rendered;
+}
+
+#if !defined(ARDUINO)
+size_t MiniAcid::renderStemsParallel(size_t total, const StemSink& sink) {
+  // Voices only meet at the bus, so each group renders on its own copy of
+  // the engine. Drum lanes share a noise generator and stay together.
+  std::vector<float> chunk(static_cast<size_t>(kStemCount) * kStemChunkFrames, 0.0f);
+  std::unique_ptr<MiniAcid> workers[kStemGroupCount];
+  size_t written[kStemGroupCount] = {};
+  for (int g = 0; g < kStemGroupCount; ++g) {
+    workers[g].reset(new MiniAcid(*this));
+    workers[g]->isolateStemGroup(g);
+    size_t* offset = &written[g];
+    workers[g]->setStemSink([&chunk, offset, g](const float* const* stems, size_t frames) {
+      for (int s = 0; s < kStemCount; ++s) {
+        if (stemGroup(s) != g) continue;
+        float* dst = chunk.data() + static_cast<size_t>(s) * kStemChunkFrames + *offset;
+        std::copy(stems[s], stems[s] + frames, dst);
+      }
+      *offset += frames;
+    });
+  }
+
+  const float* stems[kStemCount];
+  for (int s = 0; s < kStemCount; ++s) stems[s] = chunk.data() + static_cast<size_t>(s) * kStemChunkFrames;
+  size_t rendered = 0;
+  while (rendered < total) {
+    size_t frames = total - rendered;
+    if (frames > kStemChunkFrames) frames = kStemChunkFrames;
+    std::thread threads[kStemGroupCount];
+    for (int g = 0; g < kStemGroupCount; ++g) {
+      written[g] = 0;
+      MiniAcid* worker = workers[g].get();
+      threads[g] = std::thread([worker, frames]() {
+        int16_t block[AUDIO_BUFFER_SAMPLES * AUDIO_CHANNELS];
+        size_t done = 0;
+        while (done < frames) {
+          size_t count = frames - done;
+          if (count > AUDIO_BUFFER_SAMPLES) count = AUDIO_BUFFER_SAMPLES;
+          worker->generateAudioBuffer(block, count);
+          done += count;
+        }
+      });
+    }
+    for (int g = 0; g < kStemGroupCount; ++g) threads[g].join();
+    sink(stems, frames);
+    rendered += frames;
+  }
+  return rendered;
+}
+#endif
+
+void MiniAcid::rebuildSongTimeline() {
+  songTimeline_.compile(sceneManager_.song(), sceneManager_.songLength());
+}
+
 int MiniAcid::display303PatternIndex(int voiceIndex) const {
   int idx = clamp303Voice(voiceIndex);
   if (songMode_) {
-    int pat = sceneManager_.songPattern(sceneManager_.getSongPosition(),
-                                        idx == 0 ? SongTrack::SynthA : SongTrack::SynthB);
-    return pat;
+    SongTrack track = idx == 0 ? SongTrack::SynthA : SongTrack::SynthB;
+    return patternInEditBank(track, sceneManager_.songPattern(sceneManager_.getSongPosition(), track));
   }
   return sceneManager_.getCurrentSynthPatternIndex(idx);
 }
 
 int MiniAcid::displayDrumPatternIndex() const {
   if (songMode_) {
-    return sceneManager_.songPattern(sceneManager_.getSongPosition(), SongTrack::Drums);
+    return patternInEditBank(SongTrack::Drums,
+                             sceneManager_.songPattern(sceneManager_.getSongPosition(), SongTrack::Drums));
   }
   return sceneManager_.getCurrentDrumPatternIndex();
 }
@@ -468,17 +882,38 @@ void MiniAcid::shiftDrumPatternIndex(int delta) {
 }
 void MiniAcid::adjust303Parameter(TB303ParamId id, int steps, int voiceIndex) {
   int idx = clamp303Voice(voiceIndex);
-  if (idx == 0)
-    voice303.adjustParameter(id, steps);
-  else
-    voice3032.adjustParameter(id, steps);
+  TB303Voice& voice = idx == 0 ? voice303 : voice3032;
+  voice.adjustParameter(id, steps);
+  record303Parameter(id, idx);
 }
 void MiniAcid::set303Parameter(TB303ParamId id, float value, int voiceIndex) {
   int idx = clamp303Voice(voiceIndex);
-  if (idx == 0)
-    voice303.setParameter(id, value);
-  else
-    voice3032.setParameter(id, value);
+  TB303Voice& voice = idx == 0 ? voice303 : voice3032;
+  voice.setParameter(id, value);
+  record303Parameter(id, idx);
+}
+void MiniAcid::record303Parameter(TB303ParamId id, int voiceIndex) {
+  const TB303Voice& voice = voiceIndex == 0 ? voice303 : voice3032;
+  switch (id) {
+  case TB303ParamId::Cutoff:
+    sceneManager_.setSynthParameter(voiceIndex, SynthParamId::Cutoff, voice.parameterValue(id));
+    break;
+  case TB303ParamId::Resonance:
+    sceneManager_.setSynthParameter(voiceIndex, SynthParamId::Resonance, voice.parameterValue(id));
+    break;
+  case TB303ParamId::EnvAmount:
+    sceneManager_.setSynthParameter(voiceIndex, SynthParamId::EnvAmount, voice.parameterValue(id));
+    break;
+  case TB303ParamId::EnvDecay:
+    sceneManager_.setSynthParameter(voiceIndex, SynthParamId::EnvDecay, voice.parameterValue(id));
+    break;
+  case TB303ParamId::Oscillator:
+    sceneManager_.setSynthParameter(voiceIndex, SynthParamId::OscType,
+                                    static_cast<float>(voice.oscillatorIndex()));
+    break;
+  default:
+    break; // not saved with the scene
+  }
 }
 void MiniAcid::set303PatternIndex(int voiceIndex, int patternIndex) {
   int idx = clamp303Voice(voiceIndex);
@@ -494,53 +929,87 @@ void MiniAcid::shift303PatternIndex(int voiceIndex, int delta) {
 }
 void MiniAcid::adjust303StepNote(int voiceIndex, int stepIndex, int semitoneDelta) {
   int idx = clamp303Voice(voiceIndex);
+  if (!editsPlayingBank(idx == 0 ? SongTrack::SynthA : SongTrack::SynthB)) return;
   int step = clamp303Step(stepIndex);
-  SynthPattern& pattern = editSynthPattern(idx);
-  int note = pattern.steps[step].note;
+  SynthStep value = synthPattern(idx).steps[step];
+  int note = value.note;
   if (note < 0) {
     if (semitoneDelta <= 0) return; // keep rests when moving downward
     note = kMin303Note;
   }
   note += semitoneDelta;
-  if (note < kMin303Note) {
-    pattern.steps[step].note = -1;
-    return;
-  }
-  note = clamp303Note(note);
-  pattern.steps[step].note = static_cast<int8_t>(note);
+  note = note < kMin303Note ? -1 : clamp303Note(note);
+  sceneManager_.setSynthStep(idx, step, note, value.slide, value.accent);
 }
 void MiniAcid::adjust303StepOctave(int voiceIndex, int stepIndex, int octaveDelta) {
   adjust303StepNote(voiceIndex, stepIndex, octaveDelta * 12);
 }
 void MiniAcid::clear303StepNote(int voiceIndex, int stepIndex) {
   int idx = clamp303Voice(voiceIndex);
+  if (!editsPlayingBank(idx == 0 ? SongTrack::SynthA : SongTrack::SynthB)) return;
   int step = clamp303Step(stepIndex);
-  SynthPattern& pattern = editSynthPattern(idx);
-  pattern.steps[step].note = -1;
+  const SynthStep& value = synthPattern(idx).steps[step];
+  sceneManager_.setSynthStep(idx, step, -1, value.slide, value.accent);
 }
 void MiniAcid::toggle303AccentStep(int voiceIndex, int stepIndex) {
   int idx = clamp303Voice(voiceIndex);
+  if (!editsPlayingBank(idx == 0 ? SongTrack::SynthA : SongTrack::SynthB)) return;
   int step = clamp303Step(stepIndex);
-  SynthPattern& pattern = editSynthPattern(idx);
-  pattern.steps[step].accent = !pattern.steps[step].accent;
+  const SynthStep& value = synthPattern(idx).steps[step];
+  sceneManager_.setSynthStep(idx, step, value.note, value.slide, !value.accent);
 }
 void MiniAcid::toggle303SlideStep(int voiceIndex, int stepIndex) {
   int idx = clamp303Voice(voiceIndex);
+  if (!editsPlayingBank(idx == 0 ? SongTrack::SynthA : SongTrack::SynthB)) return;
   int step = clamp303Step(stepIndex);
-  SynthPattern& pattern = editSynthPattern(idx);
-  pattern.steps[step].slide = !pattern.steps[step].slide;
+  const SynthStep& value = synthPattern(idx).steps[step];
+  sceneManager_.setSynthStep(idx, step, value.note, !value.slide, value.accent);
 }
 
 void MiniAcid::toggleDrumStep(int voiceIndex, int stepIndex) {
+  if (!editsPlayingBank(SongTrack::Drums)) return;
   int voice = clampDrumVoice(voiceIndex);
   int step = stepIndex;
   if (step < 0) step = 0;
   if (step >= DrumPattern::kSteps) step = DrumPattern::kSteps - 1;
-  DrumPattern& pattern = editDrumPattern(voice);
-  pattern.steps[step].hit = !pattern.steps[step].hit;
-  pattern.steps[step].accent = pattern.steps[step].hit;
+  bool hit = !drumPattern(voice).steps[step].hit;
+  sceneManager_.setDrumStep(voice, step, hit, hit);
+}
+
+void MiniAcid::set303StepTiming(int voiceIndex, int stepIndex, int timing) {
+  int idx = clamp303Voice(voiceIndex);
+  if (!editsPlayingBank(idx == 0 ? SongTrack::SynthA : SongTrack::SynthB)) return;
+  sceneManager_.setSynthStepTiming(idx, clamp303Step(stepIndex), timing);
+}
+
+void MiniAcid::setDrumStepTiming(int voiceIndex, int stepIndex, int timing) {
+  if (!editsPlayingBank(SongTrack::Drums)) return;
+  sceneManager_.setDrumStepTiming(clampDrumVoice(voiceIndex), clamp303Step(stepIndex), timing);
+}
+
+void MiniAcid::set303Swing(int voiceIndex, int swing) {
+  int idx = clamp303Voice(voiceIndex);
+  if (!editsPlayingBank(idx == 0 ? SongTrack::SynthA : SongTrack::SynthB)) return;
+  sceneManager_.setSynthSwing(idx, swing);
+}
+
+void MiniAcid::setDrumSwing(int voiceIndex, int swing) {
+  if (!editsPlayingBank(SongTrack::Drums)) return;
+  sceneManager_.setDrumSwing(clampDrumVoice(voiceIndex), swing);
+}
+
+int MiniAcid::step303Timing(int voiceIndex, int stepIndex) const {
+  return synthPattern(voiceIndex).steps[clamp303Step(stepIndex)].timing;
+}
+
+int MiniAcid::stepDrumTiming(int voiceIndex, int stepIndex) const {
+  return drumPattern(voiceIndex).steps[clamp303Step(stepIndex)].timing;
 }
 
+int MiniAcid::swing303(int voiceIndex) const { return synthPattern(voiceIndex).swing; }
+
+int MiniAcid::drumSwing(int voiceIndex) const { return drumPattern(voiceIndex).swing; }
+
 int MiniAcid::clamp303Voice(int voiceIndex) const {
   if (voiceIndex < 0) return 0;
   if (voiceIndex >= NUM_303_VOICES) return NUM_303_VOICES - 1;
@@ -564,62 +1033,79 @@ int MiniAcid::clamp303Note(int note) const {
 
 const SynthPattern& MiniAcid::synthPattern(int synthIndex) const {
   int idx = clamp303Voice(synthIndex);
+  // a bar on another bank shows what it plays
+  if (!editsPlayingBank(idx == 0 ? SongTrack::SynthA : SongTrack::SynthB)) return activeSynthPattern(idx);
   return sceneManager_.getCurrentSynthPattern(idx);
 }
 
-SynthPattern& MiniAcid::editSynthPattern(int synthIndex) {
-  int idx = clamp303Voice(synthIndex);
-  return sceneManager_.editCurrentSynthPattern(idx);
-}
-
 const DrumPattern& MiniAcid::drumPattern(int drumVoiceIndex) const {
   int idx = clampDrumVoice(drumVoiceIndex);
+  if (!editsPlayingBank(SongTrack::Drums)) return activeDrumPattern(idx);
   const DrumPatternSet& patternSet = sceneManager_.getCurrentDrumPattern();
   return patternSet.voices[idx];
 }
 
-DrumPattern& MiniAcid::editDrumPattern(int drumVoiceIndex) {
-  int idx = clampDrumVoice(drumVoiceIndex);
-  DrumPatternSet& patternSet = sceneManager_.editCurrentDrumPattern();
-  return patternSet.voices[idx];
-}
 
+// The song cell a track plays: bank and pattern, -1 when it is silent.
 int MiniAcid::songPatternIndexForTrack(SongTrack track) const {
   if (!songMode_) {
     switch (track) {
     case SongTrack::SynthA:
-      return sceneManager_.getCurrentSynthPatternIndex(0);
+      return SceneManager::songCell(bankIndex(track), sceneManager_.getCurrentSynthPatternIndex(0));
     case SongTrack::SynthB:
-      return sceneManager_.getCurrentSynthPatternIndex(1);
+      return SceneManager::songCell(bankIndex(track), sceneManager_.getCurrentSynthPatternIndex(1));
     case SongTrack::Drums:
-      return sceneManager_.getCurrentDrumPatternIndex();
+      return SceneManager::songCell(bankIndex(track), sceneManager_.getCurrentDrumPatternIndex());
     default:
       return -1;
     }
   }
   int pos = clampSongPosition(sceneManager_.getSongPosition());
-  int pat = sceneManager_.songPattern(pos, track);
-  if (pat < 0) return -1;
-  int maxPatterns = track == SongTrack::Drums ? Bank<DrumPatternSet>::kPatterns
-                                              : Bank<SynthPattern>::kPatterns;
-  if (pat >= maxPatterns) pat = maxPatterns - 1;
-  return pat;
+  return songTimeline_.pattern(pos, track);
+}
+
+// In song mode a bar may play a bank other than the one the pattern pages
+// edit; they show it then, but cannot change it.
+bool MiniAcid::editsPlayingBank(SongTrack track) const {
+  if (!songMode_) return true;
+  int cell = songPatternIndexForTrack(track);
+  return cell < 0 || SceneManager::songCellBank(cell) == bankIndex(track);
+}
+
+int MiniAcid::patternInEditBank(SongTrack track, int cell) const {
+  if (cell < 0 || SceneManager::songCellBank(cell) != bankIndex(track)) return -1;
+  return SceneManager::songCellPattern(cell);
+}
+
+const SynthPattern& MiniAcid::synthPatternForCell(int synthIndex, int cell) const {
+  if (cell < 0) return kEmptySynthPattern;
+  SongTrack track = synthIndex == 0 ? SongTrack::SynthA : SongTrack::SynthB;
+  int bank = SceneManager::songCellBank(cell);
+  int pattern = SceneManager::songCellPattern(cell);
+  if (bank == bankIndex(track)) return sceneManager_.getSynthPattern(synthIndex, pattern);
+  // a bank that is not paged in yet rests
+  const SynthPattern* paged = bankPager_.pager ? bankPager_.pager->synthPattern(synthIndex, bank, pattern) : nullptr;
+  return paged ? *paged : kEmptySynthPattern;
+}
+
+const DrumPatternSet& MiniAcid::drumPatternSetForCell(int cell) const {
+  if (cell < 0) return kEmptyDrumPatternSet;
+  int bank = SceneManager::songCellBank(cell);
+  int pattern = SceneManager::songCellPattern(cell);
+  if (bank == bankIndex(SongTrack::Drums)) return sceneManager_.getDrumPatternSet(pattern);
+  const DrumPatternSet* paged = bankPager_.pager ? bankPager_.pager->drumPattern(bank, pattern) : nullptr;
+  return paged ? *paged : kEmptyDrumPatternSet;
 }
 
 const SynthPattern& MiniAcid::activeSynthPattern(int synthIndex) const {
   int idx = clamp303Voice(synthIndex);
   SongTrack track = idx == 0 ? SongTrack::SynthA : SongTrack::SynthB;
-  int pat = songPatternIndexForTrack(track);
-  if (pat < 0) return kEmptySynthPattern;
-  return sceneManager_.getSynthPattern(idx, pat);
+  return synthPatternForCell(idx, songPatternIndexForTrack(track));
 }
 
 const DrumPattern& MiniAcid::activeDrumPattern(int drumVoiceIndex) const {
   int idx = clampDrumVoice(drumVoiceIndex);
-  int pat = songPatternIndexForTrack(SongTrack::Drums);
-  const DrumPatternSet& set = pat >= 0 ? sceneManager_.getDrumPatternSet(pat)
-                                       : kEmptyDrumPatternSet;
-  return set.voices[idx];
+  return drumPatternSetForCell(songPatternIndexForTrack(SongTrack::Drums)).voices[idx];
 }
 
 int MiniAcid::clampSongPosition(int position) const {
@@ -636,23 +1122,63 @@ void MiniAcid::applySongPositionSelection() {
   int pos = clampSongPosition(sceneManager_.getSongPosition());
   sceneManager_.setSongPosition(pos);
   songPlayheadPosition_ = pos;
-  int patA = sceneManager_.songPattern(pos, SongTrack::SynthA);
-  int patB = sceneManager_.songPattern(pos, SongTrack::SynthB);
-  int patD = sceneManager_.songPattern(pos, SongTrack::Drums);
-
-  if (patA < 0) patA = patternModeSynthPatternIndex_[0];
-  if (patB < 0) patB = patternModeSynthPatternIndex_[1];
-  if (patD < 0) patD = patternModeDrumPatternIndex_;
+  const int fallback[SongPosition::kTrackCount] = {patternModeSynthPatternIndex_[0],
+                                                   patternModeSynthPatternIndex_[1],
+                                                   patternModeDrumPatternIndex_};
+  for (int t = 0; t < SongPosition::kTrackCount; ++t) {
+    SongTrack track = static_cast<SongTrack>(t);
+    int cell = sceneManager_.songPattern(pos, track);
+    int pattern = cell < 0 ? fallback[t] : patternInEditBank(track, cell);
+    // a bar on another bank leaves the selection where it was
+    if (pattern < 0) continue;
+    if (track == SongTrack::Drums) {
+      sceneManager_.setCurrentDrumPatternIndex(pattern);
+    } else {
+      sceneManager_.setCurrentSynthPatternIndex(t, pattern);
+    }
+  }
+  pageSongBanks(pos);
+}
+
+// Pages in the banks this bar plays and asks for the next bar's, keeping
+// the one playing. Offline renders read them on the spot instead.
+void MiniAcid::pageSongBanks(int position) {
+  SceneBankPager* pager = bankPager_.pager;
+  if (!pager) return;
+  int next = songTimeline_.nextPosition(position);
+  for (int t = 0; t < SongPosition::kTrackCount; ++t) {
+    SongTrack track = static_cast<SongTrack>(t);
+    int editBank = bankIndex(track);
+    int cell = songTimeline_.pattern(position, track);
+    int bank = cell < 0 ? -1 : SceneManager::songCellBank(cell);
+    if (bank >= 0 && bank != editBank) {
+      if (renderingOffline_) {
+        pager->load(track, bank, -1);
+      } else {
+        pager->prefetch(track, bank, bank);
+        // counted once per bar, as it starts
+        if (playing && currentStepIndex == 0) pager->arrive(track, bank);
+      }
+    }
+    int nextCell = songTimeline_.pattern(next, track);
+    int nextBank = nextCell < 0 ? -1 : SceneManager::songCellBank(nextCell);
+    if (nextBank >= 0 && nextBank != editBank && !renderingOffline_) pager->prefetch(track, nextBank, bank);
+  }
+}
 
-  sceneManager_.setCurrentSynthPatternIndex(0, patA);
-  sceneManager_.setCurrentSynthPatternIndex(1, patB);
-  sceneManager_.setCurrentDrumPatternIndex(patD);
+bool MiniAcid::songUsesOtherBanks() const {
+  for (int pos = 0; pos < songTimeline_.length(); ++pos) {
+    for (int t = 0; t < SongPosition::kTrackCount; ++t) {
+      SongTrack track = static_cast<SongTrack>(t);
+      int cell = songTimeline_.pattern(pos, track);
+      if (cell >= 0 && SceneManager::songCellBank(cell) != bankIndex(track)) return true;
+    }
+  }
+  return false;
 }
 
 void MiniAcid::advanceSongPlayhead() {
-  int len = sceneManager_.songLength();
-  if (len < 1) len = 1;
-  songPlayheadPosition_ = (songPlayheadPosition_ + 1) % len;
+  songPlayheadPosition_ = songTimeline_.nextPosition(clampSongPosition(songPlayheadPosition_));
   sceneManager_.setSongPosition(songPlayheadPosition_);
   applySongPositionSelection();
 }
@@ -676,19 +1202,27 @@ void MiniAcid::refreshDrumCache(int drumVoiceIndex) const {
 }
 
 void MiniAcid::updateSamplesPerStep() {
-  samplesPerStep = sampleRateValue * 60.0f / (bpmValue * 4.0f);
+  float previous = samplesPerStep;
+  appliedBpm_ = bpmValue;
+  samplesPerStep = sampleRateValue * 60.0f / (appliedBpm_ * 4.0f);
+  // keep the playhead at the same fraction of the step across the change
+  if (previous > 0.0f) samplesIntoStep *= samplesPerStep / previous;
+  delay303.setBpm(appliedBpm_);
+  delay3032.setBpm(appliedBpm_);
 }
 
 float MiniAcid::noteToFreq(int note) {
-  return 440.0f * powf(2.0f, (note - 69) / 12.0f);
+  return noteFrequency(note);
 }
 
 void MiniAcid::advanceStep() {
   int prevStep = currentStepIndex;
   currentStepIndex = (currentStepIndex + 1) % SEQ_STEPS;
+  // a scene switch waits for the bar line so the groove does not stumble
+  bool switched = currentStepIndex == 0 && commitPendingScene();
 
   if (songMode_) {
-    if (prevStep < 0) {
+    if (prevStep < 0 || switched) {
       songPlayheadPosition_ = clampSongPosition(sceneManager_.getSongPosition());
       sceneManager_.setSongPosition(songPlayheadPosition_);
       applySongPositionSelection();
@@ -697,6 +1231,14 @@ void MiniAcid::advanceStep() {
     }
   }
 
+  scheduleStepTriggers(currentStepIndex, false);
+  // Steps that play ahead of their grid line are queued one step early. Not
+  // across a song position change, the next patterns aren't selected yet.
+  int nextStep = (currentStepIndex + 1) % SEQ_STEPS;
+  if (!(songMode_ && nextStep == 0)) scheduleStepTriggers(nextStep, true);
+}
+
+void MiniAcid::scheduleStepTriggers(int stepIndex, bool early) {
   int songPatternA = songPatternIndexForTrack(SongTrack::SynthA);
   int songPatternB = songPatternIndexForTrack(SongTrack::SynthB);
   int songPatternDrums = songPatternIndexForTrack(SongTrack::Drums);
@@ -704,54 +1246,117 @@ void MiniAcid::advanceStep() {
   // 303 voices
   const SynthPattern& synthA = activeSynthPattern(0);
   const SynthPattern& synthB = activeSynthPattern(1);
-  const SynthStep& stepA = synthA.steps[currentStepIndex];
-  const SynthStep& stepB = synthB.steps[currentStepIndex];
-  int note = stepA.note;
-  bool accent = stepA.accent;
-  bool slide = stepA.slide;
-
-  int note2 = stepB.note;
-  bool accent2 = stepB.accent;
-  bool slide2 = stepB.slide;
-
-  if (!mute303 && songPatternA >= 0 && note >= 0)
-    voice303.startNote(noteToFreq(note), accent, slide);
-  else
-    voice303.release();
-
-  if (!mute303_2 && songPatternB >= 0 && note2 >= 0)
-    voice3032.startNote(noteToFreq(note2), accent2, slide2);
-  else
-    voice3032.release();
+  const SynthStep& stepA = synthA.steps[stepIndex];
+  const SynthStep& stepB = synthB.steps[stepIndex];
+
+  PendingTrigger trigger{};
+  trigger.track = 0;
+  trigger.note = static_cast<int8_t>(!mute303 && songPatternA >= 0 && stepA.note >= 0 ? stepA.note : -1);
+  trigger.accent = stepA.accent;
+  trigger.slide = stepA.slide;
+  scheduleTrigger(trigger, stepTimingOffset(synthA.swing, stepA.timing, stepIndex), stepIndex, early);
+
+  trigger.track = 1;
+  trigger.note = static_cast<int8_t>(!mute303_2 && songPatternB >= 0 && stepB.note >= 0 ? stepB.note : -1);
+  trigger.accent = stepB.accent;
+  trigger.slide = stepB.slide;
+  scheduleTrigger(trigger, stepTimingOffset(synthB.swing, stepB.timing, stepIndex), stepIndex, early);
 
   // Drums
-  const DrumPattern& kick = activeDrumPattern(kDrumKickVoice);
-  const DrumPattern& snare = activeDrumPattern(kDrumSnareVoice);
-  const DrumPattern& hat = activeDrumPattern(kDrumHatVoice);
-  const DrumPattern& openHat = activeDrumPattern(kDrumOpenHatVoice);
-  const DrumPattern& midTom = activeDrumPattern(kDrumMidTomVoice);
-  const DrumPattern& highTom = activeDrumPattern(kDrumHighTomVoice);
-  const DrumPattern& rim = activeDrumPattern(kDrumRimVoice);
-  const DrumPattern& clap = activeDrumPattern(kDrumClapVoice);
-
+  const bool drumMutes[NUM_DRUM_VOICES] = {muteKick, muteSnare, muteHat, muteOpenHat,
+                                           muteMidTom, muteHighTom, muteRim, muteClap};
   bool drumsActive = songPatternDrums >= 0;
 
-  if (kick.steps[currentStepIndex].hit && !muteKick && drumsActive)
-    drums.triggerKick();
-  if (snare.steps[currentStepIndex].hit && !muteSnare && drumsActive)
-    drums.triggerSnare();
-  if (hat.steps[currentStepIndex].hit && !muteHat && drumsActive)
-    drums.triggerHat();
-  if (openHat.steps[currentStepIndex].hit && !muteOpenHat && drumsActive)
-    drums.triggerOpenHat();
-  if (midTom.steps[currentStepIndex].hit && !muteMidTom && drumsActive)
-    drums.triggerMidTom();
-  if (highTom.steps[currentStepIndex].hit && !muteHighTom && drumsActive)
-    drums.triggerHighTom();
-  if (rim.steps[currentStepIndex].hit && !muteRim && drumsActive)
-    drums.triggerRim();
-  if (clap.steps[currentStepIndex].hit && !muteClap && drumsActive)
-    drums.triggerClap();
+  for (int v = 0; v < NUM_DRUM_VOICES; ++v) {
+    const DrumPattern& pattern = activeDrumPattern(v);
+    const DrumStep& step = pattern.steps[stepIndex];
+    int track = NUM_303_VOICES + v;
+    bool play = step.hit && !drumMutes[v] && drumsActive;
+    if (!play) {
+      // an early trigger for this step may already be queued; it stays valid
+      if (!early && earlyTriggerStep_[track] == stepIndex) earlyTriggerStep_[track] = -1;
+      continue;
+    }
+    trigger = PendingTrigger{};
+    trigger.track = static_cast<uint8_t>(track);
+    trigger.accent = step.accent;
+    scheduleTrigger(trigger, stepTimingOffset(pattern.swing, step.timing, stepIndex), stepIndex, early);
+  }
+}
+
+void MiniAcid::scheduleTrigger(PendingTrigger trigger, float stepOffset, int stepIndex, bool early) {
+  int track = trigger.track;
+  if (early) {
+    if (stepOffset >= 0.0f) return;
+    trigger.samplesLeft = static_cast<int>(lroundf((1.0f + stepOffset) * samplesPerStep));
+    earlyTriggerStep_[track] = static_cast<int8_t>(stepIndex);
+  } else {
+    if (earlyTriggerStep_[track] == stepIndex) {
+      // already queued during the previous step
+      earlyTriggerStep_[track] = -1;
+      return;
+    }
+    // nothing ran ahead for this step (first step, pattern change): play on the grid
+    if (stepOffset < 0.0f) stepOffset = 0.0f;
+    trigger.samplesLeft = static_cast<int>(lroundf(stepOffset * samplesPerStep));
+  }
+
+  if (trigger.samplesLeft <= 0 || pendingTriggerCount_ >= kMaxPendingTriggers) {
+    fireTrigger(trigger);
+    return;
+  }
+  pendingTriggers_[pendingTriggerCount_++] = trigger;
+}
+
+void MiniAcid::fireTrigger(const PendingTrigger& trigger) {
+  if (trigger.track < NUM_303_VOICES) {
+    TB303Voice& voice = trigger.track == 0 ? voice303 : voice3032;
+    if (trigger.note >= 0)
+      voice.startNote(noteToFreq(trigger.note), trigger.accent, trigger.slide);
+    else
+      voice.release();
+    return;
+  }
+
+  switch (trigger.track - NUM_303_VOICES) {
+  case kDrumKickVoice: drums.triggerKick(); break;
+  case kDrumSnareVoice: drums.triggerSnare(); break;
+  case kDrumHatVoice: drums.triggerHat(); break;
+  case kDrumOpenHatVoice: drums.triggerOpenHat(); break;
+  case kDrumMidTomVoice: drums.triggerMidTom(); break;
+  case kDrumHighTomVoice: drums.triggerHighTom(); break;
+  case kDrumRimVoice: drums.triggerRim(); break;
+  case kDrumClapVoice: drums.triggerClap(); break;
+  default: break;
+  }
+}
+
+void MiniAcid::firePendingTriggers() {
+  int i = 0;
+  while (i < pendingTriggerCount_) {
+    if (pendingTriggers_[i].samplesLeft > 0) {
+      ++i;
+      continue;
+    }
+    PendingTrigger trigger = pendingTriggers_[i];
+    pendingTriggers_[i] = pendingTriggers_[--pendingTriggerCount_];
+    fireTrigger(trigger);
+  }
+}
+
+void MiniAcid::clearPendingTriggers() {
+  pendingTriggerCount_ = 0;
+  for (int i = 0; i < kTriggerTracks; ++i) earlyTriggerStep_[i] = -1;
+}
+
+size_t MiniAcid::samplesUntilNextEvent() const {
+  float remaining = samplesPerStep - samplesIntoStep;
+  size_t next = remaining > 1.0f ? static_cast<size_t>(ceilf(remaining)) : 1;
+  for (int i = 0; i < pendingTriggerCount_; ++i) {
+    size_t left = static_cast<size_t>(pendingTriggers_[i].samplesLeft);
+    if (left < next) next = left;
+  }
+  return next;
 }
 
 void MiniAcid::generateAudioBuffer(int16_t *buffer, size_t numSamples) {
@@ -759,76 +1364,382 @@ void MiniAcid::generateAudioBuffer(int16_t *buffer, size_t numSamples) {
     return;
   }
 
-  updateSamplesPerStep();
-  delay303.setBpm(bpmValue);
-  delay3032.setBpm(bpmValue);
+  enableFlushToZero();
+  if (bpmValue != appliedBpm_) updateSamplesPerStep();
+
+  size_t offset = 0;
+  while (offset < numSamples) {
+    size_t count = numSamples - offset;
+    if (count > AUDIO_BUFFER_SAMPLES) count = AUDIO_BUFFER_SAMPLES;
+    renderBlock(buffer + offset * AUDIO_CHANNELS, count);
+    offset += count;
+  }
 
-  for (size_t i = 0; i < numSamples; ++i) {
-    if (playing) {
-      if (samplesIntoStep >= (unsigned long)samplesPerStep) {
-        samplesIntoStep = 0;
+  size_t copyCount = numSamples;
+  if (copyCount > AUDIO_BUFFER_SAMPLES) copyCount = AUDIO_BUFFER_SAMPLES;
+#if MINIACID_STEREO
+  // the scope shows the mono downmix
+  for (size_t i = 0; i < copyCount; ++i) {
+    lastBuffer[i] = static_cast<int16_t>((buffer[i * 2] + buffer[i * 2 + 1]) / 2);
+  }
+#else
+  for (size_t i = 0; i < copyCount; ++i) lastBuffer[i] = buffer[i];
+#endif
+  lastBufferCount = copyCount;
+}
+
+void MiniAcid::renderBlock(int16_t *buffer, size_t numSamples) {
+  float reverbSend = params[static_cast<int>(MiniAcidParamId::ReverbSend)].value();
+  float reverbDecay = params[static_cast<int>(MiniAcidParamId::ReverbDecay)].value();
+  if (reverbDecay != reverbDecayApplied_) {
+    reverb_.setDecay(reverbDecay);
+    reverbDecayApplied_ = reverbDecay;
+  }
+  reverbSendRamp_.beginBlock(reverbSend);
+  bool feedReverb = reverbSend > 0.0f || reverbSendRamp_.isRamping() || !reverb_.isIdle();
+  bool blockActive = false;
+  const bool captureStems = !stemStorage_.empty();
+
+  // mutes are resolved once per block, not per sample
+  const bool laneMuted[DrumSynthVoice::kLaneCount] = {muteKick, muteSnare, muteHat, muteOpenHat,
+                                                      muteMidTom, muteHighTom, muteRim, muteClap};
+
+  // Render in spans between sequencer events so step and off-grid triggers
+  // land on their exact sample.
+  size_t pos = 0;
+  while (pos < numSamples) {
+    size_t span = numSamples - pos;
+    bool active = playing;
+    if (active) {
+      if (samplesIntoStep >= samplesPerStep) {
+        samplesIntoStep -= samplesPerStep;
         advanceStep();
       }
-      samplesIntoStep++;
+      firePendingTriggers();
+      size_t next = samplesUntilNextEvent();
+      if (next < span) span = next;
     }
 
-    float sampleOut = 0.0f;
+    // Stages that are silent for the whole span are skipped. Voices only
+    // wake up on a trigger, and triggers only happen between spans.
+    bool runVoiceA = active && !mute303 && !voice303.isSilent();
+    bool runVoiceB = active && !mute303_2 && !voice3032.isSilent();
+    bool runDelayA = active && !delay303.isIdle();
+    bool runDelayB = active && !delay3032.isIdle();
+    bool runDrums = active && drums.isActive();
+    bool runBus = active && (runDrums || !drums.isBusIdle());
+    bool spanActive = runVoiceA || runVoiceB || runDelayA || runDelayB || runBus;
+    blockActive = blockActive || spanActive;
+
+    float* mix = mixBuffer_ + pos;
+    float* send = reverbSendBuffer_ + pos;
+    std::fill(mix, mix + span, 0.0f);
+#if MINIACID_STEREO
+    std::fill(mixRight_ + pos, mixRight_ + pos + span, 0.0f);
+    std::fill(send, send + span, 0.0f);
+#endif
+    if (captureStems) {
+      for (int s = 0; s < kStemCount; ++s) {
+        float* stem = stemBuffer(static_cast<MiniAcidStem>(s)) + pos;
+        std::fill(stem, stem + span, 0.0f);
+      }
+    }
 
-    if (playing) {
-      // 303 voices (with tempo delay)
-      float sample303 = 0.0f;
-      if (!mute303) {
-        float v = voice303.process() * 0.5f;
-        sample303 += delay303.process(v);
+    // 303 voices (with tempo delay); a muted voice still feeds its delay
+    // silence so tails decay naturally
+    if (runVoiceA || runDelayA) {
+      if (runVoiceA) {
+        voice303.processBlock(voiceBuffer_, span);
+        mixScale(voiceBuffer_, span, 0.5f);
       } else {
-        // keep delay.line ticking so tails decay naturally
-        delay303.process(0.0f);
+        std::fill(voiceBuffer_, voiceBuffer_ + span, 0.0f);
+      }
+      float* dry = captureStems ? stemBuffer(MiniAcidStem::Synth303A) + pos : nullptr;
+      if (dry) std::copy(voiceBuffer_, voiceBuffer_ + span, dry);
+      delay303.processBlock(voiceBuffer_, span);
+      if (dry) {
+        float* wet = stemBuffer(MiniAcidStem::Delay303A) + pos;
+        for (size_t i = 0; i < span; ++i) wet[i] = voiceBuffer_[i] - dry[i];
       }
-      if (!mute303_2) {
-        float v = voice3032.process() * 0.5f;
-        sample303 += delay3032.process(v);
+      mixTrack(0, voiceBuffer_, pos, span);
+    }
+    if (runVoiceB || runDelayB) {
+      if (runVoiceB) {
+        voice3032.processBlock(voiceBuffer_, span);
+        mixScale(voiceBuffer_, span, 0.5f);
       } else {
-        delay3032.process(0.0f);
+        std::fill(voiceBuffer_, voiceBuffer_ + span, 0.0f);
+      }
+      float* dry = captureStems ? stemBuffer(MiniAcidStem::Synth303B) + pos : nullptr;
+      if (dry) std::copy(voiceBuffer_, voiceBuffer_ + span, dry);
+      delay3032.processBlock(voiceBuffer_, span);
+      if (dry) {
+        float* wet = stemBuffer(MiniAcidStem::Delay303B) + pos;
+        for (size_t i = 0; i < span; ++i) wet[i] = voiceBuffer_[i] - dry[i];
       }
+      mixTrack(1, voiceBuffer_, pos, span);
+    }
 
-      float drumSum = 0.0f;
-      if (!muteKick)    drumSum += drums.processKick();
-      if (!muteSnare)   drumSum += drums.processSnare();
-      if (!muteHat)     drumSum += drums.processHat();
-      if (!muteOpenHat) drumSum += drums.processOpenHat();
-      if (!muteMidTom)  drumSum += drums.processMidTom();
-      if (!muteHighTom) drumSum += drums.processHighTom();
-      if (!muteRim)     drumSum += drums.processRim();
-      if (!muteClap)    drumSum += drums.processClap();
-
-      // Bus compressor can be applied to the whole mix, or just the drums
-      // uncoment the line below to process the drums w/ the bus comp
-      drumSum = drums.processBus(drumSum);
-
-      sampleOut = drumSum + sample303;
-      
-      // uncomment to use bus comp on the whole mix
-      // sampleOut = drums.processBus(sampleOut);
+    // Bus compressor can be applied to the whole mix, or just the drums;
+    // here it only sees the drums
+    if (runBus) {
+      std::fill(drumBuffer_, drumBuffer_ + span, 0.0f);
+#if MINIACID_STEREO
+      // lanes are panned one by one; the compressor keys off their mono sum
+      std::fill(drumLeft_, drumLeft_ + span, 0.0f);
+      std::fill(drumRight_, drumRight_ + span, 0.0f);
+      for (int lane = 0; runDrums && lane < DrumSynthVoice::kLaneCount; ++lane) {
+        if (laneMuted[lane] || !drums.isLaneActive(lane)) continue;
+        float* laneOut = laneBuffer_;
+        if (captureStems) {
+          laneOut = stemBuffer(static_cast<MiniAcidStem>(static_cast<int>(MiniAcidStem::Kick) + lane)) + pos;
+        } else {
+          std::fill(laneBuffer_, laneBuffer_ + span, 0.0f);
+        }
+        drums.processLaneBlock(lane, laneOut, span);
+        int track = NUM_303_VOICES + lane;
+        mixPanned(drumLeft_, drumRight_, laneOut, span, panLeft_[track], panRight_[track]);
+        mixAdd(drumBuffer_, laneOut, span);
+      }
+      drums.processBusStereo(drumBuffer_, drumLeft_, drumRight_, span);
+      mixAdd(mix, drumLeft_, span);
+      mixAdd(mixRight_ + pos, drumRight_, span);
+      mixAdd(send, drumBuffer_, span);
+#else
+      for (int lane = 0; runDrums && lane < DrumSynthVoice::kLaneCount; ++lane) {
+        if (laneMuted[lane] || !drums.isLaneActive(lane)) continue;
+        if (captureStems) {
+          // render the lane on its own, then sum; same result as summing in place
+          float* laneOut = stemBuffer(static_cast<MiniAcidStem>(static_cast<int>(MiniAcidStem::Kick) + lane)) + pos;
+          drums.processLaneBlock(lane, laneOut, span);
+          mixAdd(drumBuffer_, laneOut, span);
+        } else {
+          drums.processLaneBlock(lane, drumBuffer_, span);
+        }
+      }
+      drums.processBusBlock(drumBuffer_, span);
+      mixAdd(mix, drumBuffer_, span);
+#endif
     }
 
-    // soft clipping/limiting
-    sampleOut *= 0.65f;
-    if (sampleOut > 1.0f)  sampleOut = 1.0f;
-    if (sampleOut < -1.0f) sampleOut = -1.0f;
+    if (feedReverb) {
+#if MINIACID_STEREO
+      // the send carries the pre-pan mono sum
+      for (size_t i = 0; i < span; ++i) send[i] *= reverbSendRamp_.next();
+#else
+      for (size_t i = 0; i < span; ++i) send[i] = mix[i] * reverbSendRamp_.next();
+#endif
+    }
 
-    float currentVolume = params[static_cast<int>(MiniAcidParamId::MainVolume)].value();
-    buffer[i] = static_cast<int16_t>(sampleOut * 32767.0f * currentVolume);
+    if (active) {
+      samplesIntoStep += static_cast<float>(span);
+      for (int t = 0; t < pendingTriggerCount_; ++t) {
+        pendingTriggers_[t].samplesLeft -= static_cast<int>(span);
+      }
+    }
+    pos += span;
   }
 
-  size_t copyCount = numSamples;
-  if (copyCount > AUDIO_BUFFER_SAMPLES) copyCount = AUDIO_BUFFER_SAMPLES;
-  for (size_t i = 0; i < copyCount; ++i) lastBuffer[i] = buffer[i];
-  lastBufferCount = copyCount;
+  if (captureStems && stemSink_) {
+    const float* stems[kStemCount];
+    for (int s = 0; s < kStemCount; ++s) stems[s] = stemBuffer(static_cast<MiniAcidStem>(s));
+    stemSink_(stems, numSamples);
+  }
+
+  // reverb is a send: its return is summed back onto the mix bus
+  if (feedReverb) {
+    uint32_t startCycles = dspCycleCount();
+#if MINIACID_STEREO
+    bool ran = reverb_.process(reverbSendBuffer_, mixBuffer_, mixRight_, numSamples);
+#else
+    bool ran = reverb_.process(reverbSendBuffer_, mixBuffer_, numSamples);
+#endif
+    uint32_t cycles = dspCycleCount() - startCycles;
+    blockActive = blockActive || ran;
+    if (ran) {
+      float perSample = static_cast<float>(cycles) / static_cast<float>(numSamples);
+      stats_.reverbCyclesPerSample += (perSample - stats_.reverbCyclesPerSample) * 0.1f;
+    }
+  }
+  stats_.reverbActive = !reverb_.isIdle();
+
+  if (mixSink_) {
+#if MINIACID_STEREO
+    const float* channels[AUDIO_CHANNELS] = {mixBuffer_, mixRight_};
+#else
+    const float* channels[AUDIO_CHANNELS] = {mixBuffer_};
+#endif
+    mixSink_(channels, numSamples);
+  }
+
+  float currentVolume = params[static_cast<int>(MiniAcidParamId::MainVolume)].value();
+  if (!blockActive) {
+    outputStage_.skip(currentVolume);
+    memset(buffer, 0, numSamples * AUDIO_CHANNELS * sizeof(int16_t));
+    return;
+  }
+#if MINIACID_STEREO
+  outputStage_.processStereo(mixBuffer_, mixRight_, buffer, numSamples, currentVolume);
+#else
+  outputStage_.process(mixBuffer_, buffer, numSamples, currentVolume);
+#endif
+}
+
+void MiniAcid::mixTrack(int track, const float* src, size_t pos, size_t count) {
+#if MINIACID_STEREO
+  mixPanned(mixBuffer_ + pos, mixRight_ + pos, src, count, panLeft_[track], panRight_[track]);
+  mixAdd(reverbSendBuffer_ + pos, src, count);
+#else
+  (void)track;
+  mixAdd(mixBuffer_ + pos, src, count);
+#endif
+}
+
+void MiniAcid::setTrackPan(int track, float pan) {
+  if (track < 0 || track >= kMixTracks) return;
+  if (pan < -1.0f) pan = -1.0f;
+  if (pan > 1.0f) pan = 1.0f;
+  trackPan_[track] = pan;
+#if MINIACID_STEREO
+  // constant power: -3 dB per side at the centre
+  float angle = (pan + 1.0f) * 0.785398163f;
+  panLeft_[track] = cosf(angle);
+  panRight_[track] = sinf(angle);
+#endif
+}
+
+float MiniAcid::trackPan(int track) const {
+  if (track < 0 || track >= kMixTracks) return 0.0f;
+  return trackPan_[track];
+}
+
+size_t MiniAcid::snapshotBytes() const {
+  SnapshotWriter counter(nullptr, 0);
+  writeSnapshot(counter);
+  return counter.size();
+}
+
+size_t MiniAcid::captureSnapshot(uint8_t* dst, size_t capacity) const {
+  if (!dst) return 0;
+  SnapshotWriter out(dst, capacity);
+  writeSnapshot(out);
+  return out.ok() ? out.size() : 0;
+}
+
+void MiniAcid::writeSnapshot(SnapshotWriter& out) const {
+  static_assert(std::is_trivially_copyable<TB303Voice>::value, "TB303Voice is snapshotted with memcpy");
+  static_assert(std::is_trivially_copyable<DrumSynthVoice>::value, "DrumSynthVoice is snapshotted with memcpy");
+
+  out.value(kSnapshotMagic);
+  out.value(kSnapshotVersion);
+  // reverb first: it is the only part that can reject a snapshot after the
+  // size check, and nothing has been overwritten at that point
+  reverb_.saveState(out);
+  out.value(voice303);
+  out.value(voice3032);
+  out.value(drums);
+  delay303.saveState(out);
+  delay3032.saveState(out);
+
+  const bool flags[] = {playing, mute303, mute303_2, muteKick, muteSnare, muteHat, muteOpenHat,
+                        muteMidTom, muteHighTom, muteRim, muteClap, delay303Enabled, delay3032Enabled};
+  out.value(flags);
+  out.value(static_cast<float>(bpmValue));
+  out.value(appliedBpm_);
+  out.value(static_cast<int>(currentStepIndex));
+  out.value(samplesIntoStep);
+  out.value(samplesPerStep);
+
+  out.value(songMode_);
+  out.value(songPlayheadPosition_);
+  out.value(patternModeDrumPatternIndex_);
+  out.value(patternModeSynthPatternIndex_);
+  const int selection[] = {sceneManager_.getCurrentDrumPatternIndex(),
+                           sceneManager_.getCurrentSynthPatternIndex(0),
+                           sceneManager_.getCurrentSynthPatternIndex(1),
+                           sceneManager_.getSongPosition(),
+                           songTimeline_.loopStart(),
+                           songTimeline_.loopEnd()};
+  out.value(selection);
+
+  out.value(pendingTriggerCount_);
+  out.value(pendingTriggers_);
+  out.value(earlyTriggerStep_);
+  out.value(params);
+  out.value(reverbDecayApplied_);
+  out.value(reverbSendRamp_);
+  out.value(outputStage_);
+  out.value(trackPan_);
+}
+
+bool MiniAcid::restoreSnapshot(const uint8_t* src, size_t size) {
+  if (!src || size != snapshotBytes()) return false;
+  SnapshotReader in(src, size);
+  if (in.read<uint32_t>() != kSnapshotMagic || in.read<uint16_t>() != kSnapshotVersion) return false;
+  if (!reverb_.loadState(in)) return false;
+  in.value(voice303);
+  in.value(voice3032);
+  in.value(drums);
+  delay303.loadState(in);
+  delay3032.loadState(in);
+
+  bool flags[13] = {};
+  in.value(flags);
+  if (!in.ok()) return false;
+  playing = flags[0];
+  mute303 = flags[1];
+  mute303_2 = flags[2];
+  muteKick = flags[3];
+  muteSnare = flags[4];
+  muteHat = flags[5];
+  muteOpenHat = flags[6];
+  muteMidTom = flags[7];
+  muteHighTom = flags[8];
+  muteRim = flags[9];
+  muteClap = flags[10];
+  delay303Enabled = flags[11];
+  delay3032Enabled = flags[12];
+  bpmValue = in.read<float>();
+  in.value(appliedBpm_);
+  currentStepIndex = in.read<int>();
+  in.value(samplesIntoStep);
+  in.value(samplesPerStep);
+
+  in.value(songMode_);
+  in.value(songPlayheadPosition_);
+  in.value(patternModeDrumPatternIndex_);
+  in.value(patternModeSynthPatternIndex_);
+  int selection[6] = {};
+  in.value(selection);
+  if (!in.ok()) return false;
+  sceneManager_.setSongMode(songMode_);
+  sceneManager_.setCurrentDrumPatternIndex(selection[0]);
+  sceneManager_.setCurrentSynthPatternIndex(0, selection[1]);
+  sceneManager_.setCurrentSynthPatternIndex(1, selection[2]);
+  sceneManager_.setSongPosition(selection[3]);
+  if (selection[5] >= 0) songTimeline_.setLoop(selection[4], selection[5]);
+  else songTimeline_.clearLoop();
+
+  in.value(pendingTriggerCount_);
+  in.value(pendingTriggers_);
+  in.value(earlyTriggerStep_);
+  in.value(params);
+  in.value(reverbDecayApplied_);
+  in.value(reverbSendRamp_);
+  in.value(outputStage_);
+  float pans[kMixTracks] = {};
+  in.value(pans);
+  if (!in.ok()) return false;
+  for (int t = 0; t < kMixTracks; ++t) setTrackPan(t, pans[t]);
+  return in.ok();
 }
 
 void MiniAcid::randomize303Pattern(int voiceIndex) {
   int idx = clamp303Voice(voiceIndex);
-  PatternGenerator::generateRandom303Pattern(editSynthPattern(idx));
+  if (!editsPlayingBank(idx == 0 ? SongTrack::SynthA : SongTrack::SynthB)) return;
+  SynthPattern pattern = synthPattern(idx);
+  PatternGenerator::generateRandom303Pattern(pattern);
+  sceneManager_.setCurrentSynthPattern(idx, pattern);
 }
 
 void MiniAcid::setParameter(MiniAcidParamId id, float value) {
@@ -839,20 +1750,48 @@ void MiniAcid::adjustParameter(MiniAcidParamId id, int steps) {
   params[static_cast<int>(id)].addSteps(steps);
 }
 
+void MiniAcid::setReverbLineCount(int lines) {
+  reverb_.setLineCount(lines);
+  stats_.reverbRamBytes = reverb_.memoryBytes();
+  stats_.reverbLines = reverb_.lineCount();
+}
+
+void MiniAcid::setReverbCompactLines(bool int16Lines) {
+  reverb_.setCompactLines(int16Lines);
+  stats_.reverbRamBytes = reverb_.memoryBytes();
+}
+
+void MiniAcid::setReverbModulation(bool on) { reverb_.setModulation(on); }
+
+void MiniAcid::setOutputSoftClip(bool on) { outputStage_.setSoftClip(on); }
+void MiniAcid::setOutputDither(bool on) { outputStage_.setDither(on); }
+bool MiniAcid::outputSoftClip() const { return outputStage_.softClip(); }
+bool MiniAcid::outputDither() const { return outputStage_.dither(); }
+
+const MiniAcidStats& MiniAcid::stats() const { return stats_; }
+
 void MiniAcid::randomizeDrumPattern() {
-  PatternGenerator::generateRandomDrumPattern(sceneManager_.editCurrentDrumPattern());
+  if (!editsPlayingBank(SongTrack::Drums)) return;
+  DrumPatternSet patternSet = sceneManager_.getCurrentDrumPattern();
+  PatternGenerator::generateRandomDrumPattern(patternSet);
+  sceneManager_.setCurrentDrumPattern(patternSet);
 }
 
 std::string MiniAcid::currentSceneName() const {
   if (!sceneStorage_) return {};
-  return sceneStorage_->getCurrentSceneName();
+  // a switch under way shows the scene asked for
+  bool switching = sceneSwitch_.state.load() != SceneSwitch::Idle;
+  uint8_t live = sceneSwitch_.live.load();
+  return sceneSwitch_.names[switching ? 1 - live : live];
 }
 
+const std::string& MiniAcid::liveSceneName() const { return sceneSwitch_.names[sceneSwitch_.live.load()]; }
+
 std::vector<std::string> MiniAcid::availableSceneNames() const {
   if (!sceneStorage_) return {};
   std::vector<std::string> names = sceneStorage_->getAvailableSceneNames();
   if (names.empty() && sceneStorage_) {
-    std::string current = sceneStorage_->getCurrentSceneName();
+    const std::string& current = liveSceneName();
     if (!current.empty()) names.push_back(current);
   }
   std::sort(names.begin(), names.end());
@@ -862,38 +1801,160 @@ std::vector<std::string> MiniAcid::availableSceneNames() const {
 
 bool MiniAcid::loadSceneByName(const std::string& name) {
   if (!sceneStorage_) return false;
-  std::string previousName = sceneStorage_->getCurrentSceneName();
-  sceneStorage_->setCurrentSceneName(name);
-
-  bool loaded = sceneStorage_->readScene(sceneManager_);
+  // a scene still waiting for the bar line is replaced, not committed here
+  claimSceneSwitch();
+
+  SceneManager& incoming = sceneSwitch_.scene;
+  bool loaded = sceneCache_ && sceneCache_->lookup(name, incoming);
+  // a save of this name the writer has not finished is newer than the file,
+  // and the file may be half written
+  if (!loaded) loaded = sceneAutosave_ && sceneAutosave_->readPending(name, incoming);
   if (!loaded) {
-    std::string serialized;
-    loaded = sceneStorage_->readScene(serialized) && sceneManager_.loadScene(serialized);
+    loaded = sceneStorage_->readSceneNamed(name, incoming);
+    if (loaded && sceneCache_) sceneCache_->store(name, incoming);
   }
   if (!loaded) {
-    sceneStorage_->setCurrentSceneName(previousName);
+    sceneSwitch_.state.store(SceneSwitch::Idle);
     return false;
   }
+
+  sceneSwitch_.kind = SceneSwitch::Load;
+  sceneSwitch_.names[1 - sceneSwitch_.live.load()] = name;
+  if (bankPager_.pager) {
+    // the old scene keeps its pages until the bar line; the new scene's
+    // first bar is asked for now, under the new name
+    bankPager_.pager->prepareScene(name);
+    for (int t = 0; t < SongPosition::kTrackCount && playing && incoming.songMode(); ++t) {
+      SongTrack track = static_cast<SongTrack>(t);
+      int cell = incoming.songPattern(incoming.getSongPosition(), track);
+      int bank = cell < 0 ? -1 : SceneManager::songCellBank(cell);
+      int editBank = incoming.getCurrentBankIndex(track == SongTrack::Drums ? 0 : t + 1);
+      if (bank >= 0 && bank != editBank) bankPager_.pager->prefetchPrepared(track, bank);
+    }
+  }
+  return true;
+}
+
+bool MiniAcid::sceneSwitchPending() const {
+  return sceneSwitch_.state.load() != SceneSwitch::Idle;
+}
+
+bool MiniAcid::commitPendingScene() {
+  uint8_t expected = SceneSwitch::Ready;
+  if (!sceneSwitch_.state.compare_exchange_strong(expected, SceneSwitch::Committing)) return false;
+  // keeps the journal; the UI clears it in finishSceneSwitch()
+  sceneManager_ = sceneSwitch_.scene;
+  sceneSwitch_.live.store(1 - sceneSwitch_.live.load());
+  if (bankPager_.pager) bankPager_.pager->commitScene();
   applySceneStateFromManager();
+  sceneSwitch_.commits.fetch_add(1);
+  sceneSwitch_.state.store(SceneSwitch::Idle);
   return true;
 }
 
+void MiniAcid::claimSceneSwitch() {
+  while (true) {
+    uint8_t state = sceneSwitch_.state.load();
+    // only the UI fills a switch, so one left Filling is its own
+    if (state == SceneSwitch::Filling) return;
+    // a load still waiting for the bar line is dropped; one being committed
+    // finishes first
+    if (state != SceneSwitch::Committing &&
+        sceneSwitch_.state.compare_exchange_strong(state, SceneSwitch::Filling)) {
+      return;
+    }
+    std::this_thread::yield();
+  }
+}
+
+void MiniAcid::finishSceneSwitch() {
+  persistSceneName();
+  dropStaleHistory();
+}
+
+void MiniAcid::dropStaleHistory() {
+  uint32_t commits = sceneSwitch_.commits.load();
+  if (commits == historyCommits_) return;
+  sceneManager_.clearEditHistory();
+  historyCommits_ = commits;
+}
+
+void MiniAcid::persistSceneName() {
+  // the storage opens this scene next time; it learns of a switch here rather
+  // than while the audio guard is held
+  const std::string& live = liveSceneName();
+  if (!sceneStorage_ || live == persistedSceneName_) return;
+  sceneStorage_->setCurrentSceneName(live);
+  persistedSceneName_ = live;
+}
+
+bool MiniAcid::editHistoryCurrent() const { return sceneSwitch_.commits.load() == historyCommits_; }
+
+void MiniAcid::setSceneCache(SceneCache* cache) {
+  sceneCache_ = cache;
+}
+
+void MiniAcid::prefetchScene(const std::string& name) {
+  if (sceneCache_) sceneCache_->prefetch(name);
+}
+
 bool MiniAcid::saveSceneAs(const std::string& name) {
   if (!sceneStorage_) return false;
-  sceneStorage_->setCurrentSceneName(name);
-  saveSceneToStorage();
+  claimSceneSwitch();
+  sceneSwitch_.kind = SceneSwitch::Rename;
+  sceneSwitch_.names[1 - sceneSwitch_.live.load()] = name;
+  if (sceneCache_) sceneCache_->invalidate(name);
+  // the banks the scene does not hold go with it
+  if (bankPager_.pager) bankPager_.pager->prepareScene(name, SceneBankPager::BankFile::Copy);
   return true;
 }
 
 bool MiniAcid::createNewSceneWithName(const std::string& name) {
   if (!sceneStorage_) return false;
-  sceneStorage_->setCurrentSceneName(name);
-  sceneManager_.loadDefaultScene();
-  applySceneStateFromManager();
-  saveSceneToStorage();
+  claimSceneSwitch();
+  sceneSwitch_.kind = SceneSwitch::Fresh;
+  sceneSwitch_.scene.loadDefaultScene();
+  sceneSwitch_.names[1 - sceneSwitch_.live.load()] = name;
+  if (sceneCache_) sceneCache_->invalidate(name);
+  if (bankPager_.pager) bankPager_.pager->prepareScene(name, SceneBankPager::BankFile::Remove);
   return true;
 }
 
+void MiniAcid::publishSceneSwitch() {
+  if (sceneSwitch_.state.load() != SceneSwitch::Filling) return;
+  switch (sceneSwitch_.kind) {
+  case SceneSwitch::Rename:
+    sceneSwitch_.live.store(1 - sceneSwitch_.live.load());
+    if (bankPager_.pager) bankPager_.pager->commitScene();
+    sceneSwitch_.state.store(SceneSwitch::Idle);
+    // whatever is stored under the new name is unrelated to this scene
+    sceneManager_.markAllDirty();
+    saveSceneToStorage();
+    break;
+  case SceneSwitch::Fresh:
+    sceneSwitch_.state.store(SceneSwitch::Ready);
+    commitPendingScene();
+    saveSceneToStorage();
+    break;
+  case SceneSwitch::Load:
+    if (sceneCache_) {
+      // unsaved edits stay with the scene for as long as it is cached
+      syncSceneStateToManager();
+      sceneCache_->store(liveSceneName(), sceneManager_);
+    }
+    sceneSwitch_.state.store(SceneSwitch::Ready);
+    if (!playing) commitPendingScene();
+    break;
+  }
+}
+
+bool MiniAcid::exportSceneJson() {
+  if (!sceneStorage_) return false;
+  syncSceneStateToManager();
+  if (sceneAutosave_) return sceneAutosave_->requestExport(liveSceneName(), sceneManager_);
+  return sceneStorage_->exportSceneJsonNamed(liveSceneName(), sceneManager_);
+}
+
 void MiniAcid::loadSceneFromStorage() {
   if (sceneStorage_) {
     if (sceneStorage_->readScene(sceneManager_)) return;
@@ -909,7 +1970,132 @@ void MiniAcid::loadSceneFromStorage() {
 void MiniAcid::saveSceneToStorage() {
   if (!sceneStorage_) return;
   syncSceneStateToManager();
-  sceneStorage_->writeScene(sceneManager_);
+  if (sceneAutosave_) {
+    sceneAutosave_->request(liveSceneName(), sceneManager_);
+    return;
+  }
+  if (!sceneManager_.isDirty()) return;
+  if (sceneStorage_->writeSceneNamed(liveSceneName(), sceneManager_)) sceneManager_.markClean();
+}
+
+void MiniAcid::beginEdit() {
+  dropStaleHistory();
+  sceneManager_.beginEdit();
+}
+
+void MiniAcid::endEdit() { sceneManager_.endEdit(); }
+
+bool MiniAcid::undoEdit() { return replayEdit(false); }
+
+bool MiniAcid::redoEdit() { return replayEdit(true); }
+
+SceneJournalStats MiniAcid::editHistoryStats() const {
+  // a switch the UI has not caught up with leaves nothing to undo
+  return editHistoryCurrent() ? sceneManager_.journalStats() : SceneJournalStats();
+}
+
+bool MiniAcid::replayEdit(bool redo) {
+  dropStaleHistory();
+  SynthParameters before[NUM_303_VOICES] = {sceneManager_.getSynthParameters(0),
+                                            sceneManager_.getSynthParameters(1)};
+  if (!(redo ? sceneManager_.redo() : sceneManager_.undo())) return false;
+  // knob edits live in the voices; only touch the ones the edit changed
+  for (int i = 0; i < NUM_303_VOICES; ++i) {
+    const SynthParameters& after = sceneManager_.getSynthParameters(i);
+    if (after.cutoff != before[i].cutoff || after.resonance != before[i].resonance ||
+        after.envAmount != before[i].envAmount || after.envDecay != before[i].envDecay ||
+        after.oscType != before[i].oscType) {
+      applySynthParametersFromManager(i);
+    }
+  }
+  rebuildSongTimeline();
+  sceneManager_.setSongPosition(clampSongPosition(sceneManager_.getSongPosition()));
+  applySongPositionSelection();
+  return true;
+}
+
+void MiniAcid::setSceneAutosave(SceneAutosave* autosave) {
+  sceneAutosave_ = autosave;
+}
+
+bool MiniAcid::flushSceneAutosave() {
+  bool ok = sceneAutosave_ ? sceneAutosave_->flush(liveSceneName(), sceneManager_) : true;
+  if (bankPager_.pager) ok = bankPager_.pager->flush() && ok;
+  persistSceneName();
+  return ok;
+}
+
+bool MiniAcid::isSavingScene() const {
+  return sceneAutosave_ && sceneAutosave_->isSaving();
+}
+
+void MiniAcid::setBankPager(SceneBankPager* pager) {
+  bankPager_.pager = pager;
+  if (pager && sceneStorage_) pager->setScene(liveSceneName());
+}
+
+int MiniAcid::bankIndex(SongTrack track) const {
+  if (track == SongTrack::Drums) return sceneManager_.getCurrentBankIndex(0);
+  return sceneManager_.getCurrentBankIndex(track == SongTrack::SynthA ? 1 : 2);
+}
+
+bool MiniAcid::prepareBankSwitch(SongTrack track, int bank) {
+  BankPagerLink& link = bankPager_;
+  SceneBankPager* pager = link.pager;
+  if (!pager) return false;
+  if (link.track >= 0) pager->releaseBank(static_cast<SongTrack>(link.track));
+  link.track = -1;
+  if (bank < 0 || bank >= SceneManager::kBankCount) return false;
+  int current = bankIndex(track);
+  if (bank == current) return true;
+  // the bank being left keeps its edits in the bank file; only the UI edits
+  // patterns, so it can be read here while the audio thread plays it. The
+  // const overload leaves the dirty flags, which the audio thread writes, be
+  const SceneManager& manager = sceneManager_;
+  const Scene& scene = manager.currentScene();
+  int cell = songMode_ ? songTimeline_.pattern(songPlayheadPosition_, track) : -1;
+  int playing = cell < 0 ? -1 : SceneManager::songCellBank(cell);
+  if (track == SongTrack::Drums) {
+    if (!pager->takeBank(bank, link.drums)) return false;
+    if (!pager->reserveBank(current, scene.drumBank, playing)) return false;
+  } else {
+    int synth = track == SongTrack::SynthA ? 0 : 1;
+    if (!pager->takeBank(synth, bank, link.synth)) return false;
+    if (!pager->reserveBank(synth, current, synth == 0 ? scene.synthABank : scene.synthBBank, playing)) {
+      return false;
+    }
+  }
+  link.track = static_cast<int8_t>(track);
+  link.bank = static_cast<int8_t>(bank);
+  link.from = static_cast<int8_t>(current);
+  link.commits = sceneSwitch_.commits.load();
+  return true;
+}
+
+void MiniAcid::publishBankSwitch() {
+  BankPagerLink& link = bankPager_;
+  if (link.track < 0) return;
+  SongTrack track = static_cast<SongTrack>(link.track);
+  link.track = -1;
+  // a scene that took over at the bar line in between has banks of its own
+  if (link.commits != sceneSwitch_.commits.load() || bankIndex(track) != link.from) {
+    link.pager->releaseBank(track);
+    return;
+  }
+  const Scene& scene = sceneManager_.currentScene();
+  if (track == SongTrack::Drums) {
+    link.pager->storeBank(scene.drumBank);
+    sceneManager_.setCurrentDrumBank(link.bank, link.drums);
+  } else {
+    int synth = track == SongTrack::SynthA ? 0 : 1;
+    link.pager->storeBank(synth, synth == 0 ? scene.synthABank : scene.synthBBank);
+    sceneManager_.setCurrentSynthBank(synth, link.bank, link.synth);
+  }
+  if (songMode_) applySongPositionSelection();
+}
+
+SceneBankPagerStats MiniAcid::bankPagerStats() const {
+  return bankPager_.pager ? bankPager_.pager->stats() : SceneBankPagerStats();
 }
 
 void MiniAcid::applySceneStateFromManager() {
@@ -926,24 +2112,13 @@ void MiniAcid::applySceneStateFromManager() {
   muteRim = sceneManager_.getDrumMute(kDrumRimVoice);
   muteClap = sceneManager_.getDrumMute(kDrumClapVoice);
 
-  const SynthParameters& paramsA = sceneManager_.getSynthParameters(0);
-  const SynthParameters& paramsB = sceneManager_.getSynthParameters(1);
-
-  voice303.setParameter(TB303ParamId::Cutoff, paramsA.cutoff);
-  voice303.setParameter(TB303ParamId::Resonance, paramsA.resonance);
-  voice303.setParameter(TB303ParamId::EnvAmount, paramsA.envAmount);
-  voice303.setParameter(TB303ParamId::EnvDecay, paramsA.envDecay);
-  voice303.setParameter(TB303ParamId::Oscillator, static_cast<float>(paramsA.oscType));
-
-  voice3032.setParameter(TB303ParamId::Cutoff, paramsB.cutoff);
-  voice3032.setParameter(TB303ParamId::Resonance, paramsB.resonance);
-  voice3032.setParameter(TB303ParamId::EnvAmount, paramsB.envAmount);
-  voice3032.setParameter(TB303ParamId::EnvDecay, paramsB.envDecay);
-  voice3032.setParameter(TB303ParamId::Oscillator, static_cast<float>(paramsB.oscType));
+  applySynthParametersFromManager(0);
+  applySynthParametersFromManager(1);
 
   patternModeDrumPatternIndex_ = sceneManager_.getCurrentDrumPatternIndex();
   patternModeSynthPatternIndex_[0] = sceneManager_.getCurrentSynthPatternIndex(0);
   patternModeSynthPatternIndex_[1] = sceneManager_.getCurrentSynthPatternIndex(1);
+  rebuildSongTimeline();
   songMode_ = sceneManager_.songMode();
   songPlayheadPosition_ = clampSongPosition(sceneManager_.getSongPosition());
   if (songMode_) {
@@ -951,6 +2126,17 @@ void MiniAcid::applySceneStateFromManager() {
   }
 }
 
+void MiniAcid::applySynthParametersFromManager(int synthIndex) {
+  int idx = clamp303Voice(synthIndex);
+  TB303Voice& voice = idx == 0 ? voice303 : voice3032;
+  const SynthParameters& params = sceneManager_.getSynthParameters(idx);
+  voice.setParameter(TB303ParamId::Cutoff, params.cutoff);
+  voice.setParameter(TB303ParamId::Resonance, params.resonance);
+  voice.setParameter(TB303ParamId::EnvAmount, params.envAmount);
+  voice.setParameter(TB303ParamId::EnvDecay, params.envDecay);
+  voice.setParameter(TB303ParamId::Oscillator, static_cast<float>(params.oscType));
+}
+
 void MiniAcid::syncSceneStateToManager() {
   sceneManager_.setBpm(bpmValue);
   sceneManager_.setSynthMute(0, mute303);
@@ -1,19 +1,35 @@
 #pragma once
 
+#include <atomic>
 #include <stddef.h>
 #include <stdint.h>
 #include <vector>
 #include <string>
+#include <functional>
 
+#include "scene_autosave.h"
+#include "scene_bank_pager.h"
+#include "scene_cache.h"
 #include "scene_storage.h"
 #include "scenes.h"
 #include "mini_tb303.h"
 #include "mini_drumvoices.h"
+#include "mini_reverb.h"
+#include "mini_output_stage.h"
+#include "mini_song_timeline.h"
+#include "mini_dsp_snapshot.h"
 
 // ===================== Audio config =====================
 
+// Build with MINIACID_STEREO=1 for interleaved stereo output with per-track
+// pan. The default mono build carries none of the stereo buffers or work.
+#ifndef MINIACID_STEREO
+#define MINIACID_STEREO 0
+#endif
+
 static const int SAMPLE_RATE = 22050;        // Hz
-static const int AUDIO_BUFFER_SAMPLES = 256; // per buffer, mono
+static const int AUDIO_BUFFER_SAMPLES = 256; // frames per buffer
+static const int AUDIO_CHANNELS = MINIACID_STEREO ? 2 : 1;
 static const int SEQ_STEPS = 16;             // 16-step sequencer
 static const int NUM_303_VOICES = 2;
 static const int NUM_DRUM_VOICES = DrumPatternSet::kVoices;
@@ -30,20 +46,39 @@ public:
   void setBeats(float beats);
   void setMix(float mix);
   void setFeedback(float fb);
+  void setGlideTime(float seconds);
   void setEnabled(bool on);
   bool isEnabled() const;
+  // True when the line holds nothing audible (or the delay is off), so
+  // process() passes silent input straight through.
+  bool isIdle() const;
 
   float process(float input);
+  // In-place version of process() over a block.
+  void processBlock(float* io, size_t count);
+
+  void saveState(SnapshotWriter& out) const;
+  bool loadState(SnapshotReader& in);
 
 private:
   // for 2 voices at 22050 Hz, this is the max that the cardputer can handle.
   static const int kMaxDelaySeconds = 1;
 
+  void updateTargetDelay();
+
   std::vector<float> buffer;
   int writeIndex;
-  int delaySamples;
+  float delaySamples;       // current (fractional) read distance
+  float targetDelaySamples; // where the read head is gliding to
+  float glideIncrement;     // per-sample read head movement while gliding
+  int glideSamplesLeft;
+  float glideSeconds;       // time to reach a new delay length after a tempo change
   float sampleRate;
   int maxDelaySamples;
+  bool idle;          // line cleared after a full pass below the silence threshold
+  float windowPeak;   // loudest sample written during the current pass
+  int windowCount;
+  float bpm;      // tempo the target delay was computed for
   float beats;    // delay length in beats
   float mix;      // wet mix 0..1
   float feedback; // feedback 0..1
@@ -53,8 +88,36 @@ private:
 
 enum class MiniAcidParamId : uint8_t {
   MainVolume = 0,
+  ReverbSend,
+  ReverbDecay,
+  Count
+};
+
+// Per-track signals taken before the drum bus and the master stage.
+enum class MiniAcidStem : uint8_t {
+  Synth303A = 0,
+  Synth303B,
+  Delay303A, // delay returns, without the dry voice
+  Delay303B,
+  Kick,
+  Snare,
+  Hat,
+  OpenHat,
+  MidTom,
+  HighTom,
+  Rim,
+  Clap,
   Count
 };
+
+// Runtime figures for deciding which effects a device can afford.
+struct MiniAcidStats {
+  float reverbCyclesPerSample = 0.0f; // smoothed, only updated while the reverb runs
+  size_t reverbRamBytes = 0;
+  int reverbLines = 0;
+  bool reverbActive = false;          // false once the tail decayed and it bypassed itself
+};
+
 class MiniAcid {
 public:
   static constexpr int kMin303Note = 24; // C1
@@ -107,13 +170,90 @@ public:
   void clearSongPattern(int position, SongTrack track);
   int songPatternAt(int position, SongTrack track) const;
   const Song& song() const;
+  // Jump the song playhead straight to a bar; when playing, the bar starts
+  // over from its first step on the next sample.
+  void seekSong(int position);
+  void setSongLoop(int startPosition, int endPosition);
+  void clearSongLoop();
+  bool songLoopEnabled() const;
+  int songLoopStart() const;
+  int songLoopEnd() const;
+  // Offline bounce of song bars [startPosition, endPosition]. Plays the range
+  // from a cold start and hands the audio to 'sink' in blocks; the engine is
+  // stopped afterwards. Returns the number of frames rendered; 'count' is in
+  // frames too, with AUDIO_CHANNELS interleaved samples per frame.
+  using RenderSink = std::function<void(const int16_t* samples, size_t count)>;
+  size_t renderSongRange(int startPosition, int endPosition, const RenderSink& sink);
+
+  // Stems, indexed by MiniAcidStem: 'stems[s]' holds 'frames' float samples,
+  // valid for the duration of the call.
+  static constexpr int kStemCount = static_cast<int>(MiniAcidStem::Count);
+  static const char* stemName(MiniAcidStem stem);
+  using StemSink = std::function<void(const float* const* stems, size_t frames)>;
+  // Live capture: 'sink' is called from generateAudioBuffer() after every
+  // block. Allocates the stem buffers; pass an empty sink to stop and free
+  // them. Call under the audio guard.
+  void setStemSink(StemSink sink);
+  // Offline stem bounce of song bars [startPosition, endPosition], same
+  // transport handling as renderSongRange(). On desktop builds the 303s and
+  // the drum machine render on their own threads. Returns frames rendered.
+  size_t renderSongStems(int startPosition, int endPosition, const StemSink& sink);
+  // Live tap of the float mix bus after the reverb return, before headroom,
+  // limiting and main volume: 'channels' holds AUDIO_CHANNELS pointers to
+  // 'frames' samples each. Offline renders do not reach it. Call under the
+  // audio guard.
+  using MixSink = std::function<void(const float* const* channels, size_t frames)>;
+  void setMixSink(MixSink sink);
   int display303PatternIndex(int voiceIndex) const;
   int displayDrumPatternIndex() const;
   std::string currentSceneName() const;
   std::vector<std::string> availableSceneNames() const;
+  // Scene switches take two steps. loadSceneByName(), saveSceneAs() and
+  // createNewSceneWithName() may wait for storage, so the UI calls them
+  // outside the audio guard; publishSceneSwitch() then hands the result
+  // over under the guard. While playing, a loaded scene takes over at the
+  // next bar (see sceneSwitchPending()) and another load before then
+  // replaces it; save as and new scene take over at once. Each drops a
+  // load still waiting for the bar line, a failed one too. The bank file
+  // is copied or removed, and the scene saved under its new name, by the
+  // writer task. Cached scenes skip storage entirely.
   bool loadSceneByName(const std::string& name);
   bool saveSceneAs(const std::string& name);
   bool createNewSceneWithName(const std::string& name);
+  void publishSceneSwitch();
+  bool sceneSwitchPending() const;
+  // UI side of a switch the audio thread committed: drops the undo history
+  // of the scene it replaced and records the scene name with the storage.
+  // Call once per frame, outside the audio guard.
+  void finishSceneSwitch();
+  void setSceneCache(SceneCache* cache);
+  // Starts loading 'name' into the scene cache in the background.
+  void prefetchScene(const std::string& name);
+  // Queues the current scene to be written as JSON alongside its binary
+  // save.
+  bool exportSceneJson();
+  // With an autosave attached, stop() only snapshots the scene and the
+  // platform's writer task does the write; without one it saves inline.
+  void setSceneAutosave(SceneAutosave* autosave);
+  // Writes any pending save now, e.g. before shutting down.
+  bool flushSceneAutosave();
+  bool isSavingScene() const;
+
+  // Pattern banks. Each track edits one of SceneManager::kBankCount banks;
+  // song cells name a bank and a pattern, and bars on a bank other than the
+  // one being edited are paged in through the pager ahead of the playhead.
+  // Without a pager every track keeps the bank the scene holds.
+  void setBankPager(SceneBankPager* pager);
+  int bankIndex(SongTrack track) const;
+  // Bank switches take two steps, like scene switches. prepareBankSwitch()
+  // reads the incoming bank and finds a page for the one being left; it may
+  // wait for storage, so the UI calls it outside the audio guard.
+  // publishBankSwitch() then swaps the bank in under the guard and queues
+  // the one left for writing. False if the bank could not be read or the
+  // one being left could not be kept.
+  bool prepareBankSwitch(SongTrack track, int bank);
+  void publishBankSwitch();
+  SceneBankPagerStats bankPagerStats() const;
 
   void toggleMute303(int voiceIndex = 0);
   void toggleMuteKick();
@@ -137,35 +277,131 @@ public:
   void toggle303AccentStep(int voiceIndex, int stepIndex);
   void toggle303SlideStep(int voiceIndex, int stepIndex);
   void toggleDrumStep(int voiceIndex, int stepIndex);
+  // Swing and microtiming in percent of a step, see kMaxStepSwing/kMaxStepTiming.
+  void set303StepTiming(int voiceIndex, int stepIndex, int timing);
+  void setDrumStepTiming(int voiceIndex, int stepIndex, int timing);
+  void set303Swing(int voiceIndex, int swing);
+  void setDrumSwing(int voiceIndex, int swing);
+  int step303Timing(int voiceIndex, int stepIndex) const;
+  int stepDrumTiming(int voiceIndex, int stepIndex) const;
+  int swing303(int voiceIndex) const;
+  int drumSwing(int voiceIndex) const;
 
   void randomize303Pattern(int voiceIndex = 0);
   void randomizeDrumPattern();
 
+  // Undo history shared by every page: step, swing, song and 303 knob edits
+  // (see SceneManager). Edits between beginEdit() and endEdit() undo as one.
+  void beginEdit();
+  void endEdit();
+  bool undoEdit();
+  bool redoEdit();
+  SceneJournalStats editHistoryStats() const;
+
   Parameter& miniParameter(MiniAcidParamId id);
   void setParameter(MiniAcidParamId id, float value);
   void adjustParameter(MiniAcidParamId id, int steps);
 
+  // Reverb configuration. Changing the line count or storage reallocates,
+  // so call these under the audio guard.
+  void setReverbLineCount(int lines);
+  void setReverbCompactLines(bool int16Lines);
+  void setReverbModulation(bool on);
+  // Output stage: tanh soft clip instead of hard clipping, TPDF dither.
+  void setOutputSoftClip(bool on);
+  void setOutputDither(bool on);
+  bool outputSoftClip() const;
+  bool outputDither() const;
+  const MiniAcidStats& stats() const;
+
+  // Mix tracks: the 303 voices, then the drum voices (kick .. clap).
+  static constexpr int kMixTracks = NUM_303_VOICES + NUM_DRUM_VOICES;
+  // -1 = left .. 1 = right, constant power. Only heard in stereo builds.
+  void setTrackPan(int track, float pan);
+  float trackPan(int track) const;
+
+  // Fills 'numSamples' frames; 'buffer' holds AUDIO_CHANNELS interleaved
+  // samples per frame.
   void generateAudioBuffer(int16_t *buffer, size_t numSamples);
 
+  // Snapshot of the full runtime state: voices, delay and reverb lines, bus
+  // compressor, sequencer position and song playhead, mutes and parameters.
+  // Pattern and song data are not included. The size is fixed for a given
+  // engine configuration; buffers are caller-owned so nothing allocates.
+  // Snapshots are an in-memory format for the running build, not a file
+  // format. Call both from the audio thread or under the audio guard.
+  size_t snapshotBytes() const;
+  size_t captureSnapshot(uint8_t* dst, size_t capacity) const;
+  bool restoreSnapshot(const uint8_t* src, size_t size);
+
 private:
+  void writeSnapshot(SnapshotWriter& out) const;
+  // A step trigger that lands off the grid; fires when samplesLeft reaches 0.
+  struct PendingTrigger {
+    int samplesLeft;
+    uint8_t track; // synth voices first, then drum voices
+    int8_t note;   // synth only, -1 releases
+    bool accent;
+    bool slide;
+  };
+  static constexpr int kTriggerTracks = NUM_303_VOICES + NUM_DRUM_VOICES;
+  static constexpr int kMaxPendingTriggers = kTriggerTracks * 2;
+
+  struct OfflineRender {
+    size_t total;
+    bool wasSongMode;
+    int previousPosition;
+    int loopStart;
+    int loopEnd;
+    MixSink liveMixSink;
+  };
+  bool beginOfflineRender(int startPosition, int endPosition, OfflineRender& render);
+  void endOfflineRender(const OfflineRender& render);
+  // Clears voices, delays, reverb and output stage back to their power-on
+  // state; parameters and settings stay.
+  void resetDspState();
+  void isolateStemGroup(int group);
+#if !defined(ARDUINO)
+  size_t renderStemsParallel(size_t total, const StemSink& sink);
+#endif
+
+  void renderBlock(int16_t *buffer, size_t numSamples);
+  float* stemBuffer(MiniAcidStem stem);
+  void mixTrack(int track, const float* src, size_t pos, size_t count);
   void updateSamplesPerStep();
   void advanceStep();
+  void scheduleStepTriggers(int stepIndex, bool early);
+  void scheduleTrigger(PendingTrigger trigger, float stepOffset, int stepIndex, bool early);
+  void fireTrigger(const PendingTrigger& trigger);
+  void firePendingTriggers();
+  void clearPendingTriggers();
+  size_t samplesUntilNextEvent() const;
   float noteToFreq(int note);
   int clamp303Voice(int voiceIndex) const;
   int clamp303Step(int stepIndex) const;
   int clamp303Note(int note) const;
   const SynthPattern& synthPattern(int synthIndex) const;
-  SynthPattern& editSynthPattern(int synthIndex);
   const DrumPattern& drumPattern(int drumVoiceIndex) const;
-  DrumPattern& editDrumPattern(int drumVoiceIndex);
   int clampDrumVoice(int voiceIndex) const;
+  void record303Parameter(TB303ParamId id, int voiceIndex);
+  void applySynthParametersFromManager(int synthIndex);
+  bool replayEdit(bool redo);
+  bool editHistoryCurrent() const;
   void refreshSynthCaches(int synthIndex) const;
   void refreshDrumCache(int drumVoiceIndex) const;
   const SynthPattern& activeSynthPattern(int synthIndex) const;
   const DrumPattern& activeDrumPattern(int drumVoiceIndex) const;
+  const SynthPattern& synthPatternForCell(int synthIndex, int cell) const;
+  const DrumPatternSet& drumPatternSetForCell(int cell) const;
   int songPatternIndexForTrack(SongTrack track) const;
+  bool editsPlayingBank(SongTrack track) const;
+  int patternInEditBank(SongTrack track, int cell) const;
+  bool songUsesOtherBanks() const;
+  void pageSongBanks(int position);
   void applySongPositionSelection();
   void advanceSongPlayhead();
+  void rebuildSongTimeline();
+  void stopPlayback();
   int clampSongPosition(int position) const;
 
   TB303Voice voice303;
@@ -174,7 +410,51 @@ private:
   float sampleRateValue;
 
   SceneManager sceneManager_;
+  SceneJournal editJournal_;
   SceneStorage* sceneStorage_;
+  SceneAutosave* sceneAutosave_ = nullptr;
+  SceneCache* sceneCache_ = nullptr;
+
+  // Stays with this engine: offline render copies get none and play only
+  // the banks the scene holds.
+  struct BankPagerLink {
+    SceneBankPager* pager = nullptr;
+    // the bank prepareBankSwitch() read, until publishBankSwitch()
+    int8_t track = -1; // a SongTrack, -1 when nothing is staged
+    int8_t bank = -1;
+    int8_t from = -1;
+    uint32_t commits = 0; // scene switches then; a switch since drops it
+    Bank<DrumPatternSet> drums;
+    Bank<SynthPattern> synth;
+    BankPagerLink() = default;
+    BankPagerLink(const BankPagerLink&) {}
+    BankPagerLink& operator=(const BankPagerLink&) { return *this; }
+  };
+  BankPagerLink bankPager_;
+  bool renderingOffline_ = false; // song bars read their banks in place
+
+  // A scene waiting to replace the live one. The UI claims it (Filling),
+  // fills in 'scene' and marks it Ready; whoever moves it to Committing (the
+  // audio thread at the bar, or the UI when playback stops) copies it over
+  // sceneManager_ and flips 'live'. A save as only renames the live scene
+  // and never gets to Ready. The names belong to the UI; the audio thread
+  // only flips the index.
+  struct SceneSwitch {
+    enum State : uint8_t { Idle, Filling, Ready, Committing };
+    enum Kind : uint8_t { Load, Rename, Fresh };
+    SceneSwitch() = default;
+    // offline render copies of the engine never switch scenes
+    SceneSwitch(const SceneSwitch& other) : scene(other.scene) {}
+    SceneManager scene;
+    Kind kind = Load;
+    std::string names[2]; // the live scene's and the incoming one's
+    std::atomic<uint8_t> live{0};
+    std::atomic<uint8_t> state{Idle};
+    std::atomic<uint32_t> commits{0};
+  };
+  SceneSwitch sceneSwitch_;
+  std::string persistedSceneName_; // last name handed to the storage
+  uint32_t historyCommits_ = 0; // switches whose history the UI has dropped
   mutable int8_t synthNotesCache_[NUM_303_VOICES][SEQ_STEPS];
   mutable bool synthAccentCache_[NUM_303_VOICES][SEQ_STEPS];
   mutable bool synthSlideCache_[NUM_303_VOICES][SEQ_STEPS];
@@ -194,21 +474,53 @@ private:
   volatile bool delay303Enabled;
   volatile bool delay3032Enabled;
   volatile float bpmValue;
+  float appliedBpm_; // tempo the step timing and delays were last computed for
   volatile int currentStepIndex;
-  unsigned long samplesIntoStep;
+  float samplesIntoStep; // fractional, so step lengths don't truncate and drift
   float samplesPerStep;
   bool songMode_;
   int songPlayheadPosition_;
+  SongTimeline songTimeline_;
   int patternModeDrumPatternIndex_;
   int patternModeSynthPatternIndex_[NUM_303_VOICES];
+  PendingTrigger pendingTriggers_[kMaxPendingTriggers];
+  int pendingTriggerCount_;
+  int8_t earlyTriggerStep_[kTriggerTracks]; // step already queued ahead of its grid line, -1 if none
 
   TempoDelay delay303;
   TempoDelay delay3032;
+  FdnReverb reverb_;
+  float reverbDecayApplied_;
+  ParamRamp reverbSendRamp_;
+  OutputStage outputStage_;
+  float mixBuffer_[AUDIO_BUFFER_SAMPLES];
+  float reverbSendBuffer_[AUDIO_BUFFER_SAMPLES];
+  float voiceBuffer_[AUDIO_BUFFER_SAMPLES];
+  float drumBuffer_[AUDIO_BUFFER_SAMPLES];
+  float trackPan_[kMixTracks];
+  StemSink stemSink_;
+  MixSink mixSink_;
+  std::vector<float> stemStorage_; // kStemCount blocks, empty unless capturing
+#if MINIACID_STEREO
+  // mixBuffer_ is the left channel; reverbSendBuffer_ collects the mono sum
+  float mixRight_[AUDIO_BUFFER_SAMPLES];
+  float laneBuffer_[AUDIO_BUFFER_SAMPLES];
+  float drumLeft_[AUDIO_BUFFER_SAMPLES];
+  float drumRight_[AUDIO_BUFFER_SAMPLES];
+  float panLeft_[kMixTracks];
+  float panRight_[kMixTracks];
+#endif
+  MiniAcidStats stats_;
   int16_t lastBuffer[AUDIO_BUFFER_SAMPLES];
   size_t lastBufferCount;
 
   void loadSceneFromStorage();
   void saveSceneToStorage();
+  bool commitPendingScene();
+  void claimSceneSwitch();
+  void dropStaleHistory();
+  const std::string& liveSceneName() const;
+  void persistSceneName();
   void applySceneStateFromManager();
   void syncSceneStateToManager();
 
@@ -82,6 +82,11 @@ inline void drawHelpPageTransport(IGfx& gfx, int x, int y, int w, int h) {
   drawHelpItem(gfx, layout.left_x, left_y, "I / O", "303A/303B randomize", IGfxColor::Yellow());
   left_y += lh;
   drawHelpItem(gfx, layout.left_x, left_y, "P", "drum randomize", IGfxColor::Yellow());
+
+  int right_y = layout.right_y;
+  drawHelpHeading(gfx, layout.right_x, right_y, "Edits");
+  right_y += lh;
+  drawHelpItem(gfx, layout.right_x, right_y, "ALT+J / M", "undo/redo", COLOR_LABEL);
 }
 
 inline void drawHelpPage303(IGfx& gfx, int x, int y, int w, int h) {
@@ -101,6 +106,8 @@ inline void drawHelpPage303(IGfx& gfx, int x, int y, int w, int h) {
   drawHelpItem(gfx, layout.left_x, left_y, "F / V", "decay +/-", COLOR_KNOB_4);
   left_y += lh;
   drawHelpItem(gfx, layout.left_x, left_y, "M", "toggle delay", IGfxColor::Magenta());
+  left_y += lh;
+  drawHelpItem(gfx, layout.left_x, left_y, "H / N", "reverb send +/-", COLOR_ACCENT);
 
   drawHelpHeading(gfx, layout.right_x, right_y, "Mutes");
   right_y += lh;
@@ -131,6 +138,8 @@ inline void drawHelpPage303PatternEdit(IGfx& gfx, int x, int y, int w, int h) {
   left_y += lh;
   drawHelpItem(gfx, layout.left_x, left_y, "Q..I", "Pick pattern", COLOR_PATTERN_SELECTED_FILL);
   left_y += lh;
+  drawHelpItem(gfx, layout.left_x, left_y, "B / G", "Bank - / +", COLOR_PATTERN_SELECTED_FILL);
+  left_y += lh;
 
   int right_y = y + 4 + lh;
   drawHelpHeading(gfx, layout.right_x, right_y, "Step edits");
@@ -144,6 +153,12 @@ inline void drawHelpPage303PatternEdit(IGfx& gfx, int x, int y, int w, int h) {
   drawHelpItem(gfx, layout.right_x, right_y, "S / X", "Octave + / -", COLOR_LABEL);
   right_y += lh;
   drawHelpItem(gfx, layout.right_x, right_y, "BACK", "Clear step", IGfxColor::Red());
+  right_y += lh;
+  drawHelpItem(gfx, layout.right_x, right_y, "J / M", "Undo / redo", COLOR_LABEL);
+  right_y += lh;
+  drawHelpItem(gfx, layout.right_x, right_y, "ALT+L/R", "Nudge step", COLOR_LABEL);
+  right_y += lh;
+  drawHelpItem(gfx, layout.right_x, right_y, "ALT+U/D", "Swing +/-", COLOR_LABEL);
 }
 
 inline void drawHelpPageDrumPatternEdit(IGfx& gfx, int x, int y, int w, int h) {
@@ -165,6 +180,15 @@ inline void drawHelpPageDrumPatternEdit(IGfx& gfx, int x, int y, int w, int h) {
   drawHelpHeading(gfx, layout.left_x, left_y, "Patterns");
   left_y += lh;
   drawHelpItem(gfx, layout.left_x, left_y, "Q..I", "Select drum pattern 1-8", COLOR_PATTERN_SELECTED_FILL);
+  left_y += lh;
+  drawHelpItem(gfx, layout.left_x, left_y, "B / G", "Bank - / +", COLOR_PATTERN_SELECTED_FILL);
+
+  int right_y = y + 4 + lh;
+  drawHelpHeading(gfx, layout.right_x, right_y, "Timing");
+  right_y += lh;
+  drawHelpItem(gfx, layout.right_x, right_y, "ALT+L/R", "Nudge step", COLOR_LABEL);
+  right_y += lh;
+  drawHelpItem(gfx, layout.right_x, right_y, "ALT+U/D", "Voice swing", COLOR_LABEL);
 }
 
 inline void drawHelpPageSong(IGfx& gfx, int x, int y, int w, int h) {
@@ -185,7 +209,7 @@ inline void drawHelpPageSong(IGfx& gfx, int x, int y, int w, int h) {
 
   drawHelpHeading(gfx, layout.left_x, left_y, "Patterns");
   left_y += lh;
-  drawHelpItem(gfx, layout.left_x, left_y, "Q..I", "set 1-8", COLOR_PATTERN_SELECTED_FILL);
+  drawHelpItem(gfx, layout.left_x, left_y, "Q..I", "set 1-8 of bank", COLOR_PATTERN_SELECTED_FILL);
   // left_y += lh;
   drawHelpItem(gfx, layout.right_x, left_y, "BACK", "clear slot", IGfxColor::Red());
 }
@@ -202,8 +226,16 @@ inline void drawHelpPageSongCont(IGfx& gfx, int x, int y, int w, int h) {
   left_y += lh;
   drawHelpItem(gfx, layout.left_x, left_y, "ALT+UP/DN @PLAY", "nudge playhead", IGfxColor::Yellow());
   left_y += lh;
+  drawHelpItem(gfx, layout.left_x, left_y, "ENTER @ ROW", "jump there", IGfxColor::Yellow());
   left_y += lh;
 
+  int right_y = layout.right_y;
+  drawHelpHeading(gfx, layout.right_x, right_y, "Loop");
+  right_y += lh;
+  drawHelpItem(gfx, layout.right_x, right_y, "A / S", "start/end here", IGfxColor::Yellow());
+  right_y += lh;
+  drawHelpItem(gfx, layout.right_x, right_y, "Z", "clear loop", IGfxColor::Yellow());
+
   drawHelpHeading(gfx, layout.left_x, left_y, "Mode");
   left_y += lh;
   drawHelpItem(gfx, layout.left_x, left_y, "ENTER @ MODE", "Song/Pat toggle", IGfxColor::Green());
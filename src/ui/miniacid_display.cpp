@@ -69,6 +69,7 @@ void MiniAcidDisplay::previousPage() {
 }
 
 void MiniAcidDisplay::update() {
+  mini_acid_.finishSceneSwitch();
   if (splash_active_) {
     unsigned long now = nowMillis();
     if (now - splash_start_ms_ >= 5000UL) splash_active_ = false;
@@ -304,7 +305,12 @@ int MiniAcidDisplay::drawPageTitle(int x, int y, int w, const char* text) {
 
 void MiniAcidDisplay::drawPageHint(int x, int y) {
   char buf[32];
-  snprintf(buf, sizeof(buf), "[< %d/%d >]", page_index_ + 1, static_cast<int>(pages_.size()));
+  // the hint makes room while a scene save is still on its way to the card
+  if (mini_acid_.isSavingScene()) {
+    snprintf(buf, sizeof(buf), "saving...");
+  } else {
+    snprintf(buf, sizeof(buf), "[< %d/%d >]", page_index_ + 1, static_cast<int>(pages_.size()));
+  }
   gfx_.setTextColor(COLOR_LABEL);
   gfx_.drawText(x, y, buf);
   gfx_.setTextColor(COLOR_WHITE);
@@ -337,6 +343,15 @@ bool MiniAcidDisplay::handleEvent(UIEvent event) {
       } else if (event.key == '=') {
         mini_acid_.adjustParameter(MiniAcidParamId::MainVolume, 5);
         return true;
+      } else if (event.alt && (event.key == 'j' || event.key == 'J' || event.key == 'm' || event.key == 'M')) {
+        // undo/redo from any page
+        bool undo = event.key == 'j' || event.key == 'J';
+        bool done = false;
+        auto replay = [&]() { done = undo ? mini_acid_.undoEdit() : mini_acid_.redoEdit(); };
+        if (audio_guard_) audio_guard_(replay);
+        else replay();
+        if (done) update();
+        return true;
       }
       break;
     default:
@@ -100,7 +100,7 @@ void DrumSequencerPage::withAudioGuard(const std::function<void()>& fn) {
   if (audio_guard_) { audio_guard_(fn); return; } fn();
 }
 
-// --- buffer & undo helpers ---
+// --- buffer helpers ---
 static inline void fetchHits(const MiniAcid& ma,
                              const bool*& kick, const bool*& snare, const bool*& hat, const bool*& openHat,
                              const bool*& midTom, const bool*& highTom, const bool*& rim, const bool*& clap) {
@@ -123,45 +123,25 @@ void DrumSequencerPage::captureCurrentDrumPattern(DrumPatternState& out) const {
       out.hits[v][s] = hits[v] ? hits[v][s] : false;
 }
 
-void DrumSequencerPage::applyDrumPatternState(const DrumPatternState& st) {
-  const bool *kick, *snare, *hat, *openHat, *midTom, *highTom, *rim, *clap;
-  fetchHits(mini_acid_, kick, snare, hat, openHat, midTom, highTom, rim, clap);
-  const bool* hits[NUM_DRUM_VOICES] = {kick, snare, hat, openHat, midTom, highTom, rim, clap};
-  for (int v = 0; v < NUM_DRUM_VOICES; ++v) {
-    for (int s = 0; s < SEQ_STEPS; ++s) {
-      bool have = hits[v] ? hits[v][s] : false;
-      bool want = st.hits[v][s];
-      if (want != have) {
-        withAudioGuard([&]() { mini_acid_.toggleDrumStep(v, s); });
-      }
-    }
-  }
-}
-
-void DrumSequencerPage::pushUndo() {
-  DrumPatternState st{}; captureCurrentDrumPattern(st);
-  undo_stack_.push_back(st);
-  if (undo_stack_.size() > static_cast<size_t>(kMaxHistory)) undo_stack_.erase(undo_stack_.begin());
-  clearRedo();
-}
-
-void DrumSequencerPage::clearRedo() { redo_stack_.clear(); }
-
 bool DrumSequencerPage::undo() {
-  if (undo_stack_.empty()) return false;
-  DrumPatternState cur{}; captureCurrentDrumPattern(cur);
-  redo_stack_.push_back(cur);
-  DrumPatternState prev = undo_stack_.back(); undo_stack_.pop_back();
-  applyDrumPatternState(prev);
-  return true;
+  bool done = false;
+  withAudioGuard([&]() { done = mini_acid_.undoEdit(); });
+  return done;
 }
 
 bool DrumSequencerPage::redo() {
-  if (redo_stack_.empty()) return false;
-  DrumPatternState cur{}; captureCurrentDrumPattern(cur);
-  undo_stack_.push_back(cur);
-  DrumPatternState next = redo_stack_.back(); redo_stack_.pop_back();
-  applyDrumPatternState(next);
+  bool done = false;
+  withAudioGuard([&]() { done = mini_acid_.redoEdit(); });
+  return done;
+}
+
+bool DrumSequencerPage::shiftBank(int delta) {
+  SongTrack track = SongTrack::Drums;
+  int bank = mini_acid_.bankIndex(track) + delta;
+  if (bank < 0 || bank >= SceneManager::kBankCount) return true;
+  // reading the bank may wait for the card; only swapping it in holds the
+  // audio guard
+  if (mini_acid_.prepareBankSwitch(track, bank)) withAudioGuard([&]() { mini_acid_.publishBankSwitch(); });
   return true;
 }
 
@@ -175,7 +155,6 @@ void DrumSequencerPage::copyCurrentDrumPatternToBuffer() {
 }
 
 void DrumSequencerPage::cutCurrentDrumPatternToBuffer() {
-  pushUndo();
   copyCurrentDrumPatternToBuffer();
   const bool *kick, *snare, *hat, *openHat, *midTom, *highTom, *rim, *clap;
   fetchHits(mini_acid_, kick, snare, hat, openHat, midTom, highTom, rim, clap);
@@ -191,7 +170,6 @@ void DrumSequencerPage::cutCurrentDrumPatternToBuffer() {
 
 void DrumSequencerPage::pasteBufferToCurrentDrumPattern() {
   if (!buffer_.has_data) return;
-  pushUndo();
   const bool *kick, *snare, *hat, *openHat, *midTom, *highTom, *rim, *clap;
   fetchHits(mini_acid_, kick, snare, hat, openHat, midTom, highTom, rim, clap);
   const bool* hits[NUM_DRUM_VOICES] = {kick, snare, hat, openHat, midTom, highTom, rim, clap};
@@ -211,7 +189,6 @@ void DrumSequencerPage::transposeDrumInstruments(int dir) {
   const bool *kick, *snare, *hat, *openHat, *midTom, *highTom, *rim, *clap;
   fetchHits(mini_acid_, kick, snare, hat, openHat, midTom, highTom, rim, clap);
   const bool* hits[NUM_DRUM_VOICES] = {kick, snare, hat, openHat, midTom, highTom, rim, clap};
-  pushUndo();
   bool rotated[NUM_DRUM_VOICES][SEQ_STEPS];
   for (int v = 0; v < NUM_DRUM_VOICES; ++v) {
     int src = (v - dir) % NUM_DRUM_VOICES; if (src < 0) src += NUM_DRUM_VOICES;
@@ -232,7 +209,6 @@ void DrumSequencerPage::rotateDrumSteps(int dir) {
   const bool *kick, *snare, *hat, *openHat, *midTom, *highTom, *rim, *clap;
   fetchHits(mini_acid_, kick, snare, hat, openHat, midTom, highTom, rim, clap);
   const bool* hits[NUM_DRUM_VOICES] = {kick, snare, hat, openHat, midTom, highTom, rim, clap};
-  pushUndo();
   bool rotated[NUM_DRUM_VOICES][SEQ_STEPS];
   for (int v = 0; v < NUM_DRUM_VOICES; ++v) {
     for (int s = 0; s < SEQ_STEPS; ++s) {
@@ -255,7 +231,6 @@ void DrumSequencerPage::duplicateTopRowToBottomRow() {
   const bool *kick, *snare, *hat, *openHat, *midTom, *highTom, *rim, *clap;
   fetchHits(mini_acid_, kick, snare, hat, openHat, midTom, highTom, rim, clap);
   const bool* hits[NUM_DRUM_VOICES] = {kick, snare, hat, openHat, midTom, highTom, rim, clap};
-  pushUndo();
   for (int v = 0; v < NUM_DRUM_VOICES; ++v) {
     for (int s = 0; s < 8; ++s) {
       bool want = hits[v] ? hits[v][s] : false;
@@ -265,9 +240,48 @@ void DrumSequencerPage::duplicateTopRowToBottomRow() {
   }
 }
 
+bool DrumSequencerPage::nudgeStepTiming(int delta) {
+  if (patternRowFocused()) focusGrid();
+  int step = activeDrumStep();
+  int voice = activeDrumVoice();
+  int timing = mini_acid_.stepDrumTiming(voice, step) + delta;
+  withAudioGuard([&]() { mini_acid_.setDrumStepTiming(voice, step, timing); });
+  return true;
+}
+
+bool DrumSequencerPage::adjustSwing(int delta) {
+  int voice = activeDrumVoice();
+  int swing = mini_acid_.drumSwing(voice) + delta;
+  withAudioGuard([&]() { mini_acid_.setDrumSwing(voice, swing); });
+  return true;
+}
+
 // --- event handling ---
 bool DrumSequencerPage::handleEvent(UIEvent& ui_event) {
   if (ui_event.event_type != MINIACID_KEY_DOWN) return false;
+  char lowerKey = static_cast<char>(std::tolower(static_cast<unsigned char>(ui_event.key)));
+  if (lowerKey == 'j') return undo();
+  if (lowerKey == 'm') return redo();
+  if (lowerKey == 'b') return shiftBank(-1);
+  if (lowerKey == 'g') return shiftBank(1);
+
+  mini_acid_.beginEdit();
+  bool handled = handleEditEvent(ui_event);
+  mini_acid_.endEdit();
+  return handled;
+}
+
+bool DrumSequencerPage::handleEditEvent(UIEvent& ui_event) {
+  if (ui_event.alt) {
+    switch (ui_event.scancode) {
+      case MINIACID_LEFT:  return nudgeStepTiming(-kTimingNudge);
+      case MINIACID_RIGHT: return nudgeStepTiming(kTimingNudge);
+      case MINIACID_UP:    return adjustSwing(kSwingNudge);
+      case MINIACID_DOWN:  return adjustSwing(-kSwingNudge);
+      default: break;
+    }
+  }
+
   bool handled = false;
   switch (ui_event.scancode) {
     case MINIACID_LEFT:  moveDrumCursor(-1); handled = true; break;
@@ -310,8 +324,8 @@ bool DrumSequencerPage::handleEvent(UIEvent& ui_event) {
   // V: rotate steps backward (left)
   // H: copy pattern
   // N: paste pattern
-  // J: undo
-  // M: redo
+  // J: undo (handleEvent)
+  // M: redo (handleEvent)
   // '\\': cut pattern
   // '\'': duplicate 0..7 -> 8..15
   char lowerKey = static_cast<char>(std::tolower(static_cast<unsigned char>(key)));
@@ -321,8 +335,6 @@ bool DrumSequencerPage::handleEvent(UIEvent& ui_event) {
   if (lowerKey == 'v') { rotateDrumSteps(-1); return true; }
   if (lowerKey == 'h') { copyCurrentDrumPatternToBuffer(); return true; }
   if (lowerKey == 'n') { pasteBufferToCurrentDrumPattern(); return true; }
-  if (lowerKey == 'j') { if (undo()) return true; }
-  if (lowerKey == 'm') { if (redo()) return true; }
   if (key == '\\')   { cutCurrentDrumPatternToBuffer(); return true; }
   if (key == '\'') { duplicateTopRowToBottomRow(); return true; }
 
@@ -364,9 +376,14 @@ void DrumSequencerPage::draw(IGfx& gfx, int x, int y, int w, int h) {
   int body_h = h - 2;
   if (body_h <= 0) return;
   int pattern_label_h = gfx.fontHeight();
+  char title[24];
+  std::snprintf(title, sizeof(title), "PATTERN  BANK %c", 'A' + mini_acid_.bankIndex(SongTrack::Drums));
   gfx.setTextColor(COLOR_LABEL);
-  gfx.drawText(x, body_y, "PATTERN");
+  gfx.drawText(x, body_y, title);
   gfx.setTextColor(COLOR_WHITE);
+  int timingVoice = activeDrumVoice();
+  drawTimingLabel(gfx, x + w, body_y, mini_acid_.drumSwing(timingVoice),
+                  patternRowFocused() ? 0 : mini_acid_.stepDrumTiming(timingVoice, activeDrumStep()));
   int spacing = 4;
   int pattern_size = (w - spacing * 7 - 2) / 8; if (pattern_size < 12) pattern_size = 12;
   int pattern_height = pattern_size / 2;
@@ -1,6 +1,5 @@
 #pragma once
 #include <functional>
-#include <vector>
 #include "../ui_core.h"
 #include "../ui_colors.h"
 #include "../ui_utils.h"
@@ -36,17 +35,21 @@ class DrumSequencerPage : public IPage {
   void rotateDrumSteps(int dir);            // dir = +1 forward (right), -1 backward (left)
   void duplicateTopRowToBottomRow();        // steps 0..7 -> 8..15 for all voices
 
-  // undo/redo
   struct DrumPatternState {
     bool hits[NUM_DRUM_VOICES][SEQ_STEPS];
   };
-  static constexpr int kMaxHistory = 64;
   void captureCurrentDrumPattern(DrumPatternState& out) const;
-  void applyDrumPatternState(const DrumPatternState& st);
-  void pushUndo();
-  void clearRedo();
+
+  // everything one key press changes undoes as one edit
+  bool handleEditEvent(UIEvent& ui_event);
   bool undo();
   bool redo();
+  // B/G: previous/next bank; switching clears the undo history
+  bool shiftBank(int delta);
+  // ALT+LEFT/RIGHT nudge the focused step, ALT+UP/DOWN change the swing
+  // of the voice under the cursor
+  bool nudgeStepTiming(int delta);
+  bool adjustSwing(int delta);
 
   IGfx& gfx_;
   MiniAcid& mini_acid_;
@@ -63,8 +66,4 @@ class DrumSequencerPage : public IPage {
     bool has_data = false;
     bool hits[NUM_DRUM_VOICES][SEQ_STEPS] = { {false} };
   } buffer_;
-
-  // undo/redo stacks
-  std::vector<DrumPatternState> undo_stack_;
-  std::vector<DrumPatternState> redo_stack_;
 };
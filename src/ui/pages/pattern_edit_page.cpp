@@ -219,7 +219,6 @@ void PatternEditPage::copyCurrentPatternToBuffer() {
 }
 
 void PatternEditPage::cutCurrentPatternToBuffer() {
-  pushUndo();
   copyCurrentPatternToBuffer();
   for (int i = 0; i < SEQ_STEPS; ++i) {
     int n = currentStepNote(i);
@@ -239,7 +238,6 @@ void PatternEditPage::cutCurrentPatternToBuffer() {
 
 void PatternEditPage::pasteBufferToCurrentPattern() {
   if (!buffer_.has_data) return;
-  pushUndo();
   const bool* accentCur = mini_acid_.pattern303AccentSteps(voice_index_);
   const bool* slideCur  = mini_acid_.pattern303SlideSteps(voice_index_);
   for (int i = 0; i < SEQ_STEPS; ++i) {
@@ -282,7 +280,6 @@ void PatternEditPage::pasteBufferToCurrentPattern() {
 
 void PatternEditPage::transposePatternSemitone(int delta) {
   if (delta == 0) return;
-  pushUndo();
   for (int i = 0; i < SEQ_STEPS; ++i) {
     int n = currentStepNote(i);
     if (n >= 0) {
@@ -299,8 +296,6 @@ void PatternEditPage::rotatePattern(int dir) {
   const bool* slide  = mini_acid_.pattern303SlideSteps(voice_index_);
   if (!notes || !accent || !slide) return;
 
-  pushUndo();
-
   int8_t nbuf[SEQ_STEPS];
   bool   abuf[SEQ_STEPS];
   bool   sbuf[SEQ_STEPS];
@@ -341,8 +336,6 @@ void PatternEditPage::duplicateTopRowToBottomRow() {
   const bool* slide  = mini_acid_.pattern303SlideSteps(voice_index_);
   if (!notes || !accent || !slide) return;
 
-  pushUndo();
-
   for (int i = 0; i < 8; ++i) {
     int dst = i + 8;
     int cur = currentStepNote(dst);
@@ -368,75 +361,67 @@ void PatternEditPage::duplicateTopRowToBottomRow() {
   }
 }
 
-// --- undo/redo helpers ---
-void PatternEditPage::captureCurrentPattern(PatternState& out) const {
-  const int8_t* notes = mini_acid_.pattern303Steps(voice_index_);
-  const bool* accent = mini_acid_.pattern303AccentSteps(voice_index_);
-  const bool* slide  = mini_acid_.pattern303SlideSteps(voice_index_);
-  if (!notes || !accent || !slide) return; // should not happen
-  std::memcpy(out.notes, notes, sizeof(out.notes));
-  std::memcpy(out.accent, accent, sizeof(out.accent));
-  std::memcpy(out.slide,  slide,  sizeof(out.slide));
-}
-
-void PatternEditPage::applyPatternState(const PatternState& st) {
-  const bool* accentCur = mini_acid_.pattern303AccentSteps(voice_index_);
-  const bool* slideCur  = mini_acid_.pattern303SlideSteps(voice_index_);
-  for (int i = 0; i < SEQ_STEPS; ++i) {
-    int cur = currentStepNote(i);
-    int tgt = st.notes[i];
-    if (tgt < 0) {
-      if (cur >= 0) withAudioGuard([&]() { mini_acid_.clear303StepNote(voice_index_, i); });
-    } else {
-      if (cur < 0) setEmptyStepToAbsoluteNote(i, tgt);
-      else {
-        int delta = tgt - cur;
-        if (delta != 0) withAudioGuard([&]() { mini_acid_.adjust303StepNote(voice_index_, i, delta); });
-        rememberLastNoteFromStep(i);
-      }
-    }
-    if (accentCur) { bool want = st.accent[i]; bool have = accentCur[i]; if (want != have) withAudioGuard([&]() { mini_acid_.toggle303AccentStep(voice_index_, i); }); }
-    if (slideCur)  { bool want = st.slide[i];  bool have = slideCur[i];  if (want != have) withAudioGuard([&]() { mini_acid_.toggle303SlideStep(voice_index_, i);  }); }
-  }
+// --- undo/redo ---
+bool PatternEditPage::undo() {
+  bool done = false;
+  withAudioGuard([&]() { done = mini_acid_.undoEdit(); });
+  return done;
 }
 
-void PatternEditPage::pushUndo() {
-  PatternState s{};
-  captureCurrentPattern(s);
-  undo_stack_.push_back(s);
-  if (undo_stack_.size() > static_cast<size_t>(kMaxHistory)) {
-    undo_stack_.erase(undo_stack_.begin());
-  }
-  clearRedo();
+bool PatternEditPage::redo() {
+  bool done = false;
+  withAudioGuard([&]() { done = mini_acid_.redoEdit(); });
+  return done;
 }
 
-void PatternEditPage::clearRedo() {
-  redo_stack_.clear();
+bool PatternEditPage::shiftBank(int delta) {
+  SongTrack track = voice_index_ == 0 ? SongTrack::SynthA : SongTrack::SynthB;
+  int bank = mini_acid_.bankIndex(track) + delta;
+  if (bank < 0 || bank >= SceneManager::kBankCount) return true;
+  if (mini_acid_.prepareBankSwitch(track, bank)) withAudioGuard([&]() { mini_acid_.publishBankSwitch(); });
+  return true;
 }
 
-bool PatternEditPage::undo() {
-  if (undo_stack_.empty()) return false;
-  PatternState cur{}; captureCurrentPattern(cur);
-  redo_stack_.push_back(cur);
-  PatternState prev = undo_stack_.back();
-  undo_stack_.pop_back();
-  applyPatternState(prev);
+bool PatternEditPage::nudgeStepTiming(int delta) {
+  ensureStepFocus();
+  int step = activePatternStep();
+  int timing = mini_acid_.step303Timing(voice_index_, step) + delta;
+  withAudioGuard([&]() { mini_acid_.set303StepTiming(voice_index_, step, timing); });
   return true;
 }
 
-bool PatternEditPage::redo() {
-  if (redo_stack_.empty()) return false;
-  PatternState cur{}; captureCurrentPattern(cur);
-  undo_stack_.push_back(cur);
-  PatternState next = redo_stack_.back();
-  redo_stack_.pop_back();
-  applyPatternState(next);
+bool PatternEditPage::adjustSwing(int delta) {
+  int swing = mini_acid_.swing303(voice_index_) + delta;
+  withAudioGuard([&]() { mini_acid_.set303Swing(voice_index_, swing); });
   return true;
 }
 
 bool PatternEditPage::handleEvent(UIEvent& ui_event) {
   if (ui_event.event_type != MINIACID_KEY_DOWN) return false;
 
+  char lowerKey = static_cast<char>(std::tolower(static_cast<unsigned char>(ui_event.key)));
+  if (lowerKey == 'j') return undo();
+  if (lowerKey == 'm') return redo();
+  if (lowerKey == 'b') return shiftBank(-1);
+  if (lowerKey == 'g') return shiftBank(1);
+
+  mini_acid_.beginEdit();
+  bool handled = handleEditEvent(ui_event);
+  mini_acid_.endEdit();
+  return handled;
+}
+
+bool PatternEditPage::handleEditEvent(UIEvent& ui_event) {
+  if (ui_event.alt) {
+    switch (ui_event.scancode) {
+      case MINIACID_LEFT: return nudgeStepTiming(-kTimingNudge);
+      case MINIACID_RIGHT: return nudgeStepTiming(kTimingNudge);
+      case MINIACID_UP: return adjustSwing(kSwingNudge);
+      case MINIACID_DOWN: return adjustSwing(-kSwingNudge);
+      default: break;
+    }
+  }
+
   bool handled = false;
   switch (ui_event.scancode) {
     case MINIACID_LEFT:
@@ -501,8 +486,6 @@ bool PatternEditPage::handleEvent(UIEvent& ui_event) {
   if (lowerKey == 'v') { rotatePattern(-1); return true; }
   if (lowerKey == 'h') { copyCurrentPatternToBuffer(); return true; }
   if (lowerKey == 'n') { pasteBufferToCurrentPattern(); return true; }
-  if (lowerKey == 'j') { if (undo()) return true; }
-  if (lowerKey == 'm') { if (redo()) return true; }
   if (key == '\'') { duplicateTopRowToBottomRow(); return true; }
   if (key == '\\') { cutCurrentPatternToBuffer(); return true; }
 
@@ -510,21 +493,18 @@ bool PatternEditPage::handleEvent(UIEvent& ui_event) {
   switch (lowerKey) {
     case 'q': { // slide toggle
       ensureStepFocusAndCursor();
-      pushUndo();
       int step = activePatternStep();
       withAudioGuard([&]() { mini_acid_.toggle303SlideStep(voice_index_, step); });
       return true;
     }
     case 'w': { // accent toggle
       ensureStepFocusAndCursor();
-      pushUndo();
       int step = activePatternStep();
       withAudioGuard([&]() { mini_acid_.toggle303AccentStep(voice_index_, step); });
       return true;
     }
     case 'a': { // note + (with last-note on empty)
       ensureStepFocusAndCursor();
-      pushUndo();
       int step = activePatternStep();
       int cur = currentStepNote(step);
       if (cur < 0) {
@@ -543,7 +523,6 @@ bool PatternEditPage::handleEvent(UIEvent& ui_event) {
     }
     case 'z': { // note - (with last-note on empty)
       ensureStepFocusAndCursor();
-      pushUndo();
       int step = activePatternStep();
       int cur = currentStepNote(step);
       if (cur < 0) {
@@ -560,7 +539,6 @@ bool PatternEditPage::handleEvent(UIEvent& ui_event) {
     }
     case 's': { // octave + (with last-note+octave on empty)
       ensureStepFocusAndCursor();
-      pushUndo();
       int step = activePatternStep();
       int cur = currentStepNote(step);
       if (cur < 0) {
@@ -579,7 +557,6 @@ bool PatternEditPage::handleEvent(UIEvent& ui_event) {
     }
     case 'x': { // octave - (with last-note-octave on empty)
       ensureStepFocusAndCursor();
-      pushUndo();
       int step = activePatternStep();
       int cur = currentStepNote(step);
       if (cur < 0) {
@@ -600,7 +577,6 @@ bool PatternEditPage::handleEvent(UIEvent& ui_event) {
 
   if (key == '\b') { // backspace = clear step
     ensureStepFocusAndCursor();
-    pushUndo();
     int step = activePatternStep();
     withAudioGuard([&]() { mini_acid_.clear303StepNote(voice_index_, step); });
     // keep last_entered_note_ unchanged
@@ -634,8 +610,13 @@ void PatternEditPage::draw(IGfx& gfx, int x, int y, int w, int h) {
   int pattern_label_h = gfx.fontHeight();
   int pattern_row_y = body_y + pattern_label_h + 1;
 
+  char title[24];
+  std::snprintf(title, sizeof(title), "PATTERNS  BANK %c",
+                'A' + mini_acid_.bankIndex(voice_index_ == 0 ? SongTrack::SynthA : SongTrack::SynthB));
   gfx.setTextColor(COLOR_LABEL);
-  gfx.drawText(x, body_y, "PATTERNS");
+  gfx.drawText(x, body_y, title);
+  drawTimingLabel(gfx, x + w, body_y, mini_acid_.swing303(voice_index_),
+                  stepFocus ? mini_acid_.step303Timing(voice_index_, activePatternStep()) : 0);
   gfx.setTextColor(COLOR_WHITE);
 
   for (int i = 0; i < Bank<SynthPattern>::kPatterns; ++i) {
@@ -1,6 +1,5 @@
 #pragma once
 #include <functional>
-#include <vector>
 #include "../ui_core.h"
 #include "../ui_colors.h"
 #include "../ui_utils.h"
@@ -53,19 +52,15 @@ class PatternEditPage : public IPage {
   void rotatePattern(int dir);            // dir = +1 forward, -1 backward
   void duplicateTopRowToBottomRow();
 
-  // --- undo/redo ---
-  struct PatternState {
-    int8_t notes[SEQ_STEPS];
-    bool accent[SEQ_STEPS];
-    bool slide[SEQ_STEPS];
-  };
-  static constexpr int kMaxHistory = 64;
-  void captureCurrentPattern(PatternState& out) const;
-  void applyPatternState(const PatternState& st);
-  void pushUndo();
-  void clearRedo();
+  // everything one key press changes undoes as one edit
+  bool handleEditEvent(UIEvent& ui_event);
   bool undo();
   bool redo();
+  // B/G: previous/next bank; switching clears the undo history
+  bool shiftBank(int delta);
+  // ALT+LEFT/RIGHT nudge the focused step, ALT+UP/DOWN change the swing
+  bool nudgeStepTiming(int delta);
+  bool adjustSwing(int delta);
 
   IGfx& gfx_;
   MiniAcid& mini_acid_;
@@ -87,8 +82,4 @@ class PatternEditPage : public IPage {
     bool accent[SEQ_STEPS] = {false};
     bool slide[SEQ_STEPS] = {false};
   } buffer_;
-
-  // undo/redo stacks
-  std::vector<PatternState> undo_stack_;
-  std::vector<PatternState> redo_stack_;
 };
@@ -73,6 +73,7 @@ void ProjectPage::openLoadDialog() {
     }
   }
   scroll_offset_ = selection_index_;
+  prefetchScene(selection_index_);
 }
 
 void ProjectPage::openSaveDialog() {
@@ -102,6 +103,12 @@ void ProjectPage::moveSelection(int delta) {
   if (selection_index_ < 0) selection_index_ = 0;
   int maxIdx = static_cast<int>(scenes_.size()) - 1;
   if (selection_index_ > maxIdx) selection_index_ = maxIdx;
+  prefetchScene(selection_index_);
+}
+
+void ProjectPage::prefetchScene(int index) {
+  if (index < 0 || index >= static_cast<int>(scenes_.size())) return;
+  mini_acid_.prefetchScene(scenes_[index]);
 }
 
 void ProjectPage::ensureSelectionVisible(int visibleRows) {
@@ -127,12 +134,16 @@ void ProjectPage::ensureSelectionVisible(int visibleRows) {
 bool ProjectPage::loadSceneAtSelection() {
   if (scenes_.empty()) return true;
   if (selection_index_ < 0 || selection_index_ >= static_cast<int>(scenes_.size())) return true;
-  bool loaded = false;
   std::string name = scenes_[selection_index_];
-  withAudioGuard([&]() {
-    loaded = mini_acid_.loadSceneByName(name);
-  });
-  if (loaded) closeDialog();
+  // reading the scene may wait for the card, so only handing it over holds
+  // the audio guard
+  bool loaded = mini_acid_.loadSceneByName(name);
+  if (loaded) withAudioGuard([&]() { mini_acid_.publishSceneSwitch(); });
+  if (loaded) {
+    closeDialog();
+    // the scene list doubles as the set list: have the next one ready
+    prefetchScene((selection_index_ + 1) % static_cast<int>(scenes_.size()));
+  }
   return true;
 }
 
@@ -142,11 +153,9 @@ void ProjectPage::randomizeSaveName() {
 
 bool ProjectPage::saveCurrentScene() {
   if (save_name_.empty()) randomizeSaveName();
-  bool saved = false;
   std::string name = save_name_;
-  withAudioGuard([&]() {
-    saved = mini_acid_.saveSceneAs(name);
-  });
+  bool saved = mini_acid_.saveSceneAs(name);
+  if (saved) withAudioGuard([&]() { mini_acid_.publishSceneSwitch(); });
   if (saved) {
     closeDialog();
     refreshScenes();
@@ -156,17 +165,24 @@ bool ProjectPage::saveCurrentScene() {
 
 bool ProjectPage::createNewScene() {
   randomizeSaveName();
-  bool created = false;
   std::string name = save_name_;
-  withAudioGuard([&]() {
-    created = mini_acid_.createNewSceneWithName(name);
-  });
+  bool created = mini_acid_.createNewSceneWithName(name);
+  if (created) withAudioGuard([&]() { mini_acid_.publishSceneSwitch(); });
   if (created) {
     refreshScenes();
   }
   return true;
 }
 
+bool ProjectPage::exportCurrentScene() {
+  bool exported = false;
+  withAudioGuard([&]() {
+    exported = mini_acid_.exportSceneJson();
+  });
+  if (exported) refreshScenes();
+  return true;
+}
+
 bool ProjectPage::handleSaveDialogInput(char key) {
   if (key == '\b') {
     if (!save_name_.empty()) save_name_.pop_back();
@@ -308,6 +324,9 @@ bool ProjectPage::handleEvent(UIEvent& ui_event) {
       return createNewScene();
     }
   }
+  if (key == 'j' || key == 'J') {
+    return exportCurrentScene();
+  }
   return false;
 }
 
@@ -340,6 +359,7 @@ void ProjectPage::draw(IGfx& gfx, int x, int y, int w, int h) {
 
   int line_h = gfx.fontHeight();
   std::string currentName = mini_acid_.currentSceneName();
+  if (mini_acid_.sceneSwitchPending()) currentName += " (next bar)";
   gfx.setTextColor(COLOR_LABEL);
   gfx.drawText(x, body_y, "Current Scene");
   gfx.setTextColor(COLOR_WHITE);
@@ -365,6 +385,7 @@ void ProjectPage::draw(IGfx& gfx, int x, int y, int w, int h) {
 
   gfx.setTextColor(COLOR_LABEL);
   gfx.drawText(x, btn_y + btn_h + 6, "Enter to act, arrows to move focus");
+  gfx.drawText(x, btn_y + btn_h + 6 + line_h + 2, "J to export the scene as JSON");
   gfx.setTextColor(COLOR_WHITE);
 
   if (dialog_type_ == DialogType::None) return;
@@ -25,11 +25,13 @@ class ProjectPage : public IPage{
   void openSaveDialog();
   void closeDialog();
   void moveSelection(int delta);
+  void prefetchScene(int index);
   bool loadSceneAtSelection();
   void ensureSelectionVisible(int visibleRows);
   void randomizeSaveName();
   bool saveCurrentScene();
   bool createNewScene();
+  bool exportCurrentScene();
   bool handleSaveDialogInput(char key);
   void withAudioGuard(const std::function<void()>& fn);
 
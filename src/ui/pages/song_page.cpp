@@ -107,9 +107,8 @@ bool SongPage::adjustSongPatternAtCursor(int delta) {
   if (!trackValid) return false;
   int row = cursorRow();
   int current = mini_acid_.songPatternAt(row, track);
-  int maxPattern = track == SongTrack::Drums
-                     ? Bank<DrumPatternSet>::kPatterns - 1
-                     : Bank<SynthPattern>::kPatterns - 1;
+  // steps through every bank's patterns, A1..A8 then B1..
+  int maxPattern = SceneManager::kSongPatternCount - 1;
   int next = current;
   if (delta > 0) next = current < 0 ? 0 : current + 1;
   else if (delta < 0) next = current < 0 ? -1 : current - 1;
@@ -147,8 +146,10 @@ bool SongPage::assignPattern(int patternIdx) {
   SongTrack track = trackForColumn(cursorTrack(), trackValid);
   if (!trackValid || cursorOnModeButton()) return false;
   int row = cursorRow();
+  // the pattern keys pick from the bank that track is editing
+  int cell = SceneManager::songCell(mini_acid_.bankIndex(track), patternIdx);
   withAudioGuard([&]() {
-    mini_acid_.setSongPattern(row, track, patternIdx);
+    mini_acid_.setSongPattern(row, track, cell);
     if (mini_acid_.songModeEnabled() && !mini_acid_.isPlaying()) {
       mini_acid_.setSongPosition(row);
     }
@@ -175,6 +176,31 @@ bool SongPage::toggleSongMode() {
   return true;
 }
 
+bool SongPage::seekToCursor() {
+  int row = cursorRow();
+  withAudioGuard([&]() {
+    if (mini_acid_.isPlaying() && mini_acid_.songModeEnabled()) mini_acid_.seekSong(row);
+    else mini_acid_.setSongPosition(row);
+  });
+  return true;
+}
+
+bool SongPage::setLoopEdge(bool start) {
+  int row = cursorRow();
+  int other = row;
+  if (mini_acid_.songLoopEnabled()) other = start ? mini_acid_.songLoopEnd() : mini_acid_.songLoopStart();
+  withAudioGuard([&]() {
+    if (start) mini_acid_.setSongLoop(row, other);
+    else mini_acid_.setSongLoop(other, row);
+  });
+  return true;
+}
+
+bool SongPage::clearLoop() {
+  withAudioGuard([&]() { mini_acid_.clearSongLoop(); });
+  return true;
+}
+
 void SongPage::setScrollToPlayhead(int playhead) {
   if (playhead < 0) playhead = 0;
   int rowHeight = gfx_.fontHeight() + 6;
@@ -231,6 +257,13 @@ bool SongPage::handleEvent(UIEvent& ui_event) {
     return toggleSongMode();
   }
 
+  if (key == '\n' || key == '\r') return seekToCursor();
+
+  char lowerKey = static_cast<char>(std::tolower(static_cast<unsigned char>(key)));
+  if (lowerKey == 'a') return setLoopEdge(true);
+  if (lowerKey == 's') return setLoopEdge(false);
+  if (lowerKey == 'z') return clearLoop();
+
   int patternIdx = patternIndexFromKey(key);
   if (cursorOnModeButton() && patternIdx >= 0) return false;
   if (patternIdx >= 0) return assignPattern(patternIdx);
@@ -300,6 +333,9 @@ void SongPage::draw(IGfx& gfx, int x, int y, int w, int h) {
   if (visible_rows < 1) visible_rows = 1;
 
   int song_len = mini_acid_.songLength();
+  bool looping = mini_acid_.songLoopEnabled();
+  int loopStart = mini_acid_.songLoopStart();
+  int loopEnd = mini_acid_.songLoopEnd();
   int cursor_row = cursorRow();
   int playhead = mini_acid_.songPlayheadPosition();
   bool playingSong = mini_acid_.isPlaying() && mini_acid_.songModeEnabled();
@@ -374,7 +410,9 @@ void SongPage::draw(IGfx& gfx, int x, int y, int w, int h) {
 
     char posLabel[8];
     snprintf(posLabel, sizeof(posLabel), "%d", row_idx + 1);
-    gfx.setTextColor(row_idx < song_len ? COLOR_WHITE : COLOR_LABEL);
+    bool inLoop = looping && row_idx >= loopStart && row_idx <= loopEnd;
+    if (inLoop) gfx.fillRect(x + pos_col_w - 3, row_y - 1, 2, row_h, IGfxColor::Yellow());
+    gfx.setTextColor(inLoop ? IGfxColor::Yellow() : (row_idx < song_len ? COLOR_WHITE : COLOR_LABEL));
     gfx.drawText(x, row_y + 2, posLabel);
     gfx.setTextColor(COLOR_WHITE);
 
@@ -391,7 +429,8 @@ void SongPage::draw(IGfx& gfx, int x, int y, int w, int h) {
         snprintf(label, sizeof(label), "--");
         gfx.setTextColor(COLOR_LABEL);
       } else {
-        snprintf(label, sizeof(label), "%d", patternIdx + 1);
+        snprintf(label, sizeof(label), "%c%d", 'A' + SceneManager::songCellBank(patternIdx),
+                 SceneManager::songCellPattern(patternIdx) + 1);
         gfx.setTextColor(COLOR_WHITE);
       }
       int tw = textWidth(gfx, label);
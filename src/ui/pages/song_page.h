@@ -32,6 +32,11 @@ class SongPage : public IPage{
   bool assignPattern(int patternIdx);
   bool clearPattern();
   bool toggleSongMode();
+  // ENTER on a row while the song plays jumps there at once
+  bool seekToCursor();
+  // A / S set the loop start / end at the cursor row, Z clears it
+  bool setLoopEdge(bool start);
+  bool clearLoop();
 
   IGfx& gfx_;
   MiniAcid& mini_acid_;
@@ -100,6 +100,16 @@ void Synth303ParamsPage::adjustFocusedElement(int direction) {
       }
       break;
     }
+    case FocusTarget::ReverbSend:
+      withAudioGuard([&]() {
+        mini_acid_.adjustParameter(MiniAcidParamId::ReverbSend, steps * direction);
+      });
+      break;
+    case FocusTarget::ReverbDecay:
+      withAudioGuard([&]() {
+        mini_acid_.adjustParameter(MiniAcidParamId::ReverbDecay, 4 * direction);
+      });
+      break;
   }
 }
 
@@ -187,6 +197,27 @@ void Synth303ParamsPage::draw(IGfx& gfx, int x, int y, int w, int h)
   gfx_.setTextColor(IGfxColor::Cyan());
   gfx_.drawText(delayValueX, oscSwitchesY, buf);
 
+  // the reverb is a mix-bus send shared by both voices; grey while its
+  // tail has died away and it bypasses itself
+  MiniAcidStats stats;
+  withAudioGuard([&]() { stats = mini_acid_.stats(); });
+  const Parameter& pSend = mini_acid_.miniParameter(MiniAcidParamId::ReverbSend);
+  const Parameter& pDecay = mini_acid_.miniParameter(MiniAcidParamId::ReverbDecay);
+  IGfxColor reverbColor = stats.reverbActive ? IGfxColor::Cyan() : COLOR_LABEL;
+  gfx_.setTextColor(COLOR_WHITE);
+  int reverbLabelX = delayValueX + textWidth(gfx_, "off") + 14;
+  gfx_.drawText(reverbLabelX, oscSwitchesY, "RVB:");
+  int reverbLabelW = textWidth(gfx_, "RVB:");
+  int reverbValueX = reverbLabelX + reverbLabelW + 3;
+  snprintf(buf, sizeof(buf), "%d", static_cast<int>(pSend.value() * 100.0f + 0.5f));
+  int reverbValueW = textWidth(gfx_, buf);
+  gfx_.setTextColor(reverbColor);
+  gfx_.drawText(reverbValueX, oscSwitchesY, buf);
+  int decayX = reverbValueX + textWidth(gfx_, "100") + 6;
+  snprintf(buf, sizeof(buf), "%.1fs", pDecay.value());
+  int decayW = textWidth(gfx_, buf);
+  gfx_.drawText(decayX, oscSwitchesY, buf);
+
   gfx_.setTextColor(COLOR_WHITE);
 
   int focusPadding = 3;
@@ -215,6 +246,12 @@ void Synth303ParamsPage::draw(IGfx& gfx, int x, int y, int w, int h)
   focus_elements_.setRect(static_cast<size_t>(FocusTarget::Delay),
                           delayLabelX, oscSwitchesY,
                           delayFocusW, delayFocusH);
+  focus_elements_.setRect(static_cast<size_t>(FocusTarget::ReverbSend),
+                          reverbLabelX, oscSwitchesY,
+                          reverbLabelW + 3 + reverbValueW, gfx_.fontHeight());
+  focus_elements_.setRect(static_cast<size_t>(FocusTarget::ReverbDecay),
+                          decayX, oscSwitchesY,
+                          decayW, gfx_.fontHeight());
 
   focus_elements_.drawFocus(gfx_, kFocusColor, focusPadding);
 }
@@ -356,6 +393,18 @@ bool Synth303ParamsPage::handleEvent(UIEvent& ui_event)
         mini_acid_.toggleDelay303(voice_index_);
       });
       break;
+    case 'h':
+      withAudioGuard([&]() {
+        mini_acid_.adjustParameter(MiniAcidParamId::ReverbSend, steps);
+      });
+      event_handled = true;
+      break;
+    case 'n':
+      withAudioGuard([&]() {
+        mini_acid_.adjustParameter(MiniAcidParamId::ReverbSend, -steps);
+      });
+      event_handled = true;
+      break;
     default:
       break;
   }
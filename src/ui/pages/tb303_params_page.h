@@ -23,6 +23,8 @@ class Synth303ParamsPage : public IPage {
     EnvDecay,
     Oscillator,
     Delay,
+    ReverbSend,
+    ReverbDecay,
   };
 
   void withAudioGuard(const std::function<void()>& fn);
@@ -32,7 +34,7 @@ class Synth303ParamsPage : public IPage {
   MiniAcid& mini_acid_;
   AudioGuard& audio_guard_;
   int voice_index_;
-  FocusableElements<6> focus_elements_;
+  FocusableElements<8> focus_elements_;
   int help_page_index_ = 0;
   int total_help_pages_ = 1;
   std::string title_;
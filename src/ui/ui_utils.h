@@ -6,6 +6,7 @@
 #include <string>
 
 #include "display.h"
+#include "ui_colors.h"
 
 inline int textWidth(IGfx& gfx, const char* s) {
   if (!s) return 0;
@@ -40,3 +41,20 @@ inline void formatNoteName(int note, char* buf, size_t bufSize) {
   snprintf(buf, bufSize, "%s%d", name, octave);
 }
 
+
+// ALT+arrow steps on the pattern pages, in percent of a step
+inline constexpr int kTimingNudge = 5;
+inline constexpr int kSwingNudge = 5;
+
+// "SW20 T+10" right-aligned at 'right': a track's swing and the focused
+// step's microtiming, each left out while it is zero.
+inline void drawTimingLabel(IGfx& gfx, int right, int y, int swing, int timing) {
+  char buf[32];
+  int used = 0;
+  if (swing != 0) used = snprintf(buf, sizeof(buf), "SW%d", swing);
+  if (timing != 0) snprintf(buf + used, sizeof(buf) - used, "%sT%+d", used ? " " : "", timing);
+  else if (used == 0) return;
+  gfx.setTextColor(COLOR_LABEL);
+  gfx.drawText(right - textWidth(gfx, buf), y, buf);
+  gfx.setTextColor(COLOR_WHITE);
+}